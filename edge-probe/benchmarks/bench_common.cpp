@@ -0,0 +1,205 @@
+#include "bench_common.h"
+
+#include "edge_probe/collectors.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+
+std::atomic<std::uint64_t> g_allocation_count {0};
+std::atomic<std::uint64_t> g_allocated_bytes {0};
+
+void append_metrics(std::vector<edge_probe::MetricSample> &target,
+                    std::vector<edge_probe::MetricSample> source)
+{
+    for (auto &sample : source)
+    {
+        target.push_back(std::move(sample));
+    }
+}
+
+}  // namespace
+
+void *operator new(std::size_t size)
+{
+    g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace edge_probe_bench
+{
+
+std::uint64_t allocation_count()
+{
+    return g_allocation_count.load(std::memory_order_relaxed);
+}
+
+std::uint64_t allocated_bytes()
+{
+    return g_allocated_bytes.load(std::memory_order_relaxed);
+}
+
+const std::vector<std::string> &fixture_lines()
+{
+    static const std::vector<std::string> lines = [] {
+        std::ifstream input(std::string(EDGE_PROBE_SOURCE_DIR) + "/cmd.txt");
+        if (!input)
+        {
+            throw std::runtime_error("failed to open cmd.txt");
+        }
+
+        std::vector<std::string> loaded;
+        std::string line;
+        while (std::getline(input, line))
+        {
+            loaded.push_back(line);
+        }
+        return loaded;
+    }();
+    return lines;
+}
+
+std::string slice_lines(int first_line, int last_line)
+{
+    const auto &lines = fixture_lines();
+    if (first_line < 1 || last_line < first_line ||
+        static_cast<std::size_t>(last_line) > lines.size())
+    {
+        throw std::out_of_range("slice_lines range is invalid");
+    }
+
+    std::string output;
+    for (int i = first_line; i <= last_line; ++i)
+    {
+        output += lines[static_cast<std::size_t>(i - 1)];
+        if (i != last_line)
+        {
+            output.push_back('\n');
+        }
+    }
+    return output;
+}
+
+std::vector<edge_probe::MetricSample> collect_fixture_metrics()
+{
+    using namespace edge_probe;
+
+    std::vector<MetricSample> metrics;
+    append_metrics(metrics,
+                   parse_system_identity(slice_lines(6, 6),
+                                         slice_lines(7, 15),
+                                         slice_lines(16, 16),
+                                         slice_lines(17, 18)));
+    append_metrics(metrics, parse_ip_br_link(slice_lines(27, 31)));
+    append_metrics(metrics, parse_ip_br_addr(slice_lines(32, 36)));
+    append_metrics(metrics, parse_ip_route(slice_lines(37, 41)));
+    append_metrics(metrics, parse_iw_dev(slice_lines(52, 58)));
+    append_metrics(metrics, parse_iw_phy(slice_lines(59, 295)));
+    append_metrics(metrics, parse_service_list_units(slice_lines(311, 313)));
+    append_metrics(metrics, parse_systemd_status("hostapd", slice_lines(314, 331)));
+    append_metrics(metrics, parse_systemd_status("dnsmasq", slice_lines(332, 346)));
+    append_metrics(metrics, parse_systemd_status("NetworkManager", slice_lines(347, 368)));
+    append_metrics(metrics, parse_command_path("hostapd_cli", slice_lines(369, 369)));
+    append_metrics(metrics, parse_command_path("nmcli", slice_lines(370, 370)));
+    append_metrics(metrics, parse_dnsmasq_leases(slice_lines(377, 377)));
+    append_metrics(metrics, parse_mmcli_snapshot("", "", ""));
+    append_metrics(metrics, parse_nmcli_device_status(slice_lines(386, 390)));
+    append_metrics(metrics, parse_device_node_listing(slice_lines(398, 398), ""));
+    append_metrics(metrics, parse_loadavg(slice_lines(405, 405)));
+    append_metrics(metrics, parse_meminfo(slice_lines(406, 425)));
+    append_metrics(metrics, parse_proc_net_dev(slice_lines(426, 432)));
+    append_metrics(metrics, parse_thermal_zone_temp(slice_lines(433, 433), "thermal_zone0"));
+    append_metrics(metrics, parse_command_path("iptables", slice_lines(484, 484)));
+    append_metrics(metrics, parse_iptables(slice_lines(485, 553)));
+    append_metrics(metrics, parse_command_path("nft", slice_lines(554, 554)));
+    append_metrics(metrics, parse_nft_ruleset(slice_lines(555, 691)));
+    append_metrics(metrics, parse_command_path("conntrack", ""));
+    append_metrics(metrics, parse_ip_neigh(slice_lines(698, 699)));
+
+    int64_t timestamp_ms = 1700000000000LL;
+    for (auto &sample : metrics)
+    {
+        sample.labels.emplace("device", "busstop-001");
+        sample.timestamp_ms = timestamp_ms++;
+    }
+    return metrics;
+}
+
+std::string legacy_json_escape(const std::string &value)
+{
+    std::ostringstream output;
+    for (const unsigned char ch : value)
+    {
+        switch (ch)
+        {
+            case '"':
+                output << "\\\"";
+                break;
+            case '\\':
+                output << "\\\\";
+                break;
+            case '\b':
+                output << "\\b";
+                break;
+            case '\f':
+                output << "\\f";
+                break;
+            case '\n':
+                output << "\\n";
+                break;
+            case '\r':
+                output << "\\r";
+                break;
+            case '\t':
+                output << "\\t";
+                break;
+            default:
+                if (ch < 0x20)
+                {
+                    output << "\\u00" << std::hex << std::nouppercase
+                           << static_cast<int>((ch >> 4) & 0x0F)
+                           << static_cast<int>(ch & 0x0F) << std::dec;
+                }
+                else
+                {
+                    output << static_cast<char>(ch);
+                }
+                break;
+        }
+    }
+    return output.str();
+}
+
+void print_row(const std::string &name, const std::string &metric, double value)
+{
+    char formatted[64];
+    std::snprintf(formatted, sizeof(formatted), "%.2f", value);
+    std::cout << name << ' ' << metric << '=' << formatted << '\n';
+}
+
+}  // namespace edge_probe_bench
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "edge_probe/telemetry_sender.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace edge_probe_bench
+{
+
+struct BenchmarkCase
+{
+    std::string name;
+    std::function<void()> run;
+};
+
+struct Measurement
+{
+    double ns_per_iteration {0.0};
+    double allocations_per_iteration {0.0};
+};
+
+// Accepts every post without doing any I/O.
+class NullTransport final : public edge_probe::HttpTransport
+{
+public:
+    Result post_json_lines(const edge_probe::TelemetryConfig &, const std::string &) override
+    {
+        Result result;
+        result.ok = true;
+        result.http_code = 204;
+        return result;
+    }
+};
+
+std::uint64_t allocation_count();
+// Total bytes requested from operator new so far; never decreases.
+std::uint64_t allocated_bytes();
+
+const std::vector<std::string> &fixture_lines();
+std::string slice_lines(int first_line, int last_line);
+std::vector<edge_probe::MetricSample> collect_fixture_metrics();
+
+std::string legacy_json_escape(const std::string &value);
+void print_row(const std::string &name, const std::string &metric, double value);
+
+template <typename Fn>
+Measurement measure(std::size_t iterations, Fn &&fn)
+{
+    fn();
+
+    const std::uint64_t allocations_before = allocation_count();
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i)
+    {
+        fn();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const std::uint64_t allocations = allocation_count() - allocations_before;
+
+    Measurement measurement;
+    measurement.ns_per_iteration =
+        static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+        static_cast<double>(iterations);
+    measurement.allocations_per_iteration =
+        static_cast<double>(allocations) / static_cast<double>(iterations);
+    return measurement;
+}
+
+std::vector<BenchmarkCase> collector_benchmarks();
+std::vector<BenchmarkCase> compression_benchmarks();
+std::vector<BenchmarkCase> encoder_benchmarks();
+std::vector<BenchmarkCase> json_escape_benchmarks();
+std::vector<BenchmarkCase> series_registry_benchmarks();
+std::vector<BenchmarkCase> transport_benchmarks();
+std::vector<BenchmarkCase> writer_benchmarks();
+
+}  // namespace edge_probe_bench
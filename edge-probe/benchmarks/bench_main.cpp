@@ -0,0 +1,48 @@
+#include "bench_common.h"
+
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    const std::string filter = argc > 1 ? argv[1] : "";
+
+    std::vector<edge_probe_bench::BenchmarkCase> cases;
+    for (auto group : {edge_probe_bench::encoder_benchmarks,
+                       edge_probe_bench::json_escape_benchmarks,
+                       edge_probe_bench::compression_benchmarks,
+                       edge_probe_bench::series_registry_benchmarks,
+                       edge_probe_bench::collector_benchmarks,
+                       edge_probe_bench::writer_benchmarks,
+                       edge_probe_bench::transport_benchmarks})
+    {
+        for (auto &benchmark : group())
+        {
+            cases.push_back(std::move(benchmark));
+        }
+    }
+
+    int failures = 0;
+    for (const auto &benchmark : cases)
+    {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        try
+        {
+            benchmark.run();
+        }
+        catch (const std::exception &ex)
+        {
+            ++failures;
+            std::cerr << "benchmark " << benchmark.name << " threw exception: " << ex.what()
+                      << '\n';
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
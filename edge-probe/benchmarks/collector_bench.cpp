@@ -0,0 +1,339 @@
+#include "bench_common.h"
+
+#include "edge_probe/collectors.h"
+#include "edge_probe/nl80211_collector.h"
+#include "edge_probe/rtnetlink_collector.h"
+#include "edge_probe/system_health_reader.h"
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace edge_probe_bench
+{
+
+namespace
+{
+
+// One fixture collection cycle: parse every cmd.txt section into samples and
+// tag them with the device label, as the fixture sender does.
+void run_collection_cycle_benchmark()
+{
+    const std::string name = "collectors/cycle";
+    const double sample_count = static_cast<double>(collect_fixture_metrics().size());
+    print_row(name, "samples", sample_count);
+    print_row(name, "metric_sample_bytes", static_cast<double>(sizeof(edge_probe::MetricSample)));
+
+    constexpr std::size_t iterations = 200;
+    const auto cycle = measure(iterations, [] {
+        const auto metrics = collect_fixture_metrics();
+        if (metrics.empty())
+        {
+            throw std::runtime_error("fixture produced no samples");
+        }
+    });
+    print_row(name, "ns_per_cycle", cycle.ns_per_iteration);
+    print_row(name, "allocs_per_cycle", cycle.allocations_per_iteration);
+    print_row(name, "allocs_per_sample", cycle.allocations_per_iteration / sample_count);
+
+    const auto metrics = collect_fixture_metrics();
+    const auto copy = measure(iterations, [&metrics] {
+        const std::vector<edge_probe::MetricSample> copied(metrics);
+        if (copied.size() != metrics.size())
+        {
+            throw std::runtime_error("copy lost samples");
+        }
+    });
+    print_row(name, "copy_allocs_per_sample", copy.allocations_per_iteration / sample_count);
+}
+
+struct ParserCase
+{
+    std::string parser;
+    std::function<std::vector<edge_probe::MetricSample>()> parse;
+};
+
+// Each text parser on its own cmd.txt section, so a regression in one parser
+// is not hidden by the rest of the cycle.
+void run_parser_benchmark()
+{
+    using namespace edge_probe;
+    const std::string name = "collectors/parsers";
+    const std::string uname = slice_lines(6, 6);
+    const std::string os_release = slice_lines(7, 15);
+    const std::string pid1 = slice_lines(16, 16);
+    const std::string systemctl_version = slice_lines(17, 18);
+    const std::string br_link = slice_lines(27, 31);
+    const std::string route = slice_lines(37, 41);
+    const std::string iw_dev = slice_lines(52, 58);
+    const std::string iw_phy = slice_lines(59, 295);
+    const std::string hostapd = slice_lines(314, 331);
+    const std::string network_manager = slice_lines(347, 368);
+    const std::string nmcli = slice_lines(386, 390);
+    const std::string device_nodes = slice_lines(398, 398);
+    const std::string loadavg = slice_lines(405, 405);
+    const std::string meminfo = slice_lines(406, 425);
+    const std::string net_dev = slice_lines(426, 432);
+    const std::string iptables = slice_lines(485, 553);
+    const std::string nft = slice_lines(555, 691);
+
+    const std::vector<ParserCase> cases = {
+        {"system_identity",
+         [&] { return parse_system_identity(uname, os_release, pid1, systemctl_version); }},
+        {"ip_br_link", [&] { return parse_ip_br_link(br_link); }},
+        {"ip_route", [&] { return parse_ip_route(route); }},
+        {"iw_dev", [&] { return parse_iw_dev(iw_dev); }},
+        {"iw_phy", [&] { return parse_iw_phy(iw_phy); }},
+        {"systemd_status_hostapd", [&] { return parse_systemd_status("hostapd", hostapd); }},
+        {"systemd_status_nm",
+         [&] { return parse_systemd_status("NetworkManager", network_manager); }},
+        {"nmcli_device_status", [&] { return parse_nmcli_device_status(nmcli); }},
+        {"device_node_listing", [&] { return parse_device_node_listing(device_nodes, ""); }},
+        {"loadavg", [&] { return parse_loadavg(loadavg); }},
+        {"meminfo", [&] { return parse_meminfo(meminfo); }},
+        {"proc_net_dev", [&] { return parse_proc_net_dev(net_dev); }},
+        {"iptables", [&] { return parse_iptables(iptables); }},
+        {"nft_ruleset", [&] { return parse_nft_ruleset(nft); }},
+    };
+
+    constexpr std::size_t iterations = 500;
+    for (const auto &parser : cases)
+    {
+        const auto result = measure(iterations, [&parser] {
+            if (parser.parse().empty())
+            {
+                throw std::runtime_error(parser.parser + " produced no samples");
+            }
+        });
+        print_row(name, parser.parser + "_ns_per_call", result.ns_per_iteration);
+        print_row(name, parser.parser + "_allocs_per_call", result.allocations_per_iteration);
+    }
+}
+
+std::string run_shell(const std::string &command)
+{
+    FILE *pipe = ::popen(command.c_str(), "r");
+    if (pipe == nullptr)
+    {
+        throw std::runtime_error("popen failed: " + command);
+    }
+    std::string output;
+    char buffer[4096];
+    std::size_t n = 0;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+    {
+        output.append(buffer, n);
+    }
+    ::pclose(pipe);
+    return output;
+}
+
+// CPU time of this process and its reaped children, so the shell path is
+// charged for the sh and cat it forks.
+double cpu_ns_with_children()
+{
+    double total = 0.0;
+    for (const int who : {RUSAGE_SELF, RUSAGE_CHILDREN})
+    {
+        rusage usage {};
+        ::getrusage(who, &usage);
+        total += (static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 +
+                  static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec)) *
+                 1000.0;
+    }
+    return total;
+}
+
+// One live system_health cycle on this host: the command plan's cat pipelines
+// through popen, against SystemHealthReader's kept-open files. The reader also
+// covers every thermal zone and hwmon input, so it may emit more samples.
+void run_system_health_benchmark()
+{
+    using namespace edge_probe;
+    const std::string name = "collectors/system_health";
+    std::vector<std::string> commands;
+    for (const auto &spec : default_command_plan())
+    {
+        if (spec.id == "system_health")
+        {
+            commands = spec.commands;
+        }
+    }
+    if (commands.size() != 4)
+    {
+        throw std::runtime_error("unexpected system_health command plan");
+    }
+
+    std::vector<MetricSample> metrics;
+    const auto shell_cycle = [&commands, &metrics] {
+        metrics = parse_loadavg(run_shell(commands[0]));
+        for (auto &sample : parse_meminfo(run_shell(commands[1])))
+        {
+            metrics.push_back(std::move(sample));
+        }
+        for (auto &sample : parse_proc_net_dev(run_shell(commands[2])))
+        {
+            metrics.push_back(std::move(sample));
+        }
+        for (auto &sample : parse_thermal_zone_temp(run_shell(commands[3]), "thermal_zone0"))
+        {
+            metrics.push_back(std::move(sample));
+        }
+    };
+    SystemHealthReader reader;
+    const auto native_cycle = [&reader, &metrics] {
+        metrics.clear();
+        reader.collect(metrics);
+    };
+
+    shell_cycle();
+    print_row(name, "shell_samples", static_cast<double>(metrics.size()));
+    native_cycle();
+    print_row(name, "native_samples", static_cast<double>(metrics.size()));
+    print_row(name, "native_open_files", static_cast<double>(reader.open_files()));
+    print_row(name, "native_thermal_zones", static_cast<double>(reader.thermal_zones()));
+    print_row(name, "native_hwmon_sensors", static_cast<double>(reader.hwmon_sensors()));
+
+    const struct
+    {
+        std::string path;
+        std::size_t iterations;
+        std::function<void()> cycle;
+    } paths[] = {{"shell", 20, shell_cycle}, {"native", 2000, native_cycle}};
+    for (const auto &path : paths)
+    {
+        const double cpu_before = cpu_ns_with_children();
+        const auto result = measure(path.iterations, path.cycle);
+        const double cpu_ns = (cpu_ns_with_children() - cpu_before) /
+                              static_cast<double>(path.iterations + 1);
+        print_row(name, path.path + "_ns_per_cycle", result.ns_per_iteration);
+        print_row(name, path.path + "_cpu_ns_per_cycle", cpu_ns);
+        print_row(name, path.path + "_allocs_per_cycle", result.allocations_per_iteration);
+    }
+}
+
+// The network_links and neighbors command groups plus /proc/net/dev through
+// popen, against RtnetlinkCollector's four dumps on one socket.
+void run_rtnetlink_benchmark()
+{
+    using namespace edge_probe;
+    const std::string name = "collectors/rtnetlink";
+
+    std::vector<MetricSample> metrics;
+    const auto append = [&metrics](std::vector<MetricSample> samples) {
+        for (auto &sample : samples)
+        {
+            metrics.push_back(std::move(sample));
+        }
+    };
+    const auto shell_cycle = [&metrics, &append] {
+        metrics = parse_ip_br_link(run_shell("ip -br link"));
+        append(parse_ip_br_addr(run_shell("ip -br addr")));
+        append(parse_ip_route(run_shell("ip route")));
+        append(parse_ip_neigh(run_shell("ip neigh")));
+        append(parse_proc_net_dev(run_shell("cat /proc/net/dev")));
+    };
+    RtnetlinkCollector collector;
+    const auto native_cycle = [&collector, &metrics] {
+        metrics.clear();
+        collector.collect(metrics);
+    };
+
+    shell_cycle();
+    print_row(name, "shell_samples", static_cast<double>(metrics.size()));
+    native_cycle();
+    print_row(name, "native_samples", static_cast<double>(metrics.size()));
+
+    const struct
+    {
+        std::string path;
+        std::size_t iterations;
+        std::function<void()> cycle;
+    } paths[] = {{"shell", 20, shell_cycle}, {"native", 2000, native_cycle}};
+    for (const auto &path : paths)
+    {
+        const double cpu_before = cpu_ns_with_children();
+        const auto result = measure(path.iterations, path.cycle);
+        const double cpu_ns = (cpu_ns_with_children() - cpu_before) /
+                              static_cast<double>(path.iterations + 1);
+        print_row(name, path.path + "_ns_per_cycle", result.ns_per_iteration);
+        print_row(name, path.path + "_cpu_ns_per_cycle", cpu_ns);
+        print_row(name, path.path + "_allocs_per_cycle", result.allocations_per_iteration);
+    }
+    print_row(name, "native_dump_failures", static_cast<double>(collector.dump_failures()));
+}
+
+std::string read_fixture(const std::string &name)
+{
+    std::ifstream input(std::string(EDGE_PROBE_SOURCE_DIR) + "/tests/fixtures/" + name,
+                        std::ios::binary);
+    if (!input)
+    {
+        throw std::runtime_error("failed to open fixture " + name);
+    }
+    std::ostringstream bytes;
+    bytes << input.rdbuf();
+    return bytes.str();
+}
+
+// iw phy and iw dev text through their parsers, against the nl80211 decoders
+// on the same wiphy and interface as binary replies. The runners have no
+// wireless hardware, so this times decoding alone, not the dumps.
+void run_nl80211_benchmark()
+{
+    using namespace edge_probe;
+    const std::string name = "collectors/nl80211";
+    const std::string iw_phy = slice_lines(59, 295);
+    const std::string iw_dev = slice_lines(52, 58);
+    const std::string wiphy = read_fixture("nl80211_wiphy.bin");
+    const std::string interfaces = read_fixture("nl80211_interface.bin");
+
+    std::size_t samples = 0;
+    const auto text_cycle = [&] {
+        samples = parse_iw_phy(iw_phy).size() + parse_iw_dev(iw_dev).size();
+    };
+    const auto netlink_cycle = [&] {
+        samples = decode_nl80211_wiphy(wiphy).size() + decode_nl80211_interfaces(interfaces).size();
+    };
+
+    text_cycle();
+    print_row(name, "text_samples", static_cast<double>(samples));
+    print_row(name, "text_input_bytes", static_cast<double>(iw_phy.size() + iw_dev.size()));
+    netlink_cycle();
+    print_row(name, "netlink_samples", static_cast<double>(samples));
+    print_row(name, "netlink_input_bytes", static_cast<double>(wiphy.size() + interfaces.size()));
+
+    constexpr std::size_t iterations = 500;
+    const struct
+    {
+        std::string path;
+        std::function<void()> cycle;
+    } paths[] = {{"text", text_cycle}, {"netlink", netlink_cycle}};
+    for (const auto &path : paths)
+    {
+        const auto result = measure(iterations, path.cycle);
+        print_row(name, path.path + "_ns_per_cycle", result.ns_per_iteration);
+        print_row(name, path.path + "_allocs_per_cycle", result.allocations_per_iteration);
+    }
+}
+
+}  // namespace
+
+std::vector<BenchmarkCase> collector_benchmarks()
+{
+    return {
+        {"collectors/cycle", run_collection_cycle_benchmark},
+        {"collectors/parsers", run_parser_benchmark},
+        {"collectors/system_health", run_system_health_benchmark},
+        {"collectors/rtnetlink", run_rtnetlink_benchmark},
+        {"collectors/nl80211", run_nl80211_benchmark},
+    };
+}
+
+}  // namespace edge_probe_bench
@@ -0,0 +1,126 @@
+#include "bench_common.h"
+
+#include "edge_probe/json_lines_encoder.h"
+#include "edge_probe/payload_compressor.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace edge_probe_bench
+{
+
+namespace
+{
+
+using edge_probe::PayloadCompression;
+using edge_probe::PayloadCompressor;
+
+// Split the fixture into batches of the default TelemetryConfig size.
+std::vector<std::string> fixture_batches()
+{
+    const auto samples = collect_fixture_metrics();
+    const std::size_t batch_samples = edge_probe::TelemetryConfig {}.max_batch_samples;
+
+    std::vector<std::string> batches;
+    edge_probe::JsonLinesEncoder encoder;
+    for (std::size_t first = 0; first < samples.size(); first += batch_samples)
+    {
+        encoder.clear();
+        const std::size_t last = std::min(samples.size(), first + batch_samples);
+        for (std::size_t i = first; i < last; ++i)
+        {
+            encoder.append(samples[i]);
+        }
+        batches.push_back(encoder.buffer());
+    }
+    return batches;
+}
+
+void run_compression_benchmark()
+{
+    const auto batches = fixture_batches();
+    if (batches.empty())
+    {
+        throw std::runtime_error("fixture produced no batches");
+    }
+
+    std::size_t raw_bytes = 0;
+    for (const auto &batch : batches)
+    {
+        raw_bytes += batch.size();
+    }
+
+    const double batch_count = static_cast<double>(batches.size());
+    const std::string name = "compression/cmd_txt_batches";
+    print_row(name, "batches", batch_count);
+    print_row(name, "raw_bytes_per_batch", static_cast<double>(raw_bytes) / batch_count);
+
+    struct Variant
+    {
+        PayloadCompression compression;
+        int level;
+        std::string label;
+    };
+
+    const std::vector<Variant> variants = {
+        {PayloadCompression::gzip, 1, "gzip_1"},
+        {PayloadCompression::gzip, 0, "gzip_default"},
+        {PayloadCompression::gzip, 9, "gzip_9"},
+        {PayloadCompression::zstd, 1, "zstd_1"},
+        {PayloadCompression::zstd, 0, "zstd_default"},
+        {PayloadCompression::snappy, 0, "snappy"},
+    };
+
+    constexpr std::size_t iterations = 200;
+    for (const auto &variant : variants)
+    {
+        if (!PayloadCompressor::supported(variant.compression))
+        {
+            continue;
+        }
+
+        PayloadCompressor compressor(variant.compression, variant.level);
+        std::size_t wire_bytes = 0;
+        const auto measurement = measure(iterations, [&batches, &compressor, &wire_bytes] {
+            wire_bytes = 0;
+            for (const auto &batch : batches)
+            {
+                wire_bytes += compressor.compress(batch).size();
+            }
+        });
+
+        if (wire_bytes == 0)
+        {
+            throw std::runtime_error("compressor produced no output");
+        }
+
+        print_row(name,
+                  variant.label + "_wire_bytes_per_batch",
+                  static_cast<double>(wire_bytes) / batch_count);
+        print_row(name,
+                  variant.label + "_ratio",
+                  static_cast<double>(raw_bytes) / static_cast<double>(wire_bytes));
+        print_row(name,
+                  variant.label + "_us_per_batch",
+                  measurement.ns_per_iteration / batch_count / 1000.0);
+        print_row(name,
+                  variant.label + "_ns_per_raw_byte",
+                  measurement.ns_per_iteration / static_cast<double>(raw_bytes));
+        print_row(name,
+                  variant.label + "_allocs_per_batch",
+                  measurement.allocations_per_iteration / batch_count);
+    }
+}
+
+}  // namespace
+
+std::vector<BenchmarkCase> compression_benchmarks()
+{
+    return {
+        {"compression/cmd_txt_batches", run_compression_benchmark},
+    };
+}
+
+}  // namespace edge_probe_bench
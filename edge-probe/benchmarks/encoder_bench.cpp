@@ -0,0 +1,369 @@
+#include "bench_common.h"
+
+#include "edge_probe/json_lines_encoder.h"
+#include "edge_probe/metric_prefix_cache.h"
+#include "edge_probe/payload_compressor.h"
+#include "edge_probe/remote_write_encoder.h"
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace edge_probe_bench
+{
+
+namespace
+{
+
+using edge_probe::MetricSample;
+
+std::string legacy_build_json_lines(const std::vector<MetricSample> &samples)
+{
+    std::ostringstream output;
+    output << std::setprecision(15);
+
+    for (const auto &sample : samples)
+    {
+        output << "{\"metric\":{\"__name__\":\"" << legacy_json_escape(sample.name) << "\"";
+        for (const auto &[key, value] : sample.labels)
+        {
+            output << ",\"" << legacy_json_escape(key) << "\":\"" << legacy_json_escape(value)
+                   << "\"";
+        }
+
+        output << "},\"values\":[" << sample.value << "],\"timestamps\":["
+               << sample.timestamp_ms << "]}\n";
+    }
+
+    return output.str();
+}
+
+void run_json_lines_encoder_benchmark()
+{
+    const auto samples = collect_fixture_metrics();
+    const double sample_count = static_cast<double>(samples.size());
+    constexpr std::size_t iterations = 200;
+
+    std::size_t legacy_bytes = 0;
+    const auto legacy = measure(iterations, [&samples, &legacy_bytes] {
+        legacy_bytes = legacy_build_json_lines(samples).size();
+    });
+
+    edge_probe::JsonLinesEncoder encoder(legacy_bytes);
+    const auto streaming = measure(iterations, [&samples, &encoder] {
+        encoder.clear();
+        for (const auto &sample : samples)
+        {
+            encoder.append(sample);
+        }
+    });
+
+    if (encoder.size() == 0 || legacy_bytes == 0)
+    {
+        throw std::runtime_error("encoder produced an empty payload");
+    }
+
+    const std::string name = "encoder/json_lines";
+    print_row(name, "samples_per_batch", sample_count);
+    print_row(name, "legacy_bytes", static_cast<double>(legacy_bytes));
+    print_row(name, "streaming_bytes", static_cast<double>(encoder.size()));
+    print_row(name, "legacy_ns_per_sample", legacy.ns_per_iteration / sample_count);
+    print_row(name, "streaming_ns_per_sample", streaming.ns_per_iteration / sample_count);
+    print_row(name,
+              "legacy_allocs_per_sample",
+              legacy.allocations_per_iteration / sample_count);
+    print_row(name,
+              "streaming_allocs_per_sample",
+              streaming.allocations_per_iteration / sample_count);
+    print_row(name, "speedup", legacy.ns_per_iteration / streaming.ns_per_iteration);
+}
+
+class CapturingTransport final : public edge_probe::HttpTransport
+{
+public:
+    Result post_json_lines(const edge_probe::TelemetryConfig &, const std::string &body) override
+    {
+        last_body.assign(body);
+        Result result;
+        result.ok = true;
+        result.http_code = 204;
+        return result;
+    }
+
+    std::string last_body;
+};
+
+// cmd.txt replayed as several collection cycles 10 s apart.
+std::vector<MetricSample> replay_fixture_cycles(int cycles)
+{
+    const auto fixture = collect_fixture_metrics();
+    std::vector<MetricSample> samples;
+    for (int cycle = 0; cycle < cycles; ++cycle)
+    {
+        for (auto sample : fixture)
+        {
+            sample.timestamp_ms += cycle * 10000;
+            samples.push_back(std::move(sample));
+        }
+    }
+    return samples;
+}
+
+// One batch of several cycles, once with a line per sample and once grouped
+// by series.
+void run_series_grouped_benchmark()
+{
+    constexpr int cycles = 6;
+    const auto samples = replay_fixture_cycles(cycles);
+
+    const std::string name = "encoder/series_grouped";
+    const double sample_count = static_cast<double>(samples.size());
+    print_row(name, "cycles", cycles);
+    print_row(name, "samples", sample_count);
+
+    std::size_t per_sample_bytes = 0;
+    for (const bool grouped : {false, true})
+    {
+        edge_probe::TelemetryConfig config;
+        config.max_batch_samples = samples.size();
+        config.max_pending_payload_bytes = 64 * 1024 * 1024;
+        config.group_series = grouped;
+
+        auto transport = std::make_shared<CapturingTransport>();
+        edge_probe::TelemetryWriter writer(config, transport);
+        constexpr std::size_t iterations = 50;
+        const auto measurement = measure(iterations, [&samples, &writer] {
+            for (const auto &sample : samples)
+            {
+                writer.submit(sample);
+            }
+            writer.force_flush();
+        });
+
+        const std::string mode = grouped ? "grouped" : "per_sample";
+        const std::size_t bytes = transport->last_body.size();
+        if (bytes == 0)
+        {
+            throw std::runtime_error("writer produced an empty payload");
+        }
+
+        print_row(name, mode + "_bytes", static_cast<double>(bytes));
+        print_row(name, mode + "_ns_per_sample", measurement.ns_per_iteration / sample_count);
+        print_row(name,
+                  mode + "_allocs_per_sample",
+                  measurement.allocations_per_iteration / sample_count);
+        if (edge_probe::PayloadCompressor::supported(edge_probe::PayloadCompression::gzip))
+        {
+            edge_probe::PayloadCompressor gzip(edge_probe::PayloadCompression::gzip);
+            print_row(name,
+                      mode + "_gzip_bytes",
+                      static_cast<double>(gzip.compress(transport->last_body).size()));
+        }
+
+        if (!grouped)
+        {
+            per_sample_bytes = bytes;
+        }
+        else
+        {
+            print_row(name,
+                      "byte_reduction",
+                      1.0 - static_cast<double>(bytes) / static_cast<double>(per_sample_bytes));
+        }
+    }
+}
+
+// Per-sample JSON lines across cycles, with and without the metric prefix
+// cache. Measured on the encoder so sample copies into submit() do not hide
+// the escaping cost.
+void run_prefix_cache_benchmark()
+{
+    constexpr int cycles = 6;
+    const auto samples = replay_fixture_cycles(cycles);
+
+    const std::string name = "encoder/prefix_cache";
+    const double sample_count = static_cast<double>(samples.size());
+    print_row(name, "samples", sample_count);
+
+    edge_probe::MetricPrefixCache cache(1024);
+    double uncached_ns = 0.0;
+    for (const bool cached : {false, true})
+    {
+        edge_probe::JsonLinesEncoder encoder(64 * 1024 * 1024);
+        encoder.set_prefix_cache(cached ? &cache : nullptr);
+        constexpr std::size_t iterations = 50;
+        const auto measurement = measure(iterations, [&samples, &encoder] {
+            encoder.clear();
+            for (const auto &sample : samples)
+            {
+                encoder.append(sample);
+            }
+        });
+
+        const std::string mode = cached ? "cached" : "uncached";
+        const double ns_per_sample = measurement.ns_per_iteration / sample_count;
+        print_row(name, mode + "_ns_per_sample", ns_per_sample);
+        print_row(name,
+                  mode + "_allocs_per_sample",
+                  measurement.allocations_per_iteration / sample_count);
+        if (!cached)
+        {
+            uncached_ns = ns_per_sample;
+        }
+        else
+        {
+            print_row(name, "speedup", uncached_ns / ns_per_sample);
+            print_row(name,
+                      "hit_ratio",
+                      static_cast<double>(cache.hits()) /
+                          static_cast<double>(cache.hits() + cache.misses()));
+        }
+    }
+}
+
+// A fleet runner adds a handful of constant labels to every sample of the
+// full fixture cycle: copied into each sample, or applied by the encoder.
+void run_external_labels_benchmark()
+{
+    const auto fixture = collect_fixture_metrics();
+    const edge_probe::ExternalLabels constant_labels {
+        {"device", "busstop-001"},
+        {"firmware", "2024.11.2"},
+        {"fixture", "cmd_txt"},
+        {"fleet", "njtransit"},
+        {"site", "newark-penn"},
+    };
+
+    const std::string name = "encoder/external_labels";
+    const double sample_count = static_cast<double>(fixture.size());
+    print_row(name, "samples", sample_count);
+    print_row(name, "labels", static_cast<double>(constant_labels.size()));
+
+    std::size_t copied_bytes = 0;
+    for (const bool external : {false, true})
+    {
+        edge_probe::TelemetryConfig config;
+        config.max_batch_samples = fixture.size();
+        config.max_pending_payload_bytes = 64 * 1024 * 1024;
+        if (external)
+        {
+            config.external_labels = constant_labels;
+        }
+
+        auto transport = std::make_shared<CapturingTransport>();
+        edge_probe::TelemetryWriter writer(config, transport);
+        constexpr std::size_t iterations = 100;
+        // Each cycle starts from fresh parser output, as a runner would.
+        const auto measurement =
+            measure(iterations, [&fixture, &constant_labels, &writer, external] {
+                std::vector<MetricSample> cycle(fixture);
+                for (auto &sample : cycle)
+                {
+                    if (!external)
+                    {
+                        for (const auto &[key, value] : constant_labels)
+                        {
+                            sample.labels.emplace(key, value);
+                        }
+                    }
+                    writer.submit(std::move(sample));
+                }
+                writer.force_flush();
+            });
+
+        const std::string mode = external ? "external" : "copied";
+        print_row(name, mode + "_ns_per_sample", measurement.ns_per_iteration / sample_count);
+        print_row(name,
+                  mode + "_allocs_per_sample",
+                  measurement.allocations_per_iteration / sample_count);
+        if (!external)
+        {
+            copied_bytes = transport->last_body.size();
+        }
+        else if (transport->last_body.size() != copied_bytes)
+        {
+            throw std::runtime_error("external labels changed the payload");
+        }
+    }
+}
+
+// The same batch as JSON lines (gzip) and as remote_write protobuf (snappy),
+// measured end to end through the writer.
+void run_remote_write_benchmark()
+{
+    constexpr int cycles = 6;
+    const auto samples = replay_fixture_cycles(cycles);
+
+    const std::string name = "encoder/remote_write";
+    const double sample_count = static_cast<double>(samples.size());
+    print_row(name, "samples", sample_count);
+
+    edge_probe::RemoteWriteEncoder encoder;
+    for (const auto &sample : samples)
+    {
+        encoder.add(sample, 64 * 1024 * 1024);
+    }
+    print_row(name, "remote_write_raw_bytes", static_cast<double>(encoder.payload().size()));
+
+    edge_probe::JsonLinesEncoder json(64 * 1024 * 1024);
+    for (const auto &sample : samples)
+    {
+        json.append(sample);
+    }
+    print_row(name, "json_raw_bytes", static_cast<double>(json.size()));
+
+    for (const auto format :
+         {edge_probe::PayloadFormat::json_lines, edge_probe::PayloadFormat::remote_write})
+    {
+        const bool remote_write = format == edge_probe::PayloadFormat::remote_write;
+        if (!remote_write &&
+            !edge_probe::PayloadCompressor::supported(edge_probe::PayloadCompression::gzip))
+        {
+            continue;
+        }
+
+        edge_probe::TelemetryConfig config;
+        config.max_batch_samples = samples.size();
+        config.max_pending_payload_bytes = 64 * 1024 * 1024;
+        config.payload_format = format;
+        config.compression = remote_write ? edge_probe::PayloadCompression::snappy
+                                          : edge_probe::PayloadCompression::gzip;
+
+        auto transport = std::make_shared<CapturingTransport>();
+        edge_probe::TelemetryWriter writer(config, transport);
+        constexpr std::size_t iterations = 50;
+        const auto measurement = measure(iterations, [&samples, &writer] {
+            for (const auto &sample : samples)
+            {
+                writer.submit(sample);
+            }
+            writer.force_flush();
+        });
+
+        const std::string mode = remote_write ? "remote_write_snappy" : "json_gzip";
+        print_row(name, mode + "_wire_bytes", static_cast<double>(transport->last_body.size()));
+        print_row(name, mode + "_ns_per_sample", measurement.ns_per_iteration / sample_count);
+        print_row(name,
+                  mode + "_allocs_per_sample",
+                  measurement.allocations_per_iteration / sample_count);
+    }
+}
+
+}  // namespace
+
+std::vector<BenchmarkCase> encoder_benchmarks()
+{
+    return {
+        {"encoder/json_lines", run_json_lines_encoder_benchmark},
+        {"encoder/series_grouped", run_series_grouped_benchmark},
+        {"encoder/prefix_cache", run_prefix_cache_benchmark},
+        {"encoder/external_labels", run_external_labels_benchmark},
+        {"encoder/remote_write", run_remote_write_benchmark},
+    };
+}
+
+}  // namespace edge_probe_bench
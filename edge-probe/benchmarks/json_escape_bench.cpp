@@ -0,0 +1,117 @@
+#include "bench_common.h"
+
+#include "edge_probe/json_escape.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace edge_probe_bench
+{
+
+namespace
+{
+
+using edge_probe::JsonEscapeKernel;
+
+std::vector<std::string> label_corpus()
+{
+    std::vector<std::string> corpus;
+    for (const auto &sample : collect_fixture_metrics())
+    {
+        corpus.push_back(sample.name);
+        for (const auto &[key, value] : sample.labels)
+        {
+            corpus.push_back(key);
+            corpus.push_back(value);
+        }
+    }
+    return corpus;
+}
+
+void run_json_escape_benchmark()
+{
+    const auto corpus = label_corpus();
+    std::size_t corpus_bytes = 0;
+    for (const auto &value : corpus)
+    {
+        corpus_bytes += value.size();
+    }
+    if (corpus_bytes == 0)
+    {
+        throw std::runtime_error("label corpus is empty");
+    }
+
+    constexpr std::size_t iterations = 500;
+    const std::string name = "json_escape/cmd_txt_labels";
+    const auto ns_per_byte = [corpus_bytes](const Measurement &measurement) {
+        return measurement.ns_per_iteration / static_cast<double>(corpus_bytes);
+    };
+
+    std::size_t sink = 0;
+    const auto legacy = measure(iterations, [&corpus, &sink] {
+        for (const auto &value : corpus)
+        {
+            sink += legacy_json_escape(value).size();
+        }
+    });
+
+    print_row(name, "corpus_strings", static_cast<double>(corpus.size()));
+    print_row(name, "corpus_bytes", static_cast<double>(corpus_bytes));
+    print_row(name, "legacy_ns_per_byte", ns_per_byte(legacy));
+
+    std::string output;
+    output.reserve(corpus_bytes * 2);
+    for (const auto kernel : {JsonEscapeKernel::scalar,
+                              JsonEscapeKernel::sse2,
+                              JsonEscapeKernel::avx2,
+                              JsonEscapeKernel::neon})
+    {
+        if (!edge_probe::json_escape_kernel_supported(kernel))
+        {
+            continue;
+        }
+
+        const auto appended = measure(iterations, [&corpus, &output, kernel] {
+            output.clear();
+            for (const auto &value : corpus)
+            {
+                edge_probe::json_escape(value, output, kernel);
+            }
+        });
+
+        const std::string kernel_name = edge_probe::json_escape_kernel_name(kernel);
+        print_row(name, kernel_name + "_append_ns_per_byte", ns_per_byte(appended));
+        print_row(name,
+                  kernel_name + "_speedup",
+                  legacy.ns_per_iteration / appended.ns_per_iteration);
+    }
+
+    const auto returning = measure(iterations, [&corpus, &sink] {
+        for (const auto &value : corpus)
+        {
+            sink += edge_probe::json_escape(value).size();
+        }
+    });
+    print_row(name,
+              std::string("active_") +
+                  edge_probe::json_escape_kernel_name(edge_probe::json_escape_active_kernel()) +
+                  "_returning_ns_per_byte",
+              ns_per_byte(returning));
+
+    if (sink == 0)
+    {
+        throw std::runtime_error("json_escape produced no output");
+    }
+}
+
+}  // namespace
+
+std::vector<BenchmarkCase> json_escape_benchmarks()
+{
+    return {
+        {"json_escape/cmd_txt_labels", run_json_escape_benchmark},
+    };
+}
+
+}  // namespace edge_probe_bench
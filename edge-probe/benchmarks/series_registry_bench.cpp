@@ -0,0 +1,98 @@
+#include "bench_common.h"
+
+#include "edge_probe/series_registry.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace edge_probe_bench
+{
+
+namespace
+{
+
+using edge_probe::MetricSample;
+using edge_probe::SeriesRegistry;
+using edge_probe::SeriesSample;
+
+// Heap bytes retained by one collection cycle held as MetricSample values
+// versus interned series plus compact samples, and the writer's per-sample
+// cost for each.
+void run_series_registry_benchmark()
+{
+    const auto fixture = collect_fixture_metrics();
+    const std::string name = "series/registry";
+    const double sample_count = static_cast<double>(fixture.size());
+    print_row(name, "samples", sample_count);
+
+    const std::uint64_t bytes_before = allocated_bytes();
+    const std::vector<MetricSample> copied(fixture);
+    print_row(name,
+              "metric_sample_bytes_per_cycle",
+              static_cast<double>(allocated_bytes() - bytes_before));
+
+    SeriesRegistry registry;
+    std::vector<SeriesSample> interned;
+    interned.reserve(fixture.size());
+    for (const auto &sample : fixture)
+    {
+        interned.push_back({registry.intern(sample), sample.value, sample.timestamp_ms});
+    }
+    print_row(name, "series", static_cast<double>(registry.size()));
+    print_row(name, "registry_bytes", static_cast<double>(registry.memory_bytes()));
+    print_row(name,
+              "series_sample_bytes_per_cycle",
+              static_cast<double>(interned.capacity() * sizeof(SeriesSample)));
+
+    constexpr std::size_t iterations = 200;
+    const auto lookup = measure(iterations, [&fixture, &registry] {
+        for (const auto &sample : fixture)
+        {
+            registry.intern(sample);
+        }
+    });
+    print_row(name, "intern_hit_ns_per_sample", lookup.ns_per_iteration / sample_count);
+
+    edge_probe::TelemetryConfig config;
+    config.max_batch_samples = fixture.size();
+    config.max_pending_payload_bytes = 64 * 1024 * 1024;
+
+    // Today's path: a fresh sample per series and cycle, moved into submit().
+    edge_probe::TelemetryWriter metric_writer(config, std::make_shared<NullTransport>());
+    const auto by_metric = measure(iterations, [&fixture, &metric_writer] {
+        for (const auto &sample : fixture)
+        {
+            metric_writer.submit(sample);
+        }
+        metric_writer.force_flush();
+    });
+    print_row(name, "metric_sample_ns_per_sample", by_metric.ns_per_iteration / sample_count);
+    print_row(name,
+              "metric_sample_allocs_per_sample",
+              by_metric.allocations_per_iteration / sample_count);
+
+    edge_probe::TelemetryWriter series_writer(config, std::make_shared<NullTransport>());
+    const auto by_series = measure(iterations, [&interned, &registry, &series_writer] {
+        for (const auto &sample : interned)
+        {
+            series_writer.submit(registry, sample);
+        }
+        series_writer.force_flush();
+    });
+    print_row(name, "series_sample_ns_per_sample", by_series.ns_per_iteration / sample_count);
+    print_row(name,
+              "series_sample_allocs_per_sample",
+              by_series.allocations_per_iteration / sample_count);
+}
+
+}  // namespace
+
+std::vector<BenchmarkCase> series_registry_benchmarks()
+{
+    return {
+        {"series/registry", run_series_registry_benchmark},
+    };
+}
+
+}  // namespace edge_probe_bench
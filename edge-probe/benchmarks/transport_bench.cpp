@@ -0,0 +1,93 @@
+#include "bench_common.h"
+
+#if defined(EDGE_PROBE_HAVE_CURL)
+#include "edge_probe/curl_http_transport.h"
+#include "local_http_server.h"
+#endif
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace edge_probe_bench
+{
+
+namespace
+{
+
+#if defined(EDGE_PROBE_HAVE_CURL)
+
+constexpr int kServerLatencyMs = 50;
+constexpr std::size_t kBatches = 16;
+
+// Drains kBatches queued fixture batches through a stand-in endpoint that
+// answers each request kServerLatencyMs after reading it, like a distant LTE
+// peer, and reports the delivery rate.
+void drain_with(const std::string &name,
+                const std::string &endpoint,
+                const std::shared_ptr<edge_probe::HttpTransport> &transport)
+{
+    const auto fixture = collect_fixture_metrics();
+    edge_probe::TelemetryConfig config;
+    config.endpoint = endpoint;
+    config.max_batch_samples = fixture.size();
+    config.max_pending_payload_bytes = 64 * 1024 * 1024;
+    config.max_retry_queue_bytes = 64 * 1024 * 1024;
+    edge_probe::TelemetryWriter writer(config, transport);
+
+    // Warm-up opens the connections.
+    writer.submit_batch(fixture);
+    writer.force_flush();
+
+    for (std::size_t i = 0; i < kBatches; ++i)
+    {
+        writer.submit_batch(fixture);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    writer.force_flush();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    const double elapsed_ms =
+        std::chrono::duration<double, std::milli>(elapsed).count();
+    print_row(name, "batches", static_cast<double>(kBatches));
+    print_row(name, "sent_batches", static_cast<double>(writer.sent_batches() - 1));
+    print_row(name, "ms_per_batch", elapsed_ms / static_cast<double>(kBatches));
+    print_row(name, "batches_per_sec", static_cast<double>(kBatches) * 1000.0 / elapsed_ms);
+}
+
+void run_in_flight_benchmark()
+{
+    edge_probe_testing::LocalHttpServer server(
+        [](const edge_probe_testing::LocalHttpServer::Request &) { return 204; },
+        kServerLatencyMs);
+    const std::string endpoint = server.url("/api/v1/import");
+
+    print_row("transport/in_flight", "server_latency_ms", kServerLatencyMs);
+    drain_with("transport/in_flight/serial",
+               endpoint,
+               std::make_shared<edge_probe::CurlHttpTransport>());
+    for (const std::size_t in_flight : {2, 4, 8})
+    {
+        drain_with("transport/in_flight/multi_" + std::to_string(in_flight),
+                   endpoint,
+                   std::make_shared<edge_probe::CurlMultiHttpTransport>(in_flight));
+    }
+}
+
+#endif
+
+}  // namespace
+
+std::vector<BenchmarkCase> transport_benchmarks()
+{
+#if defined(EDGE_PROBE_HAVE_CURL)
+    return {
+        {"transport/in_flight", run_in_flight_benchmark},
+    };
+#else
+    return {};
+#endif
+}
+
+}  // namespace edge_probe_bench
@@ -0,0 +1,119 @@
+#include "bench_common.h"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace edge_probe_bench
+{
+
+namespace
+{
+
+using edge_probe::MetricSample;
+
+class CountingClock final : public edge_probe::Clock
+{
+public:
+    int64_t monotonic_now_ms() const override
+    {
+        reads.fetch_add(1, std::memory_order_relaxed);
+        return clock_.monotonic_now_ms();
+    }
+
+    int64_t unix_epoch_ms() const override
+    {
+        reads.fetch_add(1, std::memory_order_relaxed);
+        return clock_.unix_epoch_ms();
+    }
+
+    mutable std::atomic<std::uint64_t> reads {0};
+
+private:
+    edge_probe::SystemClock clock_;
+};
+
+// Per-sample writer overhead for one parser cycle with unset timestamps,
+// submitted sample by sample versus as one submit_batch(). Both paths pay
+// for the same fresh copy of the cycle, which is measured on its own too.
+void run_submit_batch_benchmark()
+{
+    auto fixture = collect_fixture_metrics();
+    for (auto &sample : fixture)
+    {
+        sample.timestamp_ms = 0;
+    }
+    const std::string name = "writer/submit_batch";
+    const double sample_count = static_cast<double>(fixture.size());
+    print_row(name, "samples", sample_count);
+
+    edge_probe::TelemetryConfig config;
+    config.max_batch_samples = fixture.size();
+    config.max_pending_payload_bytes = 64 * 1024 * 1024;
+
+    constexpr std::size_t iterations = 1000;
+    const auto copy_only = measure(iterations, [&fixture] {
+        std::vector<MetricSample> cycle(fixture);
+        if (cycle.size() != fixture.size())
+        {
+            throw std::runtime_error("copy lost samples");
+        }
+    });
+
+    auto single_clock = std::make_shared<CountingClock>();
+    edge_probe::TelemetryWriter single_writer(
+        config, std::make_shared<NullTransport>(), single_clock);
+    const auto single = measure(iterations, [&fixture, &single_writer] {
+        std::vector<MetricSample> cycle(fixture);
+        for (auto &sample : cycle)
+        {
+            single_writer.submit(std::move(sample));
+        }
+        single_writer.force_flush();
+    });
+
+    auto batch_clock = std::make_shared<CountingClock>();
+    edge_probe::TelemetryWriter batch_writer(
+        config, std::make_shared<NullTransport>(), batch_clock);
+    const auto batch = measure(iterations, [&fixture, &batch_writer] {
+        batch_writer.submit_batch(std::vector<MetricSample>(fixture));
+        batch_writer.force_flush();
+    });
+
+    const double cycles = static_cast<double>(iterations + 1);
+    print_row(name, "copy_ns_per_sample", copy_only.ns_per_iteration / sample_count);
+    print_row(name,
+              "submit_ns_per_sample",
+              (single.ns_per_iteration - copy_only.ns_per_iteration) / sample_count);
+    print_row(name,
+              "submit_clock_reads_per_sample",
+              static_cast<double>(single_clock->reads.load()) / cycles / sample_count);
+    print_row(name,
+              "submit_allocs_per_sample",
+              (single.allocations_per_iteration - copy_only.allocations_per_iteration) /
+                  sample_count);
+    print_row(name,
+              "batch_ns_per_sample",
+              (batch.ns_per_iteration - copy_only.ns_per_iteration) / sample_count);
+    print_row(name,
+              "batch_clock_reads_per_sample",
+              static_cast<double>(batch_clock->reads.load()) / cycles / sample_count);
+    print_row(name,
+              "batch_allocs_per_sample",
+              (batch.allocations_per_iteration - copy_only.allocations_per_iteration) /
+                  sample_count);
+}
+
+}  // namespace
+
+std::vector<BenchmarkCase> writer_benchmarks()
+{
+    return {
+        {"writer/submit_batch", run_submit_batch_benchmark},
+    };
+}
+
+}  // namespace edge_probe_bench
@@ -47,6 +47,11 @@ std::vector<MetricSample> parse_meminfo(const std::string &output);
 std::vector<MetricSample> parse_proc_net_dev(const std::string &output);
 std::vector<MetricSample> parse_thermal_zone_temp(const std::string &output,
                                                   const std::string &zone_name);
+// A hwmon tempN_input file, in millidegrees like a thermal zone.
+std::vector<MetricSample> parse_hwmon_temp(const std::string &output,
+                                           const std::string &hwmon_name,
+                                           const std::string &chip,
+                                           const std::string &sensor);
 
 std::vector<MetricSample> parse_iptables(const std::string &output);
 std::vector<MetricSample> parse_nft_ruleset(const std::string &output);
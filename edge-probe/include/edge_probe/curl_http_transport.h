@@ -2,14 +2,61 @@
 
 #include "edge_probe/telemetry_sender.h"
 
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 namespace edge_probe
 {
 
+// Keeps one easy handle, and with it a keep-alive connection, across posts.
+// DNS results and TLS sessions live in a share handle, so the handle rebuilt
+// after a transfer error still skips the lookup and a full handshake.
+// Concurrent posts are serialized.
 class CurlHttpTransport final : public HttpTransport
 {
 public:
+    CurlHttpTransport();
+    ~CurlHttpTransport() override;
+
+    CurlHttpTransport(const CurlHttpTransport &) = delete;
+    CurlHttpTransport &operator=(const CurlHttpTransport &) = delete;
+
     Result post_json_lines(const TelemetryConfig &config,
                            const std::string &body) override;
+
+private:
+    struct Handles;
+
+    std::mutex mutex_;
+    std::unique_ptr<Handles> handles_;
+};
+
+// Posts up to max_in_flight batches at once through curl_multi. Over HTTPS
+// with HTTP/2 they share one multiplexed connection; otherwise each gets its
+// own keep-alive connection. post_many() returns when every post finished.
+class CurlMultiHttpTransport final : public HttpTransport
+{
+public:
+    explicit CurlMultiHttpTransport(std::size_t max_in_flight = 4);
+    ~CurlMultiHttpTransport() override;
+
+    CurlMultiHttpTransport(const CurlMultiHttpTransport &) = delete;
+    CurlMultiHttpTransport &operator=(const CurlMultiHttpTransport &) = delete;
+
+    Result post_json_lines(const TelemetryConfig &config,
+                           const std::string &body) override;
+    std::vector<Result> post_many(const TelemetryConfig &config,
+                                  const std::vector<const std::string *> &bodies) override;
+    std::size_t max_in_flight() const override;
+
+private:
+    struct Handles;
+
+    std::size_t max_in_flight_;
+    std::mutex mutex_;
+    std::unique_ptr<Handles> handles_;
 };
 
 }  // namespace edge_probe
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace edge_probe
+{
+
+enum class JsonEscapeKernel
+{
+    scalar,
+    sse2,
+    avx2,
+    neon,
+};
+
+std::string json_escape(const std::string &value);
+void json_escape(std::string_view value, std::string &output);
+void json_escape(std::string_view value, std::string &output, JsonEscapeKernel kernel);
+
+JsonEscapeKernel json_escape_active_kernel();
+bool json_escape_kernel_supported(JsonEscapeKernel kernel);
+const char *json_escape_kernel_name(JsonEscapeKernel kernel);
+
+}  // namespace edge_probe
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "edge_probe/label_merge.h"
+#include "edge_probe/series_registry.h"
+#include "edge_probe/telemetry_sender.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace edge_probe
+{
+
+class MetricPrefixCache;
+
+class JsonLinesEncoder
+{
+public:
+    explicit JsonLinesEncoder(std::size_t reserve_bytes = 0);
+
+    void reserve(std::size_t bytes);
+    // append() takes metric objects from cache when set; it must outlive the encoder.
+    void set_prefix_cache(MetricPrefixCache *cache);
+    // Merged into every uncached metric object; must outlive the encoder.
+    void set_external_labels(const ExternalLabels *labels);
+    void append(const MetricSample &sample);
+    void append(const SeriesRegistry &registry, const SeriesSample &sample);
+    // Appends one line holding several points of a series. metric comes from
+    // append_metric(); values and timestamps are comma-separated lists.
+    void append_series(std::string_view metric,
+                       std::string_view values,
+                       std::string_view timestamps);
+    void clear();
+    void truncate(std::size_t size);
+    // Gives the encoded buffer to other and continues in other's cleared storage.
+    void swap_buffer(std::string &other);
+
+    bool empty() const;
+    std::size_t size() const;
+    std::size_t capacity() const;
+    const std::string &buffer() const;
+
+    static std::size_t series_line_bytes(std::size_t metric_bytes,
+                                         std::size_t values_bytes,
+                                         std::size_t timestamps_bytes);
+    static void append_metric(const MetricSample &sample,
+                              std::string &output,
+                              const ExternalLabels *external = nullptr);
+    static void append_metric(const SeriesRegistry &registry,
+                              SeriesId series,
+                              std::string &output,
+                              const ExternalLabels *external = nullptr);
+    static void append_value(double value, std::string &output);
+    static void append_timestamp(int64_t value, std::string &output);
+
+private:
+    std::string buffer_;
+    MetricPrefixCache *prefix_cache_ {nullptr};
+    const ExternalLabels *external_labels_ {nullptr};
+};
+
+}  // namespace edge_probe
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "edge_probe/label_set.h"
+
+#include <string_view>
+
+namespace edge_probe
+{
+
+using ExternalLabels = LabelSet;
+
+// Calls fn(name, value) for the union of two name-sorted label ranges, in name
+// order. A series label shadows an external label of the same name.
+template <typename Labels, typename Fn>
+void merge_labels(const Labels &labels, const ExternalLabels *external, Fn &&fn)
+{
+    if (external == nullptr || external->empty())
+    {
+        for (const auto &[name, value] : labels)
+        {
+            fn(std::string_view(name), std::string_view(value));
+        }
+        return;
+    }
+
+    auto label = labels.begin();
+    auto extra = external->begin();
+    while (label != labels.end() || extra != external->end())
+    {
+        if (extra == external->end())
+        {
+            const auto &[name, value] = *label++;
+            fn(std::string_view(name), std::string_view(value));
+            continue;
+        }
+        if (label == labels.end())
+        {
+            fn(std::string_view(extra->name), std::string_view(extra->value));
+            ++extra;
+            continue;
+        }
+
+        const auto &[name, value] = *label;
+        const int order = std::string_view(name).compare(extra->name);
+        if (order <= 0)
+        {
+            fn(std::string_view(name), std::string_view(value));
+            ++label;
+            if (order == 0)
+            {
+                ++extra;
+            }
+        }
+        else
+        {
+            fn(std::string_view(extra->name), std::string_view(extra->value));
+            ++extra;
+        }
+    }
+}
+
+}  // namespace edge_probe
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace edge_probe
+{
+
+struct Label
+{
+    std::string name;
+    std::string value;
+};
+
+// Name-sorted labels with unique names. Up to kInlineCapacity labels live in
+// the object itself; a larger set moves into one heap vector. Most collector
+// samples carry two to four labels, so building one allocates no map nodes.
+class LabelSet
+{
+public:
+    static constexpr std::size_t kInlineCapacity = 4;
+
+    LabelSet() = default;
+    // For a repeated name the first label wins, as with std::map.
+    LabelSet(std::initializer_list<Label> labels);
+
+    LabelSet(const LabelSet &) = default;
+    LabelSet &operator=(const LabelSet &) = default;
+    // Moving leaves other empty: data() reads inline_ once heap_ is gone, so
+    // its size_ must not outlive the heap vector.
+    LabelSet(LabelSet &&other) noexcept;
+    LabelSet &operator=(LabelSet &&other) noexcept;
+
+    // Inserts in name order. An existing name keeps its value; returns whether
+    // the label was inserted.
+    bool emplace(std::string name, std::string value);
+    // Value for name, inserted empty when missing.
+    std::string &operator[](std::string_view name);
+    // Returns whether a label was removed.
+    bool erase(std::string_view name);
+
+    // nullptr when the name is not present.
+    const std::string *find(std::string_view name) const;
+    bool contains(std::string_view name) const
+    {
+        return find(name) != nullptr;
+    }
+
+    const Label *begin() const
+    {
+        return data();
+    }
+
+    const Label *end() const
+    {
+        return data() + size_;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    void clear();
+
+    friend bool operator==(const LabelSet &lhs, const LabelSet &rhs);
+    friend bool operator!=(const LabelSet &lhs, const LabelSet &rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    Label *data()
+    {
+        return heap_.empty() ? inline_.data() : heap_.data();
+    }
+
+    const Label *data() const
+    {
+        return heap_.empty() ? inline_.data() : heap_.data();
+    }
+
+    // Index of the first label whose name is not less than name.
+    std::size_t lower_bound(std::string_view name) const;
+    Label &insert_at(std::size_t index, std::string name);
+
+    std::array<Label, kInlineCapacity> inline_;
+    // Holds every label once the set outgrows inline_; empty otherwise.
+    std::vector<Label> heap_;
+    std::uint32_t size_ {0};
+};
+
+}  // namespace edge_probe
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "edge_probe/label_merge.h"
+#include "edge_probe/series_registry.h"
+#include "edge_probe/telemetry_sender.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace edge_probe
+{
+
+// LRU cache of escaped {"metric":{...}} objects, keyed by a fingerprint of
+// name plus labels. A hit copies the cached bytes instead of escaping again.
+// Used from one thread; the counters may be read from any thread.
+class MetricPrefixCache
+{
+public:
+    // external_labels are merged into every rendered object and must outlive
+    // the cache.
+    explicit MetricPrefixCache(std::size_t max_entries,
+                               const ExternalLabels *external_labels = nullptr);
+
+    MetricPrefixCache(const MetricPrefixCache &) = delete;
+    MetricPrefixCache &operator=(const MetricPrefixCache &) = delete;
+
+    void append_metric(const MetricSample &sample, std::string &output);
+    void append_metric(const SeriesRegistry &registry, SeriesId series, std::string &output);
+
+    std::size_t size() const;
+    std::size_t max_entries() const;
+    std::uint64_t hits() const;
+    std::uint64_t misses() const;
+    std::uint64_t evictions() const;
+
+private:
+    struct Entry
+    {
+        std::uint64_t fingerprint {0};
+        // Length-prefixed name and labels, compared on lookup so a fingerprint
+        // collision is a miss rather than wrong labels.
+        std::string key;
+        std::string prefix;
+    };
+
+    // Returns the entry for the series, moved to the front. On a miss the
+    // entry's prefix is empty and the caller renders it.
+    template <typename Labels>
+    std::string &lookup(std::string_view name, const Labels &labels, bool &hit);
+
+    std::size_t max_entries_;
+    const ExternalLabels *external_labels_;
+    std::list<Entry> entries_;
+    std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index_;
+    std::string key_scratch_;
+
+    std::atomic<std::uint64_t> hits_ {0};
+    std::atomic<std::uint64_t> misses_ {0};
+    std::atomic<std::uint64_t> evictions_ {0};
+};
+
+}  // namespace edge_probe
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "edge_probe/label_set.h"
+#include "edge_probe/telemetry_sender.h"
+
+#include <string>
+#include <utility>
+
+namespace edge_probe
+{
+
+// Sample builders shared by the collectors. The timestamp is left at zero, so
+// the writer stamps each sample when it is submitted.
+inline MetricSample make_metric(std::string name, double value, LabelSet labels = {})
+{
+    MetricSample sample;
+    sample.name = std::move(name);
+    sample.value = value;
+    sample.labels = std::move(labels);
+    return sample;
+}
+
+// An info sample: value 1, with the information in its labels.
+inline MetricSample make_info(std::string name, LabelSet labels = {})
+{
+    return make_metric(std::move(name), 1.0, std::move(labels));
+}
+
+}  // namespace edge_probe
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <linux/netlink.h>
+
+namespace edge_probe
+{
+
+// Copies a fixed-size kernel struct from the front of bytes; bytes missing at
+// the end read as zero.
+template <typename T>
+T read_netlink_struct(std::string_view bytes)
+{
+    T value {};
+    std::memcpy(&value, bytes.data(), std::min(bytes.size(), sizeof(value)));
+    return value;
+}
+
+// Attribute values: integers in host byte order, strings up to their NUL.
+inline std::uint8_t read_netlink_u8(std::string_view value)
+{
+    return read_netlink_struct<std::uint8_t>(value);
+}
+
+inline std::uint16_t read_netlink_u16(std::string_view value)
+{
+    return read_netlink_struct<std::uint16_t>(value);
+}
+
+inline std::uint32_t read_netlink_u32(std::string_view value)
+{
+    return read_netlink_struct<std::uint32_t>(value);
+}
+
+inline std::uint64_t read_netlink_u64(std::string_view value)
+{
+    return read_netlink_struct<std::uint64_t>(value);
+}
+
+inline std::string read_netlink_string(std::string_view value)
+{
+    return std::string(value.substr(0, value.find('\0')));
+}
+
+// A link-layer address as ip link and iw print it: lowercase hex bytes
+// separated by colons.
+inline std::string format_link_address(std::string_view bytes)
+{
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string text;
+    for (const unsigned char byte : bytes)
+    {
+        if (!text.empty())
+        {
+            text += ':';
+        }
+        text += kHex[byte >> 4];
+        text += kHex[byte & 0x0f];
+    }
+    return text;
+}
+
+// Calls fn(header, payload) for each message in a datagram or a capture of
+// back-to-back messages. Returns false when a length runs past the end.
+template <typename Fn>
+bool for_each_netlink_message(std::string_view messages, Fn &&fn)
+{
+    while (messages.size() >= NLMSG_HDRLEN)
+    {
+        const auto header = read_netlink_struct<nlmsghdr>(messages);
+        if (header.nlmsg_len < NLMSG_HDRLEN || header.nlmsg_len > messages.size())
+        {
+            return false;
+        }
+        fn(header, messages.substr(NLMSG_HDRLEN, header.nlmsg_len - NLMSG_HDRLEN));
+        messages.remove_prefix(
+            std::min<std::size_t>(NLMSG_ALIGN(header.nlmsg_len), messages.size()));
+    }
+    return true;
+}
+
+// Calls fn(type, value) for each attribute in attributes, with the nested and
+// byte-order flags cleared from type. Stops at a length that runs past the
+// end. rtattr and nlattr share this layout.
+template <typename Fn>
+void for_each_netlink_attribute(std::string_view attributes, Fn &&fn)
+{
+    while (attributes.size() >= NLA_HDRLEN)
+    {
+        const auto attribute = read_netlink_struct<nlattr>(attributes);
+        if (attribute.nla_len < NLA_HDRLEN || attribute.nla_len > attributes.size())
+        {
+            return;
+        }
+        fn(static_cast<std::uint16_t>(attribute.nla_type & NLA_TYPE_MASK),
+           attributes.substr(NLA_HDRLEN, attribute.nla_len - NLA_HDRLEN));
+        attributes.remove_prefix(
+            std::min<std::size_t>(NLA_ALIGN(attribute.nla_len), attributes.size()));
+    }
+}
+
+// Receives one message of an exchange with its header.
+using NetlinkMessageHandler =
+    std::function<void(const nlmsghdr &header, std::string_view payload)>;
+
+// The replies to one request, read datagram by datagram.
+class NetlinkExchange
+{
+public:
+    NetlinkExchange(std::uint32_t sequence, std::uint32_t port_id, bool is_dump);
+
+    // Passes each reply in datagram to handler until the exchange ends. Other
+    // ports' messages, notifications included, go to notification_handler
+    // when it is set; leftovers of this port's abandoned requests are dropped.
+    void read(std::string_view datagram,
+              const NetlinkMessageHandler &handler,
+              const NetlinkMessageHandler &notification_handler);
+
+    // A dump ends at NLMSG_DONE, any other request at its first reply.
+    bool finished() const;
+    // Whether the exchange finished without an error, a truncated datagram,
+    // or an interrupted dump.
+    bool succeeded() const;
+
+private:
+    std::uint32_t sequence_;
+    std::uint32_t port_id_;
+    bool is_dump_;
+    bool interrupted_ {false};
+    bool failed_ {false};
+    bool done_ {false};
+};
+
+// A netlink socket kept open for request and dump exchanges with the kernel,
+// and for notifications when it joins multicast groups.
+class NetlinkSocket
+{
+public:
+    // Receives each reply addressed to this request, with its header.
+    using ReplyHandler = NetlinkMessageHandler;
+
+    // Throws std::runtime_error when the socket cannot be opened or bound.
+    explicit NetlinkSocket(int protocol, std::uint32_t groups = 0);
+    ~NetlinkSocket();
+
+    NetlinkSocket(const NetlinkSocket &) = delete;
+    NetlinkSocket &operator=(const NetlinkSocket &) = delete;
+
+    int fd() const;
+
+    // Sends one message of type with body (the family header and attributes)
+    // and passes each reply to handler. With NLM_F_DUMP in flags the exchange
+    // ends at NLMSG_DONE, otherwise at the first reply. Notifications received
+    // meanwhile go to notification_handler, or are dropped without one.
+    // Returns false when the kernel reports an error, a datagram is truncated,
+    // or a dump is interrupted.
+    bool request(std::uint16_t type,
+                 std::uint16_t flags,
+                 std::string_view body,
+                 const ReplyHandler &handler,
+                 const ReplyHandler &notification_handler = {});
+
+    // Receives one datagram into the socket's buffer. On failure returns false
+    // with errno set; a datagram larger than the buffer fails with EMSGSIZE.
+    bool receive(int flags, std::string_view &datagram);
+
+private:
+    int fd_ {-1};
+    std::uint32_t port_id_ {0};
+    std::uint32_t sequence_ {0};
+    std::string request_;
+    std::vector<char> buffer_;
+};
+
+}  // namespace edge_probe
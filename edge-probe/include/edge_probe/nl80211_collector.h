@@ -0,0 +1,61 @@
+#pragma once
+
+#include "edge_probe/netlink_socket.h"
+#include "edge_probe/telemetry_sender.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace edge_probe
+{
+
+// The decoders take nl80211 replies as received: back-to-back netlink
+// messages, each a genetlink header and attributes. Control messages and
+// other commands are skipped, so a whole dump, NLMSG_DONE included, can be
+// passed as is.
+
+// NL80211_CMD_NEW_WIPHY replies, split or not, into the families and labels
+// of parse_iw_phy.
+std::vector<MetricSample> decode_nl80211_wiphy(std::string_view messages);
+// NL80211_CMD_NEW_INTERFACE replies into the families of parse_iw_dev.
+std::vector<MetricSample> decode_nl80211_interfaces(std::string_view messages);
+// NL80211_CMD_NEW_STATION replies for one interface into the per-station
+// families, labelled with interface_name and the station's MAC, plus
+// edge_wifi_stations_total.
+std::vector<MetricSample> decode_nl80211_stations(std::string_view messages,
+                                                  const std::string &interface_name);
+
+// Dumps wiphys, interfaces, and each interface's stations over one generic
+// netlink socket kept for the collector's lifetime, replacing iw dev and
+// iw phy. The dumps need no privileges.
+class Nl80211Collector
+{
+public:
+    // Resolves the nl80211 family. Throws std::runtime_error when the socket
+    // cannot be opened or no wireless driver has registered the family.
+    Nl80211Collector();
+
+    Nl80211Collector(const Nl80211Collector &) = delete;
+    Nl80211Collector &operator=(const Nl80211Collector &) = delete;
+
+    // Appends one cycle of samples. A dump that fails or is interrupted adds
+    // nothing for its families this cycle and is counted in dump_failures().
+    void collect(std::vector<MetricSample> &metrics);
+
+    std::uint64_t dump_failures() const;
+
+private:
+    // Collects the replies of one dump into messages_. A nonzero ifindex
+    // limits the dump to that interface.
+    bool dump(std::uint8_t command, std::uint32_t ifindex);
+
+    NetlinkSocket socket_;
+    std::uint16_t family_id_ {0};
+    std::string request_;
+    std::string messages_;
+    std::uint64_t dump_failures_ {0};
+};
+
+}  // namespace edge_probe
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace edge_probe
+{
+
+enum class PayloadCompression
+{
+    none,
+    gzip,
+    zstd,
+    snappy,
+};
+
+// Reuses one codec context and one output buffer across payloads.
+class PayloadCompressor
+{
+public:
+    // level 0 selects the codec default.
+    explicit PayloadCompressor(PayloadCompression compression, int level = 0);
+    ~PayloadCompressor();
+
+    PayloadCompressor(const PayloadCompressor &) = delete;
+    PayloadCompressor &operator=(const PayloadCompressor &) = delete;
+
+    PayloadCompression compression() const;
+
+    // The returned buffer is overwritten by the next call.
+    const std::string &compress(std::string_view input);
+
+    static bool supported(PayloadCompression compression);
+
+private:
+    struct Context;
+
+    PayloadCompression compression_;
+    std::unique_ptr<Context> context_;
+    std::string output_;
+};
+
+const char *payload_compression_name(PayloadCompression compression);
+
+// Value for the Content-Encoding header, or nullptr for uncompressed bodies.
+const char *payload_content_encoding(PayloadCompression compression);
+
+}  // namespace edge_probe
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "edge_probe/series_registry.h"
+#include "edge_probe/telemetry_sender.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace edge_probe
+{
+
+class MetricPrefixCache;
+
+// Serializes one batch incrementally. The encoded size is known after every
+// add(), so TelemetryWriter can seal batches on a byte target.
+class PayloadEncoder
+{
+public:
+    virtual ~PayloadEncoder() = default;
+
+    // Returns false, leaving the batch unchanged, when the sample would push a
+    // non-empty batch past max_bytes.
+    virtual bool add(const MetricSample &sample, std::size_t max_bytes) = 0;
+    virtual bool add(const SeriesRegistry &registry,
+                     const SeriesSample &sample,
+                     std::size_t max_bytes) = 0;
+    virtual std::size_t size_bytes() const = 0;
+
+    // The encoded batch; valid until the next add() or clear().
+    virtual const std::string &payload() = 0;
+    // Moves the encoded batch into output and continues in output's storage.
+    virtual void take_payload(std::string &output) = 0;
+    virtual void clear() = 0;
+
+    // The encoder's metric prefix cache, if it uses one.
+    virtual const MetricPrefixCache *prefix_cache() const
+    {
+        return nullptr;
+    }
+};
+
+// The encoder refers to config.external_labels, so config must outlive it.
+std::unique_ptr<PayloadEncoder> make_payload_encoder(const TelemetryConfig &config);
+
+}  // namespace edge_probe
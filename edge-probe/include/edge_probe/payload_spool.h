@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace edge_probe
+{
+
+class PayloadSpool
+{
+public:
+    struct Record
+    {
+        std::uint64_t id {0};
+        std::string body;
+        std::size_t sample_count {0};
+        int64_t enqueued_unix_ms {0};
+        std::uint32_t encoding {0};
+    };
+
+    PayloadSpool(std::string directory,
+                 std::size_t max_total_bytes,
+                 std::size_t segment_bytes,
+                 bool sync_writes = true);
+    ~PayloadSpool();
+
+    PayloadSpool(const PayloadSpool &) = delete;
+    PayloadSpool &operator=(const PayloadSpool &) = delete;
+
+    std::vector<Record> take_recovered();
+
+    std::optional<std::uint64_t> append(const std::string &body,
+                                        std::size_t sample_count,
+                                        int64_t enqueued_unix_ms,
+                                        std::uint32_t encoding = 0);
+    void ack(std::uint64_t id);
+    // Reads a live record back from disk. False once it was acked, evicted,
+    // or fails its checksum.
+    bool read(std::uint64_t id, Record &record) const;
+
+    std::size_t disk_bytes() const;
+    std::size_t live_records() const;
+    std::size_t segment_count() const;
+    std::uint64_t evicted_records() const;
+    std::uint64_t discarded_corrupt_records() const;
+
+private:
+    struct RecordEntry
+    {
+        std::uint64_t offset {0};
+        bool live {true};
+    };
+
+    struct Segment
+    {
+        std::uint64_t sequence {0};
+        std::string path;
+        std::size_t size {0};
+        std::uint64_t first_id {0};
+        std::vector<RecordEntry> records;
+        std::size_t live_count {0};
+    };
+
+    void recover();
+    void recover_segment(Segment &segment);
+    bool open_active_segment();
+    void roll_segment();
+    void evict_oldest_segment();
+    void remove_segment(std::size_t index);
+    std::size_t find_segment(std::uint64_t id) const;
+    std::string segment_path(std::uint64_t sequence) const;
+
+    std::string directory_;
+    std::size_t max_total_bytes_;
+    std::size_t segment_bytes_;
+    bool sync_writes_;
+
+    std::deque<Segment> segments_;
+    std::vector<Record> recovered_;
+    int active_fd_ {-1};
+    std::uint64_t next_id_ {1};
+    std::uint64_t next_sequence_ {1};
+    std::size_t disk_bytes_ {0};
+    std::size_t live_records_ {0};
+    std::uint64_t evicted_records_ {0};
+    std::uint64_t discarded_corrupt_records_ {0};
+};
+
+}  // namespace edge_probe
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "edge_probe/label_merge.h"
+#include "edge_probe/payload_encoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace edge_probe
+{
+
+// Encodes a batch as an uncompressed Prometheus remote_write WriteRequest.
+// Samples are grouped into one TimeSeries per label set, in first-seen order;
+// the label set includes __name__ and is emitted sorted by name.
+class RemoteWriteEncoder final : public PayloadEncoder
+{
+public:
+    // external_labels are merged into every series and must outlive the encoder.
+    explicit RemoteWriteEncoder(std::size_t reserve_bytes = 0,
+                                const ExternalLabels *external_labels = nullptr);
+
+    bool add(const MetricSample &sample, std::size_t max_bytes) override;
+    bool add(const SeriesRegistry &registry,
+             const SeriesSample &sample,
+             std::size_t max_bytes) override;
+    std::size_t size_bytes() const override;
+    const std::string &payload() override;
+    void take_payload(std::string &output) override;
+    void clear() override;
+
+    std::size_t series_count() const;
+
+private:
+    struct Series
+    {
+        std::string samples;
+    };
+
+    // Adds one sample to the series whose labels are encoded in labels_scratch_.
+    bool add_sample(double value, int64_t timestamp_ms, std::size_t max_bytes);
+
+    // Key is the encoded repeated Label field of the TimeSeries.
+    const ExternalLabels *external_labels_;
+    std::unordered_map<std::string, Series> series_;
+    std::vector<std::pair<const std::string, Series> *> series_order_;
+    std::size_t size_bytes_ {0};
+    std::string buffer_;
+    std::string labels_scratch_;
+    std::string sample_scratch_;
+};
+
+}  // namespace edge_probe
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "edge_probe/netlink_socket.h"
+#include "edge_probe/telemetry_sender.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace edge_probe
+{
+
+// Dumps links, addresses, IPv4 main-table routes, and neighbours over one
+// NETLINK_ROUTE socket kept for the collector's lifetime. It decodes the
+// attributes straight into the metric families of parse_ip_br_link,
+// parse_ip_br_addr, parse_ip_route, parse_ip_neigh, and, from IFLA_STATS64,
+// parse_proc_net_dev. The dumps need no privileges.
+class RtnetlinkCollector
+{
+public:
+    // Throws std::runtime_error when the socket cannot be opened.
+    RtnetlinkCollector();
+
+    RtnetlinkCollector(const RtnetlinkCollector &) = delete;
+    RtnetlinkCollector &operator=(const RtnetlinkCollector &) = delete;
+
+    // Appends one cycle of samples. A dump that fails or is interrupted adds
+    // nothing for its family this cycle and is counted in dump_failures().
+    void collect(std::vector<MetricSample> &metrics);
+
+    std::uint64_t dump_failures() const;
+
+private:
+    // Receives the payload of each reply message, starting with the family
+    // header (ifinfomsg, ifaddrmsg, rtmsg, or ndmsg).
+    using MessageHandler = std::function<void(std::string_view payload)>;
+
+    bool dump(std::uint16_t type,
+              std::size_t header_bytes,
+              unsigned char family,
+              const MessageHandler &handler);
+
+    NetlinkSocket socket_;
+    std::uint64_t dump_failures_ {0};
+};
+
+// Subscribes to the link, IPv4 address, IPv4 route, and neighbour multicast
+// groups and keeps a table of links and neighbours between collection cycles.
+// A change becomes samples as soon as its notification is read, so a flap
+// shorter than the polling interval is still seen and counted.
+class RtnetlinkEventMonitor
+{
+public:
+    // Joins the groups and loads the current links and neighbours without
+    // reporting them as changes. Throws std::runtime_error when the socket
+    // cannot be opened or the initial dumps fail.
+    RtnetlinkEventMonitor();
+
+    RtnetlinkEventMonitor(const RtnetlinkEventMonitor &) = delete;
+    RtnetlinkEventMonitor &operator=(const RtnetlinkEventMonitor &) = delete;
+
+    // Readable when notifications are pending.
+    int fd() const;
+
+    // Waits up to timeout_ms for a notification, then applies every pending
+    // one and appends the change samples. Returns the number of messages
+    // applied. After the kernel drops notifications (ENOBUFS) the table is
+    // reloaded and the differences are reported as changes.
+    std::size_t poll(int timeout_ms, std::vector<MetricSample> &changes);
+    // poll() into writer, sealing its batch at once when anything changed.
+    // Queued retries keep their backoff.
+    std::size_t poll(int timeout_ms, TelemetryWriter &writer);
+
+    // Applies one datagram of notifications, read from the socket or replayed
+    // from a capture. Returns the number of messages applied.
+    std::size_t apply(std::string_view datagram, std::vector<MetricSample> &changes);
+
+    // Appends the transition counters for every device seen so far.
+    void collect(std::vector<MetricSample> &metrics) const;
+
+    std::uint64_t overruns() const;
+
+private:
+    struct LinkState
+    {
+        int index {0};
+        std::string name;
+        bool up {false};
+        bool lower_up {false};
+    };
+
+    struct NeighbourState
+    {
+        int index {0};
+        std::string ip;
+        std::string state;
+    };
+
+    struct DeviceCounters
+    {
+        std::string device;
+        std::uint64_t link_flaps {0};
+        std::uint64_t address_changes {0};
+        std::uint64_t route_changes {0};
+        std::uint64_t neighbor_changes {0};
+    };
+
+    // A null changes loads the table without reporting.
+    bool reload(std::vector<MetricSample> *changes);
+    bool apply_message(std::uint16_t type,
+                       std::string_view payload,
+                       std::vector<MetricSample> *changes);
+    void apply_link(bool removed, std::string_view payload, std::vector<MetricSample> *changes);
+    void update_link(LinkState &link,
+                     bool up,
+                     bool lower_up,
+                     std::vector<MetricSample> *changes);
+    void apply_address(std::string_view payload, std::vector<MetricSample> *changes);
+    void apply_route(std::string_view payload, std::vector<MetricSample> *changes);
+    void apply_neighbour(bool removed,
+                         std::string_view payload,
+                         std::vector<MetricSample> *changes);
+    // An empty state removes the entry.
+    void set_neighbour(int index,
+                       const std::string &ip,
+                       const std::string &mac,
+                       const std::string &state,
+                       std::vector<MetricSample> *changes);
+    const std::string *link_name(int index) const;
+    DeviceCounters &counters(const std::string &device);
+
+    NetlinkSocket socket_;
+    std::vector<LinkState> links_;
+    std::vector<NeighbourState> neighbours_;
+    std::vector<DeviceCounters> counters_;
+    std::uint64_t overruns_ {0};
+};
+
+}  // namespace edge_probe
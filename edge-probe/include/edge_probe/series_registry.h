@@ -0,0 +1,112 @@
+#pragma once
+
+#include "edge_probe/telemetry_sender.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace edge_probe
+{
+
+using SeriesId = std::uint32_t;
+
+struct LabelView
+{
+    std::string_view name;
+    std::string_view value;
+};
+
+// A sample of an interned series; the registry supplies name and labels when
+// the sample is encoded.
+struct SeriesSample
+{
+    SeriesId series {0};
+    double value {0.0};
+    int64_t timestamp_ms {0};
+};
+
+class SeriesLabels
+{
+public:
+    SeriesLabels(const LabelView *begin, const LabelView *end) : begin_(begin), end_(end)
+    {
+    }
+
+    const LabelView *begin() const
+    {
+        return begin_;
+    }
+
+    const LabelView *end() const
+    {
+        return end_;
+    }
+
+    std::size_t size() const
+    {
+        return static_cast<std::size_t>(end_ - begin_);
+    }
+
+private:
+    const LabelView *begin_;
+    const LabelView *end_;
+};
+
+// Interns metric names and label sets into dense, stable series IDs. Strings
+// live once each in an append-only arena, and label sets are kept sorted by
+// name. Not thread-safe; intern and submit from the same thread.
+class SeriesRegistry
+{
+public:
+    SeriesRegistry();
+
+    SeriesRegistry(const SeriesRegistry &) = delete;
+    SeriesRegistry &operator=(const SeriesRegistry &) = delete;
+
+    SeriesId intern(std::string_view name, const LabelSet &labels);
+    // Labels may come in any order; for a repeated name the first value wins.
+    SeriesId intern(std::string_view name, std::initializer_list<LabelView> labels);
+    SeriesId intern(const MetricSample &sample);
+
+    bool contains(SeriesId id) const;
+    std::string_view name(SeriesId id) const;
+    SeriesLabels labels(SeriesId id) const;
+
+    std::size_t size() const;
+    // Heap bytes held by the arena, label table, and index.
+    std::size_t memory_bytes() const;
+
+private:
+    struct Series
+    {
+        std::string_view name;
+        std::uint32_t first_label {0};
+        std::uint32_t label_count {0};
+        std::uint64_t hash {0};
+    };
+
+    SeriesId intern_scratch(std::string_view name);
+    std::string_view store(std::string_view value);
+    bool matches(const Series &series, std::string_view name) const;
+    void grow_index();
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    std::size_t chunk_used_ {0};
+    std::size_t chunk_capacity_ {0};
+    std::size_t arena_bytes_ {0};
+    std::unordered_set<std::string_view> strings_;
+
+    std::vector<Series> series_;
+    std::vector<LabelView> labels_;
+    // Open-addressed by hash; each slot holds series ID + 1, or 0 when empty.
+    std::vector<std::uint32_t> index_;
+    std::vector<LabelView> scratch_;
+};
+
+}  // namespace edge_probe
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace edge_probe
+{
+
+// Raw snappy block format, as used by Prometheus remote_write bodies. Both
+// functions overwrite output.
+void snappy_compress(std::string_view input, std::string &output);
+bool snappy_uncompress(std::string_view input, std::string &output);
+
+}  // namespace edge_probe
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "edge_probe/telemetry_sender.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace edge_probe
+{
+
+// Plain HTTP/1.1 over a POSIX socket, for images that cannot carry libcurl.
+// Takes the endpoint, unix_socket_path, basic-auth credentials, and timeouts
+// from TelemetryConfig and keeps one keep-alive connection across posts. Only
+// http:// endpoints are supported. Concurrent posts are serialized.
+class SocketHttpTransport final : public HttpTransport
+{
+public:
+    SocketHttpTransport() = default;
+    ~SocketHttpTransport() override;
+
+    SocketHttpTransport(const SocketHttpTransport &) = delete;
+    SocketHttpTransport &operator=(const SocketHttpTransport &) = delete;
+
+    Result post_json_lines(const TelemetryConfig &config,
+                           const std::string &body) override;
+
+private:
+    struct Endpoint
+    {
+        std::string authority;
+        std::string host;
+        std::string port;
+        std::string target;
+    };
+
+    enum class Attempt
+    {
+        done,
+        // The connection failed before any response byte arrived.
+        connection_lost,
+        failed,
+    };
+
+    bool parse_endpoint(const TelemetryConfig &config, Result &result);
+    bool connect_socket(const TelemetryConfig &config, int64_t deadline_ms, Result &result);
+    Attempt send_request(const TelemetryConfig &config,
+                         const std::string &body,
+                         int64_t deadline_ms,
+                         Result &result);
+    Attempt read_response(int64_t deadline_ms, Result &result);
+    void close_socket();
+
+    std::mutex mutex_;
+    std::string endpoint_;
+    std::string unix_socket_path_;
+    Endpoint parsed_;
+    int fd_ {-1};
+    std::string head_;
+    std::string input_;
+};
+
+}  // namespace edge_probe
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace edge_probe
+{
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Slots are reused, so element storage (e.g. string capacity) can be
+// handed back and forth without reallocating.
+template <typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing(std::size_t capacity) : slots_(capacity)
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument("ring capacity must be > 0");
+        }
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    // Leaves value untouched when the ring is full.
+    bool try_push(T &&value)
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == slots_.size())
+        {
+            return false;
+        }
+
+        slots_[tail % slots_.size()] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T &value)
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        value = std::move(slots_[head % slots_.size()]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const
+    {
+        return slots_.size();
+    }
+
+private:
+    std::vector<T> slots_;
+    alignas(64) std::atomic<std::size_t> head_ {0};
+    alignas(64) std::atomic<std::size_t> tail_ {0};
+};
+
+}  // namespace edge_probe
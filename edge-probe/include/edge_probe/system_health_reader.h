@@ -0,0 +1,71 @@
+#pragma once
+
+#include "edge_probe/telemetry_sender.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace edge_probe
+{
+
+// Reads the system_health sources without shelling out. Each file is opened
+// once and re-read every cycle with pread() at offset 0 into one reused
+// buffer, then handed to the same parsers as the cat output of the command
+// plan. Thermal zones and hwmon temperature inputs are discovered when the
+// reader is built.
+class SystemHealthReader
+{
+public:
+    // The roots are parameters so tests can point the reader at a fake tree.
+    explicit SystemHealthReader(std::string proc_root = "/proc", std::string sys_root = "/sys");
+    ~SystemHealthReader();
+
+    SystemHealthReader(const SystemHealthReader &) = delete;
+    SystemHealthReader &operator=(const SystemHealthReader &) = delete;
+
+    // Appends one cycle of samples. A file that fails to read is skipped for
+    // the cycle, as the shell path discards stderr.
+    void collect(std::vector<MetricSample> &metrics);
+
+    std::size_t open_files() const;
+    std::size_t thermal_zones() const;
+    std::size_t hwmon_sensors() const;
+    std::uint64_t read_failures() const;
+
+private:
+    enum class Source
+    {
+        loadavg,
+        meminfo,
+        net_dev,
+        thermal_zone,
+        hwmon_temp,
+    };
+
+    struct OpenFile
+    {
+        Source source {Source::loadavg};
+        int fd {-1};
+        // Thermal zone name, or the hwmonN directory for a hwmon input.
+        std::string device;
+        std::string chip;
+        std::string sensor;
+    };
+
+    void open_file(Source source, const std::string &path, OpenFile file);
+    void discover_thermal_zones();
+    void discover_hwmon_sensors();
+    bool read(const OpenFile &file);
+
+    std::string proc_root_;
+    std::string sys_root_;
+    std::vector<OpenFile> files_;
+    std::string buffer_;
+    std::size_t thermal_zones_ {0};
+    std::size_t hwmon_sensors_ {0};
+    std::uint64_t read_failures_ {0};
+};
+
+}  // namespace edge_probe
@@ -1,10 +1,19 @@
 #pragma once
 
+#include "edge_probe/json_escape.h"
+#include "edge_probe/label_merge.h"
+#include "edge_probe/label_set.h"
+#include "edge_probe/payload_compressor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
-#include <map>
+#include <deque>
 #include <memory>
-#include <optional>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace edge_probe
@@ -14,15 +23,29 @@ struct MetricSample
 {
     std::string name;
     double value {0.0};
-    std::map<std::string, std::string> labels;
+    LabelSet labels;
     int64_t timestamp_ms {0};
 };
 
+enum class PayloadFormat
+{
+    // VictoriaMetrics /api/v1/import.
+    json_lines,
+    // Prometheus remote_write protobuf, snappy-compressed, for /api/v1/write.
+    remote_write,
+};
+
+const char *payload_content_type(PayloadFormat format);
+
 struct TelemetryConfig
 {
     std::string endpoint;
     std::string username;
     std::string password;
+    // When set, transports connect to this AF_UNIX socket, e.g. a local relay
+    // agent, instead of the endpoint's host; the endpoint still supplies the
+    // scheme, Host header, and path.
+    std::string unix_socket_path;
 
     std::size_t max_batch_samples {50};
     int flush_interval_ms {5000};
@@ -30,7 +53,40 @@ struct TelemetryConfig
     int retry_initial_ms {5000};
     int retry_max_ms {60000};
 
+    // Serialized size, before compression, at which the open batch is sealed.
     std::size_t max_pending_payload_bytes {256 * 1024};
+    // Memory for payloads waiting to be posted: retries, plus in foreground
+    // mode the batches sealed since the last tick(), which may also use
+    // max_pending_payload_bytes of headroom.
+    std::size_t max_retry_queue_bytes {1024 * 1024};
+
+    PayloadFormat payload_format {PayloadFormat::json_lines};
+    // Added to every series when it is encoded, e.g. device and site. A label
+    // the sample already carries takes precedence.
+    ExternalLabels external_labels;
+    // json_lines only: emit one line per series (name plus labels) with all of
+    // its points in the batch, instead of one line per sample. remote_write
+    // always groups by series.
+    bool group_series {false};
+    // json_lines only: escaped {"metric":{...}} objects kept for reuse, least
+    // recently used evicted first. 0 disables the cache.
+    std::size_t metric_prefix_cache_entries {1024};
+
+    // Batches are spooled before their first post and acked once delivered,
+    // so a restart resends what was queued or in flight. Retries beyond
+    // max_retry_queue_bytes wait on disk up to max_spool_bytes.
+    std::string spool_directory;
+    std::size_t max_spool_bytes {16 * 1024 * 1024};
+    std::size_t spool_segment_bytes {1024 * 1024};
+    bool spool_sync_writes {true};
+
+    PayloadCompression compression {PayloadCompression::none};
+    int compression_level {0};
+
+    // Sends from a dedicated thread; submit() and tick() only hand batches over.
+    bool background_sender {false};
+    std::size_t sender_queue_capacity {64};
+
     long connect_timeout_sec {10};
     long request_timeout_sec {20};
 
@@ -62,26 +118,72 @@ public:
         long http_code {0};
         std::string response_body;
         std::string error_message;
+        // Microseconds from the start of the request, when the transport can
+        // measure them; tls_time_us stays 0 for plain HTTP.
+        int64_t connect_time_us {0};
+        int64_t tls_time_us {0};
+        int64_t total_time_us {0};
+        bool reused_connection {false};
     };
 
     virtual ~HttpTransport() = default;
+    // Posts one encoded batch; config.payload_format and config.compression
+    // describe the body.
     virtual Result post_json_lines(const TelemetryConfig &config,
                                    const std::string &body) = 0;
+    // Posts several batches and returns one result per body, in order. The
+    // default posts them one after another; a transport that overlaps them
+    // reports how many through max_in_flight().
+    virtual std::vector<Result> post_many(const TelemetryConfig &config,
+                                          const std::vector<const std::string *> &bodies);
+    virtual std::size_t max_in_flight() const
+    {
+        return 1;
+    }
 };
 
-std::string json_escape(const std::string &value);
+class PayloadSpool;
+class SeriesRegistry;
+struct SeriesSample;
+
+template <typename T>
+class SpscRing;
 
 class TelemetryWriter
 {
 public:
+    struct SubmitResult
+    {
+        std::size_t accepted {0};
+        std::size_t dropped {0};
+    };
+
     TelemetryWriter(TelemetryConfig config,
                     std::shared_ptr<HttpTransport> transport,
                     std::shared_ptr<Clock> clock = std::make_shared<SystemClock>());
     ~TelemetryWriter();
 
     bool submit(MetricSample sample);
+    // Submits a sample of an interned series. The registry is read during the
+    // call only. Returns false for an ID the registry does not know.
+    bool submit(const SeriesRegistry &registry, SeriesSample sample);
+    // Submits a parser's output as one group: unset timestamps share a single
+    // clock read, and each sample is encoded straight from the vector.
+    SubmitResult submit_batch(std::vector<MetricSample> samples);
+    // Samples with IDs the registry does not know are dropped and counted.
+    SubmitResult submit_batch(const SeriesRegistry &registry,
+                              const std::vector<SeriesSample> &samples);
     void tick();
     void force_flush();
+    // Seals the open batch now and posts it as tick() would: during a retry
+    // backoff it queues behind the retries instead of posting. For callers
+    // that report events promptly without force_flush() draining the queue.
+    void flush_open_batch();
+
+    // Background mode: blocks until the sender thread has taken every batch
+    // handed over so far and acted on the retry timer at the current clock.
+    // Returns immediately otherwise.
+    void wait_idle();
 
     std::uint64_t sent_batches() const;
     std::uint64_t send_failures() const;
@@ -90,14 +192,65 @@ public:
 
     std::size_t buffered_samples() const;
     bool has_pending_payload() const;
+    std::size_t queued_payloads() const;
+    std::size_t queued_payload_bytes() const;
+    int64_t oldest_queued_payload_age_ms() const;
+    std::size_t spool_disk_bytes() const;
     int64_t next_retry_at_ms() const;
     int64_t last_success_unix_ms() const;
 
+    std::uint64_t prefix_cache_hits() const;
+    std::uint64_t prefix_cache_misses() const;
+    std::uint64_t prefix_cache_evictions() const;
+
+    // The counters above as edge_sender_* samples with unset timestamps, to be
+    // submitted alongside collected metrics.
+    std::vector<MetricSample> self_metrics() const;
+
 private:
     class BatchBuffer;
 
+    struct QueuedPayload
+    {
+        std::string body;
+        std::size_t sample_count {0};
+        int64_t enqueued_monotonic_ms {0};
+        std::uint64_t spool_id {0};
+        PayloadCompression compression {PayloadCompression::none};
+        // Size before compression, for logging.
+        std::size_t raw_bytes {0};
+        // Body size of a spilled payload, whose body is on disk only.
+        std::size_t spilled_bytes {0};
+    };
+
+    void add_to_batch(const MetricSample &sample, int64_t now_monotonic_ms);
+    void add_to_batch(const SeriesRegistry &registry,
+                      const SeriesSample &sample,
+                      int64_t now_monotonic_ms);
     void flush_batch();
-    void retry_pending();
+    void seal_batch();
+    void send_ready_batches();
+    // Foreground mode: retries whose backoff has passed, then ready batches.
+    void send_due_payloads(int64_t now_monotonic_ms);
+    bool send_batch(QueuedPayload &payload);
+    void hand_off_batch();
+    void notify_sender();
+    void run_sender();
+    void accept_handoffs(bool send);
+    void send_window();
+    void recycle_body(std::string body);
+    void update_queue_stats();
+    void spool_payload(QueuedPayload &payload);
+    void enqueue_payload(QueuedPayload payload);
+    void admit_to_queue(QueuedPayload payload);
+    void release_queued(const QueuedPayload &payload);
+    void reload_spilled();
+    void recover_spool();
+    void drain_queue();
+    std::vector<HttpTransport::Result> post_payloads(
+        const std::vector<const std::string *> &bodies,
+        PayloadCompression compression);
+    void on_send_success();
     void schedule_retry(const HttpTransport::Result &result);
     static std::string truncate(const std::string &value, std::size_t max_len);
     static void log(const std::string &level, const std::string &message);
@@ -106,19 +259,49 @@ private:
     std::shared_ptr<HttpTransport> transport_;
     std::shared_ptr<Clock> clock_;
     std::unique_ptr<BatchBuffer> batch_;
+    std::unique_ptr<PayloadCompressor> compressor_;
+    std::unique_ptr<PayloadSpool> spool_;
 
-    std::optional<std::string> pending_payload_;
-    std::size_t pending_payload_sample_count_ {0};
+    // Foreground mode: batches sealed on submit, posted by the next tick() or
+    // force_flush(). They join retry_queue_ only after a failed post.
+    std::deque<QueuedPayload> ready_batches_;
+    std::atomic<std::size_t> ready_payload_bytes_ {0};
+    std::deque<QueuedPayload> retry_queue_;
+    // Spooled retries past max_retry_queue_bytes, without their bodies. They
+    // stay on disk, within max_spool_bytes, until the retry queue has room.
+    std::deque<QueuedPayload> spilled_;
+    std::atomic<std::size_t> queued_payload_bytes_ {0};
+    std::atomic<std::size_t> queued_payload_count_ {0};
+    std::atomic<int64_t> oldest_queued_monotonic_ms_ {0};
+    std::atomic<std::size_t> spool_disk_bytes_ {0};
 
     int retry_count_ {0};
-    int64_t next_retry_at_ms_ {0};
+    std::atomic<int64_t> next_retry_at_ms_ {0};
     int next_retry_delay_ms_ {0};
 
-    std::uint64_t sent_batches_ {0};
-    std::uint64_t send_failures_ {0};
-    std::uint64_t dropped_samples_ {0};
-    std::uint64_t dropped_batches_ {0};
-    int64_t last_success_unix_ms_ {0};
+    std::atomic<std::uint64_t> sent_batches_ {0};
+    std::atomic<std::uint64_t> send_failures_ {0};
+    std::atomic<std::uint64_t> dropped_samples_ {0};
+    std::atomic<std::uint64_t> dropped_batches_ {0};
+    std::atomic<int64_t> last_success_unix_ms_ {0};
+
+    std::size_t max_in_flight_ {1};
+    // Batches posted together: hand-offs on the sender thread, or ready
+    // batches in foreground mode.
+    std::vector<QueuedPayload> send_window_;
+    std::vector<const std::string *> window_bodies_;
+
+    std::unique_ptr<SpscRing<QueuedPayload>> handoff_;
+    std::unique_ptr<SpscRing<std::string>> recycled_bodies_;
+    std::thread sender_thread_;
+    std::mutex sender_mutex_;
+    std::condition_variable sender_wake_;
+    std::condition_variable sender_idle_;
+    std::uint64_t wake_requests_ {0};
+    std::uint64_t wakes_handled_ {0};
+    std::uint64_t flush_requests_ {0};
+    std::uint64_t flushes_handled_ {0};
+    bool stop_sender_ {false};
 };
 
 }  // namespace edge_probe
@@ -1,13 +1,17 @@
 #include "edge_probe/collectors.h"
 
+#include "edge_probe/metric_sample_builders.h"
+
 #include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <cmath>
-#include <regex>
+#include <cstddef>
+#include <iterator>
 #include <set>
-#include <sstream>
 #include <stdexcept>
 #include <unordered_map>
+#include <string_view>
 #include <utility>
 
 namespace edge_probe
@@ -16,155 +20,396 @@ namespace edge_probe
 namespace
 {
 
-std::string trim(const std::string &value)
+bool is_space(char value)
+{
+    return value == ' ' || (value >= '\t' && value <= '\r');
+}
+
+bool is_digit(char value)
+{
+    return value >= '0' && value <= '9';
+}
+
+bool is_word(char value)
+{
+    return is_digit(value) || value == '_' || (value >= 'a' && value <= 'z') ||
+           (value >= 'A' && value <= 'Z');
+}
+
+bool is_mac_char(char value)
+{
+    return std::isxdigit(static_cast<unsigned char>(value)) || value == ':';
+}
+
+bool equals_ignore_case(std::string_view left, std::string_view right)
+{
+    return left.size() == right.size() &&
+           std::equal(left.begin(), left.end(), right.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) ==
+                      std::tolower(static_cast<unsigned char>(b));
+           });
+}
+
+std::string_view trim_view(std::string_view value)
 {
     const auto begin = value.find_first_not_of(" \t\r\n");
-    if (begin == std::string::npos)
+    if (begin == std::string_view::npos)
     {
-        return "";
+        return {};
     }
 
     const auto end = value.find_last_not_of(" \t\r\n");
     return value.substr(begin, end - begin + 1);
 }
 
-std::vector<std::string> split_lines(const std::string &value)
+std::string trim(std::string_view value)
+{
+    return std::string(trim_view(value));
+}
+
+bool consume(std::string_view &text, std::string_view prefix)
+{
+    if (text.substr(0, prefix.size()) != prefix)
+    {
+        return false;
+    }
+    text.remove_prefix(prefix.size());
+    return true;
+}
+
+// Drops leading whitespace; false when there was none, so it stands in for \s+.
+bool skip_spaces(std::string_view &text)
 {
-    std::vector<std::string> lines;
-    std::istringstream input(value);
-    std::string line;
-    while (std::getline(input, line))
+    std::size_t count = 0;
+    while (count < text.size() && is_space(text[count]))
     {
-        lines.push_back(line);
+        ++count;
     }
-    return lines;
+    text.remove_prefix(count);
+    return count > 0;
 }
 
-std::vector<std::string> split_whitespace(const std::string &value)
+template <typename Predicate>
+std::string_view take_while(std::string_view &text, Predicate predicate)
 {
-    std::vector<std::string> tokens;
-    std::istringstream input(value);
-    std::string token;
-    while (input >> token)
+    std::size_t count = 0;
+    while (count < text.size() && predicate(text[count]))
     {
-        tokens.push_back(token);
+        ++count;
     }
-    return tokens;
+    const std::string_view taken = text.substr(0, count);
+    text.remove_prefix(count);
+    return taken;
 }
 
-std::vector<std::string> split_columns(const std::string &value)
+std::string_view take_digits(std::string_view &text)
 {
-    std::vector<std::string> columns;
-    static const std::regex separator("\\s{2,}");
+    return take_while(text, is_digit);
+}
 
-    const std::string cleaned = trim(value);
-    if (cleaned.empty())
+std::string_view take_token(std::string_view &text)
+{
+    return take_while(text, [](char value) { return !is_space(value); });
+}
+
+// [0-9]+(\.[0-9]+)?, or empty when text does not start with a digit.
+std::string_view take_decimal(std::string_view &text)
+{
+    std::size_t count = 0;
+    while (count < text.size() && is_digit(text[count]))
     {
-        return columns;
+        ++count;
     }
-
-    std::sregex_token_iterator it(cleaned.begin(), cleaned.end(), separator, -1);
-    std::sregex_token_iterator end;
-    for (; it != end; ++it)
+    if (count > 0 && count + 1 < text.size() && text[count] == '.' &&
+        is_digit(text[count + 1]))
     {
-        const std::string token = trim(*it);
-        if (!token.empty())
+        count += 2;
+        while (count < text.size() && is_digit(text[count]))
         {
-            columns.push_back(token);
+            ++count;
         }
     }
-    return columns;
+    const std::string_view taken = text.substr(0, count);
+    text.remove_prefix(count);
+    return taken;
 }
 
-std::string strip_quotes(const std::string &value)
+// \(([^)]+)\): sets inner and drops the group from text.
+bool take_parenthesized(std::string_view &text, std::string_view &inner)
 {
-    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+    const auto close = text.find(')');
+    if (text.empty() || text.front() != '(' || close == std::string_view::npos || close < 2)
     {
-        return value.substr(1, value.size() - 2);
+        return false;
+    }
+    inner = text.substr(1, close - 1);
+    text.remove_prefix(close + 1);
+    return true;
+}
+
+// Reads the leading number like std::stod, including its exceptions, but
+// without a std::string copy or the locale-aware strtod.
+double to_double(std::string_view text)
+{
+    skip_spaces(text);
+    if (text.size() > 1 && text.front() == '+' && text[1] != '-')
+    {
+        text.remove_prefix(1);
+    }
+    const char *end = text.data() + text.size();
+    double value = 0.0;
+
+    std::string_view hex = text;
+    const bool negative = consume(hex, "-");
+    if ((consume(hex, "0x") || consume(hex, "0X")) && !hex.empty() && hex.front() != '-' &&
+        std::from_chars(hex.data(), end, value, std::chars_format::hex).ec == std::errc())
+    {
+        return negative ? -value : value;
+    }
+
+    const auto parsed = std::from_chars(text.data(), end, value);
+    if (parsed.ec == std::errc::invalid_argument)
+    {
+        throw std::invalid_argument("not a number: " + std::string(text));
+    }
+    if (parsed.ec == std::errc::result_out_of_range)
+    {
+        throw std::out_of_range("number out of range: " + std::string(text));
     }
     return value;
 }
 
-MetricSample make_metric(std::string name,
-                         double value,
-                         std::map<std::string, std::string> labels = {})
+// A lazy range over the pieces of a text, as views into it; next() splits the
+// following piece off the unread rest and returns false once there is none.
+class ViewRange
 {
-    MetricSample sample;
-    sample.name = std::move(name);
-    sample.value = value;
-    sample.labels = std::move(labels);
-    return sample;
+public:
+    using Next = bool (*)(std::string_view &rest, std::string_view &piece);
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view *;
+        using reference = const std::string_view &;
+
+        iterator() = default;
+        iterator(std::string_view rest, Next next) : rest_(rest), next_(next)
+        {
+            ++*this;
+        }
+
+        reference operator*() const
+        {
+            return piece_;
+        }
+
+        pointer operator->() const
+        {
+            return &piece_;
+        }
+
+        iterator &operator++()
+        {
+            done_ = !next_(rest_, piece_);
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const iterator &other) const
+        {
+            return done_ == other.done_ && (done_ || piece_.data() == other.piece_.data());
+        }
+
+        bool operator!=(const iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        std::string_view rest_;
+        std::string_view piece_;
+        Next next_ {nullptr};
+        bool done_ {true};
+    };
+
+    ViewRange(std::string_view text, Next next) : text_(text), next_(next) {}
+
+    iterator begin() const
+    {
+        return {text_, next_};
+    }
+
+    iterator end() const
+    {
+        return {};
+    }
+
+private:
+    std::string_view text_;
+    Next next_;
+};
+
+// As std::getline: a final newline does not start another, empty line.
+bool next_line(std::string_view &rest, std::string_view &line)
+{
+    if (rest.empty())
+    {
+        return false;
+    }
+    const auto newline = rest.find('\n');
+    line = rest.substr(0, newline);
+    rest.remove_prefix(newline == std::string_view::npos ? rest.size() : newline + 1);
+    return true;
 }
 
-MetricSample make_info(std::string name, std::map<std::string, std::string> labels = {})
+bool next_token(std::string_view &rest, std::string_view &token)
 {
-    return make_metric(std::move(name), 1.0, std::move(labels));
+    skip_spaces(rest);
+    token = take_token(rest);
+    return !token.empty();
+}
+
+ViewRange lines_of(std::string_view text)
+{
+    return {text, next_line};
+}
+
+ViewRange tokens_of(std::string_view text)
+{
+    return {text, next_token};
+}
+
+// Refills tokens in place; once its capacity covers the widest line, the
+// vector no longer allocates.
+void assign_tokens(std::vector<std::string_view> &tokens, std::string_view text)
+{
+    tokens.clear();
+    for (const auto token : tokens_of(text))
+    {
+        tokens.push_back(token);
+    }
 }
 
-std::set<std::string> parse_angle_flags(const std::string &value)
+// Columns are separated by two or more whitespace characters.
+void assign_columns(std::vector<std::string_view> &columns, std::string_view text)
+{
+    columns.clear();
+    std::string_view rest = trim_view(text);
+    while (!rest.empty())
+    {
+        std::size_t end = 0;
+        while (end < rest.size() &&
+               !(end + 1 < rest.size() && is_space(rest[end]) && is_space(rest[end + 1])))
+        {
+            ++end;
+        }
+
+        const std::string_view column = trim_view(rest.substr(0, end));
+        if (!column.empty())
+        {
+            columns.push_back(column);
+        }
+        rest.remove_prefix(end);
+        skip_spaces(rest);
+    }
+}
+
+std::string_view strip_quotes(std::string_view value)
+{
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+    {
+        return value.substr(1, value.size() - 2);
+    }
+    return value;
+}
+
+// Whether flag is one of the comma-separated names in "<UP,LOWER_UP>".
+bool has_angle_flag(std::string_view value, std::string_view flag)
 {
-    std::set<std::string> flags;
     const auto left = value.find('<');
     const auto right = value.find('>');
-    if (left == std::string::npos || right == std::string::npos || right <= left + 1)
+    if (left == std::string_view::npos || right == std::string_view::npos || right <= left + 1)
     {
-        return flags;
+        return false;
     }
 
-    std::stringstream stream(value.substr(left + 1, right - left - 1));
-    std::string flag;
-    while (std::getline(stream, flag, ','))
+    std::string_view flags = value.substr(left + 1, right - left - 1);
+    while (true)
     {
-        flag = trim(flag);
-        if (!flag.empty())
+        const auto comma = flags.find(',');
+        if (trim_view(flags.substr(0, comma)) == flag)
+        {
+            return true;
+        }
+        if (comma == std::string_view::npos)
         {
-            flags.insert(flag);
+            return false;
         }
+        flags.remove_prefix(comma + 1);
     }
-    return flags;
 }
 
-std::map<std::string, std::string> parse_key_value_lines(const std::string &value)
+// Calls fn(key, value) for each KEY=value line, quotes stripped from the value.
+template <typename Fn>
+void for_each_key_value(std::string_view text, Fn &&fn)
 {
-    std::map<std::string, std::string> parsed;
-    for (const auto &line : split_lines(value))
+    for (const auto line : lines_of(text))
     {
         const auto pos = line.find('=');
-        if (pos == std::string::npos)
+        if (pos == std::string_view::npos)
         {
             continue;
         }
 
-        const std::string key = trim(line.substr(0, pos));
-        const std::string val = strip_quotes(trim(line.substr(pos + 1)));
+        const std::string_view key = trim_view(line.substr(0, pos));
         if (!key.empty())
         {
-            parsed[key] = val;
+            fn(key, strip_quotes(trim_view(line.substr(pos + 1))));
         }
     }
-    return parsed;
 }
 
-double parse_human_quantity(const std::string &value)
+double parse_human_quantity(std::string_view value)
 {
-    static const std::regex pattern("^([0-9]+(?:\\.[0-9]+)?)([KMGTP]?)(?:i?B|B)?$",
-                                    std::regex::icase);
-    std::smatch match;
-    const std::string cleaned = trim(value);
-    if (!std::regex_match(cleaned, match, pattern))
+    // [0-9]+(\.[0-9]+)? with an optional K/M/G/T/P and B or iB, in any case;
+    // anything else is read like std::stod.
+    const std::string_view cleaned = trim_view(value);
+    std::string_view rest = cleaned;
+    const std::string_view number = take_decimal(rest);
+    const auto upper = [](char letter) {
+        return static_cast<char>(std::toupper(static_cast<unsigned char>(letter)));
+    };
+    char unit = '\0';
+    if (!rest.empty() && std::string_view("KMGTP").find(upper(rest.front())) !=
+                             std::string_view::npos)
     {
-        return std::stod(cleaned);
+        unit = upper(rest.front());
+        rest.remove_prefix(1);
     }
-
-    double numeric = std::stod(match[1].str());
-    const std::string unit = match[2].str();
-    if (unit.empty())
+    if (rest.size() == 2 && upper(rest.front()) == 'I')
+    {
+        rest.remove_prefix(1);
+    }
+    if (rest.size() == 1 && upper(rest.front()) == 'B')
+    {
+        rest.remove_prefix(1);
+    }
+    if (number.empty() || !rest.empty())
     {
-        return numeric;
+        return to_double(cleaned);
     }
 
-    const char upper = static_cast<char>(std::toupper(unit.front()));
-    switch (upper)
+    double numeric = to_double(number);
+    switch (unit)
     {
         case 'K':
             numeric *= 1024.0;
@@ -187,59 +432,342 @@ double parse_human_quantity(const std::string &value)
     return numeric;
 }
 
-double parse_duration_seconds(const std::string &value)
+// Sums every [0-9]+(\.[0-9]+)?(ms|s|min|h) token, e.g. "1min 2.5s".
+double parse_duration_seconds(std::string_view value)
 {
-    static const std::regex token_pattern("([0-9]+(?:\\.[0-9]+)?)(ms|s|min|h)");
     double seconds = 0.0;
-    auto begin = std::sregex_iterator(value.begin(), value.end(), token_pattern);
-    auto end = std::sregex_iterator();
-    for (auto it = begin; it != end; ++it)
+    while (!value.empty())
     {
-        const double number = std::stod((*it)[1].str());
-        const std::string unit = (*it)[2].str();
-        if (unit == "ms")
+        if (!is_digit(value.front()))
         {
-            seconds += number / 1000.0;
+            value.remove_prefix(1);
+            continue;
         }
-        else if (unit == "s")
+
+        std::string_view rest = value;
+        const std::string_view number = take_decimal(rest);
+        if (consume(rest, "ms"))
         {
-            seconds += number;
+            seconds += to_double(number) / 1000.0;
         }
-        else if (unit == "min")
+        else if (consume(rest, "s"))
         {
-            seconds += number * 60.0;
+            seconds += to_double(number);
         }
-        else if (unit == "h")
+        else if (consume(rest, "min"))
         {
-            seconds += number * 3600.0;
+            seconds += to_double(number) * 60.0;
         }
+        else if (consume(rest, "h"))
+        {
+            seconds += to_double(number) * 3600.0;
+        }
+        else
+        {
+            // The fraction may still start a token, as "11.6s" in "1.11.6s".
+            take_digits(value);
+            continue;
+        }
+        value = rest;
     }
     return seconds;
 }
 
+// "* 5260 MHz [52] (20.0 dBm) (radar detection)"; extra is the optional
+// second parenthesized note.
+struct FrequencyLine
+{
+    std::string_view mhz;
+    std::string_view channel;
+    std::string_view primary;
+    std::string_view extra;
+};
+
+bool match_frequency_line(std::string_view line, FrequencyLine &parsed)
+{
+    return consume(line, "*") && skip_spaces(line) &&
+           !(parsed.mhz = take_digits(line)).empty() && skip_spaces(line) &&
+           consume(line, "MHz") && skip_spaces(line) && consume(line, "[") &&
+           !(parsed.channel = take_digits(line)).empty() && consume(line, "]") &&
+           skip_spaces(line) && take_parenthesized(line, parsed.primary) &&
+           (line.empty() ||
+            (skip_spaces(line) && take_parenthesized(line, parsed.extra) && line.empty()));
+}
+
+// "* managed: 0x00 0x10 ..."; mode runs to the first colon.
+bool match_frame_line(std::string_view line, std::string_view &mode, std::string_view &values)
+{
+    if (!consume(line, "*") || line.empty() || !is_space(line.front()))
+    {
+        return false;
+    }
+    const auto colon = line.find(':');
+    if (colon == std::string_view::npos || colon < 2 || colon + 2 >= line.size() ||
+        !is_space(line[colon + 1]))
+    {
+        return false;
+    }
+    mode = line.substr(1, colon - 1);
+    values = line.substr(colon + 2);
+    skip_spaces(mode);
+    skip_spaces(values);
+    mode = trim_view(mode);
+    values = trim_view(values);
+    return true;
+}
+
+// "* [ SCHED_SCAN_RELATIVE_RSSI ]: description"; the brackets and the
+// description are optional, and the feature is the shortest text that
+// leaves only them behind.
+bool match_feature_line(std::string_view line, std::string_view &feature)
+{
+    if (!consume(line, "*") || !skip_spaces(line))
+    {
+        return false;
+    }
+
+    const auto ends_feature = [](std::string_view tail) {
+        std::string_view after_bracket = tail;
+        skip_spaces(after_bracket);
+        if (consume(after_bracket, "]"))
+        {
+            tail = after_bracket;
+        }
+        return tail.empty() || (tail.size() >= 3 && tail[0] == ':' && is_space(tail[1]));
+    };
+
+    std::string_view bracketed = line;
+    if (consume(bracketed, "["))
+    {
+        skip_spaces(bracketed);
+    }
+    for (const std::string_view candidate : {bracketed, line})
+    {
+        for (std::size_t end = 1; end <= candidate.size() && candidate[end - 1] != ']'; ++end)
+        {
+            if (ends_feature(candidate.substr(end)))
+            {
+                feature = trim_view(candidate.substr(0, end));
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// "Coverage class: 0 (up to 0m)": an integer after the first colon, then
+// optionally whitespace and anything.
+bool match_number_line(std::string_view line, std::string_view &key, std::string_view &number)
+{
+    const auto colon = line.find(':');
+    if (colon == 0 || colon == std::string_view::npos)
+    {
+        return false;
+    }
+    key = trim_view(line.substr(0, colon));
+    line.remove_prefix(colon + 1);
+    if (!skip_spaces(line))
+    {
+        return false;
+    }
+
+    std::string_view rest = line;
+    consume(rest, "-");
+    if (take_digits(rest).empty() || (!rest.empty() && !is_space(rest.front())))
+    {
+        return false;
+    }
+    number = line.substr(0, line.size() - rest.size());
+    return true;
+}
+
+// "Loaded: loaded (/lib/systemd/system/hostapd.service; enabled; preset: enabled)"
+// after the "Loaded:" prefix. Fields are untrimmed.
+struct LoadedLine
+{
+    std::string_view load_state;
+    std::string_view unit_path;
+    std::string_view enabled_state;
+    std::string_view preset;
+};
+
+bool match_loaded_line(std::string_view line, LoadedLine &parsed)
+{
+    const auto open = line.find('(');
+    if (open == std::string_view::npos || open < 3 || !is_space(line.front()) ||
+        !is_space(line[open - 1]))
+    {
+        return false;
+    }
+    parsed.load_state = line.substr(1, open - 2);
+    skip_spaces(parsed.load_state);
+    line.remove_prefix(open + 1);
+
+    const auto first_semicolon = line.find(';');
+    if (first_semicolon == std::string_view::npos || first_semicolon == 0)
+    {
+        return false;
+    }
+    parsed.unit_path = line.substr(0, first_semicolon);
+    line.remove_prefix(first_semicolon + 1);
+    // Whitespace may itself be the field, as in a regex \s*([^;]+).
+    bool spaced = skip_spaces(line);
+
+    const auto second_semicolon = line.find(';');
+    if (second_semicolon == std::string_view::npos || (second_semicolon == 0 && !spaced))
+    {
+        return false;
+    }
+    parsed.enabled_state = line.substr(0, second_semicolon);
+    line.remove_prefix(second_semicolon + 1);
+
+    skip_spaces(line);
+    if (!consume(line, "preset:"))
+    {
+        return false;
+    }
+    spaced = skip_spaces(line);
+    const auto close = line.find(')');
+    if (close == std::string_view::npos || (close == 0 && !spaced) || close + 1 != line.size())
+    {
+        return false;
+    }
+    parsed.preset = line.substr(0, close);
+    return true;
+}
+
+// Calls fn with every occurrence of prefix followed by digits, such as
+// /dev/ttyUSB0, anywhere in text.
+template <typename Fn>
+void for_each_numbered_path(std::string_view text, std::string_view prefix, Fn &&fn)
+{
+    for (auto pos = text.find(prefix); pos != std::string_view::npos; pos = text.find(prefix, pos))
+    {
+        std::string_view rest = text.substr(pos + prefix.size());
+        const std::size_t digits = take_digits(rest).size();
+        if (digits == 0)
+        {
+            ++pos;
+            continue;
+        }
+        fn(text.substr(pos, prefix.size() + digits));
+        pos += prefix.size() + digits;
+    }
+}
+
+// "(policy DROP 111 packets, 4180 bytes)" after the chain name; bytes keeps
+// any unit suffix, such as 136K.
+struct ChainPolicyLine
+{
+    std::string_view policy;
+    std::string_view packets;
+    std::string_view bytes;
+};
+
+bool match_chain_policy(std::string_view line, ChainPolicyLine &parsed)
+{
+    if (!consume(line, "(policy") || !skip_spaces(line) ||
+        (parsed.policy = take_token(line)).empty() || !skip_spaces(line) ||
+        (parsed.packets = take_digits(line)).empty() || !skip_spaces(line) ||
+        !consume(line, "packets,") || !skip_spaces(line))
+    {
+        return false;
+    }
+
+    constexpr std::string_view suffix = "bytes)";
+    if (line.size() < suffix.size() + 2 || line.substr(line.size() - suffix.size()) != suffix)
+    {
+        return false;
+    }
+    line.remove_suffix(suffix.size());
+    if (!is_space(line.back()) || line.find(')') != std::string_view::npos)
+    {
+        return false;
+    }
+    parsed.bytes = line.substr(0, line.size() - 1);
+    return true;
+}
+
+// The "name {" that ends a table or chain header line.
+bool match_block_name(std::string_view line, std::string_view &name)
+{
+    if (line.empty() || line.back() != '{')
+    {
+        return false;
+    }
+    line.remove_suffix(1);
+    while (!line.empty() && is_space(line.back()))
+    {
+        line.remove_suffix(1);
+    }
+    if (line.empty() || std::any_of(line.begin(), line.end(), is_space))
+    {
+        return false;
+    }
+    name = line;
+    return true;
+}
+
+// "iifname "wlan0" counter packets 258 bytes 136406 jump ndsRTR"; the last
+// well-formed counter on the line wins.
+struct NftCounterLine
+{
+    std::string_view before;
+    std::string_view packets;
+    std::string_view bytes;
+    std::string_view after;
+};
+
+bool match_nft_counter(std::string_view line, NftCounterLine &parsed)
+{
+    constexpr std::string_view marker = "counter packets";
+    for (auto pos = line.rfind(marker); pos != std::string_view::npos;
+         pos = pos == 0 ? std::string_view::npos : line.rfind(marker, pos - 1))
+    {
+        std::string_view rest = line.substr(pos + marker.size());
+        if (skip_spaces(rest) && !(parsed.packets = take_digits(rest)).empty() &&
+            skip_spaces(rest) && consume(rest, "bytes") && skip_spaces(rest) &&
+            !(parsed.bytes = take_digits(rest)).empty())
+        {
+            parsed.before = line.substr(0, pos);
+            parsed.after = rest;
+            return true;
+        }
+    }
+    return false;
+}
+
 std::string bool_label(bool value)
 {
     return value ? "true" : "false";
 }
 
-std::string join_tail(const std::vector<std::string> &tokens, std::size_t index)
+std::string join_tail(const std::vector<std::string_view> &tokens, std::size_t index)
 {
-    std::ostringstream output;
+    std::string output;
     for (std::size_t i = index; i < tokens.size(); ++i)
     {
         if (i > index)
         {
-            output << ' ';
+            output += ' ';
         }
-        output << tokens[i];
+        output.append(tokens[i]);
     }
-    return output.str();
+    return output;
 }
 
-std::string normalize_spaces(const std::string &value)
+// Appends the tokens of value to output, each preceded by one space unless
+// output is empty.
+void append_normalized(std::string &output, std::string_view value)
 {
-    const auto tokens = split_whitespace(value);
-    return join_tail(tokens, 0);
+    for (const auto token : tokens_of(value))
+    {
+        if (!output.empty())
+        {
+            output += ' ';
+        }
+        output.append(token);
+    }
 }
 
 }  // namespace
@@ -292,8 +820,9 @@ std::vector<MetricSample> parse_system_identity(const std::string &uname_output,
 {
     std::vector<MetricSample> metrics;
 
-    std::vector<std::string> uname_tokens = split_whitespace(trim(uname_output));
-    std::map<std::string, std::string> labels;
+    std::vector<std::string_view> uname_tokens;
+    assign_tokens(uname_tokens, uname_output);
+    LabelSet labels;
     if (uname_tokens.size() >= 3)
     {
         labels["host"] = uname_tokens[1];
@@ -308,39 +837,40 @@ std::vector<MetricSample> parse_system_identity(const std::string &uname_output,
         labels["arch"] = uname_tokens[uname_tokens.size() - 2];
     }
 
-    const auto os_release = parse_key_value_lines(os_release_output);
-    const auto os_id = os_release.find("ID");
-    if (os_id != os_release.end())
-    {
-        labels["os_id"] = os_id->second;
-    }
-    const auto os_pretty = os_release.find("PRETTY_NAME");
-    if (os_pretty != os_release.end())
-    {
-        labels["os_pretty_name"] = os_pretty->second;
-    }
-    const auto os_version = os_release.find("VERSION_ID");
-    if (os_version != os_release.end())
-    {
-        labels["os_version_id"] = os_version->second;
-    }
+    // As with a map of the file, the last assignment of a key wins.
+    for_each_key_value(os_release_output, [&labels](std::string_view key, std::string_view value) {
+        if (key == "ID")
+        {
+            labels["os_id"] = value;
+        }
+        else if (key == "PRETTY_NAME")
+        {
+            labels["os_pretty_name"] = value;
+        }
+        else if (key == "VERSION_ID")
+        {
+            labels["os_version_id"] = value;
+        }
+    });
 
     labels["pid1"] = trim(pid1_output);
     metrics.push_back(make_info("edge_system_identity_info", labels));
 
-    const auto systemctl_lines = split_lines(systemctl_version_output);
-    if (!systemctl_lines.empty())
+    const ViewRange systemctl_lines = lines_of(systemctl_version_output);
+    if (systemctl_lines.begin() != systemctl_lines.end())
     {
-        std::smatch match;
-        static const std::regex version_pattern("^systemd\\s+([0-9]+)\\s+\\(([^)]+)\\)$");
-        const std::string version_line = trim(systemctl_lines.front());
-        if (std::regex_match(version_line, match, version_pattern))
+        // systemd 252 (252.22-1~deb12u1)
+        std::string_view rest = trim_view(*systemctl_lines.begin());
+        std::string_view major;
+        std::string_view version;
+        if (consume(rest, "systemd") && skip_spaces(rest) &&
+            !(major = take_digits(rest)).empty() && skip_spaces(rest) &&
+            take_parenthesized(rest, version) && rest.empty())
         {
             metrics.push_back(make_info("edge_systemd_version_info",
-                                        {{"major", match[1].str()},
-                                         {"version", match[2].str()}}));
-            metrics.push_back(
-                make_metric("edge_systemd_major_version", std::stod(match[1].str())));
+                                        {{"major", std::string(major)},
+                                         {"version", std::string(version)}}));
+            metrics.push_back(make_metric("edge_systemd_major_version", to_double(major)));
         }
     }
 
@@ -351,54 +881,48 @@ std::vector<MetricSample> parse_ip_br_link(const std::string &output)
 {
     std::vector<MetricSample> metrics;
 
-    for (const auto &line : split_lines(output))
+    for (const auto line : lines_of(output))
     {
-        const std::string cleaned = trim(line);
-        if (cleaned.empty())
+        std::string_view remainder = trim_view(line);
+        if (remainder.empty())
         {
             continue;
         }
 
-        std::istringstream input(cleaned);
-        std::string interface_name;
-        std::string oper_state;
-        input >> interface_name >> oper_state;
-        std::string remainder;
-        std::getline(input, remainder);
-        remainder = trim(remainder);
+        skip_spaces(remainder);
+        const std::string interface_name(take_token(remainder));
+        skip_spaces(remainder);
+        const std::string_view oper_state = take_token(remainder);
+        remainder = trim_view(remainder);
 
-        std::string mac;
-        std::string flags_text;
-        if (!remainder.empty())
+        std::string_view mac;
+        std::string_view flags = remainder;
+        skip_spaces(flags);
+        const std::string_view first = take_token(flags);
+        if (first.find(':') != std::string_view::npos)
         {
-            const auto remainder_tokens = split_whitespace(remainder);
-            if (!remainder_tokens.empty() &&
-                remainder_tokens.front().find(':') != std::string::npos)
-            {
-                mac = remainder_tokens.front();
-                flags_text = join_tail(remainder_tokens, 1);
-            }
-            else
-            {
-                flags_text = remainder;
-            }
+            mac = first;
+        }
+        else
+        {
+            flags = remainder;
         }
 
-        const auto flags = parse_angle_flags(flags_text);
-        metrics.push_back(
-            make_info("edge_network_link_info",
-                      {{"interface", interface_name}, {"state", oper_state}, {"mac", mac}}));
+        metrics.push_back(make_info("edge_network_link_info",
+                                    {{"interface", interface_name},
+                                     {"state", std::string(oper_state)},
+                                     {"mac", std::string(mac)}}));
         metrics.push_back(make_metric(
             "edge_network_link_up",
-            flags.count("UP") > 0 ? 1.0 : 0.0,
+            has_angle_flag(flags, "UP") ? 1.0 : 0.0,
             {{"interface", interface_name}}));
         metrics.push_back(make_metric(
             "edge_network_lower_up",
-            flags.count("LOWER_UP") > 0 ? 1.0 : 0.0,
+            has_angle_flag(flags, "LOWER_UP") ? 1.0 : 0.0,
             {{"interface", interface_name}}));
         metrics.push_back(make_metric(
             "edge_network_no_carrier",
-            flags.count("NO-CARRIER") > 0 ? 1.0 : 0.0,
+            has_angle_flag(flags, "NO-CARRIER") ? 1.0 : 0.0,
             {{"interface", interface_name}}));
     }
 
@@ -408,33 +932,31 @@ std::vector<MetricSample> parse_ip_br_link(const std::string &output)
 std::vector<MetricSample> parse_ip_br_addr(const std::string &output)
 {
     std::vector<MetricSample> metrics;
+    std::vector<std::string_view> addresses;
 
-    for (const auto &line : split_lines(output))
+    for (const auto line : lines_of(output))
     {
-        const std::string cleaned = trim(line);
-        if (cleaned.empty())
+        std::string_view remainder = trim_view(line);
+        if (remainder.empty())
         {
             continue;
         }
 
-        std::istringstream input(cleaned);
-        std::string interface_name;
-        std::string oper_state;
-        input >> interface_name >> oper_state;
-        std::string remainder;
-        std::getline(input, remainder);
-        remainder = trim(remainder);
+        skip_spaces(remainder);
+        const std::string interface_name(take_token(remainder));
+        skip_spaces(remainder);
+        const std::string oper_state(take_token(remainder));
 
-        const auto addresses = split_whitespace(remainder);
+        assign_tokens(addresses, remainder);
         metrics.push_back(make_metric("edge_network_address_count",
                                       static_cast<double>(addresses.size()),
                                       {{"interface", interface_name}}));
-        for (const auto &address : addresses)
+        for (const auto address : addresses)
         {
             metrics.push_back(make_info("edge_network_address_info",
                                         {{"interface", interface_name},
                                          {"state", oper_state},
-                                         {"cidr", address}}));
+                                         {"cidr", std::string(address)}}));
         }
     }
 
@@ -444,27 +966,22 @@ std::vector<MetricSample> parse_ip_br_addr(const std::string &output)
 std::vector<MetricSample> parse_ip_route(const std::string &output)
 {
     std::vector<MetricSample> metrics;
+    std::vector<std::string_view> tokens;
 
-    for (const auto &line : split_lines(output))
+    for (const auto line : lines_of(output))
     {
-        const std::string cleaned = trim(line);
-        if (cleaned.empty())
-        {
-            continue;
-        }
-
-        auto tokens = split_whitespace(cleaned);
+        assign_tokens(tokens, line);
         if (tokens.empty())
         {
             continue;
         }
 
-        std::map<std::string, std::string> labels;
+        LabelSet labels;
         labels["prefix"] = tokens.front();
         for (std::size_t i = 1; i + 1 < tokens.size(); ++i)
         {
-            const std::string &key = tokens[i];
-            const std::string &value = tokens[i + 1];
+            const std::string_view key = tokens[i];
+            const std::string_view value = tokens[i + 1];
             if (key == "dev")
             {
                 labels["device"] = value;
@@ -489,7 +1006,7 @@ std::vector<MetricSample> parse_ip_route(const std::string &output)
             {
                 labels["metric"] = value;
                 metrics.push_back(make_metric("edge_network_route_metric",
-                                              std::stod(value),
+                                              to_double(value),
                                               {{"prefix", labels["prefix"]},
                                                {"device", labels["device"]}}));
             }
@@ -518,44 +1035,45 @@ std::vector<MetricSample> parse_iw_dev(const std::string &output)
     std::string ssid;
     std::string type;
 
-    for (const auto &line : split_lines(output))
+    for (const auto line : lines_of(output))
     {
-        const std::string cleaned = trim(line);
+        const std::string_view cleaned = trim_view(line);
         if (cleaned.empty())
         {
             continue;
         }
 
-        std::smatch match;
-        static const std::regex interface_pattern("^Interface\\s+(\\S+)$");
-        static const std::regex ifindex_pattern("^ifindex\\s+([0-9]+)$");
-        static const std::regex addr_pattern("^addr\\s+([0-9a-f:]+)$",
-                                             std::regex::icase);
-        static const std::regex ssid_pattern("^ssid\\s+(.+)$");
-        static const std::regex type_pattern("^type\\s+(.+)$");
+        // Each line is a keyword, whitespace, and a value running to the end.
+        std::string_view value = cleaned;
+        const std::string_view keyword = take_token(value);
+        if (!skip_spaces(value) || value.empty())
+        {
+            continue;
+        }
 
-        if (std::regex_match(cleaned, match, interface_pattern))
+        if (keyword == "Interface" && std::none_of(value.begin(), value.end(), is_space))
         {
-            interface_name = match[1].str();
+            interface_name = std::string(value);
         }
-        else if (std::regex_match(cleaned, match, ifindex_pattern) &&
-                 !interface_name.empty())
+        else if (keyword == "ifindex" && !interface_name.empty() &&
+                 std::all_of(value.begin(), value.end(), is_digit))
         {
             metrics.push_back(make_metric("edge_wifi_interface_ifindex",
-                                          std::stod(match[1].str()),
+                                          to_double(value),
                                           {{"interface", interface_name}}));
         }
-        else if (std::regex_match(cleaned, match, addr_pattern))
+        else if (equals_ignore_case(keyword, "addr") &&
+                 std::all_of(value.begin(), value.end(), is_mac_char))
         {
-            mac = match[1].str();
+            mac = std::string(value);
         }
-        else if (std::regex_match(cleaned, match, ssid_pattern))
+        else if (keyword == "ssid")
         {
-            ssid = match[1].str();
+            ssid = std::string(value);
         }
-        else if (std::regex_match(cleaned, match, type_pattern))
+        else if (keyword == "type")
         {
-            type = match[1].str();
+            type = std::string(value);
             if (!interface_name.empty())
             {
                 metrics.push_back(make_info("edge_wifi_ap_info",
@@ -595,26 +1113,20 @@ std::vector<MetricSample> parse_iw_phy(const std::string &output)
         metrics.push_back(make_metric("edge_wifi_phy_limit", value, {{"limit", limit}}));
     };
 
-    for (const auto &line : split_lines(output))
+    for (const auto line : lines_of(output))
     {
-        const std::string cleaned = trim(line);
+        const std::string_view cleaned = trim_view(line);
         if (cleaned.empty())
         {
             continue;
         }
 
-        std::smatch match;
-        static const std::regex number_line("^([^:]+):\\s+(-?[0-9]+)(?:\\s+.*)?$");
-        static const std::regex band_pattern("^Band\\s+([0-9]+):$");
-        static const std::regex freq_pattern(
-            "^\\*\\s+([0-9]+)\\s+MHz\\s+\\[([0-9]+)\\]\\s+\\(([^)]+)\\)(?:\\s+\\(([^)]+)\\))?$");
-        static const std::regex mode_pattern("^\\*\\s+(.+)$");
-        static const std::regex frame_pattern("^\\*\\s+([^:]+):\\s+(.+)$");
-        static const std::regex feature_pattern("^\\*\\s+(?:\\[\\s*)?([^\\]]+?)(?:\\s*\\])?(?::\\s+.+)?$");
-
-        if (std::regex_match(cleaned, match, band_pattern))
+        std::string_view band_line = cleaned;
+        std::string_view band;
+        if (consume(band_line, "Band") && skip_spaces(band_line) &&
+            !(band = take_digits(band_line)).empty() && band_line == ":")
         {
-            current_band = match[1].str();
+            current_band = std::string(band);
             block = Block::none;
             continue;
         }
@@ -650,14 +1162,12 @@ std::vector<MetricSample> parse_iw_phy(const std::string &output)
             continue;
         }
 
-        if (std::regex_match(cleaned, match, freq_pattern) && !current_band.empty())
+        FrequencyLine frequency;
+        if (match_frequency_line(cleaned, frequency) && !current_band.empty())
         {
-            const std::string mhz = match[1].str();
-            const std::string channel = match[2].str();
-            const std::string primary = match[3].str();
-            const std::string extra = match[4].matched ? match[4].str() : "";
+            const std::string_view primary = frequency.primary;
             const bool disabled = primary == "disabled";
-            const bool radar = primary == "radar detection" || extra == "radar detection";
+            const bool radar = primary == "radar detection" || frequency.extra == "radar detection";
 
             if (disabled)
             {
@@ -672,55 +1182,58 @@ std::vector<MetricSample> parse_iw_phy(const std::string &output)
                 ++band_radar_count[current_band];
             }
 
-            std::map<std::string, std::string> labels {
+            LabelSet labels {
                 {"band", current_band},
-                {"mhz", mhz},
-                {"channel", channel},
+                {"mhz", std::string(frequency.mhz)},
+                {"channel", std::string(frequency.channel)},
                 {"disabled", bool_label(disabled)},
                 {"radar_detection", bool_label(radar)},
             };
             if (!disabled)
             {
-                labels["max_tx_power_dbm"] =
-                    primary == "disabled" ? "" : primary.substr(0, primary.find(' '));
+                labels["max_tx_power_dbm"] = std::string(primary.substr(0, primary.find(' ')));
             }
             metrics.push_back(make_info("edge_wifi_band_frequency_info", labels));
             continue;
         }
 
-        if (block == Block::interface_modes && std::regex_match(cleaned, match, mode_pattern))
+        std::string_view item = cleaned;
+        const bool is_item = consume(item, "*") && skip_spaces(item) && !item.empty();
+        if (block == Block::interface_modes && is_item)
         {
             metrics.push_back(make_info("edge_wifi_supported_interface_mode_info",
-                                        {{"mode", match[1].str()}}));
+                                        {{"mode", std::string(item)}}));
             continue;
         }
-        if (block == Block::commands && std::regex_match(cleaned, match, mode_pattern))
+        if (block == Block::commands && is_item)
         {
             metrics.push_back(make_info("edge_wifi_supported_command_info",
-                                        {{"command", match[1].str()}}));
+                                        {{"command", std::string(item)}}));
             continue;
         }
-        if (block == Block::wowlan && std::regex_match(cleaned, match, mode_pattern))
+        if (block == Block::wowlan && is_item)
         {
             metrics.push_back(make_info("edge_wifi_wowlan_support_info",
-                                        {{"feature", match[1].str()}}));
+                                        {{"feature", std::string(item)}}));
             continue;
         }
+        std::string_view mode;
+        std::string_view values;
         if ((block == Block::tx_frame_types || block == Block::rx_frame_types) &&
-            std::regex_match(cleaned, match, frame_pattern))
+            match_frame_line(cleaned, mode, values))
         {
             metrics.push_back(make_info(
                 "edge_wifi_frame_type_support_info",
                 {{"direction", block == Block::tx_frame_types ? "tx" : "rx"},
-                 {"mode", trim(match[1].str())},
-                 {"values", trim(match[2].str())}}));
+                 {"mode", std::string(mode)},
+                 {"values", std::string(values)}}));
             continue;
         }
-        if (block == Block::extended_features &&
-            std::regex_match(cleaned, match, feature_pattern))
+        std::string_view feature;
+        if (block == Block::extended_features && match_feature_line(cleaned, feature))
         {
             metrics.push_back(make_info("edge_wifi_extended_feature_info",
-                                        {{"feature", trim(match[1].str())}}));
+                                        {{"feature", std::string(feature)}}));
             continue;
         }
 
@@ -730,10 +1243,11 @@ std::vector<MetricSample> parse_iw_phy(const std::string &output)
             block = Block::none;
         }
 
-        if (std::regex_match(cleaned, match, number_line))
+        std::string_view key;
+        std::string_view number;
+        if (match_number_line(cleaned, key, number))
         {
-            const std::string key = trim(match[1].str());
-            const double value = std::stod(match[2].str());
+            const double value = to_double(number);
             if (key == "max # scan SSIDs")
             {
                 emit_limit("max_scan_ssids", value);
@@ -814,19 +1328,20 @@ std::vector<MetricSample> parse_iw_phy(const std::string &output)
 std::vector<MetricSample> parse_service_list_units(const std::string &output)
 {
     std::vector<MetricSample> metrics;
-    for (const auto &line : split_lines(output))
+    std::vector<std::string_view> tokens;
+    for (const auto line : lines_of(output))
     {
-        const auto tokens = split_whitespace(trim(line));
+        assign_tokens(tokens, line);
         if (tokens.size() < 5)
         {
             continue;
         }
 
         metrics.push_back(make_info("edge_service_unit_state_info",
-                                    {{"service", tokens[0]},
-                                     {"load_state", tokens[1]},
-                                     {"active_state", tokens[2]},
-                                     {"sub_state", tokens[3]},
+                                    {{"service", std::string(tokens[0])},
+                                     {"load_state", std::string(tokens[1])},
+                                     {"active_state", std::string(tokens[2])},
+                                     {"sub_state", std::string(tokens[3])},
                                      {"description", join_tail(tokens, 4)}}));
     }
     return metrics;
@@ -839,75 +1354,109 @@ std::vector<MetricSample> parse_systemd_status(const std::string &service_name,
     std::size_t associated_events = 0;
     std::size_t radius_events = 0;
 
-    for (const auto &line : split_lines(output))
+    for (const auto line : lines_of(output))
     {
-        const std::string cleaned = trim(line);
+        const std::string_view cleaned = trim_view(line);
         if (cleaned.empty())
         {
             continue;
         }
 
-        std::smatch match;
-        static const std::regex loaded_pattern(
-            "^Loaded:\\s+([^(]+)\\s+\\(([^;]+);\\s*([^;]+);\\s*preset:\\s*([^)]+)\\)$");
-        static const std::regex active_pattern("^Active:\\s+(\\w+)\\s+\\(([^)]+)\\).*$");
-        static const std::regex main_pid_pattern("^Main PID:\\s+([0-9]+).*$");
-        static const std::regex tasks_pattern("^Tasks:\\s+([0-9]+)\\s+\\(limit:\\s*([0-9]+)\\)$");
-        static const std::regex memory_pattern("^Memory:\\s+([0-9.]+[KMGTP]?)$");
-        static const std::regex cpu_pattern("^CPU:\\s+(.+)$");
-
-        if (std::regex_match(cleaned, match, loaded_pattern))
+        std::string_view rest = cleaned;
+        if (consume(rest, "Loaded:"))
         {
-            metrics.push_back(make_info("edge_service_loaded_info",
-                                        {{"service", service_name},
-                                         {"load_state", trim(match[1].str())},
-                                         {"unit_path", trim(match[2].str())},
-                                         {"enabled_state", trim(match[3].str())},
-                                         {"preset", trim(match[4].str())}}));
+            LoadedLine loaded;
+            if (match_loaded_line(rest, loaded))
+            {
+                metrics.push_back(make_info("edge_service_loaded_info",
+                                            {{"service", service_name},
+                                             {"load_state", trim(loaded.load_state)},
+                                             {"unit_path", trim(loaded.unit_path)},
+                                             {"enabled_state", trim(loaded.enabled_state)},
+                                             {"preset", trim(loaded.preset)}}));
+            }
         }
-        else if (std::regex_match(cleaned, match, active_pattern))
+        else if (consume(rest, "Active:"))
         {
-            metrics.push_back(make_metric("edge_service_active",
-                                          match[1].str() == "active" ? 1.0 : 0.0,
-                                          {{"service", service_name}}));
-            metrics.push_back(make_info("edge_service_active_state_info",
-                                        {{"service", service_name},
-                                         {"active_state", match[1].str()},
-                                         {"sub_state", match[2].str()}}));
+            // Active: active (running) since ...
+            std::string_view active_state;
+            std::string_view sub_state;
+            if (skip_spaces(rest) && !(active_state = take_while(rest, is_word)).empty() &&
+                skip_spaces(rest) && take_parenthesized(rest, sub_state))
+            {
+                metrics.push_back(make_metric("edge_service_active",
+                                              active_state == "active" ? 1.0 : 0.0,
+                                              {{"service", service_name}}));
+                metrics.push_back(make_info("edge_service_active_state_info",
+                                            {{"service", service_name},
+                                             {"active_state", std::string(active_state)},
+                                             {"sub_state", std::string(sub_state)}}));
+            }
         }
-        else if (std::regex_match(cleaned, match, main_pid_pattern))
+        else if (consume(rest, "Main PID:"))
         {
-            metrics.push_back(make_metric("edge_service_main_pid",
-                                          std::stod(match[1].str()),
-                                          {{"service", service_name}}));
+            std::string_view pid;
+            if (skip_spaces(rest) && !(pid = take_digits(rest)).empty())
+            {
+                metrics.push_back(make_metric("edge_service_main_pid",
+                                              to_double(pid),
+                                              {{"service", service_name}}));
+            }
         }
-        else if (std::regex_match(cleaned, match, tasks_pattern))
+        else if (consume(rest, "Tasks:"))
         {
-            metrics.push_back(make_metric("edge_service_tasks",
-                                          std::stod(match[1].str()),
-                                          {{"service", service_name}}));
-            metrics.push_back(make_metric("edge_service_task_limit",
-                                          std::stod(match[2].str()),
-                                          {{"service", service_name}}));
+            // Tasks: 1 (limit: 979)
+            std::string_view tasks;
+            if (skip_spaces(rest) && !(tasks = take_digits(rest)).empty() &&
+                skip_spaces(rest) && consume(rest, "(limit:"))
+            {
+                skip_spaces(rest);
+                const std::string_view limit = take_digits(rest);
+                if (!limit.empty() && rest == ")")
+                {
+                    metrics.push_back(make_metric("edge_service_tasks",
+                                                  to_double(tasks),
+                                                  {{"service", service_name}}));
+                    metrics.push_back(make_metric("edge_service_task_limit",
+                                                  to_double(limit),
+                                                  {{"service", service_name}}));
+                }
+            }
         }
-        else if (std::regex_match(cleaned, match, memory_pattern))
+        else if (consume(rest, "Memory:"))
         {
-            metrics.push_back(make_metric("edge_service_memory_bytes",
-                                          parse_human_quantity(match[1].str()),
-                                          {{"service", service_name}}));
+            // Memory: 888.0K
+            if (skip_spaces(rest))
+            {
+                std::string_view unit = rest;
+                const std::string_view number =
+                    take_while(unit, [](char value) { return is_digit(value) || value == '.'; });
+                if (!number.empty() &&
+                    (unit.empty() ||
+                     (unit.size() == 1 && std::string_view("KMGTP").find(unit.front()) !=
+                                              std::string_view::npos)))
+                {
+                    metrics.push_back(make_metric("edge_service_memory_bytes",
+                                                  parse_human_quantity(rest),
+                                                  {{"service", service_name}}));
+                }
+            }
         }
-        else if (std::regex_match(cleaned, match, cpu_pattern))
+        else if (consume(rest, "CPU:"))
         {
-            metrics.push_back(make_metric("edge_service_cpu_seconds",
-                                          parse_duration_seconds(match[1].str()),
-                                          {{"service", service_name}}));
+            if (skip_spaces(rest) && !rest.empty())
+            {
+                metrics.push_back(make_metric("edge_service_cpu_seconds",
+                                              parse_duration_seconds(rest),
+                                              {{"service", service_name}}));
+            }
         }
 
-        if (cleaned.find("IEEE 802.11: associated") != std::string::npos)
+        if (cleaned.find("IEEE 802.11: associated") != std::string_view::npos)
         {
             ++associated_events;
         }
-        if (cleaned.find("RADIUS: starting accounting session") != std::string::npos)
+        if (cleaned.find("RADIUS: starting accounting session") != std::string_view::npos)
         {
             ++radius_events;
         }
@@ -941,24 +1490,27 @@ std::vector<MetricSample> parse_dnsmasq_leases(const std::string &output)
 {
     std::vector<MetricSample> metrics;
     std::size_t count = 0;
+    std::vector<std::string_view> tokens;
 
-    for (const auto &line : split_lines(output))
+    for (const auto line : lines_of(output))
     {
-        const auto tokens = split_whitespace(trim(line));
+        assign_tokens(tokens, line);
         if (tokens.size() < 5)
         {
             continue;
         }
 
         ++count;
+        const std::string mac(tokens[1]);
+        const std::string ip(tokens[2]);
         metrics.push_back(make_info("edge_hotspot_dhcp_lease_info",
-                                    {{"mac", tokens[1]},
-                                     {"ip", tokens[2]},
-                                     {"hostname", tokens[3]},
-                                     {"client_id", tokens[4]}}));
+                                    {{"mac", mac},
+                                     {"ip", ip},
+                                     {"hostname", std::string(tokens[3])},
+                                     {"client_id", std::string(tokens[4])}}));
         metrics.push_back(make_metric("edge_hotspot_dhcp_lease_expiry_epoch_seconds",
-                                      std::stod(tokens[0]),
-                                      {{"mac", tokens[1]}, {"ip", tokens[2]}}));
+                                      to_double(tokens[0]),
+                                      {{"mac", mac}, {"ip", ip}}));
     }
 
     metrics.push_back(make_metric("edge_hotspot_dhcp_leases_total",
@@ -973,9 +1525,9 @@ std::vector<MetricSample> parse_mmcli_snapshot(const std::string &command_path_o
     std::vector<MetricSample> metrics = parse_command_path("mmcli", command_path_output);
 
     std::size_t modem_count = 0;
-    for (const auto &line : split_lines(list_output))
+    for (const auto line : lines_of(list_output))
     {
-        if (line.find("/org/freedesktop/ModemManager1/Modem/") != std::string::npos)
+        if (line.find("/org/freedesktop/ModemManager1/Modem/") != std::string_view::npos)
         {
             ++modem_count;
         }
@@ -983,41 +1535,37 @@ std::vector<MetricSample> parse_mmcli_snapshot(const std::string &command_path_o
     metrics.push_back(
         make_metric("edge_lte_modemmanager_modems_total", static_cast<double>(modem_count)));
 
-    for (const auto &line : split_lines(modem_output))
+    for (const auto line : lines_of(modem_output))
     {
-        const std::string cleaned = trim(line);
-        if (cleaned.empty())
-        {
-            continue;
-        }
-
+        const std::string_view cleaned = trim_view(line);
         const auto pos = cleaned.find(':');
-        if (pos == std::string::npos)
+        if (pos == std::string_view::npos)
         {
             continue;
         }
 
-        const std::string key = trim(cleaned.substr(0, pos));
-        const std::string value = trim(cleaned.substr(pos + 1));
+        const std::string_view key = trim_view(cleaned.substr(0, pos));
+        const std::string_view value = trim_view(cleaned.substr(pos + 1));
         if (key == "state")
         {
-            metrics.push_back(
-                make_info("edge_lte_modem_state_info", {{"state", strip_quotes(value)}}));
+            metrics.push_back(make_info("edge_lte_modem_state_info",
+                                        {{"state", std::string(strip_quotes(value))}}));
         }
         else if (key == "signal quality")
         {
-            std::smatch match;
-            static const std::regex signal_pattern("^([0-9]+)%.*$");
-            if (std::regex_match(value, match, signal_pattern))
+            // signal quality: 80% (recent)
+            std::string_view rest = value;
+            const std::string_view percent = take_digits(rest);
+            if (!percent.empty() && consume(rest, "%"))
             {
-                metrics.push_back(make_metric("edge_lte_signal_quality_percent",
-                                              std::stod(match[1].str())));
+                metrics.push_back(
+                    make_metric("edge_lte_signal_quality_percent", to_double(percent)));
             }
         }
         else if (key == "access tech")
         {
             metrics.push_back(
-                make_info("edge_lte_access_technology_info", {{"technology", value}}));
+                make_info("edge_lte_access_technology_info", {{"technology", std::string(value)}}));
         }
     }
 
@@ -1027,19 +1575,20 @@ std::vector<MetricSample> parse_mmcli_snapshot(const std::string &command_path_o
 std::vector<MetricSample> parse_nmcli_device_status(const std::string &output)
 {
     std::vector<MetricSample> metrics;
-    for (const auto &line : split_lines(output))
+    std::vector<std::string_view> columns;
+    for (const auto line : lines_of(output))
     {
-        const auto columns = split_columns(line);
+        assign_columns(columns, line);
         if (columns.size() != 4 || columns.front() == "DEVICE")
         {
             continue;
         }
 
         metrics.push_back(make_info("edge_nm_device_state_info",
-                                    {{"device", columns[0]},
-                                     {"type", columns[1]},
-                                     {"state", columns[2]},
-                                     {"connection", columns[3]}}));
+                                    {{"device", std::string(columns[0])},
+                                     {"type", std::string(columns[1])},
+                                     {"state", std::string(columns[2])},
+                                     {"connection", std::string(columns[3])}}));
     }
     return metrics;
 }
@@ -1048,28 +1597,20 @@ std::vector<MetricSample> parse_device_node_listing(const std::string &ttyusb_ou
                                                     const std::string &cdc_wdm_output)
 {
     std::vector<MetricSample> metrics;
-    static const std::regex tty_pattern("(/dev/ttyUSB[0-9]+)");
-    static const std::regex cdc_pattern("(/dev/cdc-wdm[0-9]+)");
 
     std::size_t tty_count = 0;
-    for (auto it = std::sregex_iterator(ttyusb_output.begin(), ttyusb_output.end(), tty_pattern);
-         it != std::sregex_iterator();
-         ++it)
-    {
+    for_each_numbered_path(ttyusb_output, "/dev/ttyUSB", [&](std::string_view path) {
         ++tty_count;
-        metrics.push_back(
-            make_info("edge_lte_device_node_info", {{"kind", "ttyUSB"}, {"path", (*it)[1]}}));
-    }
+        metrics.push_back(make_info("edge_lte_device_node_info",
+                                    {{"kind", "ttyUSB"}, {"path", std::string(path)}}));
+    });
 
     std::size_t cdc_count = 0;
-    for (auto it = std::sregex_iterator(cdc_wdm_output.begin(), cdc_wdm_output.end(), cdc_pattern);
-         it != std::sregex_iterator();
-         ++it)
-    {
+    for_each_numbered_path(cdc_wdm_output, "/dev/cdc-wdm", [&](std::string_view path) {
         ++cdc_count;
-        metrics.push_back(
-            make_info("edge_lte_device_node_info", {{"kind", "cdc-wdm"}, {"path", (*it)[1]}}));
-    }
+        metrics.push_back(make_info("edge_lte_device_node_info",
+                                    {{"kind", "cdc-wdm"}, {"path", std::string(path)}}));
+    });
 
     metrics.push_back(
         make_metric("edge_lte_usb_tty_devices_total", static_cast<double>(tty_count)));
@@ -1080,45 +1621,65 @@ std::vector<MetricSample> parse_device_node_listing(const std::string &ttyusb_ou
 
 std::vector<MetricSample> parse_loadavg(const std::string &output)
 {
+    // 0.08 0.03 0.01 1/123 4567
     std::vector<MetricSample> metrics;
-    std::smatch match;
-    static const std::regex pattern(
-        "^\\s*([0-9]+(?:\\.[0-9]+)?)\\s+([0-9]+(?:\\.[0-9]+)?)\\s+([0-9]+(?:\\.[0-9]+)?)\\s+([0-9]+)/([0-9]+)\\s+([0-9]+)\\s*$");
-    const std::string cleaned = trim(output);
-    if (!std::regex_match(cleaned, match, pattern))
+    std::string_view rest = trim_view(output);
+    skip_spaces(rest);
+    std::string_view fields[6];
+    for (std::size_t i = 0; i < 6; ++i)
+    {
+        const bool separated = i == 0 || (i == 4 ? consume(rest, "/") : skip_spaces(rest));
+        fields[i] = i < 3 ? take_decimal(rest) : take_digits(rest);
+        if (!separated || fields[i].empty())
+        {
+            return metrics;
+        }
+    }
+    skip_spaces(rest);
+    if (!rest.empty())
     {
         return metrics;
     }
 
     metrics.push_back(
-        make_metric("edge_system_load_average", std::stod(match[1].str()), {{"window", "1m"}}));
+        make_metric("edge_system_load_average", to_double(fields[0]), {{"window", "1m"}}));
     metrics.push_back(
-        make_metric("edge_system_load_average", std::stod(match[2].str()), {{"window", "5m"}}));
+        make_metric("edge_system_load_average", to_double(fields[1]), {{"window", "5m"}}));
     metrics.push_back(
-        make_metric("edge_system_load_average", std::stod(match[3].str()), {{"window", "15m"}}));
-    metrics.push_back(
-        make_metric("edge_system_processes_running", std::stod(match[4].str())));
-    metrics.push_back(make_metric("edge_system_processes_total", std::stod(match[5].str())));
-    metrics.push_back(make_metric("edge_system_last_pid", std::stod(match[6].str())));
+        make_metric("edge_system_load_average", to_double(fields[2]), {{"window", "15m"}}));
+    metrics.push_back(make_metric("edge_system_processes_running", to_double(fields[3])));
+    metrics.push_back(make_metric("edge_system_processes_total", to_double(fields[4])));
+    metrics.push_back(make_metric("edge_system_last_pid", to_double(fields[5])));
     return metrics;
 }
 
 std::vector<MetricSample> parse_meminfo(const std::string &output)
 {
     std::vector<MetricSample> metrics;
-    static const std::regex pattern("^([^:]+):\\s+([0-9]+)\\s*(\\w+)?$");
 
-    for (const auto &line : split_lines(output))
+    for (const auto line : lines_of(output))
     {
-        std::smatch match;
-        const std::string cleaned = trim(line);
-        if (!std::regex_match(cleaned, match, pattern))
+        // MemTotal:        1012348 kB
+        const std::string_view cleaned = trim_view(line);
+        const auto colon = cleaned.find(':');
+        if (colon == 0 || colon == std::string_view::npos)
+        {
+            continue;
+        }
+        std::string_view rest = cleaned.substr(colon + 1);
+        std::string_view number;
+        if (!skip_spaces(rest) || (number = take_digits(rest)).empty())
+        {
+            continue;
+        }
+        skip_spaces(rest);
+        const std::string_view unit = take_while(rest, is_word);
+        if (!rest.empty())
         {
             continue;
         }
 
-        double value = std::stod(match[2].str());
-        const std::string unit = match[3].matched ? match[3].str() : "";
+        double value = to_double(number);
         if (unit == "kB")
         {
             value *= 1024.0;
@@ -1126,7 +1687,7 @@ std::vector<MetricSample> parse_meminfo(const std::string &output)
 
         metrics.push_back(make_metric("edge_system_meminfo_bytes",
                                       value,
-                                      {{"field", trim(match[1].str())}}));
+                                      {{"field", trim(cleaned.substr(0, colon))}}));
     }
 
     return metrics;
@@ -1154,25 +1715,26 @@ std::vector<MetricSample> parse_proc_net_dev(const std::string &output)
         "edge_network_transmit_compressed",
     };
 
-    for (const auto &line : split_lines(output))
+    std::vector<std::string_view> tokens;
+    for (const auto line : lines_of(output))
     {
         const auto pos = line.find(':');
-        if (pos == std::string::npos)
+        if (pos == std::string_view::npos)
         {
             continue;
         }
 
-        const std::string interface_name = trim(line.substr(0, pos));
-        const auto tokens = split_whitespace(line.substr(pos + 1));
+        assign_tokens(tokens, line.substr(pos + 1));
         if (tokens.size() != metric_names.size())
         {
             continue;
         }
 
+        const std::string interface_name = trim(line.substr(0, pos));
         for (std::size_t i = 0; i < metric_names.size(); ++i)
         {
             metrics.push_back(make_metric(metric_names[i],
-                                          std::stod(tokens[i]),
+                                          to_double(tokens[i]),
                                           {{"interface", interface_name}}));
         }
     }
@@ -1183,74 +1745,94 @@ std::vector<MetricSample> parse_proc_net_dev(const std::string &output)
 std::vector<MetricSample> parse_thermal_zone_temp(const std::string &output,
                                                   const std::string &zone_name)
 {
-    const std::string cleaned = trim(output);
+    const std::string_view cleaned = trim_view(output);
     if (cleaned.empty())
     {
         return {};
     }
 
     return {make_metric("edge_system_temperature_celsius",
-                        std::stod(cleaned) / 1000.0,
+                        to_double(cleaned) / 1000.0,
                         {{"zone", zone_name}})};
 }
 
+std::vector<MetricSample> parse_hwmon_temp(const std::string &output,
+                                           const std::string &hwmon_name,
+                                           const std::string &chip,
+                                           const std::string &sensor)
+{
+    const std::string_view cleaned = trim_view(output);
+    if (cleaned.empty())
+    {
+        return {};
+    }
+
+    return {make_metric("edge_system_hwmon_temperature_celsius",
+                        to_double(cleaned) / 1000.0,
+                        {{"hwmon", hwmon_name}, {"chip", chip}, {"sensor", sensor}})};
+}
+
 std::vector<MetricSample> parse_iptables(const std::string &output)
 {
     std::vector<MetricSample> metrics;
     std::string current_chain;
+    std::vector<std::string_view> tokens;
 
-    static const std::regex chain_pattern(
-        "^Chain\\s+(\\S+)\\s+\\(policy\\s+(\\S+)\\s+([0-9]+)\\s+packets,\\s+([^\\)]+)\\s+bytes\\)$");
-    static const std::regex reference_chain_pattern(
-        "^Chain\\s+(\\S+)\\s+\\(([0-9]+)\\s+references\\)$");
-
-    for (const auto &line : split_lines(output))
+    for (const auto line : lines_of(output))
     {
-        const std::string cleaned = trim(line);
+        const std::string_view cleaned = trim_view(line);
         if (cleaned.empty())
         {
             continue;
         }
 
-        std::smatch match;
-        if (std::regex_match(cleaned, match, chain_pattern))
-        {
-            current_chain = match[1].str();
-            metrics.push_back(make_metric("edge_firewall_iptables_chain_policy_packets",
-                                          std::stod(match[3].str()),
-                                          {{"chain", current_chain},
-                                           {"policy", match[2].str()}}));
-            metrics.push_back(make_metric("edge_firewall_iptables_chain_policy_bytes",
-                                          parse_human_quantity(match[4].str()),
-                                          {{"chain", current_chain},
-                                           {"policy", match[2].str()}}));
-            continue;
-        }
-        if (std::regex_match(cleaned, match, reference_chain_pattern))
+        std::string_view rest = cleaned;
+        std::string_view chain;
+        if (consume(rest, "Chain") && skip_spaces(rest) && !(chain = take_token(rest)).empty() &&
+            skip_spaces(rest))
         {
-            current_chain = match[1].str();
-            continue;
+            ChainPolicyLine policy;
+            if (match_chain_policy(rest, policy))
+            {
+                current_chain = std::string(chain);
+                metrics.push_back(make_metric("edge_firewall_iptables_chain_policy_packets",
+                                              to_double(policy.packets),
+                                              {{"chain", current_chain},
+                                               {"policy", std::string(policy.policy)}}));
+                metrics.push_back(make_metric("edge_firewall_iptables_chain_policy_bytes",
+                                              parse_human_quantity(policy.bytes),
+                                              {{"chain", current_chain},
+                                               {"policy", std::string(policy.policy)}}));
+                continue;
+            }
+
+            // Chain ndsRTR (1 references)
+            if (consume(rest, "(") && !take_digits(rest).empty() && skip_spaces(rest) &&
+                rest == "references)")
+            {
+                current_chain = std::string(chain);
+                continue;
+            }
         }
 
-        const auto tokens = split_whitespace(cleaned);
-        if (tokens.size() < 9 || !std::isdigit(tokens[0].front()))
+        assign_tokens(tokens, cleaned);
+        if (tokens.size() < 9 || !is_digit(tokens[0].front()))
         {
             continue;
         }
 
-        const std::string extra = tokens.size() > 9 ? join_tail(tokens, 9) : "";
-        const std::map<std::string, std::string> labels {
+        const LabelSet labels {
             {"chain", current_chain},
-            {"target", tokens[2]},
-            {"input", tokens[5]},
-            {"output", tokens[6]},
-            {"source", tokens[7]},
-            {"destination", tokens[8]},
-            {"extra", extra},
+            {"target", std::string(tokens[2])},
+            {"input", std::string(tokens[5])},
+            {"output", std::string(tokens[6])},
+            {"source", std::string(tokens[7])},
+            {"destination", std::string(tokens[8])},
+            {"extra", join_tail(tokens, 9)},
         };
 
         metrics.push_back(make_metric("edge_firewall_iptables_rule_packets",
-                                      std::stod(tokens[0]),
+                                      to_double(tokens[0]),
                                       labels));
         metrics.push_back(make_metric("edge_firewall_iptables_rule_bytes",
                                       parse_human_quantity(tokens[1]),
@@ -1266,28 +1848,27 @@ std::vector<MetricSample> parse_nft_ruleset(const std::string &output)
     std::string current_table;
     std::string current_chain;
 
-    static const std::regex table_pattern("^table\\s+\\S+\\s+(\\S+)\\s*\\{$");
-    static const std::regex chain_pattern("^chain\\s+(\\S+)\\s*\\{$");
-    static const std::regex rule_pattern("^(.*)counter packets\\s+([0-9]+)\\s+bytes\\s+([0-9]+)(.*)$");
-
-    for (const auto &line : split_lines(output))
+    for (const auto line : lines_of(output))
     {
-        const std::string cleaned = trim(line);
+        const std::string_view cleaned = trim_view(line);
         if (cleaned.empty())
         {
             continue;
         }
 
-        std::smatch match;
-        if (std::regex_match(cleaned, match, table_pattern))
+        std::string_view rest = cleaned;
+        std::string_view name;
+        if (consume(rest, "table") && skip_spaces(rest) && !take_token(rest).empty() &&
+            skip_spaces(rest) && match_block_name(rest, name))
         {
-            current_table = match[1].str();
+            current_table = std::string(name);
             current_chain.clear();
             continue;
         }
-        if (std::regex_match(cleaned, match, chain_pattern))
+        rest = cleaned;
+        if (consume(rest, "chain") && skip_spaces(rest) && match_block_name(rest, name))
         {
-            current_chain = match[1].str();
+            current_chain = std::string(name);
             continue;
         }
         if (cleaned == "}")
@@ -1303,21 +1884,23 @@ std::vector<MetricSample> parse_nft_ruleset(const std::string &output)
             continue;
         }
 
-        if (std::regex_match(cleaned, match, rule_pattern) &&
-            !current_table.empty() && !current_chain.empty())
+        NftCounterLine counter;
+        if (match_nft_counter(cleaned, counter) && !current_table.empty() &&
+            !current_chain.empty())
         {
-            const std::string expression =
-                normalize_spaces(match[1].str() + " " + match[4].str());
-            const std::map<std::string, std::string> labels {
+            std::string expression;
+            append_normalized(expression, counter.before);
+            append_normalized(expression, counter.after);
+            const LabelSet labels {
                 {"table", current_table},
                 {"chain", current_chain},
                 {"expression", expression},
             };
             metrics.push_back(make_metric("edge_firewall_nft_rule_packets",
-                                          std::stod(match[2].str()),
+                                          to_double(counter.packets),
                                           labels));
             metrics.push_back(make_metric("edge_firewall_nft_rule_bytes",
-                                          std::stod(match[3].str()),
+                                          to_double(counter.bytes),
                                           labels));
         }
     }
@@ -1330,18 +1913,17 @@ std::vector<MetricSample> parse_ip_neigh(const std::string &output)
     std::vector<MetricSample> metrics;
     std::unordered_map<std::string, std::size_t> count_by_device;
 
-    for (const auto &line : split_lines(output))
+    std::vector<std::string_view> tokens;
+    for (const auto line : lines_of(output))
     {
-        const auto tokens = split_whitespace(trim(line));
+        assign_tokens(tokens, line);
         if (tokens.size() < 5)
         {
             continue;
         }
 
-        std::string ip = tokens[0];
-        std::string device;
-        std::string mac;
-        std::string state = tokens.back();
+        std::string_view device;
+        std::string_view mac;
         for (std::size_t i = 1; i + 1 < tokens.size(); ++i)
         {
             if (tokens[i] == "dev")
@@ -1359,12 +1941,12 @@ std::vector<MetricSample> parse_ip_neigh(const std::string &output)
             continue;
         }
 
-        ++count_by_device[device];
+        ++count_by_device[std::string(device)];
         metrics.push_back(make_info("edge_neighbor_entry_info",
-                                    {{"device", device},
-                                     {"ip", ip},
-                                     {"mac", mac},
-                                     {"state", state}}));
+                                    {{"device", std::string(device)},
+                                     {"ip", std::string(tokens[0])},
+                                     {"mac", std::string(mac)},
+                                     {"state", std::string(tokens.back())}}));
     }
 
     for (const auto &[device, count] : count_by_device)
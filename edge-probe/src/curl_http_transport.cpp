@@ -2,7 +2,10 @@
 
 #include <curl/curl.h>
 
+#include <algorithm>
 #include <mutex>
+#include <stdexcept>
+#include <string>
 
 namespace edge_probe
 {
@@ -12,6 +15,10 @@ namespace
 
 std::once_flag g_curl_init_once;
 
+constexpr long kKeepAliveIdleSec = 30;
+constexpr long kKeepAliveIntervalSec = 15;
+constexpr int kMultiPollTimeoutMs = 1000;
+
 void ensure_curl_global_init()
 {
     std::call_once(g_curl_init_once, []() { curl_global_init(CURL_GLOBAL_DEFAULT); });
@@ -29,26 +36,77 @@ std::size_t write_callback(char *ptr, std::size_t size, std::size_t nmemb, void
     return size * nmemb;
 }
 
-}  // namespace
-
-HttpTransport::Result CurlHttpTransport::post_json_lines(const TelemetryConfig &config,
-                                                         const std::string &body)
+int64_t info_time_us(CURL *curl, CURLINFO info)
 {
-    ensure_curl_global_init();
+    curl_off_t value = 0;
+    if (curl_easy_getinfo(curl, info, &value) != CURLE_OK)
+    {
+        return 0;
+    }
+    return static_cast<int64_t>(value);
+}
 
-    Result result;
-    CURL *curl = curl_easy_init();
-    if (curl == nullptr)
+// DNS results and TLS sessions outlive any one easy handle. Each transport
+// uses its share handle under its own mutex, so no lock callbacks are needed.
+CURLSH *make_share()
+{
+    CURLSH *share = curl_share_init();
+    if (share == nullptr)
     {
-        result.error_message = "curl_easy_init failed";
-        return result;
+        throw std::runtime_error("curl_share_init failed");
     }
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    return share;
+}
 
+curl_slist *request_headers(const TelemetryConfig &config)
+{
     struct curl_slist *headers = nullptr;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    headers = curl_slist_append(
+        headers,
+        (std::string("Content-Type: ") + payload_content_type(config.payload_format)).c_str());
     headers = curl_slist_append(headers, "Expect:");
+    if (config.payload_format == PayloadFormat::remote_write)
+    {
+        headers = curl_slist_append(headers, "X-Prometheus-Remote-Write-Version: 0.1.0");
+    }
+    if (const char *encoding = payload_content_encoding(config.compression))
+    {
+        headers = curl_slist_append(headers,
+                                    (std::string("Content-Encoding: ") + encoding).c_str());
+    }
+    return headers;
+}
+
+// Returns a reused handle with its options cleared, or a new one; the open
+// connections of a reused handle are kept.
+CURL *prepare_easy(CURL *&curl)
+{
+    if (curl == nullptr)
+    {
+        curl = curl_easy_init();
+    }
+    else
+    {
+        curl_easy_reset(curl);
+    }
+    return curl;
+}
 
+void set_post_options(CURL *curl,
+                      CURLSH *share,
+                      const TelemetryConfig &config,
+                      const std::string &body,
+                      curl_slist *headers,
+                      std::string *response_body)
+{
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
     curl_easy_setopt(curl, CURLOPT_URL, config.endpoint.c_str());
+    if (!config.unix_socket_path.empty())
+    {
+        curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, config.unix_socket_path.c_str());
+    }
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_POST, 1L);
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.data());
@@ -59,23 +117,249 @@ HttpTransport::Result CurlHttpTransport::post_json_lines(const TelemetryConfig &
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, config.request_timeout_sec);
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, config.verify_peer ? 1L : 0L);
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, config.verify_host ? 2L : 0L);
+    if (config.unix_socket_path.empty())
+    {
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, kKeepAliveIdleSec);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, kKeepAliveIntervalSec);
+    }
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &result.response_body);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response_body);
+}
 
-    const CURLcode code = curl_easy_perform(curl);
+// Fills result from a finished transfer; returns false when the transfer
+// itself failed and the handle should be rebuilt.
+bool finish_transfer(CURL *curl, CURLcode code, HttpTransport::Result &result)
+{
+    result.connect_time_us = info_time_us(curl, CURLINFO_CONNECT_TIME_T);
+    result.tls_time_us = info_time_us(curl, CURLINFO_APPCONNECT_TIME_T);
+    result.total_time_us = info_time_us(curl, CURLINFO_TOTAL_TIME_T);
     if (code != CURLE_OK)
     {
         result.error_message = curl_easy_strerror(code);
+        return false;
     }
-    else
+
+    long new_connections = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connections);
+    result.reused_connection = new_connections == 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &result.http_code);
+    result.ok = result.http_code >= 200 && result.http_code < 300;
+    return true;
+}
+
+}  // namespace
+
+struct CurlHttpTransport::Handles
+{
+    CURLSH *share {nullptr};
+    CURL *easy {nullptr};
+
+    ~Handles()
+    {
+        if (easy != nullptr)
+        {
+            curl_easy_cleanup(easy);
+        }
+        if (share != nullptr)
+        {
+            curl_share_cleanup(share);
+        }
+    }
+
+    // Drops the handle and its connection; the next post starts over.
+    void discard_easy()
     {
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &result.http_code);
-        result.ok = result.http_code >= 200 && result.http_code < 300;
+        if (easy != nullptr)
+        {
+            curl_easy_cleanup(easy);
+            easy = nullptr;
+        }
     }
+};
 
+CurlHttpTransport::CurlHttpTransport() : handles_(std::make_unique<Handles>())
+{
+    ensure_curl_global_init();
+    handles_->share = make_share();
+}
+
+CurlHttpTransport::~CurlHttpTransport() = default;
+
+HttpTransport::Result CurlHttpTransport::post_json_lines(const TelemetryConfig &config,
+                                                         const std::string &body)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Result result;
+    CURL *curl = prepare_easy(handles_->easy);
+    if (curl == nullptr)
+    {
+        result.error_message = "curl_easy_init failed";
+        return result;
+    }
+
+    curl_slist *headers = request_headers(config);
+    set_post_options(curl, handles_->share, config, body, headers, &result.response_body);
+    const CURLcode code = curl_easy_perform(curl);
     curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+
+    if (!finish_transfer(curl, code, result))
+    {
+        handles_->discard_easy();
+    }
     return result;
 }
 
+struct CurlMultiHttpTransport::Handles
+{
+    CURLSH *share {nullptr};
+    CURLM *multi {nullptr};
+    std::vector<CURL *> easy;
+    bool http2 {false};
+
+    ~Handles()
+    {
+        for (CURL *curl : easy)
+        {
+            if (curl != nullptr)
+            {
+                curl_easy_cleanup(curl);
+            }
+        }
+        if (multi != nullptr)
+        {
+            curl_multi_cleanup(multi);
+        }
+        if (share != nullptr)
+        {
+            curl_share_cleanup(share);
+        }
+    }
+};
+
+CurlMultiHttpTransport::CurlMultiHttpTransport(std::size_t max_in_flight)
+    : max_in_flight_(max_in_flight), handles_(std::make_unique<Handles>())
+{
+    if (max_in_flight_ == 0)
+    {
+        throw std::invalid_argument("curl multi transport needs at least one post in flight");
+    }
+
+    ensure_curl_global_init();
+    handles_->share = make_share();
+    handles_->multi = curl_multi_init();
+    if (handles_->multi == nullptr)
+    {
+        throw std::runtime_error("curl_multi_init failed");
+    }
+    handles_->easy.assign(max_in_flight_, nullptr);
+    handles_->http2 = (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2) != 0;
+
+    curl_multi_setopt(handles_->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(handles_->multi,
+                      CURLMOPT_MAX_HOST_CONNECTIONS,
+                      static_cast<long>(max_in_flight_));
+}
+
+CurlMultiHttpTransport::~CurlMultiHttpTransport() = default;
+
+HttpTransport::Result CurlMultiHttpTransport::post_json_lines(const TelemetryConfig &config,
+                                                              const std::string &body)
+{
+    return post_many(config, {&body}).front();
+}
+
+std::vector<HttpTransport::Result> CurlMultiHttpTransport::post_many(
+    const TelemetryConfig &config,
+    const std::vector<const std::string *> &bodies)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<Result> results(bodies.size());
+    // Cleartext endpoints stay on HTTP/1.1, where waiting to multiplex would
+    // only hold posts back.
+    const bool multiplex =
+        handles_->http2 && config.endpoint.compare(0, 8, "https://") == 0;
+    curl_slist *headers = request_headers(config);
+    for (std::size_t first = 0; first < bodies.size(); first += max_in_flight_)
+    {
+        const std::size_t count = std::min(max_in_flight_, bodies.size() - first);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Result &result = results[first + i];
+            CURL *curl = prepare_easy(handles_->easy[i]);
+            if (curl == nullptr)
+            {
+                result.error_message = "curl_easy_init failed";
+                continue;
+            }
+
+            set_post_options(
+                curl, handles_->share, config, *bodies[first + i], headers, &result.response_body);
+            if (multiplex)
+            {
+                // h2 where ALPN offers it; later posts wait to multiplex on
+                // that connection rather than opening their own.
+                curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+                curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+            }
+            curl_easy_setopt(curl, CURLOPT_PRIVATE, static_cast<void *>(&result));
+            result.error_message = "transfer did not complete";
+            curl_multi_add_handle(handles_->multi, curl);
+        }
+
+        int running = 0;
+        do
+        {
+            if (curl_multi_perform(handles_->multi, &running) != CURLM_OK)
+            {
+                break;
+            }
+            if (running > 0)
+            {
+                curl_multi_poll(handles_->multi, nullptr, 0, kMultiPollTimeoutMs, nullptr);
+            }
+        } while (running > 0);
+
+        int queued = 0;
+        while (CURLMsg *message = curl_multi_info_read(handles_->multi, &queued))
+        {
+            if (message->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+            char *data = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &data);
+            auto *result = reinterpret_cast<Result *>(data);
+            result->error_message.clear();
+            finish_transfer(message->easy_handle, message->data.result, *result);
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            CURL *&curl = handles_->easy[i];
+            if (curl == nullptr)
+            {
+                continue;
+            }
+            curl_multi_remove_handle(handles_->multi, curl);
+            if (!results[first + i].ok && results[first + i].http_code == 0)
+            {
+                // The transfer itself failed; start the next one on a new handle.
+                curl_easy_cleanup(curl);
+                curl = nullptr;
+            }
+        }
+    }
+    curl_slist_free_all(headers);
+    return results;
+}
+
+std::size_t CurlMultiHttpTransport::max_in_flight() const
+{
+    return max_in_flight_;
+}
+
 }  // namespace edge_probe
@@ -0,0 +1,278 @@
+#include "edge_probe/json_escape.h"
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define EDGE_PROBE_JSON_ESCAPE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define EDGE_PROBE_JSON_ESCAPE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace edge_probe
+{
+
+namespace
+{
+
+using FindEscapeFn = std::size_t (*)(const char *data, std::size_t size);
+
+bool needs_escape(unsigned char ch)
+{
+    return ch == '"' || ch == '\\' || ch < 0x20;
+}
+
+std::size_t find_escape_scalar(const char *data, std::size_t size)
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        if (needs_escape(static_cast<unsigned char>(data[i])))
+        {
+            return i;
+        }
+    }
+    return size;
+}
+
+#if defined(EDGE_PROBE_JSON_ESCAPE_X86) && defined(__SSE2__)
+std::size_t find_escape_sse2(const char *data, std::size_t size)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i is_quote = _mm_cmpeq_epi8(chunk, quote);
+        const __m128i is_backslash = _mm_cmpeq_epi8(chunk, backslash);
+        const __m128i is_control =
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, control_max), control_max);
+        const int mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_or_si128(is_quote, is_backslash), is_control));
+        if (mask != 0)
+        {
+            return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+    return i + find_escape_scalar(data + i, size - i);
+}
+
+__attribute__((target("avx2"))) std::size_t find_escape_avx2_wide(const char *data,
+                                                                   std::size_t size)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control_max = _mm256_set1_epi8(0x1F);
+
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        const __m256i chunk =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const __m256i is_quote = _mm256_cmpeq_epi8(chunk, quote);
+        const __m256i is_backslash = _mm256_cmpeq_epi8(chunk, backslash);
+        const __m256i is_control =
+            _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control_max), control_max);
+        const int mask = _mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_or_si256(is_quote, is_backslash), is_control));
+        if (mask != 0)
+        {
+            return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+    return i + find_escape_sse2(data + i, size - i);
+}
+
+// Entering 256-bit code has a fixed cost that dominates on short labels, so only
+// runs long enough to amortize it take the AVX2 loop.
+std::size_t find_escape_avx2(const char *data, std::size_t size)
+{
+    constexpr std::size_t kMinAvx2Bytes = 1024;
+    if (size < kMinAvx2Bytes)
+    {
+        return find_escape_sse2(data, size);
+    }
+    return find_escape_avx2_wide(data, size);
+}
+#endif
+
+#if defined(EDGE_PROBE_JSON_ESCAPE_NEON)
+std::size_t find_escape_neon(const char *data, std::size_t size)
+{
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t control_limit = vdupq_n_u8(0x20);
+
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        const uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t *>(data + i));
+        const uint8x16_t is_quote_or_backslash =
+            vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash));
+        const uint8x16_t hits =
+            vorrq_u8(is_quote_or_backslash, vcltq_u8(chunk, control_limit));
+        if (vmaxvq_u8(hits) != 0)
+        {
+            return i + find_escape_scalar(data + i, 16);
+        }
+    }
+    return i + find_escape_scalar(data + i, size - i);
+}
+#endif
+
+FindEscapeFn find_escape_for(JsonEscapeKernel kernel)
+{
+    switch (kernel)
+    {
+#if defined(EDGE_PROBE_JSON_ESCAPE_X86) && defined(__SSE2__)
+        case JsonEscapeKernel::sse2:
+            return &find_escape_sse2;
+        case JsonEscapeKernel::avx2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? &find_escape_avx2 : nullptr;
+#endif
+#if defined(EDGE_PROBE_JSON_ESCAPE_NEON)
+        case JsonEscapeKernel::neon:
+            return &find_escape_neon;
+#endif
+        case JsonEscapeKernel::scalar:
+            return &find_escape_scalar;
+        default:
+            return nullptr;
+    }
+}
+
+JsonEscapeKernel detect_kernel()
+{
+    for (const auto kernel :
+         {JsonEscapeKernel::avx2, JsonEscapeKernel::neon, JsonEscapeKernel::sse2})
+    {
+        if (find_escape_for(kernel) != nullptr)
+        {
+            return kernel;
+        }
+    }
+    return JsonEscapeKernel::scalar;
+}
+
+JsonEscapeKernel active_kernel()
+{
+    static const JsonEscapeKernel kernel = detect_kernel();
+    return kernel;
+}
+
+FindEscapeFn active_find_escape()
+{
+    static const FindEscapeFn find_escape = find_escape_for(active_kernel());
+    return find_escape;
+}
+
+void append_escape_sequence(unsigned char ch, std::string &output)
+{
+    static constexpr char kHexDigits[] = "0123456789abcdef";
+
+    switch (ch)
+    {
+        case '"':
+            output.append("\\\"");
+            break;
+        case '\\':
+            output.append("\\\\");
+            break;
+        case '\b':
+            output.append("\\b");
+            break;
+        case '\f':
+            output.append("\\f");
+            break;
+        case '\n':
+            output.append("\\n");
+            break;
+        case '\r':
+            output.append("\\r");
+            break;
+        case '\t':
+            output.append("\\t");
+            break;
+        default:
+        {
+            const char escaped[] = {
+                '\\', 'u', '0', '0', kHexDigits[(ch >> 4) & 0x0F], kHexDigits[ch & 0x0F]};
+            output.append(escaped, sizeof(escaped));
+            break;
+        }
+    }
+}
+
+void escape_with(FindEscapeFn find_escape, std::string_view value, std::string &output)
+{
+    const char *data = value.data();
+    std::size_t remaining = value.size();
+    while (remaining > 0)
+    {
+        const std::size_t clean = find_escape(data, remaining);
+        output.append(data, clean);
+        if (clean == remaining)
+        {
+            return;
+        }
+
+        append_escape_sequence(static_cast<unsigned char>(data[clean]), output);
+        data += clean + 1;
+        remaining -= clean + 1;
+    }
+}
+
+}  // namespace
+
+std::string json_escape(const std::string &value)
+{
+    std::string output;
+    output.reserve(value.size());
+    escape_with(active_find_escape(), value, output);
+    return output;
+}
+
+void json_escape(std::string_view value, std::string &output)
+{
+    escape_with(active_find_escape(), value, output);
+}
+
+void json_escape(std::string_view value, std::string &output, JsonEscapeKernel kernel)
+{
+    const FindEscapeFn find_escape = find_escape_for(kernel);
+    escape_with(find_escape != nullptr ? find_escape : &find_escape_scalar, value, output);
+}
+
+JsonEscapeKernel json_escape_active_kernel()
+{
+    return active_kernel();
+}
+
+bool json_escape_kernel_supported(JsonEscapeKernel kernel)
+{
+    return find_escape_for(kernel) != nullptr;
+}
+
+const char *json_escape_kernel_name(JsonEscapeKernel kernel)
+{
+    switch (kernel)
+    {
+        case JsonEscapeKernel::scalar:
+            return "scalar";
+        case JsonEscapeKernel::sse2:
+            return "sse2";
+        case JsonEscapeKernel::avx2:
+            return "avx2";
+        case JsonEscapeKernel::neon:
+            return "neon";
+    }
+    return "unknown";
+}
+
+}  // namespace edge_probe
@@ -0,0 +1,192 @@
+#include "edge_probe/json_lines_encoder.h"
+
+#include "edge_probe/json_escape.h"
+#include "edge_probe/metric_prefix_cache.h"
+
+#include <charconv>
+#include <system_error>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+constexpr std::string_view kMetricPrefix = "{\"metric\":{\"__name__\":\"";
+constexpr std::string_view kMetricSuffix = "}";
+constexpr std::string_view kValuesPrefix = ",\"values\":[";
+constexpr std::string_view kTimestampsPrefix = "],\"timestamps\":[";
+constexpr std::string_view kLineSuffix = "]}\n";
+
+template <typename Labels>
+void append_metric_object(std::string_view name,
+                          const Labels &labels,
+                          const ExternalLabels *external,
+                          std::string &output)
+{
+    output.append(kMetricPrefix);
+    json_escape(name, output);
+    output.push_back('"');
+
+    merge_labels(labels, external, [&output](std::string_view key, std::string_view value) {
+        output.append(",\"");
+        json_escape(key, output);
+        output.append("\":\"");
+        json_escape(value, output);
+        output.push_back('"');
+    });
+
+    output.append(kMetricSuffix);
+}
+
+}  // namespace
+
+JsonLinesEncoder::JsonLinesEncoder(std::size_t reserve_bytes)
+{
+    buffer_.reserve(reserve_bytes);
+}
+
+void JsonLinesEncoder::reserve(std::size_t bytes)
+{
+    buffer_.reserve(bytes);
+}
+
+void JsonLinesEncoder::set_prefix_cache(MetricPrefixCache *cache)
+{
+    prefix_cache_ = cache;
+}
+
+void JsonLinesEncoder::set_external_labels(const ExternalLabels *labels)
+{
+    external_labels_ = labels;
+}
+
+void JsonLinesEncoder::append(const MetricSample &sample)
+{
+    if (prefix_cache_ != nullptr)
+    {
+        prefix_cache_->append_metric(sample, buffer_);
+    }
+    else
+    {
+        append_metric(sample, buffer_, external_labels_);
+    }
+    buffer_.append(kValuesPrefix);
+    append_value(sample.value, buffer_);
+    buffer_.append(kTimestampsPrefix);
+    append_timestamp(sample.timestamp_ms, buffer_);
+    buffer_.append(kLineSuffix);
+}
+
+void JsonLinesEncoder::append(const SeriesRegistry &registry, const SeriesSample &sample)
+{
+    if (prefix_cache_ != nullptr)
+    {
+        prefix_cache_->append_metric(registry, sample.series, buffer_);
+    }
+    else
+    {
+        append_metric(registry, sample.series, buffer_, external_labels_);
+    }
+    buffer_.append(kValuesPrefix);
+    append_value(sample.value, buffer_);
+    buffer_.append(kTimestampsPrefix);
+    append_timestamp(sample.timestamp_ms, buffer_);
+    buffer_.append(kLineSuffix);
+}
+
+void JsonLinesEncoder::append_series(std::string_view metric,
+                                     std::string_view values,
+                                     std::string_view timestamps)
+{
+    buffer_.append(metric);
+    buffer_.append(kValuesPrefix);
+    buffer_.append(values);
+    buffer_.append(kTimestampsPrefix);
+    buffer_.append(timestamps);
+    buffer_.append(kLineSuffix);
+}
+
+std::size_t JsonLinesEncoder::series_line_bytes(std::size_t metric_bytes,
+                                                std::size_t values_bytes,
+                                                std::size_t timestamps_bytes)
+{
+    return metric_bytes + kValuesPrefix.size() + values_bytes + kTimestampsPrefix.size() +
+           timestamps_bytes + kLineSuffix.size();
+}
+
+void JsonLinesEncoder::append_metric(const MetricSample &sample,
+                                     std::string &output,
+                                     const ExternalLabels *external)
+{
+    append_metric_object(sample.name, sample.labels, external, output);
+}
+
+void JsonLinesEncoder::append_metric(const SeriesRegistry &registry,
+                                     SeriesId series,
+                                     std::string &output,
+                                     const ExternalLabels *external)
+{
+    append_metric_object(registry.name(series), registry.labels(series), external, output);
+}
+
+void JsonLinesEncoder::append_value(double value, std::string &output)
+{
+    char digits[32];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    if (result.ec == std::errc())
+    {
+        output.append(digits, static_cast<std::size_t>(result.ptr - digits));
+    }
+}
+
+void JsonLinesEncoder::append_timestamp(int64_t value, std::string &output)
+{
+    char digits[24];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    if (result.ec == std::errc())
+    {
+        output.append(digits, static_cast<std::size_t>(result.ptr - digits));
+    }
+}
+
+void JsonLinesEncoder::clear()
+{
+    buffer_.clear();
+}
+
+void JsonLinesEncoder::truncate(std::size_t size)
+{
+    if (size < buffer_.size())
+    {
+        buffer_.resize(size);
+    }
+}
+
+void JsonLinesEncoder::swap_buffer(std::string &other)
+{
+    buffer_.swap(other);
+    buffer_.clear();
+}
+
+bool JsonLinesEncoder::empty() const
+{
+    return buffer_.empty();
+}
+
+std::size_t JsonLinesEncoder::size() const
+{
+    return buffer_.size();
+}
+
+std::size_t JsonLinesEncoder::capacity() const
+{
+    return buffer_.capacity();
+}
+
+const std::string &JsonLinesEncoder::buffer() const
+{
+    return buffer_;
+}
+
+}  // namespace edge_probe
@@ -0,0 +1,164 @@
+#include "edge_probe/label_set.h"
+
+#include <utility>
+
+namespace edge_probe
+{
+
+LabelSet::LabelSet(std::initializer_list<Label> labels)
+{
+    for (const auto &label : labels)
+    {
+        emplace(label.name, label.value);
+    }
+}
+
+LabelSet::LabelSet(LabelSet &&other) noexcept
+    : inline_(std::move(other.inline_)), heap_(std::move(other.heap_)), size_(other.size_)
+{
+    other.heap_.clear();
+    other.size_ = 0;
+}
+
+LabelSet &LabelSet::operator=(LabelSet &&other) noexcept
+{
+    if (this != &other)
+    {
+        inline_ = std::move(other.inline_);
+        heap_ = std::move(other.heap_);
+        size_ = other.size_;
+        other.heap_.clear();
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+bool LabelSet::emplace(std::string name, std::string value)
+{
+    const std::size_t index = lower_bound(name);
+    if (index < size_ && data()[index].name == name)
+    {
+        return false;
+    }
+    insert_at(index, std::move(name)).value = std::move(value);
+    return true;
+}
+
+std::string &LabelSet::operator[](std::string_view name)
+{
+    const std::size_t index = lower_bound(name);
+    if (index < size_ && data()[index].name == name)
+    {
+        return data()[index].value;
+    }
+    return insert_at(index, std::string(name)).value;
+}
+
+bool LabelSet::erase(std::string_view name)
+{
+    const std::size_t index = lower_bound(name);
+    if (index >= size_ || data()[index].name != name)
+    {
+        return false;
+    }
+
+    if (!heap_.empty())
+    {
+        heap_.erase(heap_.begin() + static_cast<std::ptrdiff_t>(index));
+        --size_;
+        return true;
+    }
+    for (std::size_t i = index + 1; i < size_; ++i)
+    {
+        inline_[i - 1] = std::move(inline_[i]);
+    }
+    --size_;
+    inline_[size_].name.clear();
+    inline_[size_].value.clear();
+    return true;
+}
+
+const std::string *LabelSet::find(std::string_view name) const
+{
+    const std::size_t index = lower_bound(name);
+    if (index < size_ && data()[index].name == name)
+    {
+        return &data()[index].value;
+    }
+    return nullptr;
+}
+
+void LabelSet::clear()
+{
+    if (heap_.empty())
+    {
+        for (std::size_t i = 0; i < size_; ++i)
+        {
+            inline_[i].name.clear();
+            inline_[i].value.clear();
+        }
+    }
+    heap_.clear();
+    size_ = 0;
+}
+
+bool operator==(const LabelSet &lhs, const LabelSet &rhs)
+{
+    if (lhs.size_ != rhs.size_)
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < lhs.size_; ++i)
+    {
+        const Label &left = lhs.data()[i];
+        const Label &right = rhs.data()[i];
+        if (left.name != right.name || left.value != right.value)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t LabelSet::lower_bound(std::string_view name) const
+{
+    // Sets are small enough that a linear scan beats a binary search.
+    const Label *labels = data();
+    std::size_t index = 0;
+    while (index < size_ && std::string_view(labels[index].name) < name)
+    {
+        ++index;
+    }
+    return index;
+}
+
+Label &LabelSet::insert_at(std::size_t index, std::string name)
+{
+    if (heap_.empty() && size_ < kInlineCapacity)
+    {
+        for (std::size_t i = size_; i > index; --i)
+        {
+            inline_[i] = std::move(inline_[i - 1]);
+        }
+        inline_[index].name = std::move(name);
+        inline_[index].value.clear();
+        ++size_;
+        return inline_[index];
+    }
+
+    if (heap_.empty())
+    {
+        heap_.reserve(kInlineCapacity * 2);
+        for (std::size_t i = 0; i < size_; ++i)
+        {
+            heap_.push_back(std::move(inline_[i]));
+            inline_[i].name.clear();
+            inline_[i].value.clear();
+        }
+    }
+    ++size_;
+    return *heap_.insert(heap_.begin() + static_cast<std::ptrdiff_t>(index),
+                         Label {std::move(name), std::string()});
+}
+
+}  // namespace edge_probe
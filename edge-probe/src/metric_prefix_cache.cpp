@@ -0,0 +1,140 @@
+#include "edge_probe/metric_prefix_cache.h"
+
+#include "edge_probe/json_lines_encoder.h"
+
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+void append_key_part(std::string_view part, std::string &key)
+{
+    const auto size = static_cast<std::uint32_t>(part.size());
+    key.append(reinterpret_cast<const char *>(&size), sizeof(size));
+    key.append(part.data(), part.size());
+}
+
+// Only the owning thread writes the counters, so a plain store is enough.
+void bump(std::atomic<std::uint64_t> &counter)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+MetricPrefixCache::MetricPrefixCache(std::size_t max_entries,
+                                     const ExternalLabels *external_labels)
+    : max_entries_(max_entries), external_labels_(external_labels)
+{
+    if (max_entries_ == 0)
+    {
+        throw std::invalid_argument("metric prefix cache needs at least one entry");
+    }
+    index_.reserve(max_entries_);
+}
+
+void MetricPrefixCache::append_metric(const MetricSample &sample, std::string &output)
+{
+    bool hit = false;
+    std::string &prefix = lookup(sample.name, sample.labels, hit);
+    if (!hit)
+    {
+        JsonLinesEncoder::append_metric(sample, prefix, external_labels_);
+    }
+    output.append(prefix);
+}
+
+void MetricPrefixCache::append_metric(const SeriesRegistry &registry,
+                                      SeriesId series,
+                                      std::string &output)
+{
+    bool hit = false;
+    std::string &prefix = lookup(registry.name(series), registry.labels(series), hit);
+    if (!hit)
+    {
+        JsonLinesEncoder::append_metric(registry, series, prefix, external_labels_);
+    }
+    output.append(prefix);
+}
+
+template <typename Labels>
+std::string &MetricPrefixCache::lookup(std::string_view name, const Labels &labels, bool &hit)
+{
+    key_scratch_.clear();
+    append_key_part(name, key_scratch_);
+    for (const auto &[key, value] : labels)
+    {
+        append_key_part(key, key_scratch_);
+        append_key_part(value, key_scratch_);
+    }
+    const std::uint64_t fingerprint = std::hash<std::string_view> {}(key_scratch_);
+
+    const auto found = index_.find(fingerprint);
+    hit = found != index_.end() && found->second->key == key_scratch_;
+    if (hit)
+    {
+        bump(hits_);
+        entries_.splice(entries_.begin(), entries_, found->second);
+        return found->second->prefix;
+    }
+    bump(misses_);
+
+    std::list<Entry>::iterator entry;
+    if (found != index_.end())
+    {
+        // Fingerprint collision: the newer series takes over the slot.
+        entry = found->second;
+        entries_.splice(entries_.begin(), entries_, entry);
+    }
+    else if (entries_.size() >= max_entries_)
+    {
+        // Reuse the least recently used node and its string capacity.
+        bump(evictions_);
+        entry = std::prev(entries_.end());
+        index_.erase(entry->fingerprint);
+        entries_.splice(entries_.begin(), entries_, entry);
+        index_.emplace(fingerprint, entry);
+    }
+    else
+    {
+        entry = entries_.emplace(entries_.begin());
+        index_.emplace(fingerprint, entry);
+    }
+
+    entry->fingerprint = fingerprint;
+    entry->key.assign(key_scratch_);
+    entry->prefix.clear();
+    return entry->prefix;
+}
+
+std::size_t MetricPrefixCache::size() const
+{
+    return entries_.size();
+}
+
+std::size_t MetricPrefixCache::max_entries() const
+{
+    return max_entries_;
+}
+
+std::uint64_t MetricPrefixCache::hits() const
+{
+    return hits_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t MetricPrefixCache::misses() const
+{
+    return misses_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t MetricPrefixCache::evictions() const
+{
+    return evictions_.load(std::memory_order_relaxed);
+}
+
+}  // namespace edge_probe
@@ -0,0 +1,180 @@
+#include "edge_probe/netlink_socket.h"
+
+#include <cerrno>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+// Dumps are built in skbs of at most 32 KiB, so one datagram always fits.
+constexpr std::size_t kReceiveBufferBytes = 64 * 1024;
+constexpr time_t kReceiveTimeoutSec = 2;
+
+}  // namespace
+
+NetlinkExchange::NetlinkExchange(std::uint32_t sequence, std::uint32_t port_id, bool is_dump)
+    : sequence_(sequence), port_id_(port_id), is_dump_(is_dump)
+{
+}
+
+void NetlinkExchange::read(std::string_view datagram,
+                           const NetlinkMessageHandler &handler,
+                           const NetlinkMessageHandler &notification_handler)
+{
+    const auto on_message = [&](const nlmsghdr &reply, std::string_view payload) {
+        if (reply.nlmsg_pid != port_id_)
+        {
+            if (notification_handler && reply.nlmsg_type >= NLMSG_MIN_TYPE)
+            {
+                notification_handler(reply, payload);
+            }
+            return;
+        }
+        // Leftovers of an earlier, abandoned request carry an older sequence.
+        if (finished() || reply.nlmsg_seq != sequence_)
+        {
+            return;
+        }
+        interrupted_ = interrupted_ || (reply.nlmsg_flags & NLM_F_DUMP_INTR) != 0;
+        if (reply.nlmsg_type == NLMSG_DONE)
+        {
+            done_ = true;
+            failed_ = failed_ || read_netlink_struct<std::int32_t>(payload) < 0;
+        }
+        else if (reply.nlmsg_type == NLMSG_ERROR)
+        {
+            // An error code of zero acknowledges a request that has no reply.
+            done_ = true;
+            failed_ = failed_ || read_netlink_struct<nlmsgerr>(payload).error != 0;
+        }
+        else if (reply.nlmsg_type >= NLMSG_MIN_TYPE)
+        {
+            handler(reply, payload);
+            done_ = !is_dump_;
+        }
+    };
+    failed_ = !for_each_netlink_message(datagram, on_message) || failed_;
+}
+
+bool NetlinkExchange::finished() const
+{
+    return done_ || failed_;
+}
+
+bool NetlinkExchange::succeeded() const
+{
+    return done_ && !failed_ && !interrupted_;
+}
+
+NetlinkSocket::NetlinkSocket(int protocol, std::uint32_t groups)
+{
+    fd_ = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, protocol);
+    if (fd_ < 0)
+    {
+        throw std::runtime_error(std::string("failed to open netlink socket: ") +
+                                 std::strerror(errno));
+    }
+
+    const timeval timeout {kReceiveTimeoutSec, 0};
+    ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    sockaddr_nl local {};
+    local.nl_family = AF_NETLINK;
+    local.nl_groups = groups;
+    socklen_t length = sizeof(local);
+    if (::bind(fd_, reinterpret_cast<const sockaddr *>(&local), sizeof(local)) != 0 ||
+        ::getsockname(fd_, reinterpret_cast<sockaddr *>(&local), &length) != 0)
+    {
+        const int error = errno;
+        ::close(fd_);
+        throw std::runtime_error(std::string("failed to bind netlink socket: ") +
+                                 std::strerror(error));
+    }
+    port_id_ = local.nl_pid;
+    buffer_.resize(kReceiveBufferBytes);
+}
+
+NetlinkSocket::~NetlinkSocket()
+{
+    ::close(fd_);
+}
+
+int NetlinkSocket::fd() const
+{
+    return fd_;
+}
+
+bool NetlinkSocket::request(std::uint16_t type,
+                            std::uint16_t flags,
+                            std::string_view body,
+                            const ReplyHandler &handler,
+                            const ReplyHandler &notification_handler)
+{
+    nlmsghdr header {};
+    header.nlmsg_len = static_cast<std::uint32_t>(NLMSG_LENGTH(body.size()));
+    header.nlmsg_type = type;
+    header.nlmsg_flags = static_cast<std::uint16_t>(NLM_F_REQUEST | flags);
+    header.nlmsg_seq = ++sequence_;
+    header.nlmsg_pid = port_id_;
+    request_.assign(reinterpret_cast<const char *>(&header), sizeof(header));
+    request_.resize(NLMSG_HDRLEN, '\0');
+    request_.append(body);
+
+    sockaddr_nl kernel {};
+    kernel.nl_family = AF_NETLINK;
+    ssize_t sent = 0;
+    do
+    {
+        sent = ::sendto(fd_,
+                        request_.data(),
+                        request_.size(),
+                        0,
+                        reinterpret_cast<const sockaddr *>(&kernel),
+                        sizeof(kernel));
+    } while (sent < 0 && errno == EINTR);
+    if (sent < 0)
+    {
+        return false;
+    }
+
+    NetlinkExchange exchange(header.nlmsg_seq, port_id_, (flags & NLM_F_DUMP) == NLM_F_DUMP);
+    while (!exchange.finished())
+    {
+        std::string_view datagram;
+        if (!receive(0, datagram))
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        exchange.read(datagram, handler, notification_handler);
+    }
+    return exchange.succeeded();
+}
+
+bool NetlinkSocket::receive(int flags, std::string_view &datagram)
+{
+    const ssize_t received = ::recv(fd_, buffer_.data(), buffer_.size(), flags | MSG_TRUNC);
+    if (received < 0)
+    {
+        return false;
+    }
+    if (static_cast<std::size_t>(received) > buffer_.size())
+    {
+        errno = EMSGSIZE;
+        return false;
+    }
+    datagram = std::string_view(buffer_.data(), static_cast<std::size_t>(received));
+    return true;
+}
+
+}  // namespace edge_probe
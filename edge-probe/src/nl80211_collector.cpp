@@ -0,0 +1,757 @@
+#include "edge_probe/nl80211_collector.h"
+
+#include "edge_probe/metric_sample_builders.h"
+
+#include <array>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+#include <linux/genetlink.h>
+#include <linux/nl80211.h>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+// nl80211_iftype in order, named as iw prints them.
+constexpr std::array<const char *, 13> kInterfaceModes = {"unspecified",
+                                                          "IBSS",
+                                                          "managed",
+                                                          "AP",
+                                                          "AP/VLAN",
+                                                          "WDS",
+                                                          "monitor",
+                                                          "mesh point",
+                                                          "P2P-client",
+                                                          "P2P-GO",
+                                                          "P2P-device",
+                                                          "outside context of a BSS",
+                                                          "NAN"};
+
+// nl80211_commands in order, lowercased as iw prints them.
+constexpr std::array<const char *, 153> kCommands = {
+    "unspec", "get_wiphy", "set_wiphy", "new_wiphy", "del_wiphy", "get_interface", "set_interface",
+    "new_interface", "del_interface", "get_key", "set_key", "new_key", "del_key", "get_beacon",
+    "set_beacon", "start_ap", "stop_ap", "get_station", "set_station", "new_station", "del_station",
+    "get_mpath", "set_mpath", "new_mpath", "del_mpath", "set_bss", "set_reg", "req_set_reg",
+    "get_mesh_config", "set_mesh_config", "set_mgmt_extra_ie", "get_reg", "get_scan",
+    "trigger_scan", "new_scan_results", "scan_aborted", "reg_change", "authenticate", "associate",
+    "deauthenticate", "disassociate", "michael_mic_failure", "reg_beacon_hint", "join_ibss",
+    "leave_ibss", "testmode", "connect", "roam", "disconnect", "set_wiphy_netns", "get_survey",
+    "new_survey_results", "set_pmksa", "del_pmksa", "flush_pmksa", "remain_on_channel",
+    "cancel_remain_on_channel", "set_tx_bitrate_mask", "register_frame", "frame", "frame_tx_status",
+    "set_power_save", "get_power_save", "set_cqm", "notify_cqm", "set_channel", "set_wds_peer",
+    "frame_wait_cancel", "join_mesh", "leave_mesh", "unprot_deauthenticate", "unprot_disassociate",
+    "new_peer_candidate", "get_wowlan", "set_wowlan", "start_sched_scan", "stop_sched_scan",
+    "sched_scan_results", "sched_scan_stopped", "set_rekey_offload", "pmksa_candidate", "tdls_oper",
+    "tdls_mgmt", "unexpected_frame", "probe_client", "register_beacons", "unexpected_4addr_frame",
+    "set_noack_map", "ch_switch_notify", "start_p2p_device", "stop_p2p_device", "conn_failed",
+    "set_mcast_rate", "set_mac_acl", "radar_detect", "get_protocol_features", "update_ft_ies",
+    "ft_event", "crit_protocol_start", "crit_protocol_stop", "get_coalesce", "set_coalesce",
+    "channel_switch", "vendor", "set_qos_map", "add_tx_ts", "del_tx_ts", "get_mpp", "join_ocb",
+    "leave_ocb", "ch_switch_started_notify", "tdls_channel_switch", "tdls_cancel_channel_switch",
+    "wiphy_reg_change", "abort_scan", "start_nan", "stop_nan", "add_nan_function",
+    "del_nan_function", "change_nan_config", "nan_match", "set_multicast_to_unicast",
+    "update_connect_params", "set_pmk", "del_pmk", "port_authorized", "reload_regdb",
+    "external_auth", "sta_opmode_changed", "control_port_frame", "get_ftm_responder_stats",
+    "peer_measurement_start", "peer_measurement_result", "peer_measurement_complete",
+    "notify_radar", "update_owe_info", "probe_mesh_link", "set_tid_config", "unprot_beacon",
+    "control_port_frame_tx_status", "set_sar_specs", "obss_color_collision", "color_change_request",
+    "color_change_started", "color_change_aborted", "color_change_completed", "set_fils_aad",
+    "assoc_comeback", "add_link", "remove_link", "add_link_sta", "modify_link_sta",
+    "remove_link_sta",
+};
+
+// nl80211_ext_feature_index in order.
+constexpr std::array<const char *, 62> kExtendedFeatures = {
+    "VHT_IBSS", "RRM", "MU_MIMO_AIR_SNIFFER", "SCAN_START_TIME", "BSS_PARENT_TSF", "SET_SCAN_DWELL",
+    "BEACON_RATE_LEGACY", "BEACON_RATE_HT", "BEACON_RATE_VHT", "FILS_STA", "MGMT_TX_RANDOM_TA",
+    "MGMT_TX_RANDOM_TA_CONNECTED", "SCHED_SCAN_RELATIVE_RSSI", "CQM_RSSI_LIST", "FILS_SK_OFFLOAD",
+    "4WAY_HANDSHAKE_STA_PSK", "4WAY_HANDSHAKE_STA_1X", "FILS_MAX_CHANNEL_TIME",
+    "ACCEPT_BCAST_PROBE_RESP", "OCE_PROBE_REQ_HIGH_TX_RATE", "OCE_PROBE_REQ_DEFERRAL_SUPPRESSION",
+    "MFP_OPTIONAL", "LOW_SPAN_SCAN", "LOW_POWER_SCAN", "HIGH_ACCURACY_SCAN", "DFS_OFFLOAD",
+    "CONTROL_PORT_OVER_NL80211", "ACK_SIGNAL_SUPPORT", "TXQS", "SCAN_RANDOM_SN",
+    "SCAN_MIN_PREQ_CONTENT", "CAN_REPLACE_PTK0", "ENABLE_FTM_RESPONDER", "AIRTIME_FAIRNESS",
+    "AP_PMKSA_CACHING", "SCHED_SCAN_BAND_SPECIFIC_RSSI_THOLD", "EXT_KEY_ID", "STA_TX_PWR",
+    "SAE_OFFLOAD", "VLAN_OFFLOAD", "AQL", "BEACON_PROTECTION", "CONTROL_PORT_NO_PREAUTH",
+    "PROTECTED_TWT", "DEL_IBSS_STA", "MULTICAST_REGISTRATIONS", "BEACON_PROTECTION_CLIENT",
+    "SCAN_FREQ_KHZ", "CONTROL_PORT_OVER_NL80211_TX_STATUS", "OPERATING_CHANNEL_VALIDATION",
+    "4WAY_HANDSHAKE_AP_PSK", "SAE_OFFLOAD_AP", "FILS_DISCOVERY", "UNSOL_BCAST_PROBE_RESP",
+    "BEACON_RATE_HE", "SECURE_LTF", "SECURE_RTT", "PROT_RANGE_NEGO_AND_MEASURE", "BSS_COLOR",
+    "FILS_CRYPTO_OFFLOAD", "RADAR_BACKGROUND", "POWERED_ADDR_CHANGE",
+};
+
+struct BandCounts
+{
+    int enabled {0};
+    int disabled {0};
+    int radar {0};
+};
+
+// Tracks the 32-bit and 64-bit forms of one byte counter; the 64-bit one
+// wins because the other wraps.
+struct ByteCounter
+{
+    bool present {false};
+    bool wide {false};
+    std::uint64_t value {0};
+
+    void set(std::uint64_t bytes, bool is_wide)
+    {
+        if (is_wide || !wide)
+        {
+            present = true;
+            wide = is_wide;
+            value = bytes;
+        }
+    }
+};
+
+// Escapes as iw does: spaces are kept only inside the SSID.
+std::string format_ssid(std::string_view bytes)
+{
+    std::string text;
+    for (std::size_t i = 0; i < bytes.size(); ++i)
+    {
+        const unsigned char byte = static_cast<unsigned char>(bytes[i]);
+        if (byte > ' ' && byte < 0x7f && byte != '\\')
+        {
+            text += static_cast<char>(byte);
+        }
+        else if (byte == ' ' && i != 0 && i + 1 != bytes.size())
+        {
+            text += ' ';
+        }
+        else
+        {
+            char escaped[5];
+            std::snprintf(escaped, sizeof(escaped), "\\x%.2x", static_cast<unsigned int>(byte));
+            text += escaped;
+        }
+    }
+    return text;
+}
+
+std::string interface_mode_name(std::uint32_t type)
+{
+    return type < kInterfaceModes.size() ? kInterfaceModes[type]
+                                         : "Unknown mode (" + std::to_string(type) + ")";
+}
+
+std::string command_name(std::uint32_t command)
+{
+    return command < kCommands.size() ? kCommands[command]
+                                      : "Unknown command (" + std::to_string(command) + ")";
+}
+
+// Channel numbers as the iw in cmd.txt derives them, 6 GHz included.
+int frequency_to_channel(std::uint32_t mhz)
+{
+    const int frequency = static_cast<int>(mhz);
+    if (frequency == 2484)
+    {
+        return 14;
+    }
+    if (frequency < 2484)
+    {
+        return (frequency - 2407) / 5;
+    }
+    if (frequency >= 4910 && frequency <= 4980)
+    {
+        return (frequency - 4000) / 5;
+    }
+    if (frequency < 5950)
+    {
+        return (frequency - 5000) / 5;
+    }
+    if (frequency <= 45000)
+    {
+        return (frequency - 5950) / 5;
+    }
+    if (frequency >= 58320 && frequency <= 70200)
+    {
+        return (frequency - 56160) / 2160;
+    }
+    return 0;
+}
+
+// Calls fn(attributes) for each message of command in messages.
+template <typename Fn>
+void for_each_command(std::string_view messages, std::uint8_t command, Fn &&fn)
+{
+    for_each_netlink_message(messages, [&](const nlmsghdr &header, std::string_view payload) {
+        if (header.nlmsg_type >= NLMSG_MIN_TYPE && payload.size() >= GENL_HDRLEN &&
+            read_netlink_struct<genlmsghdr>(payload).cmd == command)
+        {
+            fn(payload.substr(GENL_HDRLEN));
+        }
+    });
+}
+
+void decode_frequency(const std::string &band,
+                      std::string_view attributes,
+                      BandCounts &counts,
+                      std::vector<MetricSample> &metrics)
+{
+    std::uint32_t mhz = 0;
+    bool disabled = false;
+    bool radar = false;
+    bool has_power = false;
+    std::uint32_t power_mbm = 0;
+    for_each_netlink_attribute(attributes, [&](std::uint16_t type, std::string_view value) {
+        switch (type)
+        {
+            case NL80211_FREQUENCY_ATTR_FREQ:
+                mhz = read_netlink_u32(value);
+                break;
+            case NL80211_FREQUENCY_ATTR_DISABLED:
+                disabled = true;
+                break;
+            case NL80211_FREQUENCY_ATTR_RADAR:
+                radar = true;
+                break;
+            case NL80211_FREQUENCY_ATTR_MAX_TX_POWER:
+                has_power = true;
+                power_mbm = read_netlink_u32(value);
+                break;
+            default:
+                break;
+        }
+    });
+    if (mhz == 0)
+    {
+        return;
+    }
+
+    // iw prints nothing but "(disabled)" for a disabled channel.
+    radar = radar && !disabled;
+    ++(disabled ? counts.disabled : counts.enabled);
+    if (radar)
+    {
+        ++counts.radar;
+    }
+
+    LabelSet labels {
+        {"band", band},
+        {"mhz", std::to_string(mhz)},
+        {"channel", std::to_string(frequency_to_channel(mhz))},
+        {"disabled", disabled ? "true" : "false"},
+        {"radar_detection", radar ? "true" : "false"},
+    };
+    if (!disabled && has_power)
+    {
+        char dbm[16];
+        std::snprintf(dbm, sizeof(dbm), "%.1f", 0.01 * static_cast<double>(power_mbm));
+        labels["max_tx_power_dbm"] = dbm;
+    }
+    metrics.push_back(make_info("edge_wifi_band_frequency_info", std::move(labels)));
+}
+
+void decode_bands(std::string_view attributes,
+                  std::map<std::uint16_t, BandCounts> &band_counts,
+                  std::vector<MetricSample> &metrics)
+{
+    for_each_netlink_attribute(attributes, [&](std::uint16_t band, std::string_view band_value) {
+        // iw numbers bands from 1.
+        const std::string band_label = std::to_string(band + 1);
+        BandCounts &counts = band_counts[band];
+        for_each_netlink_attribute(band_value, [&](std::uint16_t type, std::string_view value) {
+            if (type != NL80211_BAND_ATTR_FREQS)
+            {
+                return;
+            }
+            for_each_netlink_attribute(value, [&](std::uint16_t, std::string_view frequency) {
+                decode_frequency(band_label, frequency, counts, metrics);
+            });
+        });
+    });
+}
+
+void decode_wowlan(std::string_view attributes, std::vector<MetricSample> &metrics)
+{
+    for_each_netlink_attribute(attributes, [&](std::uint16_t type, std::string_view value) {
+        std::string feature;
+        switch (type)
+        {
+            case NL80211_WOWLAN_TRIG_ANY:
+                feature = "wake up on anything (device continues operating normally)";
+                break;
+            case NL80211_WOWLAN_TRIG_DISCONNECT:
+                feature = "wake up on disconnect";
+                break;
+            case NL80211_WOWLAN_TRIG_MAGIC_PKT:
+                feature = "wake up on magic packet";
+                break;
+            case NL80211_WOWLAN_TRIG_PKT_PATTERN:
+            {
+                const auto pattern = read_netlink_struct<nl80211_pattern_support>(value);
+                feature = "wake up on pattern match, up to " +
+                          std::to_string(pattern.max_patterns) + " patterns of " +
+                          std::to_string(pattern.min_pattern_len) + "-" +
+                          std::to_string(pattern.max_pattern_len) + " bytes,";
+                break;
+            }
+            case NL80211_WOWLAN_TRIG_GTK_REKEY_SUPPORTED:
+                feature = "can do GTK rekeying";
+                break;
+            case NL80211_WOWLAN_TRIG_GTK_REKEY_FAILURE:
+                feature = "wake up on GTK rekey failure";
+                break;
+            case NL80211_WOWLAN_TRIG_EAP_IDENT_REQUEST:
+                feature = "wake up on EAP identity request";
+                break;
+            case NL80211_WOWLAN_TRIG_4WAY_HANDSHAKE:
+                feature = "wake up on 4-way handshake";
+                break;
+            case NL80211_WOWLAN_TRIG_RFKILL_RELEASE:
+                feature = "wake up on rfkill release";
+                break;
+            case NL80211_WOWLAN_TRIG_NET_DETECT:
+                feature = "wake up on network detection, up to " +
+                          std::to_string(read_netlink_u32(value)) + " match sets";
+                break;
+            case NL80211_WOWLAN_TRIG_TCP_CONNECTION:
+                feature = "wake up on TCP connection";
+                break;
+            default:
+                return;
+        }
+        metrics.push_back(make_info("edge_wifi_wowlan_support_info", {{"feature", feature}}));
+    });
+}
+
+void decode_frame_types(const char *direction,
+                        std::string_view attributes,
+                        std::vector<MetricSample> &metrics)
+{
+    // The kernel nests every interface type, including those with no frames.
+    for_each_netlink_attribute(attributes, [&](std::uint16_t mode, std::string_view frames) {
+        std::string values;
+        for_each_netlink_attribute(frames, [&values](std::uint16_t type, std::string_view frame) {
+            if (type != NL80211_ATTR_FRAME_TYPE)
+            {
+                return;
+            }
+            char text[8];
+            std::snprintf(text,
+                          sizeof(text),
+                          "0x%.2x",
+                          static_cast<unsigned int>(read_netlink_u16(frame)));
+            if (!values.empty())
+            {
+                values += ' ';
+            }
+            values += text;
+        });
+        if (!values.empty())
+        {
+            metrics.push_back(make_info("edge_wifi_frame_type_support_info",
+                                        {{"direction", direction},
+                                         {"mode", interface_mode_name(mode)},
+                                         {"values", values}}));
+        }
+    });
+}
+
+void decode_station_info(const std::string &interface_name,
+                         const std::string &station,
+                         std::string_view attributes,
+                         std::vector<MetricSample> &metrics)
+{
+    const auto emit = [&](const char *name, double value) {
+        metrics.push_back(
+            make_metric(name, value, {{"interface", interface_name}, {"station", station}}));
+    };
+    // In units of 100 kbit/s; BITRATE32 supersedes the 16-bit field.
+    const auto emit_bitrate = [&emit](const char *name, std::string_view rate) {
+        std::uint32_t bitrate = 0;
+        for_each_netlink_attribute(rate, [&bitrate](std::uint16_t type, std::string_view value) {
+            if (type == NL80211_RATE_INFO_BITRATE32)
+            {
+                bitrate = read_netlink_u32(value);
+            }
+            else if (type == NL80211_RATE_INFO_BITRATE && bitrate == 0)
+            {
+                bitrate = read_netlink_u16(value);
+            }
+        });
+        if (bitrate != 0)
+        {
+            emit(name, 0.1 * static_cast<double>(bitrate));
+        }
+    };
+
+    ByteCounter receive_bytes;
+    ByteCounter transmit_bytes;
+    for_each_netlink_attribute(attributes, [&](std::uint16_t type, std::string_view value) {
+        switch (type)
+        {
+            case NL80211_STA_INFO_SIGNAL:
+                emit("edge_wifi_station_signal_dbm", read_netlink_struct<std::int8_t>(value));
+                break;
+            case NL80211_STA_INFO_TX_BITRATE:
+                emit_bitrate("edge_wifi_station_transmit_bitrate_mbps", value);
+                break;
+            case NL80211_STA_INFO_RX_BITRATE:
+                emit_bitrate("edge_wifi_station_receive_bitrate_mbps", value);
+                break;
+            case NL80211_STA_INFO_RX_BYTES:
+                receive_bytes.set(read_netlink_u32(value), false);
+                break;
+            case NL80211_STA_INFO_RX_BYTES64:
+                receive_bytes.set(read_netlink_u64(value), true);
+                break;
+            case NL80211_STA_INFO_TX_BYTES:
+                transmit_bytes.set(read_netlink_u32(value), false);
+                break;
+            case NL80211_STA_INFO_TX_BYTES64:
+                transmit_bytes.set(read_netlink_u64(value), true);
+                break;
+            case NL80211_STA_INFO_RX_PACKETS:
+                emit("edge_wifi_station_receive_packets", read_netlink_u32(value));
+                break;
+            case NL80211_STA_INFO_TX_PACKETS:
+                emit("edge_wifi_station_transmit_packets", read_netlink_u32(value));
+                break;
+            case NL80211_STA_INFO_INACTIVE_TIME:
+                emit("edge_wifi_station_inactive_seconds", 0.001 * read_netlink_u32(value));
+                break;
+            case NL80211_STA_INFO_CONNECTED_TIME:
+                emit("edge_wifi_station_connected_seconds", read_netlink_u32(value));
+                break;
+            default:
+                break;
+        }
+    });
+    if (receive_bytes.present)
+    {
+        emit("edge_wifi_station_receive_bytes", static_cast<double>(receive_bytes.value));
+    }
+    if (transmit_bytes.present)
+    {
+        emit("edge_wifi_station_transmit_bytes", static_cast<double>(transmit_bytes.value));
+    }
+}
+
+void start_request(std::string &request, std::uint8_t command, std::uint8_t version)
+{
+    genlmsghdr header {};
+    header.cmd = command;
+    header.version = version;
+    request.assign(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+void append_attribute(std::string &request, std::uint16_t type, std::string_view value)
+{
+    nlattr attribute {};
+    attribute.nla_len = static_cast<std::uint16_t>(NLA_HDRLEN + value.size());
+    attribute.nla_type = type;
+    request.append(reinterpret_cast<const char *>(&attribute), sizeof(attribute));
+    request.append(value);
+    request.resize(NLA_ALIGN(request.size()), '\0');
+}
+
+}  // namespace
+
+std::vector<MetricSample> decode_nl80211_wiphy(std::string_view messages)
+{
+    std::vector<MetricSample> metrics;
+    std::map<std::uint16_t, BandCounts> band_counts;
+
+    const auto emit_limit = [&metrics](const char *limit, double value) {
+        metrics.push_back(make_metric("edge_wifi_phy_limit", value, {{"limit", limit}}));
+    };
+    // iw prints these with %d, so an unset u32 shows as -1.
+    const auto read_signed = [](std::string_view value) {
+        return static_cast<double>(static_cast<std::int32_t>(read_netlink_u32(value)));
+    };
+
+    for_each_command(messages, NL80211_CMD_NEW_WIPHY, [&](std::string_view attributes) {
+        for_each_netlink_attribute(attributes, [&](std::uint16_t type, std::string_view value) {
+            switch (type)
+            {
+                case NL80211_ATTR_MAX_NUM_SCAN_SSIDS:
+                    emit_limit("max_scan_ssids", read_netlink_u8(value));
+                    break;
+                case NL80211_ATTR_MAX_SCAN_IE_LEN:
+                    emit_limit("max_scan_ie_length_bytes", read_netlink_u16(value));
+                    break;
+                case NL80211_ATTR_MAX_NUM_SCHED_SCAN_SSIDS:
+                    emit_limit("max_sched_scan_ssids", read_netlink_u8(value));
+                    break;
+                case NL80211_ATTR_MAX_MATCH_SETS:
+                    emit_limit("max_match_sets", read_netlink_u8(value));
+                    break;
+                case NL80211_ATTR_WIPHY_RTS_THRESHOLD:
+                    // iw prints "off" for an unset threshold.
+                    if (read_netlink_u32(value) != UINT32_MAX)
+                    {
+                        emit_limit("rts_threshold", read_netlink_u32(value));
+                    }
+                    break;
+                case NL80211_ATTR_WIPHY_RETRY_SHORT:
+                    emit_limit("retry_short_limit", read_netlink_u8(value));
+                    break;
+                case NL80211_ATTR_WIPHY_RETRY_LONG:
+                    emit_limit("retry_long_limit", read_netlink_u8(value));
+                    break;
+                case NL80211_ATTR_WIPHY_COVERAGE_CLASS:
+                    emit_limit("coverage_class", read_netlink_u8(value));
+                    break;
+                case NL80211_ATTR_MAX_NUM_SCHED_SCAN_PLANS:
+                    emit_limit("max_scan_plans", read_signed(value));
+                    break;
+                case NL80211_ATTR_MAX_SCAN_PLAN_INTERVAL:
+                    emit_limit("max_scan_plan_interval", read_signed(value));
+                    break;
+                case NL80211_ATTR_MAX_SCAN_PLAN_ITERATIONS:
+                    emit_limit("max_scan_plan_iterations", read_signed(value));
+                    break;
+                case NL80211_ATTR_MAX_AP_ASSOC_STA:
+                    metrics.push_back(make_metric("edge_wifi_max_associated_stations",
+                                                  read_netlink_u32(value)));
+                    break;
+                case NL80211_ATTR_SUPPORTED_IFTYPES:
+                    for_each_netlink_attribute(value, [&](std::uint16_t mode, std::string_view) {
+                        metrics.push_back(make_info("edge_wifi_supported_interface_mode_info",
+                                                    {{"mode", interface_mode_name(mode)}}));
+                    });
+                    break;
+                case NL80211_ATTR_WIPHY_BANDS:
+                    decode_bands(value, band_counts, metrics);
+                    break;
+                case NL80211_ATTR_SUPPORTED_COMMANDS:
+                    for_each_netlink_attribute(value, [&](std::uint16_t, std::string_view command) {
+                        metrics.push_back(
+                            make_info("edge_wifi_supported_command_info",
+                                      {{"command", command_name(read_netlink_u32(command))}}));
+                    });
+                    break;
+                case NL80211_ATTR_WOWLAN_TRIGGERS_SUPPORTED:
+                    decode_wowlan(value, metrics);
+                    break;
+                case NL80211_ATTR_TX_FRAME_TYPES:
+                    decode_frame_types("tx", value, metrics);
+                    break;
+                case NL80211_ATTR_RX_FRAME_TYPES:
+                    decode_frame_types("rx", value, metrics);
+                    break;
+                case NL80211_ATTR_EXT_FEATURES:
+                    for (std::size_t bit = 0;
+                         bit < kExtendedFeatures.size() && bit / 8 < value.size();
+                         ++bit)
+                    {
+                        if ((static_cast<unsigned char>(value[bit / 8]) >> (bit % 8) & 1) != 0)
+                        {
+                            metrics.push_back(make_info("edge_wifi_extended_feature_info",
+                                                        {{"feature", kExtendedFeatures[bit]}}));
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+        });
+    });
+
+    for (const auto &[band, counts] : band_counts)
+    {
+        const std::string band_label = std::to_string(band + 1);
+        metrics.push_back(make_metric("edge_wifi_band_frequencies_total",
+                                      counts.enabled,
+                                      {{"band", band_label}, {"disabled", "false"}}));
+        metrics.push_back(make_metric("edge_wifi_band_frequencies_total",
+                                      counts.disabled,
+                                      {{"band", band_label}, {"disabled", "true"}}));
+        metrics.push_back(make_metric(
+            "edge_wifi_band_radar_frequencies_total", counts.radar, {{"band", band_label}}));
+    }
+    return metrics;
+}
+
+std::vector<MetricSample> decode_nl80211_interfaces(std::string_view messages)
+{
+    std::vector<MetricSample> metrics;
+    for_each_command(messages, NL80211_CMD_NEW_INTERFACE, [&](std::string_view attributes) {
+        std::string name;
+        std::string mac;
+        std::string ssid;
+        std::string mode;
+        bool has_index = false;
+        std::uint32_t index = 0;
+        for_each_netlink_attribute(attributes, [&](std::uint16_t type, std::string_view value) {
+            switch (type)
+            {
+                case NL80211_ATTR_IFNAME:
+                    name = read_netlink_string(value);
+                    break;
+                case NL80211_ATTR_IFINDEX:
+                    has_index = true;
+                    index = read_netlink_u32(value);
+                    break;
+                case NL80211_ATTR_MAC:
+                    mac = format_link_address(value);
+                    break;
+                case NL80211_ATTR_SSID:
+                    ssid = format_ssid(value);
+                    break;
+                case NL80211_ATTR_IFTYPE:
+                    mode = interface_mode_name(read_netlink_u32(value));
+                    break;
+                default:
+                    break;
+            }
+        });
+        // A P2P-device or NAN interface has no netdev and so no name.
+        if (name.empty())
+        {
+            return;
+        }
+        if (has_index)
+        {
+            metrics.push_back(
+                make_metric("edge_wifi_interface_ifindex", index, {{"interface", name}}));
+        }
+        if (!mode.empty())
+        {
+            metrics.push_back(make_info(
+                "edge_wifi_ap_info",
+                {{"interface", name}, {"ssid", ssid}, {"type", mode}, {"mac", mac}}));
+        }
+    });
+    return metrics;
+}
+
+std::vector<MetricSample> decode_nl80211_stations(std::string_view messages,
+                                                  const std::string &interface_name)
+{
+    std::vector<MetricSample> metrics;
+    std::size_t stations = 0;
+    for_each_command(messages, NL80211_CMD_NEW_STATION, [&](std::string_view attributes) {
+        std::string station;
+        std::string_view info;
+        for_each_netlink_attribute(attributes, [&](std::uint16_t type, std::string_view value) {
+            if (type == NL80211_ATTR_MAC)
+            {
+                station = format_link_address(value);
+            }
+            else if (type == NL80211_ATTR_STA_INFO)
+            {
+                info = value;
+            }
+        });
+        if (station.empty())
+        {
+            return;
+        }
+        ++stations;
+        decode_station_info(interface_name, station, info, metrics);
+    });
+    metrics.push_back(make_metric("edge_wifi_stations_total",
+                                  static_cast<double>(stations),
+                                  {{"interface", interface_name}}));
+    return metrics;
+}
+
+Nl80211Collector::Nl80211Collector() : socket_(NETLINK_GENERIC)
+{
+    start_request(request_, CTRL_CMD_GETFAMILY, 1);
+    // The family name is matched with its terminating NUL.
+    const std::string_view family_name(NL80211_GENL_NAME, sizeof(NL80211_GENL_NAME));
+    append_attribute(request_, CTRL_ATTR_FAMILY_NAME, family_name);
+    socket_.request(GENL_ID_CTRL, 0, request_, [this](const nlmsghdr &, std::string_view payload) {
+        if (payload.size() < GENL_HDRLEN)
+        {
+            return;
+        }
+        for_each_netlink_attribute(payload.substr(GENL_HDRLEN),
+                                   [this](std::uint16_t type, std::string_view value) {
+                                       if (type == CTRL_ATTR_FAMILY_ID)
+                                       {
+                                           family_id_ = read_netlink_u16(value);
+                                       }
+                                   });
+    });
+    if (family_id_ == 0)
+    {
+        throw std::runtime_error("nl80211 is not available: no wireless driver is loaded");
+    }
+}
+
+void Nl80211Collector::collect(std::vector<MetricSample> &metrics)
+{
+    const auto append = [&metrics](std::vector<MetricSample> samples) {
+        metrics.insert(metrics.end(),
+                       std::make_move_iterator(samples.begin()),
+                       std::make_move_iterator(samples.end()));
+    };
+
+    if (dump(NL80211_CMD_GET_WIPHY, 0))
+    {
+        append(decode_nl80211_wiphy(messages_));
+    }
+    else
+    {
+        ++dump_failures_;
+    }
+
+    if (!dump(NL80211_CMD_GET_INTERFACE, 0))
+    {
+        ++dump_failures_;
+        return;
+    }
+    std::vector<MetricSample> interfaces = decode_nl80211_interfaces(messages_);
+    for (const auto &sample : interfaces)
+    {
+        const std::string *name = sample.labels.find("interface");
+        if (sample.name != "edge_wifi_interface_ifindex" || name == nullptr)
+        {
+            continue;
+        }
+        if (dump(NL80211_CMD_GET_STATION, static_cast<std::uint32_t>(sample.value)))
+        {
+            append(decode_nl80211_stations(messages_, *name));
+        }
+        else
+        {
+            ++dump_failures_;
+        }
+    }
+    append(std::move(interfaces));
+}
+
+std::uint64_t Nl80211Collector::dump_failures() const
+{
+    return dump_failures_;
+}
+
+bool Nl80211Collector::dump(std::uint8_t command, std::uint32_t ifindex)
+{
+    start_request(request_, command, 0);
+    if (command == NL80211_CMD_GET_WIPHY)
+    {
+        // Without the split layout, the kernel leaves out whatever does not
+        // fit one message.
+        append_attribute(request_, NL80211_ATTR_SPLIT_WIPHY_DUMP, {});
+    }
+    if (ifindex != 0)
+    {
+        const std::string_view index(reinterpret_cast<const char *>(&ifindex), sizeof(ifindex));
+        append_attribute(request_, NL80211_ATTR_IFINDEX, index);
+    }
+
+    messages_.clear();
+    return socket_.request(
+        family_id_, NLM_F_DUMP, request_, [this](const nlmsghdr &header, std::string_view payload) {
+            messages_.append(reinterpret_cast<const char *>(&header), NLMSG_HDRLEN);
+            messages_.append(payload);
+            messages_.resize(NLMSG_ALIGN(messages_.size()), '\0');
+        });
+}
+
+}  // namespace edge_probe
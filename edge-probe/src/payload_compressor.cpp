@@ -0,0 +1,205 @@
+#include "edge_probe/payload_compressor.h"
+
+#include "edge_probe/snappy.h"
+
+#include <stdexcept>
+
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(EDGE_PROBE_HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace edge_probe
+{
+
+struct PayloadCompressor::Context
+{
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+    z_stream deflate_stream {};
+    bool deflate_ready {false};
+#endif
+#if defined(EDGE_PROBE_HAVE_ZSTD)
+    ZSTD_CCtx *zstd_context {nullptr};
+#endif
+
+    ~Context()
+    {
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+        if (deflate_ready)
+        {
+            deflateEnd(&deflate_stream);
+        }
+#endif
+#if defined(EDGE_PROBE_HAVE_ZSTD)
+        ZSTD_freeCCtx(zstd_context);
+#endif
+    }
+};
+
+// Builds without zlib and zstd never read level.
+PayloadCompressor::PayloadCompressor(PayloadCompression compression, [[maybe_unused]] int level)
+    : compression_(compression), context_(std::make_unique<Context>())
+{
+    if (!supported(compression_))
+    {
+        throw std::invalid_argument(std::string("payload compression not available: ") +
+                                    payload_compression_name(compression_));
+    }
+
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+    if (compression_ == PayloadCompression::gzip)
+    {
+        // windowBits 15 + 16 selects the gzip wrapper rather than raw zlib.
+        if (deflateInit2(&context_->deflate_stream,
+                         level == 0 ? Z_DEFAULT_COMPRESSION : level,
+                         Z_DEFLATED,
+                         15 + 16,
+                         8,
+                         Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            throw std::runtime_error("deflateInit2 failed");
+        }
+        context_->deflate_ready = true;
+    }
+#endif
+
+#if defined(EDGE_PROBE_HAVE_ZSTD)
+    if (compression_ == PayloadCompression::zstd)
+    {
+        context_->zstd_context = ZSTD_createCCtx();
+        if (context_->zstd_context == nullptr)
+        {
+            throw std::runtime_error("ZSTD_createCCtx failed");
+        }
+        if (level != 0 &&
+            ZSTD_isError(ZSTD_CCtx_setParameter(
+                context_->zstd_context, ZSTD_c_compressionLevel, level)))
+        {
+            throw std::invalid_argument("invalid zstd compression level");
+        }
+    }
+#endif
+}
+
+PayloadCompressor::~PayloadCompressor() = default;
+
+PayloadCompression PayloadCompressor::compression() const
+{
+    return compression_;
+}
+
+const std::string &PayloadCompressor::compress(std::string_view input)
+{
+    output_.clear();
+
+    switch (compression_)
+    {
+        case PayloadCompression::none:
+            output_.assign(input.data(), input.size());
+            return output_;
+
+        case PayloadCompression::gzip:
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+        {
+            z_stream &stream = context_->deflate_stream;
+            if (deflateReset(&stream) != Z_OK)
+            {
+                throw std::runtime_error("deflateReset failed");
+            }
+
+            output_.resize(deflateBound(&stream, static_cast<uLong>(input.size())));
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+            stream.avail_in = static_cast<uInt>(input.size());
+            stream.next_out = reinterpret_cast<Bytef *>(output_.data());
+            stream.avail_out = static_cast<uInt>(output_.size());
+
+            if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
+            {
+                throw std::runtime_error("deflate did not finish the gzip stream");
+            }
+            output_.resize(stream.total_out);
+            return output_;
+        }
+#else
+            break;
+#endif
+
+        case PayloadCompression::zstd:
+#if defined(EDGE_PROBE_HAVE_ZSTD)
+        {
+            output_.resize(ZSTD_compressBound(input.size()));
+            const std::size_t written = ZSTD_compress2(context_->zstd_context,
+                                                       output_.data(),
+                                                       output_.size(),
+                                                       input.data(),
+                                                       input.size());
+            if (ZSTD_isError(written))
+            {
+                throw std::runtime_error(std::string("ZSTD_compress2 failed: ") +
+                                         ZSTD_getErrorName(written));
+            }
+            output_.resize(written);
+            return output_;
+        }
+#else
+            break;
+#endif
+
+        case PayloadCompression::snappy:
+            snappy_compress(input, output_);
+            return output_;
+    }
+
+    throw std::logic_error("payload compression not available");
+}
+
+bool PayloadCompressor::supported(PayloadCompression compression)
+{
+    switch (compression)
+    {
+        case PayloadCompression::none:
+            return true;
+        case PayloadCompression::gzip:
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+            return true;
+#else
+            return false;
+#endif
+        case PayloadCompression::zstd:
+#if defined(EDGE_PROBE_HAVE_ZSTD)
+            return true;
+#else
+            return false;
+#endif
+        case PayloadCompression::snappy:
+            return true;
+    }
+    return false;
+}
+
+const char *payload_compression_name(PayloadCompression compression)
+{
+    switch (compression)
+    {
+        case PayloadCompression::none:
+            return "none";
+        case PayloadCompression::gzip:
+            return "gzip";
+        case PayloadCompression::zstd:
+            return "zstd";
+        case PayloadCompression::snappy:
+            return "snappy";
+    }
+    return "unknown";
+}
+
+const char *payload_content_encoding(PayloadCompression compression)
+{
+    return compression == PayloadCompression::none ? nullptr
+                                                   : payload_compression_name(compression);
+}
+
+}  // namespace edge_probe
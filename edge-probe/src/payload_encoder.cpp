@@ -0,0 +1,266 @@
+#include "edge_probe/payload_encoder.h"
+
+#include "edge_probe/json_lines_encoder.h"
+#include "edge_probe/metric_prefix_cache.h"
+#include "edge_probe/remote_write_encoder.h"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+const ExternalLabels *external_labels(const TelemetryConfig &config)
+{
+    return config.external_labels.empty() ? nullptr : &config.external_labels;
+}
+
+std::unique_ptr<MetricPrefixCache> make_prefix_cache(const TelemetryConfig &config)
+{
+    if (config.metric_prefix_cache_entries == 0)
+    {
+        return nullptr;
+    }
+    return std::make_unique<MetricPrefixCache>(config.metric_prefix_cache_entries,
+                                               external_labels(config));
+}
+
+class LinePerSampleEncoder final : public PayloadEncoder
+{
+public:
+    explicit LinePerSampleEncoder(const TelemetryConfig &config)
+        : encoder_(config.max_pending_payload_bytes), prefix_cache_(make_prefix_cache(config))
+    {
+        encoder_.set_prefix_cache(prefix_cache_.get());
+        encoder_.set_external_labels(external_labels(config));
+    }
+
+    bool add(const MetricSample &sample, std::size_t max_bytes) override
+    {
+        const std::size_t previous_size = encoder_.size();
+        encoder_.append(sample);
+        return keep_within(previous_size, max_bytes);
+    }
+
+    bool add(const SeriesRegistry &registry,
+             const SeriesSample &sample,
+             std::size_t max_bytes) override
+    {
+        const std::size_t previous_size = encoder_.size();
+        encoder_.append(registry, sample);
+        return keep_within(previous_size, max_bytes);
+    }
+
+    std::size_t size_bytes() const override
+    {
+        return encoder_.size();
+    }
+
+    const std::string &payload() override
+    {
+        return encoder_.buffer();
+    }
+
+    void take_payload(std::string &output) override
+    {
+        encoder_.swap_buffer(output);
+    }
+
+    void clear() override
+    {
+        encoder_.clear();
+    }
+
+    const MetricPrefixCache *prefix_cache() const override
+    {
+        return prefix_cache_.get();
+    }
+
+private:
+    bool keep_within(std::size_t previous_size, std::size_t max_bytes)
+    {
+        if (previous_size > 0 && encoder_.size() > max_bytes)
+        {
+            encoder_.truncate(previous_size);
+            return false;
+        }
+        return true;
+    }
+
+    JsonLinesEncoder encoder_;
+    std::unique_ptr<MetricPrefixCache> prefix_cache_;
+};
+
+// Keeps one line per series; the line is only written out on payload(), but
+// its final size is tracked exactly as points arrive.
+class LinePerSeriesEncoder final : public PayloadEncoder
+{
+public:
+    explicit LinePerSeriesEncoder(const TelemetryConfig &config)
+        : encoder_(config.max_pending_payload_bytes),
+          prefix_cache_(make_prefix_cache(config)),
+          external_labels_(external_labels(config))
+    {
+    }
+
+    bool add(const MetricSample &sample, std::size_t max_bytes) override
+    {
+        metric_scratch_.clear();
+        if (prefix_cache_ != nullptr)
+        {
+            prefix_cache_->append_metric(sample, metric_scratch_);
+        }
+        else
+        {
+            JsonLinesEncoder::append_metric(sample, metric_scratch_, external_labels_);
+        }
+        return add_point(sample.value, sample.timestamp_ms, max_bytes);
+    }
+
+    bool add(const SeriesRegistry &registry,
+             const SeriesSample &sample,
+             std::size_t max_bytes) override
+    {
+        metric_scratch_.clear();
+        if (prefix_cache_ != nullptr)
+        {
+            prefix_cache_->append_metric(registry, sample.series, metric_scratch_);
+        }
+        else
+        {
+            JsonLinesEncoder::append_metric(
+                registry, sample.series, metric_scratch_, external_labels_);
+        }
+        return add_point(sample.value, sample.timestamp_ms, max_bytes);
+    }
+
+    std::size_t size_bytes() const override
+    {
+        return size_bytes_;
+    }
+
+    const std::string &payload() override
+    {
+        if (encoder_.empty())
+        {
+            for (const auto *series : series_order_)
+            {
+                encoder_.append_series(
+                    series->first, series->second.values, series->second.timestamps);
+            }
+        }
+        return encoder_.buffer();
+    }
+
+    void take_payload(std::string &output) override
+    {
+        payload();
+        encoder_.swap_buffer(output);
+    }
+
+    void clear() override
+    {
+        encoder_.clear();
+        series_.clear();
+        series_order_.clear();
+        size_bytes_ = 0;
+    }
+
+    const MetricPrefixCache *prefix_cache() const override
+    {
+        return prefix_cache_.get();
+    }
+
+private:
+    struct SeriesPoints
+    {
+        std::string values;
+        std::string timestamps;
+    };
+
+    // Adds one point to the series encoded in metric_scratch_.
+    bool add_point(double value, int64_t timestamp_ms, std::size_t max_bytes)
+    {
+        value_scratch_.clear();
+        timestamp_scratch_.clear();
+        JsonLinesEncoder::append_value(value, value_scratch_);
+        JsonLinesEncoder::append_timestamp(timestamp_ms, timestamp_scratch_);
+
+        const auto found = series_.find(metric_scratch_);
+        const std::size_t added_bytes =
+            found == series_.end()
+                ? JsonLinesEncoder::series_line_bytes(metric_scratch_.size(),
+                                                      value_scratch_.size(),
+                                                      timestamp_scratch_.size())
+                : value_scratch_.size() + timestamp_scratch_.size() + 2;
+        if (size_bytes_ > 0 && size_bytes_ + added_bytes > max_bytes)
+        {
+            return false;
+        }
+
+        SeriesPoints *points = nullptr;
+        if (found == series_.end())
+        {
+            auto &entry = *series_.emplace(metric_scratch_, SeriesPoints {}).first;
+            series_order_.push_back(&entry);
+            points = &entry.second;
+        }
+        else
+        {
+            points = &found->second;
+            points->values.push_back(',');
+            points->timestamps.push_back(',');
+        }
+
+        points->values.append(value_scratch_);
+        points->timestamps.append(timestamp_scratch_);
+        size_bytes_ += added_bytes;
+        encoder_.clear();
+        return true;
+    }
+
+    JsonLinesEncoder encoder_;
+    std::unique_ptr<MetricPrefixCache> prefix_cache_;
+    const ExternalLabels *external_labels_;
+    std::unordered_map<std::string, SeriesPoints> series_;
+    std::vector<std::pair<const std::string, SeriesPoints> *> series_order_;
+    std::size_t size_bytes_ {0};
+    std::string metric_scratch_;
+    std::string value_scratch_;
+    std::string timestamp_scratch_;
+};
+
+}  // namespace
+
+const char *payload_content_type(PayloadFormat format)
+{
+    switch (format)
+    {
+        case PayloadFormat::json_lines:
+            return "application/json";
+        case PayloadFormat::remote_write:
+            return "application/x-protobuf";
+    }
+    return "application/octet-stream";
+}
+
+std::unique_ptr<PayloadEncoder> make_payload_encoder(const TelemetryConfig &config)
+{
+    if (config.payload_format == PayloadFormat::remote_write)
+    {
+        return std::make_unique<RemoteWriteEncoder>(config.max_pending_payload_bytes,
+                                                    external_labels(config));
+    }
+
+    if (config.group_series)
+    {
+        return std::make_unique<LinePerSeriesEncoder>(config);
+    }
+    return std::make_unique<LinePerSampleEncoder>(config);
+}
+
+}  // namespace edge_probe
@@ -0,0 +1,575 @@
+#include "edge_probe/payload_spool.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+constexpr std::uint32_t kRecordMagic = 0x31535045;  // "EPS1"
+constexpr std::uint32_t kStateLive = 1;
+constexpr std::uint32_t kStateAcked = 2;
+
+constexpr std::size_t kHeaderBytes = 32;
+constexpr std::size_t kStateOffset = 4;
+constexpr std::size_t kChecksummedHeaderOffset = 16;
+
+constexpr std::string_view kSegmentPrefix = "segment-";
+constexpr std::string_view kSegmentSuffix = ".spool";
+
+const std::array<std::uint32_t, 256> &crc32_table()
+{
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> built {};
+        for (std::uint32_t i = 0; i < built.size(); ++i)
+        {
+            std::uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc & 1U) != 0 ? (crc >> 1) ^ 0xEDB88320U : crc >> 1;
+            }
+            built[i] = crc;
+        }
+        return built;
+    }();
+    return table;
+}
+
+std::uint32_t crc32_update(std::uint32_t crc, const char *data, std::size_t size)
+{
+    const auto &table = crc32_table();
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFFU] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+std::uint32_t record_checksum(const char *header, const char *body, std::size_t body_size)
+{
+    std::uint32_t crc = 0xFFFFFFFFU;
+    crc = crc32_update(crc,
+                       header + kChecksummedHeaderOffset,
+                       kHeaderBytes - kChecksummedHeaderOffset);
+    crc = crc32_update(crc, body, body_size);
+    return crc ^ 0xFFFFFFFFU;
+}
+
+template <typename T>
+void store(char *target, T value)
+{
+    std::memcpy(target, &value, sizeof(value));
+}
+
+template <typename T>
+T load(const char *source)
+{
+    T value;
+    std::memcpy(&value, source, sizeof(value));
+    return value;
+}
+
+bool read_file(const std::string &path, std::string &contents)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info {};
+    if (::fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    contents.resize(static_cast<std::size_t>(info.st_size));
+    std::size_t done = 0;
+    while (done < contents.size())
+    {
+        const ssize_t n = ::pread(fd, contents.data() + done, contents.size() - done,
+                                  static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    contents.resize(done);
+    ::close(fd);
+    return true;
+}
+
+bool read_exact(int fd, char *target, std::size_t size, std::uint64_t offset)
+{
+    std::size_t done = 0;
+    while (done < size)
+    {
+        const ssize_t n =
+            ::pread(fd, target + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool write_state(int fd, std::uint64_t record_offset, std::uint32_t state)
+{
+    char encoded[sizeof(state)];
+    store(encoded, state);
+    return ::pwrite(fd, encoded, sizeof(encoded),
+                    static_cast<off_t>(record_offset + kStateOffset)) ==
+           static_cast<ssize_t>(sizeof(encoded));
+}
+
+}  // namespace
+
+PayloadSpool::PayloadSpool(std::string directory,
+                           std::size_t max_total_bytes,
+                           std::size_t segment_bytes,
+                           bool sync_writes)
+    : directory_(std::move(directory)),
+      max_total_bytes_(max_total_bytes),
+      segment_bytes_(segment_bytes),
+      sync_writes_(sync_writes)
+{
+    if (directory_.empty())
+    {
+        throw std::invalid_argument("spool directory must not be empty");
+    }
+
+    if (segment_bytes_ <= kHeaderBytes || max_total_bytes_ < segment_bytes_)
+    {
+        throw std::invalid_argument(
+            "spool segment size must exceed the record header and fit the spool budget");
+    }
+
+    if (::mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        throw std::runtime_error("failed to create spool directory " + directory_ + ": " +
+                                 std::strerror(errno));
+    }
+
+    recover();
+}
+
+PayloadSpool::~PayloadSpool()
+{
+    if (active_fd_ >= 0)
+    {
+        ::close(active_fd_);
+    }
+}
+
+std::vector<PayloadSpool::Record> PayloadSpool::take_recovered()
+{
+    std::vector<Record> recovered;
+    recovered.swap(recovered_);
+    return recovered;
+}
+
+std::optional<std::uint64_t> PayloadSpool::append(const std::string &body,
+                                                  std::size_t sample_count,
+                                                  int64_t enqueued_unix_ms,
+                                                  std::uint32_t encoding)
+{
+    const std::size_t record_bytes = kHeaderBytes + body.size();
+    if (record_bytes > segment_bytes_)
+    {
+        return std::nullopt;
+    }
+
+    if (active_fd_ >= 0 && segments_.back().size + record_bytes > segment_bytes_)
+    {
+        roll_segment();
+    }
+
+    while (!segments_.empty() && disk_bytes_ + record_bytes > max_total_bytes_)
+    {
+        if (active_fd_ >= 0 && segments_.size() == 1)
+        {
+            roll_segment();
+            continue;
+        }
+        evict_oldest_segment();
+    }
+
+    if (active_fd_ < 0 && !open_active_segment())
+    {
+        return std::nullopt;
+    }
+
+    Segment &segment = segments_.back();
+
+    char header[kHeaderBytes] {};
+    store(header, kRecordMagic);
+    store(header + kStateOffset, kStateLive);
+    store(header + 8, static_cast<std::uint32_t>(body.size()));
+    store(header + 16, static_cast<std::uint32_t>(sample_count));
+    store(header + 20, encoding);
+    store(header + 24, enqueued_unix_ms);
+    store(header + 12, record_checksum(header, body.data(), body.size()));
+
+    struct iovec parts[2];
+    parts[0].iov_base = header;
+    parts[0].iov_len = sizeof(header);
+    parts[1].iov_base = const_cast<char *>(body.data());
+    parts[1].iov_len = body.size();
+
+    const ssize_t written =
+        ::pwritev(active_fd_, parts, 2, static_cast<off_t>(segment.size));
+    if (written != static_cast<ssize_t>(record_bytes) ||
+        (sync_writes_ && ::fdatasync(active_fd_) != 0))
+    {
+        if (::ftruncate(active_fd_, static_cast<off_t>(segment.size)) != 0)
+        {
+            roll_segment();
+        }
+        return std::nullopt;
+    }
+
+    const std::uint64_t id = next_id_++;
+    segment.records.push_back({segment.size, true});
+    segment.size += record_bytes;
+    ++segment.live_count;
+    disk_bytes_ += record_bytes;
+    ++live_records_;
+    return id;
+}
+
+void PayloadSpool::ack(std::uint64_t id)
+{
+    const std::size_t index = find_segment(id);
+    if (index == segments_.size())
+    {
+        return;
+    }
+
+    Segment *segment = &segments_[index];
+    RecordEntry &entry = segment->records[id - segment->first_id];
+    if (!entry.live)
+    {
+        return;
+    }
+
+    const bool active = active_fd_ >= 0 && index + 1 == segments_.size();
+    if (active)
+    {
+        write_state(active_fd_, entry.offset, kStateAcked);
+    }
+    else
+    {
+        const int fd = ::open(segment->path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd >= 0)
+        {
+            write_state(fd, entry.offset, kStateAcked);
+            ::close(fd);
+        }
+    }
+
+    entry.live = false;
+    --segment->live_count;
+    --live_records_;
+    if (segment->live_count > 0)
+    {
+        return;
+    }
+
+    if (active)
+    {
+        if (::ftruncate(active_fd_, 0) == 0)
+        {
+            disk_bytes_ -= segment->size;
+            segment->size = 0;
+            segment->records.clear();
+            segment->first_id = next_id_;
+        }
+        return;
+    }
+
+    remove_segment(index);
+}
+
+bool PayloadSpool::read(std::uint64_t id, Record &record) const
+{
+    const std::size_t index = find_segment(id);
+    if (index == segments_.size())
+    {
+        return false;
+    }
+
+    const Segment &segment = segments_[index];
+    const RecordEntry &entry = segment.records[id - segment.first_id];
+    if (!entry.live)
+    {
+        return false;
+    }
+
+    const int fd = ::open(segment.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    char header[kHeaderBytes];
+    bool ok = read_exact(fd, header, sizeof(header), entry.offset) &&
+              load<std::uint32_t>(header) == kRecordMagic &&
+              load<std::uint32_t>(header + kStateOffset) == kStateLive &&
+              load<std::uint32_t>(header + 8) <= segment.size - entry.offset - kHeaderBytes;
+    if (ok)
+    {
+        record.body.resize(load<std::uint32_t>(header + 8));
+        ok = read_exact(fd, record.body.data(), record.body.size(), entry.offset + kHeaderBytes) &&
+             load<std::uint32_t>(header + 12) ==
+                 record_checksum(header, record.body.data(), record.body.size());
+    }
+    ::close(fd);
+    if (!ok)
+    {
+        return false;
+    }
+
+    record.id = id;
+    record.sample_count = static_cast<std::size_t>(load<std::uint32_t>(header + 16));
+    record.encoding = load<std::uint32_t>(header + 20);
+    record.enqueued_unix_ms = load<int64_t>(header + 24);
+    return true;
+}
+
+std::size_t PayloadSpool::disk_bytes() const
+{
+    return disk_bytes_;
+}
+
+std::size_t PayloadSpool::live_records() const
+{
+    return live_records_;
+}
+
+std::size_t PayloadSpool::segment_count() const
+{
+    return segments_.size();
+}
+
+std::uint64_t PayloadSpool::evicted_records() const
+{
+    return evicted_records_;
+}
+
+std::uint64_t PayloadSpool::discarded_corrupt_records() const
+{
+    return discarded_corrupt_records_;
+}
+
+void PayloadSpool::recover()
+{
+    DIR *dir = ::opendir(directory_.c_str());
+    if (dir == nullptr)
+    {
+        throw std::runtime_error("failed to open spool directory " + directory_ + ": " +
+                                 std::strerror(errno));
+    }
+
+    std::vector<std::uint64_t> sequences;
+    while (const dirent *entry = ::readdir(dir))
+    {
+        const std::string_view name(entry->d_name);
+        if (name.size() <= kSegmentPrefix.size() + kSegmentSuffix.size() ||
+            name.substr(0, kSegmentPrefix.size()) != kSegmentPrefix ||
+            name.substr(name.size() - kSegmentSuffix.size()) != kSegmentSuffix)
+        {
+            continue;
+        }
+
+        const std::string_view digits = name.substr(
+            kSegmentPrefix.size(), name.size() - kSegmentPrefix.size() - kSegmentSuffix.size());
+        std::uint64_t sequence = 0;
+        const auto result =
+            std::from_chars(digits.data(), digits.data() + digits.size(), sequence);
+        if (result.ec == std::errc() && result.ptr == digits.data() + digits.size())
+        {
+            sequences.push_back(sequence);
+        }
+    }
+    ::closedir(dir);
+
+    std::sort(sequences.begin(), sequences.end());
+    for (const std::uint64_t sequence : sequences)
+    {
+        Segment segment;
+        segment.sequence = sequence;
+        segment.path = segment_path(sequence);
+        segment.first_id = next_id_;
+        recover_segment(segment);
+        next_sequence_ = sequence + 1;
+
+        if (segment.live_count == 0)
+        {
+            ::unlink(segment.path.c_str());
+            continue;
+        }
+
+        disk_bytes_ += segment.size;
+        live_records_ += segment.live_count;
+        segments_.push_back(std::move(segment));
+    }
+}
+
+void PayloadSpool::recover_segment(Segment &segment)
+{
+    std::string contents;
+    if (!read_file(segment.path, contents))
+    {
+        return;
+    }
+
+    std::size_t offset = 0;
+    while (offset < contents.size())
+    {
+        const char *header = contents.data() + offset;
+        const std::size_t remaining = contents.size() - offset;
+        if (remaining < kHeaderBytes || load<std::uint32_t>(header) != kRecordMagic)
+        {
+            break;
+        }
+
+        const auto body_size = static_cast<std::size_t>(load<std::uint32_t>(header + 8));
+        if (body_size > remaining - kHeaderBytes ||
+            load<std::uint32_t>(header + 12) !=
+                record_checksum(header, header + kHeaderBytes, body_size))
+        {
+            break;
+        }
+
+        const std::uint32_t state = load<std::uint32_t>(header + kStateOffset);
+        const std::uint64_t id = next_id_++;
+        segment.records.push_back({offset, state == kStateLive});
+        if (state == kStateLive)
+        {
+            ++segment.live_count;
+
+            Record record;
+            record.id = id;
+            record.body.assign(header + kHeaderBytes, body_size);
+            record.sample_count = static_cast<std::size_t>(load<std::uint32_t>(header + 16));
+            record.encoding = load<std::uint32_t>(header + 20);
+            record.enqueued_unix_ms = load<int64_t>(header + 24);
+            recovered_.push_back(std::move(record));
+        }
+
+        offset += kHeaderBytes + body_size;
+    }
+
+    if (offset < contents.size())
+    {
+        ++discarded_corrupt_records_;
+        if (::truncate(segment.path.c_str(), static_cast<off_t>(offset)) != 0)
+        {
+            offset = contents.size();
+        }
+    }
+    segment.size = offset;
+}
+
+bool PayloadSpool::open_active_segment()
+{
+    Segment segment;
+    segment.sequence = next_sequence_;
+    segment.path = segment_path(segment.sequence);
+    segment.first_id = next_id_;
+
+    const int fd =
+        ::open(segment.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    ++next_sequence_;
+    active_fd_ = fd;
+    segments_.push_back(std::move(segment));
+    return true;
+}
+
+void PayloadSpool::roll_segment()
+{
+    if (active_fd_ < 0)
+    {
+        return;
+    }
+
+    ::close(active_fd_);
+    active_fd_ = -1;
+    if (segments_.back().live_count == 0)
+    {
+        remove_segment(segments_.size() - 1);
+    }
+}
+
+void PayloadSpool::evict_oldest_segment()
+{
+    Segment &oldest = segments_.front();
+    evicted_records_ += oldest.live_count;
+    live_records_ -= oldest.live_count;
+    remove_segment(0);
+}
+
+void PayloadSpool::remove_segment(std::size_t index)
+{
+    Segment &segment = segments_[index];
+    ::unlink(segment.path.c_str());
+    disk_bytes_ -= segment.size;
+    segments_.erase(segments_.begin() + static_cast<std::ptrdiff_t>(index));
+}
+
+std::size_t PayloadSpool::find_segment(std::uint64_t id) const
+{
+    for (std::size_t i = 0; i < segments_.size(); ++i)
+    {
+        const Segment &segment = segments_[i];
+        if (id >= segment.first_id && id - segment.first_id < segment.records.size())
+        {
+            return i;
+        }
+    }
+    return segments_.size();
+}
+
+std::string PayloadSpool::segment_path(std::uint64_t sequence) const
+{
+    char digits[21];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), sequence);
+    const std::string number(digits, result.ptr);
+    return directory_ + "/" + std::string(kSegmentPrefix) +
+           std::string(20 - std::min<std::size_t>(20, number.size()), '0') + number +
+           std::string(kSegmentSuffix);
+}
+
+}  // namespace edge_probe
@@ -0,0 +1,211 @@
+#include "edge_probe/remote_write_encoder.h"
+
+#include <cstring>
+#include <string_view>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+// Protobuf keys: (field_number << 3) | wire_type.
+constexpr char kWriteRequestTimeseries = 0x0A;  // 1, length-delimited
+constexpr char kTimeSeriesLabel = 0x0A;         // 1, length-delimited
+constexpr char kTimeSeriesSample = 0x12;        // 2, length-delimited
+constexpr char kLabelName = 0x0A;               // 1, length-delimited
+constexpr char kLabelValue = 0x12;              // 2, length-delimited
+constexpr char kSampleValue = 0x09;             // 1, fixed64
+constexpr char kSampleTimestamp = 0x10;         // 2, varint
+
+constexpr std::string_view kMetricNameLabel = "__name__";
+
+std::size_t varint_size(std::uint64_t value)
+{
+    std::size_t size = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+void append_varint(std::uint64_t value, std::string &output)
+{
+    while (value >= 0x80)
+    {
+        output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<char>(value));
+}
+
+void append_bytes_field(char key, std::string_view bytes, std::string &output)
+{
+    output.push_back(key);
+    append_varint(bytes.size(), output);
+    output.append(bytes.data(), bytes.size());
+}
+
+void append_label(std::string_view name, std::string_view value, std::string &output)
+{
+    const std::size_t body_size = 1 + varint_size(name.size()) + name.size() + 1 +
+                                  varint_size(value.size()) + value.size();
+    output.push_back(kTimeSeriesLabel);
+    append_varint(body_size, output);
+    append_bytes_field(kLabelName, name, output);
+    append_bytes_field(kLabelValue, value, output);
+}
+
+template <typename Labels>
+void append_labels(std::string_view metric_name,
+                   const Labels &labels,
+                   const ExternalLabels *external,
+                   std::string &output)
+{
+    bool name_written = false;
+    merge_labels(labels, external, [&](std::string_view name, std::string_view value) {
+        if (!name_written && kMetricNameLabel < name)
+        {
+            append_label(kMetricNameLabel, metric_name, output);
+            name_written = true;
+        }
+        append_label(name, value, output);
+    });
+    if (!name_written)
+    {
+        append_label(kMetricNameLabel, metric_name, output);
+    }
+}
+
+void append_sample(double value, int64_t timestamp_ms, std::string &output)
+{
+    std::uint64_t value_bits = 0;
+    std::memcpy(&value_bits, &value, sizeof(value_bits));
+    const auto timestamp = static_cast<std::uint64_t>(timestamp_ms);
+
+    output.push_back(kTimeSeriesSample);
+    append_varint(1 + 8 + 1 + varint_size(timestamp), output);
+    output.push_back(kSampleValue);
+    for (int i = 0; i < 8; ++i)
+    {
+        output.push_back(static_cast<char>((value_bits >> (8 * i)) & 0xFF));
+    }
+    output.push_back(kSampleTimestamp);
+    append_varint(timestamp, output);
+}
+
+std::size_t series_field_bytes(std::size_t body_size)
+{
+    return 1 + varint_size(body_size) + body_size;
+}
+
+}  // namespace
+
+RemoteWriteEncoder::RemoteWriteEncoder(std::size_t reserve_bytes,
+                                       const ExternalLabels *external_labels)
+    : external_labels_(external_labels)
+{
+    buffer_.reserve(reserve_bytes);
+}
+
+bool RemoteWriteEncoder::add(const MetricSample &sample, std::size_t max_bytes)
+{
+    labels_scratch_.clear();
+    append_labels(sample.name, sample.labels, external_labels_, labels_scratch_);
+    return add_sample(sample.value, sample.timestamp_ms, max_bytes);
+}
+
+bool RemoteWriteEncoder::add(const SeriesRegistry &registry,
+                             const SeriesSample &sample,
+                             std::size_t max_bytes)
+{
+    labels_scratch_.clear();
+    append_labels(registry.name(sample.series),
+                  registry.labels(sample.series),
+                  external_labels_,
+                  labels_scratch_);
+    return add_sample(sample.value, sample.timestamp_ms, max_bytes);
+}
+
+bool RemoteWriteEncoder::add_sample(double value, int64_t timestamp_ms, std::size_t max_bytes)
+{
+    sample_scratch_.clear();
+    append_sample(value, timestamp_ms, sample_scratch_);
+
+    const auto found = series_.find(labels_scratch_);
+    std::size_t added_bytes = 0;
+    if (found == series_.end())
+    {
+        added_bytes = series_field_bytes(labels_scratch_.size() + sample_scratch_.size());
+    }
+    else
+    {
+        const std::size_t body_size = found->first.size() + found->second.samples.size();
+        added_bytes = series_field_bytes(body_size + sample_scratch_.size()) -
+                      series_field_bytes(body_size);
+    }
+    if (size_bytes_ > 0 && size_bytes_ + added_bytes > max_bytes)
+    {
+        return false;
+    }
+
+    if (found == series_.end())
+    {
+        auto &entry = *series_.emplace(labels_scratch_, Series {}).first;
+        series_order_.push_back(&entry);
+        entry.second.samples.append(sample_scratch_);
+    }
+    else
+    {
+        found->second.samples.append(sample_scratch_);
+    }
+
+    size_bytes_ += added_bytes;
+    buffer_.clear();
+    return true;
+}
+
+std::size_t RemoteWriteEncoder::size_bytes() const
+{
+    return size_bytes_;
+}
+
+const std::string &RemoteWriteEncoder::payload()
+{
+    if (buffer_.empty() && size_bytes_ > 0)
+    {
+        buffer_.reserve(size_bytes_);
+        for (const auto *series : series_order_)
+        {
+            buffer_.push_back(kWriteRequestTimeseries);
+            append_varint(series->first.size() + series->second.samples.size(), buffer_);
+            buffer_.append(series->first);
+            buffer_.append(series->second.samples);
+        }
+    }
+    return buffer_;
+}
+
+void RemoteWriteEncoder::take_payload(std::string &output)
+{
+    payload();
+    buffer_.swap(output);
+    buffer_.clear();
+}
+
+void RemoteWriteEncoder::clear()
+{
+    buffer_.clear();
+    series_.clear();
+    series_order_.clear();
+    size_bytes_ = 0;
+}
+
+std::size_t RemoteWriteEncoder::series_count() const
+{
+    return series_order_.size();
+}
+
+}  // namespace edge_probe
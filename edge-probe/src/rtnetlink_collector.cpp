@@ -0,0 +1,972 @@
+#include "edge_probe/rtnetlink_collector.h"
+
+#include "edge_probe/metric_sample_builders.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <linux/if.h>
+#include <linux/if_link.h>
+#include <linux/neighbour.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+constexpr std::size_t kEventSocketBufferBytes = 1024 * 1024;
+constexpr int kReloadAttempts = 3;
+
+// IF_OPER_* in order, named as ip -br link prints them.
+constexpr std::array<const char *, 7> kOperStates = {
+    "UNKNOWN", "NOTPRESENT", "DOWN", "LOWERLAYERDOWN", "TESTING", "DORMANT", "UP"};
+
+struct Link
+{
+    int index {0};
+    std::string name;
+    std::string mac;
+    unsigned int flags {0};
+    unsigned char operstate {IF_OPER_UNKNOWN};
+    bool has_stats {false};
+    rtnl_link_stats64 stats {};
+};
+
+struct Address
+{
+    int index {0};
+    std::string cidr;
+};
+
+struct Neighbour
+{
+    int index {0};
+    std::string ip;
+    std::string mac;
+    std::string state;
+};
+
+// Calls fn(type, value) for each attribute that follows a Header in payload.
+template <typename Header, typename Fn>
+void for_each_attribute(std::string_view payload, Fn &&fn)
+{
+    for_each_netlink_attribute(
+        payload.substr(std::min<std::size_t>(NLMSG_ALIGN(sizeof(Header)), payload.size())), fn);
+}
+
+std::string format_ip(unsigned char family, std::string_view bytes)
+{
+    char text[INET6_ADDRSTRLEN] = {};
+    if ((family == AF_INET && bytes.size() == 4) || (family == AF_INET6 && bytes.size() == 16))
+    {
+        ::inet_ntop(family, bytes.data(), text, sizeof(text));
+    }
+    return text;
+}
+
+std::string route_protocol_name(unsigned char protocol)
+{
+    switch (protocol)
+    {
+        case RTPROT_REDIRECT:
+            return "redirect";
+        case RTPROT_KERNEL:
+            return "kernel";
+        case RTPROT_BOOT:
+            return "boot";
+        case RTPROT_STATIC:
+            return "static";
+        case RTPROT_RA:
+            return "ra";
+        case RTPROT_DHCP:
+            return "dhcp";
+        default:
+            return std::to_string(protocol);
+    }
+}
+
+std::string route_scope_name(unsigned char scope)
+{
+    switch (scope)
+    {
+        case RT_SCOPE_SITE:
+            return "site";
+        case RT_SCOPE_LINK:
+            return "link";
+        case RT_SCOPE_HOST:
+            return "host";
+        case RT_SCOPE_NOWHERE:
+            return "nowhere";
+        default:
+            return std::to_string(scope);
+    }
+}
+
+std::string neighbour_state_name(std::uint16_t state)
+{
+    static constexpr std::pair<std::uint16_t, const char *> kStates[] = {
+        {NUD_INCOMPLETE, "INCOMPLETE"},
+        {NUD_REACHABLE, "REACHABLE"},
+        {NUD_STALE, "STALE"},
+        {NUD_DELAY, "DELAY"},
+        {NUD_PROBE, "PROBE"},
+        {NUD_FAILED, "FAILED"},
+        {NUD_NOARP, "NOARP"},
+        {NUD_PERMANENT, "PERMANENT"},
+    };
+    for (const auto &[bit, name] : kStates)
+    {
+        if ((state & bit) != 0)
+        {
+            return name;
+        }
+    }
+    return "NONE";
+}
+
+const Link *find_link(const std::vector<Link> &links, int index)
+{
+    for (const auto &link : links)
+    {
+        if (link.index == index)
+        {
+            return &link;
+        }
+    }
+    return nullptr;
+}
+
+const char *oper_state_name(const Link &link)
+{
+    return link.operstate < kOperStates.size() ? kOperStates[link.operstate] : "UNKNOWN";
+}
+
+void emit_links(const std::vector<Link> &links, std::vector<MetricSample> &metrics)
+{
+    for (const auto &link : links)
+    {
+        const bool up = (link.flags & IFF_UP) != 0;
+        metrics.push_back(make_info("edge_network_link_info",
+                                    {{"interface", link.name},
+                                     {"state", oper_state_name(link)},
+                                     {"mac", link.mac}}));
+        metrics.push_back(
+            make_metric("edge_network_link_up", up ? 1.0 : 0.0, {{"interface", link.name}}));
+        metrics.push_back(make_metric("edge_network_lower_up",
+                                      (link.flags & IFF_LOWER_UP) != 0 ? 1.0 : 0.0,
+                                      {{"interface", link.name}}));
+        metrics.push_back(make_metric("edge_network_no_carrier",
+                                      up && (link.flags & IFF_RUNNING) == 0 ? 1.0 : 0.0,
+                                      {{"interface", link.name}}));
+    }
+}
+
+// The /proc/net/dev columns, summed from rtnl_link_stats64 the way the kernel
+// prints that file.
+void emit_link_stats(const std::vector<Link> &links, std::vector<MetricSample> &metrics)
+{
+    for (const auto &link : links)
+    {
+        if (!link.has_stats)
+        {
+            continue;
+        }
+        const rtnl_link_stats64 &s = link.stats;
+        const std::pair<const char *, std::uint64_t> counters[] = {
+            {"edge_network_receive_bytes", s.rx_bytes},
+            {"edge_network_receive_packets", s.rx_packets},
+            {"edge_network_receive_errors", s.rx_errors},
+            {"edge_network_receive_drops", s.rx_dropped + s.rx_missed_errors},
+            {"edge_network_receive_fifo", s.rx_fifo_errors},
+            {"edge_network_receive_frame",
+             s.rx_length_errors + s.rx_over_errors + s.rx_crc_errors + s.rx_frame_errors},
+            {"edge_network_receive_compressed", s.rx_compressed},
+            {"edge_network_receive_multicast", s.multicast},
+            {"edge_network_transmit_bytes", s.tx_bytes},
+            {"edge_network_transmit_packets", s.tx_packets},
+            {"edge_network_transmit_errors", s.tx_errors},
+            {"edge_network_transmit_drops", s.tx_dropped},
+            {"edge_network_transmit_fifo", s.tx_fifo_errors},
+            {"edge_network_transmit_collisions", s.collisions},
+            {"edge_network_transmit_carrier",
+             s.tx_carrier_errors + s.tx_aborted_errors + s.tx_window_errors +
+                 s.tx_heartbeat_errors},
+            {"edge_network_transmit_compressed", s.tx_compressed},
+        };
+        for (const auto &[name, value] : counters)
+        {
+            metrics.push_back(
+                make_metric(name, static_cast<double>(value), {{"interface", link.name}}));
+        }
+    }
+}
+
+void emit_addresses(const std::vector<Link> &links,
+                    const std::vector<Address> &addresses,
+                    std::vector<MetricSample> &metrics)
+{
+    for (const auto &link : links)
+    {
+        const auto count =
+            std::count_if(addresses.begin(), addresses.end(), [&link](const Address &address) {
+                return address.index == link.index;
+            });
+        metrics.push_back(make_metric("edge_network_address_count",
+                                      static_cast<double>(count),
+                                      {{"interface", link.name}}));
+        for (const auto &address : addresses)
+        {
+            if (address.index == link.index)
+            {
+                metrics.push_back(make_info("edge_network_address_info",
+                                            {{"interface", link.name},
+                                             {"state", oper_state_name(link)},
+                                             {"cidr", address.cidr}}));
+            }
+        }
+    }
+}
+
+void emit_neighbours(const std::vector<Neighbour> &neighbours,
+                     const std::vector<Link> &links,
+                     std::vector<MetricSample> &metrics)
+{
+    std::vector<std::pair<std::string, std::size_t>> count_by_device;
+    for (const auto &neighbour : neighbours)
+    {
+        const Link *link = find_link(links, neighbour.index);
+        if (link == nullptr)
+        {
+            continue;
+        }
+
+        auto counted =
+            std::find_if(count_by_device.begin(), count_by_device.end(), [link](const auto &entry) {
+                return entry.first == link->name;
+            });
+        if (counted == count_by_device.end())
+        {
+            counted = count_by_device.insert(count_by_device.end(), {link->name, 0});
+        }
+        ++counted->second;
+        metrics.push_back(make_info("edge_neighbor_entry_info",
+                                    {{"device", link->name},
+                                     {"ip", neighbour.ip},
+                                     {"mac", neighbour.mac},
+                                     {"state", neighbour.state}}));
+    }
+
+    for (const auto &[device, count] : count_by_device)
+    {
+        metrics.push_back(make_metric(
+            "edge_neighbor_entries_total", static_cast<double>(count), {{"device", device}}));
+    }
+}
+
+Link decode_link(std::string_view payload)
+{
+    const auto header = read_netlink_struct<ifinfomsg>(payload);
+    Link link;
+    link.index = header.ifi_index;
+    link.flags = header.ifi_flags;
+    for_each_attribute<ifinfomsg>(payload, [&link](unsigned short type, std::string_view value) {
+        if (type == IFLA_IFNAME)
+        {
+            link.name = read_netlink_string(value);
+        }
+        else if (type == IFLA_ADDRESS)
+        {
+            link.mac = format_link_address(value);
+        }
+        else if (type == IFLA_OPERSTATE && !value.empty())
+        {
+            link.operstate = static_cast<unsigned char>(value.front());
+        }
+        else if (type == IFLA_STATS64)
+        {
+            // Newer kernels append counters; older ones send fewer.
+            link.stats = read_netlink_struct<rtnl_link_stats64>(value);
+            link.has_stats = true;
+        }
+    });
+    return link;
+}
+
+void decode_address(std::string_view payload, std::vector<Address> &addresses)
+{
+    const auto header = read_netlink_struct<ifaddrmsg>(payload);
+    std::string local;
+    std::string address;
+    for_each_attribute<ifaddrmsg>(payload, [&](unsigned short type, std::string_view value) {
+        if (type == IFA_LOCAL)
+        {
+            local = format_ip(header.ifa_family, value);
+        }
+        else if (type == IFA_ADDRESS)
+        {
+            address = format_ip(header.ifa_family, value);
+        }
+    });
+
+    // On a point-to-point link IFA_ADDRESS is the peer.
+    std::string cidr = local.empty() ? address : local;
+    if (!cidr.empty())
+    {
+        cidr += '/' + std::to_string(header.ifa_prefixlen);
+        addresses.push_back({static_cast<int>(header.ifa_index), std::move(cidr)});
+    }
+}
+
+// Labels routes the way parse_ip_route reads them from ip route.
+void decode_route(std::string_view payload,
+                  const std::vector<Link> &links,
+                  std::vector<MetricSample> &routes)
+{
+    const auto header = read_netlink_struct<rtmsg>(payload);
+    std::uint32_t table = header.rtm_table;
+    LabelSet labels;
+    std::string prefix = "default";
+    bool has_priority = false;
+    std::uint32_t priority = 0;
+    for_each_attribute<rtmsg>(payload, [&](unsigned short type, std::string_view value) {
+        switch (type)
+        {
+            case RTA_TABLE:
+                table = read_netlink_u32(value);
+                break;
+            case RTA_DST:
+                prefix = format_ip(AF_INET, value);
+                if (header.rtm_dst_len != 32)
+                {
+                    prefix += '/' + std::to_string(header.rtm_dst_len);
+                }
+                break;
+            case RTA_OIF:
+                if (const Link *link = find_link(links, static_cast<int>(read_netlink_u32(value))))
+                {
+                    labels["device"] = link->name;
+                }
+                break;
+            case RTA_GATEWAY:
+                labels["gateway"] = format_ip(AF_INET, value);
+                break;
+            case RTA_PREFSRC:
+                labels["src"] = format_ip(AF_INET, value);
+                break;
+            case RTA_PRIORITY:
+                has_priority = true;
+                priority = read_netlink_u32(value);
+                break;
+            default:
+                break;
+        }
+    });
+
+    // ip route lists unicast routes of the main table, and leaves out universe
+    // scope and the boot protocol.
+    if (table != RT_TABLE_MAIN || header.rtm_type != RTN_UNICAST)
+    {
+        return;
+    }
+    if (header.rtm_scope != RT_SCOPE_UNIVERSE)
+    {
+        labels["scope"] = route_scope_name(header.rtm_scope);
+    }
+    if (header.rtm_protocol != RTPROT_BOOT)
+    {
+        labels["proto"] = route_protocol_name(header.rtm_protocol);
+    }
+    if (has_priority)
+    {
+        labels["metric"] = std::to_string(priority);
+        // Multipath routes carry their devices in RTA_MULTIPATH, not RTA_OIF.
+        LabelSet metric_labels {{"prefix", prefix}};
+        if (const std::string *device = labels.find("device"))
+        {
+            metric_labels.emplace("device", *device);
+        }
+        routes.push_back(make_metric(
+            "edge_network_route_metric", static_cast<double>(priority), std::move(metric_labels)));
+    }
+
+    if (header.rtm_dst_len == 0)
+    {
+        routes.push_back(make_info("edge_network_default_route_info", std::move(labels)));
+    }
+    else
+    {
+        labels["prefix"] = prefix;
+        routes.push_back(make_info("edge_network_route_info", std::move(labels)));
+    }
+}
+
+// Returns whether ip neigh would list the entry: it leaves out NOARP entries
+// and entries in no state.
+bool decode_neighbour(std::string_view payload, Neighbour &neighbour)
+{
+    const auto header = read_netlink_struct<ndmsg>(payload);
+    neighbour.index = header.ndm_ifindex;
+    neighbour.state = neighbour_state_name(header.ndm_state);
+    for_each_attribute<ndmsg>(payload, [&](unsigned short type, std::string_view value) {
+        if (type == NDA_DST)
+        {
+            neighbour.ip = format_ip(header.ndm_family, value);
+        }
+        else if (type == NDA_LLADDR)
+        {
+            neighbour.mac = format_link_address(value);
+        }
+    });
+    return (header.ndm_family == AF_INET || header.ndm_family == AF_INET6) &&
+           (header.ndm_state & 0xff & ~NUD_NOARP) != 0;
+}
+
+// Sends one dump request and passes each reply's payload, starting with the
+// family header, to handler. Returns false when the dump fails, is truncated,
+// or is interrupted.
+bool dump_messages(NetlinkSocket &socket,
+                   std::uint16_t type,
+                   std::size_t header_bytes,
+                   unsigned char family,
+                   const std::function<void(std::string_view payload)> &handler,
+                   const NetlinkSocket::ReplyHandler &notification_handler = {})
+{
+    // The family is the first byte of ifinfomsg, ifaddrmsg, rtmsg, and ndmsg
+    // alike; the rest of the family header stays zero.
+    std::array<char, NLMSG_ALIGN(sizeof(ifinfomsg))> body {};
+    body[0] = static_cast<char>(family);
+
+    // Each RTM_GETx dump is answered with RTM_NEWx messages.
+    const std::uint16_t reply_type = type - (RTM_GETLINK - RTM_NEWLINK);
+    return socket.request(type,
+                          NLM_F_DUMP,
+                          std::string_view(body.data(), NLMSG_ALIGN(header_bytes)),
+                          [&](const nlmsghdr &reply, std::string_view payload) {
+                              if (reply.nlmsg_type == reply_type && payload.size() >= header_bytes)
+                              {
+                                  handler(payload);
+                              }
+                          },
+                          notification_handler);
+}
+
+}  // namespace
+
+RtnetlinkCollector::RtnetlinkCollector() : socket_(NETLINK_ROUTE) {}
+
+void RtnetlinkCollector::collect(std::vector<MetricSample> &metrics)
+{
+    // The other families name devices by ifindex, so without links there is
+    // nothing to label them with.
+    std::vector<Link> links;
+    if (!dump(RTM_GETLINK, sizeof(ifinfomsg), AF_UNSPEC, [&links](std::string_view payload) {
+            links.push_back(decode_link(payload));
+        }))
+    {
+        ++dump_failures_;
+        return;
+    }
+    emit_links(links, metrics);
+
+    std::vector<Address> addresses;
+    if (dump(RTM_GETADDR, sizeof(ifaddrmsg), AF_UNSPEC, [&addresses](std::string_view payload) {
+            decode_address(payload, addresses);
+        }))
+    {
+        emit_addresses(links, addresses, metrics);
+    }
+    else
+    {
+        ++dump_failures_;
+    }
+
+    std::vector<MetricSample> routes;
+    if (dump(RTM_GETROUTE, sizeof(rtmsg), AF_INET, [&links, &routes](std::string_view payload) {
+            decode_route(payload, links, routes);
+        }))
+    {
+        std::move(routes.begin(), routes.end(), std::back_inserter(metrics));
+    }
+    else
+    {
+        ++dump_failures_;
+    }
+
+    std::vector<Neighbour> neighbours;
+    if (dump(RTM_GETNEIGH, sizeof(ndmsg), AF_UNSPEC, [&neighbours](std::string_view payload) {
+            Neighbour neighbour;
+            if (decode_neighbour(payload, neighbour))
+            {
+                neighbours.push_back(std::move(neighbour));
+            }
+        }))
+    {
+        emit_neighbours(neighbours, links, metrics);
+    }
+    else
+    {
+        ++dump_failures_;
+    }
+
+    emit_link_stats(links, metrics);
+}
+
+std::uint64_t RtnetlinkCollector::dump_failures() const
+{
+    return dump_failures_;
+}
+
+bool RtnetlinkCollector::dump(std::uint16_t type,
+                              std::size_t header_bytes,
+                              unsigned char family,
+                              const MessageHandler &handler)
+{
+    return dump_messages(socket_, type, header_bytes, family, handler);
+}
+
+RtnetlinkEventMonitor::RtnetlinkEventMonitor()
+    : socket_(NETLINK_ROUTE, RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV4_ROUTE | RTMGRP_NEIGH)
+{
+    // Best effort: a larger queue rides out bursts such as a bridge coming up.
+    const int receive_buffer = static_cast<int>(kEventSocketBufferBytes);
+    ::setsockopt(socket_.fd(), SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+    if (!reload(nullptr))
+    {
+        throw std::runtime_error("failed to load the rtnetlink link and neighbour tables");
+    }
+}
+
+int RtnetlinkEventMonitor::fd() const
+{
+    return socket_.fd();
+}
+
+std::size_t RtnetlinkEventMonitor::poll(int timeout_ms, std::vector<MetricSample> &changes)
+{
+    pollfd readable {socket_.fd(), POLLIN, 0};
+    if (::poll(&readable, 1, timeout_ms) <= 0)
+    {
+        return 0;
+    }
+
+    std::size_t applied = 0;
+    std::string_view datagram;
+    while (true)
+    {
+        if (socket_.receive(MSG_DONTWAIT, datagram))
+        {
+            applied += apply(datagram, changes);
+            continue;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno != ENOBUFS && errno != EMSGSIZE)
+        {
+            break;
+        }
+        // Notifications were lost; the dumps show what changed meanwhile.
+        ++overruns_;
+        reload(&changes);
+    }
+    return applied;
+}
+
+std::size_t RtnetlinkEventMonitor::poll(int timeout_ms, TelemetryWriter &writer)
+{
+    std::vector<MetricSample> changes;
+    const std::size_t applied = poll(timeout_ms, changes);
+    if (!changes.empty())
+    {
+        writer.submit_batch(std::move(changes));
+        writer.flush_open_batch();
+    }
+    return applied;
+}
+
+std::size_t RtnetlinkEventMonitor::apply(std::string_view datagram,
+                                         std::vector<MetricSample> &changes)
+{
+    std::size_t applied = 0;
+    for_each_netlink_message(datagram, [&](const nlmsghdr &header, std::string_view payload) {
+        if (apply_message(header.nlmsg_type, payload, &changes))
+        {
+            ++applied;
+        }
+    });
+    return applied;
+}
+
+void RtnetlinkEventMonitor::collect(std::vector<MetricSample> &metrics) const
+{
+    for (const auto &device : counters_)
+    {
+        metrics.push_back(make_metric("edge_network_link_flaps_total",
+                                      static_cast<double>(device.link_flaps),
+                                      {{"interface", device.device}}));
+        metrics.push_back(make_metric("edge_network_address_changes_total",
+                                      static_cast<double>(device.address_changes),
+                                      {{"interface", device.device}}));
+        metrics.push_back(make_metric("edge_network_route_changes_total",
+                                      static_cast<double>(device.route_changes),
+                                      {{"device", device.device}}));
+        metrics.push_back(make_metric("edge_neighbor_state_changes_total",
+                                      static_cast<double>(device.neighbor_changes),
+                                      {{"device", device.device}}));
+    }
+    metrics.push_back(
+        make_metric("edge_netlink_event_overruns_total", static_cast<double>(overruns_)));
+}
+
+std::uint64_t RtnetlinkEventMonitor::overruns() const
+{
+    return overruns_;
+}
+
+bool RtnetlinkEventMonitor::reload(std::vector<MetricSample> *changes)
+{
+    // Notifications keep arriving during the dumps, so an interrupted dump is
+    // retried a few times.
+    for (int attempt = 0; attempt < kReloadAttempts; ++attempt)
+    {
+        std::vector<int> seen_links;
+        std::vector<Neighbour> seen_neighbours;
+        // The dumps share the socket with the groups. Notifications read
+        // meanwhile are applied in order, and what they create counts as seen
+        // even when the dump had already passed it.
+        const auto on_notification = [&](const nlmsghdr &message, std::string_view payload) {
+            if (!apply_message(message.nlmsg_type, payload, changes))
+            {
+                return;
+            }
+            Neighbour neighbour;
+            if (message.nlmsg_type == RTM_NEWLINK)
+            {
+                seen_links.push_back(read_netlink_struct<ifinfomsg>(payload).ifi_index);
+            }
+            else if (message.nlmsg_type == RTM_NEWNEIGH && decode_neighbour(payload, neighbour))
+            {
+                seen_neighbours.push_back(std::move(neighbour));
+            }
+        };
+
+        if (!dump_messages(
+                socket_,
+                RTM_GETLINK,
+                sizeof(ifinfomsg),
+                AF_UNSPEC,
+                [&](std::string_view payload) {
+                    const auto header = read_netlink_struct<ifinfomsg>(payload);
+                    seen_links.push_back(header.ifi_index);
+                    apply_link(false, payload, changes);
+                },
+                on_notification))
+        {
+            continue;
+        }
+        for (std::size_t i = links_.size(); i-- > 0;)
+        {
+            if (std::find(seen_links.begin(), seen_links.end(), links_[i].index) ==
+                seen_links.end())
+            {
+                update_link(links_[i], false, false, changes);
+                links_.erase(links_.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+        }
+
+        if (!dump_messages(
+                socket_,
+                RTM_GETNEIGH,
+                sizeof(ndmsg),
+                AF_UNSPEC,
+                [&](std::string_view payload) {
+                    Neighbour neighbour;
+                    if (decode_neighbour(payload, neighbour))
+                    {
+                        set_neighbour(neighbour.index,
+                                      neighbour.ip,
+                                      neighbour.mac,
+                                      neighbour.state,
+                                      changes);
+                        seen_neighbours.push_back(std::move(neighbour));
+                    }
+                },
+                on_notification))
+        {
+            continue;
+        }
+        for (std::size_t i = neighbours_.size(); i-- > 0;)
+        {
+            const NeighbourState &entry = neighbours_[i];
+            if (std::none_of(seen_neighbours.begin(),
+                             seen_neighbours.end(),
+                             [&entry](const Neighbour &neighbour) {
+                                 return neighbour.index == entry.index && neighbour.ip == entry.ip;
+                             }))
+            {
+                set_neighbour(entry.index, std::string(entry.ip), "", "", changes);
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+bool RtnetlinkEventMonitor::apply_message(std::uint16_t type,
+                                          std::string_view payload,
+                                          std::vector<MetricSample> *changes)
+{
+    switch (type)
+    {
+        case RTM_NEWLINK:
+        case RTM_DELLINK:
+            if (payload.size() < sizeof(ifinfomsg))
+            {
+                return false;
+            }
+            apply_link(type == RTM_DELLINK, payload, changes);
+            return true;
+        case RTM_NEWADDR:
+        case RTM_DELADDR:
+            if (payload.size() < sizeof(ifaddrmsg))
+            {
+                return false;
+            }
+            apply_address(payload, changes);
+            return true;
+        case RTM_NEWROUTE:
+        case RTM_DELROUTE:
+            if (payload.size() < sizeof(rtmsg))
+            {
+                return false;
+            }
+            apply_route(payload, changes);
+            return true;
+        case RTM_NEWNEIGH:
+        case RTM_DELNEIGH:
+            if (payload.size() < sizeof(ndmsg))
+            {
+                return false;
+            }
+            apply_neighbour(type == RTM_DELNEIGH, payload, changes);
+            return true;
+        default:
+            return false;
+    }
+}
+
+void RtnetlinkEventMonitor::apply_link(bool removed,
+                                       std::string_view payload,
+                                       std::vector<MetricSample> *changes)
+{
+    const Link link = decode_link(payload);
+    auto state = std::find_if(links_.begin(), links_.end(), [&link](const LinkState &known) {
+        return known.index == link.index;
+    });
+    if (removed)
+    {
+        if (state != links_.end())
+        {
+            update_link(*state, false, false, changes);
+            links_.erase(state);
+        }
+        return;
+    }
+
+    if (state == links_.end())
+    {
+        state = links_.insert(links_.end(), LinkState {link.index, link.name});
+        counters(link.name);
+    }
+    else if (!link.name.empty() && state->name != link.name)
+    {
+        state->name = link.name;
+        counters(link.name);
+    }
+    update_link(*state, (link.flags & IFF_UP) != 0, (link.flags & IFF_LOWER_UP) != 0, changes);
+}
+
+void RtnetlinkEventMonitor::update_link(LinkState &link,
+                                        bool up,
+                                        bool lower_up,
+                                        std::vector<MetricSample> *changes)
+{
+    if (link.up == up && link.lower_up == lower_up)
+    {
+        return;
+    }
+    // A flap is the link leaving the state where it is up with carrier.
+    const bool was_running = link.up && link.lower_up;
+    link.up = up;
+    link.lower_up = lower_up;
+    if (changes == nullptr)
+    {
+        return;
+    }
+
+    DeviceCounters &device = counters(link.name);
+    if (was_running && !(up && lower_up))
+    {
+        ++device.link_flaps;
+    }
+    changes->push_back(
+        make_metric("edge_network_link_up", up ? 1.0 : 0.0, {{"interface", link.name}}));
+    changes->push_back(
+        make_metric("edge_network_lower_up", lower_up ? 1.0 : 0.0, {{"interface", link.name}}));
+    changes->push_back(make_metric("edge_network_link_flaps_total",
+                                   static_cast<double>(device.link_flaps),
+                                   {{"interface", link.name}}));
+}
+
+void RtnetlinkEventMonitor::apply_address(std::string_view payload,
+                                          std::vector<MetricSample> *changes)
+{
+    const auto header = read_netlink_struct<ifaddrmsg>(payload);
+    const std::string *name = link_name(static_cast<int>(header.ifa_index));
+    if (name == nullptr || changes == nullptr)
+    {
+        return;
+    }
+
+    DeviceCounters &device = counters(*name);
+    ++device.address_changes;
+    changes->push_back(make_metric("edge_network_address_changes_total",
+                                   static_cast<double>(device.address_changes),
+                                   {{"interface", *name}}));
+}
+
+void RtnetlinkEventMonitor::apply_route(std::string_view payload,
+                                        std::vector<MetricSample> *changes)
+{
+    const auto header = read_netlink_struct<rtmsg>(payload);
+    std::uint32_t table = header.rtm_table;
+    int device_index = 0;
+    for_each_attribute<rtmsg>(payload, [&](unsigned short type, std::string_view value) {
+        if (type == RTA_TABLE)
+        {
+            table = read_netlink_u32(value);
+        }
+        else if (type == RTA_OIF)
+        {
+            device_index = static_cast<int>(read_netlink_u32(value));
+        }
+    });
+    // The same routes the collector reports.
+    if (table != RT_TABLE_MAIN || header.rtm_type != RTN_UNICAST)
+    {
+        return;
+    }
+    const std::string *name = link_name(device_index);
+    if (name == nullptr || changes == nullptr)
+    {
+        return;
+    }
+
+    DeviceCounters &device = counters(*name);
+    ++device.route_changes;
+    changes->push_back(make_metric("edge_network_route_changes_total",
+                                   static_cast<double>(device.route_changes),
+                                   {{"device", *name}}));
+}
+
+void RtnetlinkEventMonitor::apply_neighbour(bool removed,
+                                            std::string_view payload,
+                                            std::vector<MetricSample> *changes)
+{
+    Neighbour neighbour;
+    const bool listed = decode_neighbour(payload, neighbour) && !removed;
+    set_neighbour(neighbour.index,
+                  neighbour.ip,
+                  neighbour.mac,
+                  listed ? neighbour.state : std::string(),
+                  changes);
+}
+
+void RtnetlinkEventMonitor::set_neighbour(int index,
+                                          const std::string &ip,
+                                          const std::string &mac,
+                                          const std::string &state,
+                                          std::vector<MetricSample> *changes)
+{
+    auto entry = std::find_if(
+        neighbours_.begin(), neighbours_.end(), [index, &ip](const NeighbourState &known) {
+            return known.index == index && known.ip == ip;
+        });
+    if (state.empty())
+    {
+        if (entry == neighbours_.end())
+        {
+            return;
+        }
+        neighbours_.erase(entry);
+    }
+    else if (entry == neighbours_.end())
+    {
+        neighbours_.push_back({index, ip, state});
+    }
+    else if (entry->state == state)
+    {
+        return;
+    }
+    else
+    {
+        entry->state = state;
+    }
+
+    const std::string *name = link_name(index);
+    if (name == nullptr || changes == nullptr)
+    {
+        return;
+    }
+    DeviceCounters &device = counters(*name);
+    ++device.neighbor_changes;
+    if (!state.empty())
+    {
+        changes->push_back(make_info(
+            "edge_neighbor_entry_info",
+            {{"device", *name}, {"ip", ip}, {"mac", mac}, {"state", state}}));
+    }
+    changes->push_back(make_metric("edge_neighbor_state_changes_total",
+                                   static_cast<double>(device.neighbor_changes),
+                                   {{"device", *name}}));
+}
+
+const std::string *RtnetlinkEventMonitor::link_name(int index) const
+{
+    for (const auto &link : links_)
+    {
+        if (link.index == index)
+        {
+            return &link.name;
+        }
+    }
+    return nullptr;
+}
+
+RtnetlinkEventMonitor::DeviceCounters &RtnetlinkEventMonitor::counters(const std::string &device)
+{
+    for (auto &entry : counters_)
+    {
+        if (entry.device == device)
+        {
+            return entry;
+        }
+    }
+    counters_.push_back({device});
+    return counters_.back();
+}
+
+}  // namespace edge_probe
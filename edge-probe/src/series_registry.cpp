@@ -0,0 +1,215 @@
+#include "edge_probe/series_registry.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+constexpr std::size_t kArenaChunkBytes = 16 * 1024;
+constexpr std::size_t kInitialIndexSlots = 256;
+
+constexpr std::uint64_t kFnvOffset = 1469598103934665603ULL;
+constexpr std::uint64_t kFnvPrime = 1099511628211ULL;
+
+std::uint64_t hash_bytes(std::uint64_t hash, std::string_view bytes)
+{
+    for (const char byte : bytes)
+    {
+        hash = (hash ^ static_cast<unsigned char>(byte)) * kFnvPrime;
+    }
+    return hash;
+}
+
+// Separators keep {a="bc"} and {ab="c"} apart.
+std::uint64_t hash_series(std::string_view name, const std::vector<LabelView> &labels)
+{
+    std::uint64_t hash = hash_bytes(kFnvOffset, name);
+    for (const auto &label : labels)
+    {
+        hash = (hash ^ 0xFFU) * kFnvPrime;
+        hash = hash_bytes(hash, label.name);
+        hash = (hash ^ 0xFEU) * kFnvPrime;
+        hash = hash_bytes(hash, label.value);
+    }
+    return hash;
+}
+
+}  // namespace
+
+SeriesRegistry::SeriesRegistry() : index_(kInitialIndexSlots, 0)
+{
+}
+
+SeriesId SeriesRegistry::intern(std::string_view name, const LabelSet &labels)
+{
+    scratch_.clear();
+    for (const auto &[key, value] : labels)
+    {
+        scratch_.push_back({key, value});
+    }
+    return intern_scratch(name);
+}
+
+SeriesId SeriesRegistry::intern(std::string_view name, std::initializer_list<LabelView> labels)
+{
+    scratch_.assign(labels.begin(), labels.end());
+    std::stable_sort(scratch_.begin(), scratch_.end(), [](const LabelView &a, const LabelView &b) {
+        return a.name < b.name;
+    });
+    scratch_.erase(std::unique(scratch_.begin(),
+                               scratch_.end(),
+                               [](const LabelView &a, const LabelView &b) {
+                                   return a.name == b.name;
+                               }),
+                   scratch_.end());
+    return intern_scratch(name);
+}
+
+SeriesId SeriesRegistry::intern(const MetricSample &sample)
+{
+    return intern(sample.name, sample.labels);
+}
+
+bool SeriesRegistry::contains(SeriesId id) const
+{
+    return id < series_.size();
+}
+
+std::string_view SeriesRegistry::name(SeriesId id) const
+{
+    if (!contains(id))
+    {
+        throw std::out_of_range("unknown series id " + std::to_string(id));
+    }
+    return series_[id].name;
+}
+
+SeriesLabels SeriesRegistry::labels(SeriesId id) const
+{
+    if (!contains(id))
+    {
+        throw std::out_of_range("unknown series id " + std::to_string(id));
+    }
+    const LabelView *first = labels_.data() + series_[id].first_label;
+    return SeriesLabels(first, first + series_[id].label_count);
+}
+
+std::size_t SeriesRegistry::size() const
+{
+    return series_.size();
+}
+
+std::size_t SeriesRegistry::memory_bytes() const
+{
+    // The string set is approximated as one node plus one bucket per entry.
+    return arena_bytes_ + chunks_.capacity() * sizeof(chunks_[0]) +
+           strings_.size() * (sizeof(std::string_view) + 2 * sizeof(void *)) +
+           strings_.bucket_count() * sizeof(void *) + series_.capacity() * sizeof(Series) +
+           labels_.capacity() * sizeof(LabelView) + index_.capacity() * sizeof(index_[0]);
+}
+
+SeriesId SeriesRegistry::intern_scratch(std::string_view name)
+{
+    const std::uint64_t hash = hash_series(name, scratch_);
+    const std::size_t mask = index_.size() - 1;
+    std::size_t slot = static_cast<std::size_t>(hash) & mask;
+    for (; index_[slot] != 0; slot = (slot + 1) & mask)
+    {
+        const Series &candidate = series_[index_[slot] - 1];
+        if (candidate.hash == hash && matches(candidate, name))
+        {
+            return index_[slot] - 1;
+        }
+    }
+
+    Series series;
+    series.name = store(name);
+    series.first_label = static_cast<std::uint32_t>(labels_.size());
+    series.label_count = static_cast<std::uint32_t>(scratch_.size());
+    series.hash = hash;
+    for (const auto &label : scratch_)
+    {
+        const std::string_view stored_name = store(label.name);
+        labels_.push_back({stored_name, store(label.value)});
+    }
+
+    const auto id = static_cast<SeriesId>(series_.size());
+    series_.push_back(series);
+    index_[slot] = id + 1;
+    if (series_.size() * 2 > index_.size())
+    {
+        grow_index();
+    }
+    return id;
+}
+
+std::string_view SeriesRegistry::store(std::string_view value)
+{
+    if (value.empty())
+    {
+        return {};
+    }
+
+    const auto found = strings_.find(value);
+    if (found != strings_.end())
+    {
+        return *found;
+    }
+
+    if (chunk_capacity_ - chunk_used_ < value.size())
+    {
+        chunk_capacity_ = std::max(kArenaChunkBytes, value.size());
+        chunks_.push_back(std::make_unique<char[]>(chunk_capacity_));
+        chunk_used_ = 0;
+        arena_bytes_ += chunk_capacity_;
+    }
+
+    char *destination = chunks_.back().get() + chunk_used_;
+    std::memcpy(destination, value.data(), value.size());
+    chunk_used_ += value.size();
+
+    const std::string_view stored(destination, value.size());
+    strings_.insert(stored);
+    return stored;
+}
+
+bool SeriesRegistry::matches(const Series &series, std::string_view name) const
+{
+    if (series.name != name || series.label_count != scratch_.size())
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < scratch_.size(); ++i)
+    {
+        const LabelView &stored = labels_[series.first_label + i];
+        if (stored.name != scratch_[i].name || stored.value != scratch_[i].value)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SeriesRegistry::grow_index()
+{
+    std::vector<std::uint32_t> grown(index_.size() * 2, 0);
+    const std::size_t mask = grown.size() - 1;
+    for (SeriesId id = 0; id < series_.size(); ++id)
+    {
+        std::size_t slot = static_cast<std::size_t>(series_[id].hash) & mask;
+        while (grown[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        grown[slot] = id + 1;
+    }
+    index_.swap(grown);
+}
+
+}  // namespace edge_probe
@@ -0,0 +1,262 @@
+#include "edge_probe/snappy.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+constexpr std::size_t kBlockBytes = 1 << 16;
+constexpr int kHashBits = 14;
+
+enum : std::uint8_t
+{
+    kLiteral = 0,
+    kCopy1ByteOffset = 1,
+    kCopy2ByteOffset = 2,
+    kCopy4ByteOffset = 3,
+};
+
+std::uint32_t load32(const char *source)
+{
+    std::uint32_t value = 0;
+    std::memcpy(&value, source, sizeof(value));
+    return value;
+}
+
+std::uint32_t hash32(std::uint32_t value)
+{
+    return (value * 0x1e35a7bdU) >> (32 - kHashBits);
+}
+
+void append_varint32(std::uint32_t value, std::string &output)
+{
+    while (value >= 0x80)
+    {
+        output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<char>(value));
+}
+
+void emit_literal(const char *data, std::size_t size, std::string &output)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    const std::size_t n = size - 1;
+    if (n < 60)
+    {
+        output.push_back(static_cast<char>(n << 2 | kLiteral));
+    }
+    else
+    {
+        char length_bytes[4];
+        int count = 0;
+        for (std::size_t rest = n; rest > 0; rest >>= 8)
+        {
+            length_bytes[count++] = static_cast<char>(rest & 0xFF);
+        }
+        output.push_back(static_cast<char>((59 + count) << 2 | kLiteral));
+        output.append(length_bytes, static_cast<std::size_t>(count));
+    }
+    output.append(data, size);
+}
+
+void emit_copy_upto_64(std::size_t offset, std::size_t length, std::string &output)
+{
+    if (length < 12 && offset < 2048)
+    {
+        output.push_back(
+            static_cast<char>((offset >> 8) << 5 | (length - 4) << 2 | kCopy1ByteOffset));
+        output.push_back(static_cast<char>(offset & 0xFF));
+        return;
+    }
+
+    output.push_back(static_cast<char>((length - 1) << 2 | kCopy2ByteOffset));
+    output.push_back(static_cast<char>(offset & 0xFF));
+    output.push_back(static_cast<char>(offset >> 8));
+}
+
+void emit_copy(std::size_t offset, std::size_t length, std::string &output)
+{
+    // Split the same way as the reference encoder so no chunk is below 4 bytes.
+    while (length >= 68)
+    {
+        emit_copy_upto_64(offset, 64, output);
+        length -= 64;
+    }
+    if (length > 64)
+    {
+        emit_copy_upto_64(offset, 60, output);
+        length -= 60;
+    }
+    emit_copy_upto_64(offset, length, output);
+}
+
+void compress_block(const char *block,
+                    std::size_t size,
+                    std::array<std::uint16_t, 1 << kHashBits> &table,
+                    std::string &output)
+{
+    table.fill(0);
+
+    std::size_t literal_start = 0;
+    std::size_t position = 0;
+    while (position + 4 <= size)
+    {
+        const std::uint32_t current = load32(block + position);
+        std::uint16_t &slot = table[hash32(current)];
+        const std::size_t candidate = slot;
+        slot = static_cast<std::uint16_t>(position);
+
+        if (candidate >= position || load32(block + candidate) != current)
+        {
+            ++position;
+            continue;
+        }
+
+        std::size_t length = 4;
+        while (position + length < size && block[candidate + length] == block[position + length])
+        {
+            ++length;
+        }
+
+        emit_literal(block + literal_start, position - literal_start, output);
+        emit_copy(position - candidate, length, output);
+        position += length;
+        literal_start = position;
+    }
+
+    emit_literal(block + literal_start, size - literal_start, output);
+}
+
+}  // namespace
+
+void snappy_compress(std::string_view input, std::string &output)
+{
+    output.clear();
+    append_varint32(static_cast<std::uint32_t>(input.size()), output);
+
+    std::array<std::uint16_t, 1 << kHashBits> table;
+    for (std::size_t offset = 0; offset < input.size(); offset += kBlockBytes)
+    {
+        const std::size_t size = std::min(kBlockBytes, input.size() - offset);
+        compress_block(input.data() + offset, size, table, output);
+    }
+}
+
+bool snappy_uncompress(std::string_view input, std::string &output)
+{
+    output.clear();
+
+    std::size_t position = 0;
+    std::uint64_t expected_size = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        if (position >= input.size() || shift > 28)
+        {
+            return false;
+        }
+        const auto byte = static_cast<std::uint8_t>(input[position++]);
+        expected_size |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            break;
+        }
+    }
+    if (expected_size > 0xFFFFFFFFULL)
+    {
+        return false;
+    }
+    output.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(expected_size, 1 << 24)));
+
+    while (position < input.size())
+    {
+        const auto tag = static_cast<std::uint8_t>(input[position++]);
+        std::size_t length = 0;
+        std::size_t offset = 0;
+
+        switch (tag & 0x03)
+        {
+            case kLiteral:
+            {
+                length = tag >> 2;
+                if (length >= 60)
+                {
+                    const std::size_t count = length - 59;
+                    if (input.size() - position < count)
+                    {
+                        return false;
+                    }
+                    length = 0;
+                    for (std::size_t i = 0; i < count; ++i)
+                    {
+                        length |= static_cast<std::size_t>(
+                                      static_cast<std::uint8_t>(input[position + i]))
+                                  << (8 * i);
+                    }
+                    position += count;
+                }
+                ++length;
+                if (input.size() - position < length || output.size() + length > expected_size)
+                {
+                    return false;
+                }
+                output.append(input.data() + position, length);
+                position += length;
+                continue;
+            }
+            case kCopy1ByteOffset:
+                if (position >= input.size())
+                {
+                    return false;
+                }
+                length = 4 + ((tag >> 2) & 0x07);
+                offset = static_cast<std::size_t>(tag >> 5) << 8 |
+                         static_cast<std::uint8_t>(input[position]);
+                position += 1;
+                break;
+            case kCopy2ByteOffset:
+            case kCopy4ByteOffset:
+            {
+                const std::size_t count = (tag & 0x03) == kCopy2ByteOffset ? 2 : 4;
+                if (input.size() - position < count)
+                {
+                    return false;
+                }
+                length = 1 + (tag >> 2);
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    offset |= static_cast<std::size_t>(
+                                  static_cast<std::uint8_t>(input[position + i]))
+                              << (8 * i);
+                }
+                position += count;
+                break;
+            }
+        }
+
+        if (offset == 0 || offset > output.size() || output.size() + length > expected_size)
+        {
+            return false;
+        }
+        // Copies may overlap their own output, e.g. offset 1 repeats a byte.
+        const std::size_t source = output.size() - offset;
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            output.push_back(output[source + i]);
+        }
+    }
+
+    return output.size() == expected_size;
+}
+
+}  // namespace edge_probe
@@ -0,0 +1,660 @@
+#include "edge_probe/socket_http_transport.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+constexpr int kKeepAliveIdleSec = 30;
+constexpr int kKeepAliveIntervalSec = 15;
+constexpr std::size_t kReceiveChunkBytes = 16 * 1024;
+
+int64_t steady_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+int64_t steady_now_ms()
+{
+    return steady_now_us() / 1000;
+}
+
+// Waits until fd is ready for events or the deadline passes.
+bool wait_ready(int fd, short events, int64_t deadline_ms)
+{
+    while (true)
+    {
+        const int64_t remaining = deadline_ms - steady_now_ms();
+        if (remaining <= 0)
+        {
+            return false;
+        }
+        pollfd entry {fd, events, 0};
+        const int ready = ::poll(&entry, 1, static_cast<int>(remaining));
+        if (ready > 0)
+        {
+            return true;
+        }
+        if (ready < 0 && errno != EINTR)
+        {
+            return false;
+        }
+    }
+}
+
+// Returns a connected non-blocking socket, or -1 with error set to an errno
+// value.
+int connect_nonblocking(const sockaddr *address,
+                        socklen_t address_length,
+                        int64_t deadline_ms,
+                        int &error)
+{
+    const int fd = ::socket(address->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        error = errno;
+        return -1;
+    }
+
+    error = 0;
+    if (::connect(fd, address, address_length) != 0)
+    {
+        error = errno;
+        if (error == EINPROGRESS)
+        {
+            socklen_t length = sizeof(error);
+            error = ETIMEDOUT;
+            if (wait_ready(fd, POLLOUT, deadline_ms))
+            {
+                ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            }
+        }
+    }
+    if (error != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+std::string base64_encode(std::string_view input)
+{
+    static constexpr char kAlphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    const auto byte = [&input](std::size_t i) {
+        return i < input.size() ? static_cast<uint32_t>(static_cast<unsigned char>(input[i])) : 0;
+    };
+
+    std::string output;
+    output.reserve((input.size() + 2) / 3 * 4);
+    for (std::size_t i = 0; i < input.size(); i += 3)
+    {
+        const uint32_t group = byte(i) << 16 | byte(i + 1) << 8 | byte(i + 2);
+        output += kAlphabet[group >> 18 & 0x3f];
+        output += kAlphabet[group >> 12 & 0x3f];
+        output += i + 1 < input.size() ? kAlphabet[group >> 6 & 0x3f] : '=';
+        output += i + 2 < input.size() ? kAlphabet[group & 0x3f] : '=';
+    }
+    return output;
+}
+
+bool iequals(std::string_view lhs, std::string_view rhs)
+{
+    return lhs.size() == rhs.size() &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) ==
+                      std::tolower(static_cast<unsigned char>(b));
+           });
+}
+
+bool icontains(std::string_view haystack, std::string_view needle)
+{
+    return std::search(haystack.begin(),
+                       haystack.end(),
+                       needle.begin(),
+                       needle.end(),
+                       [](char a, char b) {
+                           return std::tolower(static_cast<unsigned char>(a)) ==
+                                  std::tolower(static_cast<unsigned char>(b));
+                       }) != haystack.end();
+}
+
+std::string_view trim(std::string_view value)
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+    {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+    {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+template <typename T>
+bool parse_number(std::string_view text, int base, T &value)
+{
+    const auto parsed = std::from_chars(text.data(), text.data() + text.size(), value, base);
+    return parsed.ec == std::errc() && parsed.ptr != text.data();
+}
+
+enum class ReceiveStatus
+{
+    data,
+    closed,
+    failed,
+};
+
+ReceiveStatus receive_more(int fd, std::string &input, int64_t deadline_ms, std::string &error)
+{
+    while (true)
+    {
+        const std::size_t old_size = input.size();
+        input.resize(old_size + kReceiveChunkBytes);
+        const ssize_t received = ::recv(fd, &input[old_size], kReceiveChunkBytes, 0);
+        input.resize(old_size + (received > 0 ? static_cast<std::size_t>(received) : 0));
+        if (received > 0)
+        {
+            return ReceiveStatus::data;
+        }
+        if (received == 0)
+        {
+            return ReceiveStatus::closed;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            error = std::string("receive failed: ") + std::strerror(errno);
+            return ReceiveStatus::failed;
+        }
+        if (!wait_ready(fd, POLLIN, deadline_ms))
+        {
+            error = "request timed out";
+            return ReceiveStatus::failed;
+        }
+    }
+}
+
+}  // namespace
+
+SocketHttpTransport::~SocketHttpTransport()
+{
+    close_socket();
+}
+
+HttpTransport::Result SocketHttpTransport::post_json_lines(const TelemetryConfig &config,
+                                                           const std::string &body)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Result result;
+    const int64_t start_us = steady_now_us();
+    const int64_t deadline_ms = start_us / 1000 + config.request_timeout_sec * 1000;
+    if (!parse_endpoint(config, result))
+    {
+        return result;
+    }
+
+    // A kept-alive connection the server has since closed fails before any
+    // response arrives; the post is then repeated once on a fresh connection.
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        const bool reused = fd_ >= 0;
+        if (!reused)
+        {
+            const bool connected = connect_socket(config, deadline_ms, result);
+            result.connect_time_us = steady_now_us() - start_us;
+            if (!connected)
+            {
+                break;
+            }
+        }
+        result.reused_connection = reused;
+
+        Attempt outcome = send_request(config, body, deadline_ms, result);
+        if (outcome == Attempt::done)
+        {
+            outcome = read_response(deadline_ms, result);
+        }
+        if (outcome == Attempt::done)
+        {
+            break;
+        }
+
+        close_socket();
+        if (outcome == Attempt::failed || !reused)
+        {
+            break;
+        }
+        result.error_message.clear();
+    }
+
+    result.total_time_us = steady_now_us() - start_us;
+    return result;
+}
+
+bool SocketHttpTransport::parse_endpoint(const TelemetryConfig &config, Result &result)
+{
+    const std::string &endpoint = config.endpoint;
+    if (endpoint == endpoint_ && config.unix_socket_path == unix_socket_path_ &&
+        !endpoint_.empty())
+    {
+        return true;
+    }
+    close_socket();
+    endpoint_.clear();
+    unix_socket_path_ = config.unix_socket_path;
+
+    constexpr std::string_view kScheme = "http://";
+    if (endpoint.compare(0, kScheme.size(), kScheme) != 0)
+    {
+        result.error_message = "socket transport supports only http:// endpoints";
+        return false;
+    }
+
+    const std::string_view rest = std::string_view(endpoint).substr(kScheme.size());
+    const std::size_t slash = rest.find('/');
+    const std::string_view authority = rest.substr(0, slash);
+    Endpoint parsed;
+    parsed.target = slash == std::string_view::npos ? "/" : std::string(rest.substr(slash));
+    parsed.authority = std::string(authority);
+
+    std::string_view host = authority;
+    std::string_view port = "80";
+    if (!authority.empty() && authority.front() == '[')
+    {
+        const std::size_t close = authority.find(']');
+        if (close == std::string_view::npos)
+        {
+            result.error_message = "malformed endpoint host: " + endpoint;
+            return false;
+        }
+        host = authority.substr(1, close - 1);
+        if (close + 1 < authority.size() && authority[close + 1] == ':')
+        {
+            port = authority.substr(close + 2);
+        }
+    }
+    else if (const std::size_t colon = authority.rfind(':'); colon != std::string_view::npos)
+    {
+        host = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+    }
+    if (host.empty() || port.empty())
+    {
+        result.error_message = "malformed endpoint host: " + endpoint;
+        return false;
+    }
+
+    parsed.host = std::string(host);
+    parsed.port = std::string(port);
+    parsed_ = std::move(parsed);
+    endpoint_ = endpoint;
+    return true;
+}
+
+bool SocketHttpTransport::connect_socket(const TelemetryConfig &config,
+                                         int64_t deadline_ms,
+                                         Result &result)
+{
+    const int64_t connect_deadline_ms =
+        std::min(deadline_ms, steady_now_ms() + config.connect_timeout_sec * 1000);
+    if (!config.unix_socket_path.empty())
+    {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        if (config.unix_socket_path.size() >= sizeof(address.sun_path))
+        {
+            result.error_message = "unix socket path too long: " + config.unix_socket_path;
+            return false;
+        }
+        std::memcpy(address.sun_path,
+                    config.unix_socket_path.data(),
+                    config.unix_socket_path.size());
+        int error = 0;
+        fd_ = connect_nonblocking(reinterpret_cast<const sockaddr *>(&address),
+                                  sizeof(address),
+                                  connect_deadline_ms,
+                                  error);
+        if (fd_ < 0)
+        {
+            result.error_message =
+                "connect to " + config.unix_socket_path + " failed: " + std::strerror(error);
+        }
+        return fd_ >= 0;
+    }
+
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    const int lookup =
+        ::getaddrinfo(parsed_.host.c_str(), parsed_.port.c_str(), &hints, &addresses);
+    if (lookup != 0)
+    {
+        result.error_message = "cannot resolve " + parsed_.host + ": " + ::gai_strerror(lookup);
+        return false;
+    }
+
+    result.error_message = "connect to " + parsed_.authority + " failed";
+    for (addrinfo *address = addresses; address != nullptr; address = address->ai_next)
+    {
+        int error = 0;
+        const int fd =
+            connect_nonblocking(address->ai_addr, address->ai_addrlen, connect_deadline_ms, error);
+        if (fd < 0)
+        {
+            result.error_message =
+                "connect to " + parsed_.authority + " failed: " + std::strerror(error);
+            continue;
+        }
+
+        const int enable = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        ::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+        ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &kKeepAliveIdleSec, sizeof(int));
+        ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &kKeepAliveIntervalSec, sizeof(int));
+        fd_ = fd;
+        result.error_message.clear();
+        break;
+    }
+    ::freeaddrinfo(addresses);
+    return fd_ >= 0;
+}
+
+SocketHttpTransport::Attempt SocketHttpTransport::send_request(const TelemetryConfig &config,
+                                                               const std::string &body,
+                                                               int64_t deadline_ms,
+                                                               Result &result)
+{
+    head_.clear();
+    head_ += "POST ";
+    head_ += parsed_.target;
+    head_ += " HTTP/1.1\r\nHost: ";
+    head_ += parsed_.authority;
+    head_ += "\r\nUser-Agent: edge-probe\r\nContent-Type: ";
+    head_ += payload_content_type(config.payload_format);
+    head_ += "\r\n";
+    if (config.payload_format == PayloadFormat::remote_write)
+    {
+        head_ += "X-Prometheus-Remote-Write-Version: 0.1.0\r\n";
+    }
+    if (const char *encoding = payload_content_encoding(config.compression))
+    {
+        head_ += "Content-Encoding: ";
+        head_ += encoding;
+        head_ += "\r\n";
+    }
+    if (!config.username.empty())
+    {
+        head_ += "Authorization: Basic ";
+        head_ += base64_encode(config.username + ":" + config.password);
+        head_ += "\r\n";
+    }
+    head_ += "Content-Length: ";
+    head_ += std::to_string(body.size());
+    head_ += "\r\n\r\n";
+
+    // Head and body go out in one gather write; the body is never copied.
+    iovec parts[2] = {{head_.data(), head_.size()},
+                      {const_cast<char *>(body.data()), body.size()}};
+    msghdr message {};
+    message.msg_iov = parts;
+    message.msg_iovlen = body.empty() ? 1 : 2;
+    while (message.msg_iovlen > 0)
+    {
+        const ssize_t sent = ::sendmsg(fd_, &message, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                result.error_message = std::string("send failed: ") + std::strerror(errno);
+                return Attempt::connection_lost;
+            }
+            if (!wait_ready(fd_, POLLOUT, deadline_ms))
+            {
+                result.error_message = "request timed out";
+                return Attempt::failed;
+            }
+            continue;
+        }
+
+        std::size_t remaining = static_cast<std::size_t>(sent);
+        while (message.msg_iovlen > 0 && remaining >= message.msg_iov->iov_len)
+        {
+            remaining -= message.msg_iov->iov_len;
+            ++message.msg_iov;
+            --message.msg_iovlen;
+        }
+        if (message.msg_iovlen > 0)
+        {
+            message.msg_iov->iov_base = static_cast<char *>(message.msg_iov->iov_base) + remaining;
+            message.msg_iov->iov_len -= remaining;
+        }
+    }
+    return Attempt::done;
+}
+
+SocketHttpTransport::Attempt SocketHttpTransport::read_response(int64_t deadline_ms,
+                                                                Result &result)
+{
+    input_.clear();
+    std::size_t position = 0;
+    bool received_any = false;
+
+    // Reads until at least `bytes` are buffered past position.
+    const auto need = [&](std::size_t bytes) {
+        while (input_.size() - position < bytes)
+        {
+            const ReceiveStatus status =
+                receive_more(fd_, input_, deadline_ms, result.error_message);
+            if (status != ReceiveStatus::data)
+            {
+                if (status == ReceiveStatus::closed)
+                {
+                    result.error_message = "connection closed before the response completed";
+                }
+                return false;
+            }
+            received_any = true;
+        }
+        return true;
+    };
+    // Returns the end of the next CRLF-terminated line, or npos.
+    const auto line_end = [&]() {
+        std::size_t end;
+        while ((end = input_.find("\r\n", position)) == std::string::npos)
+        {
+            if (!need(input_.size() - position + 1))
+            {
+                return std::string::npos;
+            }
+        }
+        return end;
+    };
+    const auto lost = [&]() { return received_any ? Attempt::failed : Attempt::connection_lost; };
+
+    std::size_t content_length = 0;
+    bool has_length = false;
+    bool chunked = false;
+    bool close_after = false;
+    while (true)
+    {
+        std::size_t end = line_end();
+        if (end == std::string::npos)
+        {
+            return lost();
+        }
+        const std::string_view status_line(input_.data() + position, end - position);
+        position = end + 2;
+        if (status_line.size() < 12 || status_line.compare(0, 5, "HTTP/") != 0 ||
+            !parse_number(status_line.substr(9, 3), 10, result.http_code))
+        {
+            result.error_message = "malformed HTTP status line";
+            return Attempt::failed;
+        }
+        close_after = status_line.compare(0, 8, "HTTP/1.0") == 0;
+
+        while ((end = line_end()) != position)
+        {
+            if (end == std::string::npos)
+            {
+                return lost();
+            }
+            const std::string_view header(input_.data() + position, end - position);
+            position = end + 2;
+            const std::size_t colon = header.find(':');
+            if (colon == std::string_view::npos)
+            {
+                continue;
+            }
+            const std::string_view name = trim(header.substr(0, colon));
+            const std::string_view value = trim(header.substr(colon + 1));
+            if (iequals(name, "content-length"))
+            {
+                has_length = parse_number(value, 10, content_length);
+            }
+            else if (iequals(name, "transfer-encoding"))
+            {
+                chunked = icontains(value, "chunked");
+            }
+            else if (iequals(name, "connection"))
+            {
+                close_after = icontains(value, "close");
+            }
+        }
+        position += 2;
+
+        // Interim 1xx responses carry no body; the final one follows.
+        if (result.http_code >= 200)
+        {
+            break;
+        }
+        has_length = chunked = false;
+    }
+
+    if (result.http_code == 204 || result.http_code == 304)
+    {
+        has_length = true;
+        content_length = 0;
+        chunked = false;
+    }
+
+    if (chunked)
+    {
+        while (true)
+        {
+            const std::size_t end = line_end();
+            if (end == std::string::npos)
+            {
+                return Attempt::failed;
+            }
+            std::string_view size_text(input_.data() + position, end - position);
+            size_text = trim(size_text.substr(0, size_text.find(';')));
+            std::size_t chunk_size = 0;
+            if (!parse_number(size_text, 16, chunk_size))
+            {
+                result.error_message = "malformed chunk size";
+                return Attempt::failed;
+            }
+            position = end + 2;
+            if (chunk_size == 0)
+            {
+                break;
+            }
+            if (!need(chunk_size + 2))
+            {
+                return Attempt::failed;
+            }
+            result.response_body.append(input_, position, chunk_size);
+            position += chunk_size + 2;
+        }
+        // Skip trailers up to the blank line that ends the message.
+        std::size_t end;
+        while ((end = line_end()) != position)
+        {
+            if (end == std::string::npos)
+            {
+                return Attempt::failed;
+            }
+            position = end + 2;
+        }
+        position += 2;
+    }
+    else if (has_length)
+    {
+        if (!need(content_length))
+        {
+            return Attempt::failed;
+        }
+        result.response_body.assign(input_, position, content_length);
+    }
+    else
+    {
+        // No framing: the body runs until the server closes the connection.
+        while (true)
+        {
+            const ReceiveStatus status =
+                receive_more(fd_, input_, deadline_ms, result.error_message);
+            if (status == ReceiveStatus::failed)
+            {
+                return Attempt::failed;
+            }
+            if (status == ReceiveStatus::closed)
+            {
+                break;
+            }
+        }
+        result.response_body.assign(input_, position, std::string::npos);
+        close_after = true;
+    }
+
+    if (close_after)
+    {
+        close_socket();
+    }
+    result.ok = result.http_code >= 200 && result.http_code < 300;
+    return Attempt::done;
+}
+
+void SocketHttpTransport::close_socket()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+}  // namespace edge_probe
@@ -0,0 +1,262 @@
+#include "edge_probe/system_health_reader.h"
+
+#include "edge_probe/collectors.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace edge_probe
+{
+
+namespace
+{
+
+constexpr std::size_t kInitialBufferBytes = 4096;
+// The command plan reads meminfo through head -20; keep the same series.
+constexpr std::size_t kMeminfoLines = 20;
+
+// Names of the form <prefix><number><suffix> in directory, in number order.
+std::vector<std::string> numbered_entries(const std::string &directory,
+                                          std::string_view prefix,
+                                          std::string_view suffix)
+{
+    std::vector<std::pair<std::uint64_t, std::string>> found;
+    DIR *dir = ::opendir(directory.c_str());
+    if (dir == nullptr)
+    {
+        return {};
+    }
+    while (const dirent *entry = ::readdir(dir))
+    {
+        const std::string_view name(entry->d_name);
+        if (name.size() <= prefix.size() + suffix.size() ||
+            name.substr(0, prefix.size()) != prefix ||
+            name.substr(name.size() - suffix.size()) != suffix)
+        {
+            continue;
+        }
+
+        const std::string_view digits =
+            name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+        std::uint64_t number = 0;
+        const auto result = std::from_chars(digits.data(), digits.data() + digits.size(), number);
+        if (result.ec == std::errc() && result.ptr == digits.data() + digits.size())
+        {
+            found.emplace_back(number, std::string(name));
+        }
+    }
+    ::closedir(dir);
+
+    std::sort(found.begin(), found.end());
+    std::vector<std::string> names;
+    for (auto &[number, name] : found)
+    {
+        names.push_back(std::move(name));
+    }
+    return names;
+}
+
+// The first line of a small attribute file such as hwmon name, or empty.
+std::string read_attribute(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return {};
+    }
+    char buffer[256];
+    ssize_t n = 0;
+    do
+    {
+        n = ::pread(fd, buffer, sizeof(buffer), 0);
+    } while (n < 0 && errno == EINTR);
+    ::close(fd);
+    if (n <= 0)
+    {
+        return {};
+    }
+    const std::string_view text(buffer, static_cast<std::size_t>(n));
+    return std::string(text.substr(0, text.find('\n')));
+}
+
+template <typename T>
+void append(std::vector<T> &target, std::vector<T> source)
+{
+    target.insert(target.end(),
+                  std::make_move_iterator(source.begin()),
+                  std::make_move_iterator(source.end()));
+}
+
+}  // namespace
+
+SystemHealthReader::SystemHealthReader(std::string proc_root, std::string sys_root)
+    : proc_root_(std::move(proc_root)), sys_root_(std::move(sys_root))
+{
+    buffer_.resize(kInitialBufferBytes);
+    open_file(Source::loadavg, proc_root_ + "/loadavg", {});
+    open_file(Source::meminfo, proc_root_ + "/meminfo", {});
+    open_file(Source::net_dev, proc_root_ + "/net/dev", {});
+    discover_thermal_zones();
+    discover_hwmon_sensors();
+}
+
+SystemHealthReader::~SystemHealthReader()
+{
+    for (const auto &file : files_)
+    {
+        ::close(file.fd);
+    }
+}
+
+void SystemHealthReader::collect(std::vector<MetricSample> &metrics)
+{
+    for (const auto &file : files_)
+    {
+        if (!read(file))
+        {
+            ++read_failures_;
+            continue;
+        }
+
+        switch (file.source)
+        {
+            case Source::loadavg:
+                append(metrics, parse_loadavg(buffer_));
+                break;
+            case Source::meminfo:
+            {
+                std::size_t end = 0;
+                for (std::size_t line = 0; line < kMeminfoLines && end < buffer_.size(); ++line)
+                {
+                    end = std::min(buffer_.find('\n', end), buffer_.size() - 1) + 1;
+                }
+                buffer_.resize(end);
+                append(metrics, parse_meminfo(buffer_));
+                break;
+            }
+            case Source::net_dev:
+                append(metrics, parse_proc_net_dev(buffer_));
+                break;
+            case Source::thermal_zone:
+                append(metrics, parse_thermal_zone_temp(buffer_, file.device));
+                break;
+            case Source::hwmon_temp:
+                append(metrics, parse_hwmon_temp(buffer_, file.device, file.chip, file.sensor));
+                break;
+        }
+    }
+}
+
+std::size_t SystemHealthReader::open_files() const
+{
+    return files_.size();
+}
+
+std::size_t SystemHealthReader::thermal_zones() const
+{
+    return thermal_zones_;
+}
+
+std::size_t SystemHealthReader::hwmon_sensors() const
+{
+    return hwmon_sensors_;
+}
+
+std::uint64_t SystemHealthReader::read_failures() const
+{
+    return read_failures_;
+}
+
+void SystemHealthReader::open_file(Source source, const std::string &path, OpenFile file)
+{
+    file.source = source;
+    file.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file.fd >= 0)
+    {
+        files_.push_back(std::move(file));
+    }
+}
+
+void SystemHealthReader::discover_thermal_zones()
+{
+    const std::string directory = sys_root_ + "/class/thermal";
+    for (const auto &zone : numbered_entries(directory, "thermal_zone", ""))
+    {
+        const std::size_t before = files_.size();
+        OpenFile file;
+        file.device = zone;
+        open_file(Source::thermal_zone, directory + "/" + zone + "/temp", std::move(file));
+        thermal_zones_ += files_.size() - before;
+    }
+}
+
+void SystemHealthReader::discover_hwmon_sensors()
+{
+    const std::string directory = sys_root_ + "/class/hwmon";
+    for (const auto &hwmon : numbered_entries(directory, "hwmon", ""))
+    {
+        const std::string device_directory = directory + "/" + hwmon;
+        const std::string chip = read_attribute(device_directory + "/name");
+        for (const auto &input : numbered_entries(device_directory, "temp", "_input"))
+        {
+            const std::string sensor = input.substr(0, input.find('_'));
+            OpenFile file;
+            file.device = hwmon;
+            file.chip = chip.empty() ? hwmon : chip;
+            file.sensor = read_attribute(device_directory + "/" + sensor + "_label");
+            if (file.sensor.empty())
+            {
+                file.sensor = sensor;
+            }
+
+            const std::size_t before = files_.size();
+            open_file(Source::hwmon_temp, device_directory + "/" + input, std::move(file));
+            hwmon_sensors_ += files_.size() - before;
+        }
+    }
+}
+
+// Fills buffer_ with the file's current contents. procfs and sysfs regenerate
+// a file on each read from offset 0, so the descriptor never needs reopening.
+bool SystemHealthReader::read(const OpenFile &file)
+{
+    buffer_.resize(buffer_.capacity());
+    std::size_t used = 0;
+    while (true)
+    {
+        if (used == buffer_.size())
+        {
+            buffer_.resize(buffer_.size() * 2);
+        }
+        const ssize_t n = ::pread(file.fd,
+                                  buffer_.data() + used,
+                                  buffer_.size() - used,
+                                  static_cast<off_t>(used));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            buffer_.clear();
+            return false;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        used += static_cast<std::size_t>(n);
+    }
+    buffer_.resize(used);
+    return true;
+}
+
+}  // namespace edge_probe
@@ -1,11 +1,14 @@
 #include "edge_probe/telemetry_sender.h"
 
+#include "edge_probe/metric_prefix_cache.h"
+#include "edge_probe/payload_encoder.h"
+#include "edge_probe/payload_spool.h"
+#include "edge_probe/series_registry.h"
+#include "edge_probe/spsc_ring.h"
+
 #include <algorithm>
 #include <chrono>
-#include <cctype>
-#include <iomanip>
 #include <iostream>
-#include <sstream>
 #include <stdexcept>
 #include <utility>
 
@@ -18,34 +21,43 @@ namespace
 class TelemetryWriterBatchBuffer
 {
 public:
-    explicit TelemetryWriterBatchBuffer(const TelemetryConfig &config) : config_(config)
+    explicit TelemetryWriterBatchBuffer(const TelemetryConfig &config)
+        : config_(config), encoder_(make_payload_encoder(config))
     {
     }
 
+    // Serializes the sample into the open batch. Returns false, leaving the
+    // batch unchanged, when the sample would push a non-empty batch past the
+    // byte target.
     bool add(const MetricSample &sample, int64_t now_monotonic_ms)
     {
-        if (samples_.empty())
-        {
-            first_sample_monotonic_ms_ = now_monotonic_ms;
-        }
+        return count_added(encoder_->add(sample, config_.max_pending_payload_bytes),
+                           now_monotonic_ms);
+    }
 
-        if (samples_.size() >= config_.max_batch_samples)
-        {
-            return false;
-        }
+    bool add(const SeriesRegistry &registry,
+             const SeriesSample &sample,
+             int64_t now_monotonic_ms)
+    {
+        return count_added(
+            encoder_->add(registry, sample, config_.max_pending_payload_bytes),
+            now_monotonic_ms);
+    }
 
-        samples_.push_back(sample);
-        return true;
+    bool full() const
+    {
+        return sample_count_ >= config_.max_batch_samples ||
+               encoder_->size_bytes() >= config_.max_pending_payload_bytes;
     }
 
     bool should_flush(int64_t now_monotonic_ms) const
     {
-        if (samples_.empty())
+        if (sample_count_ == 0)
         {
             return false;
         }
 
-        if (samples_.size() >= config_.max_batch_samples)
+        if (full())
         {
             return true;
         }
@@ -56,47 +68,66 @@ public:
 
     bool empty() const
     {
-        return samples_.empty();
+        return sample_count_ == 0;
     }
 
     std::size_t size() const
     {
-        return samples_.size();
+        return sample_count_;
     }
 
-    std::string build_json_lines() const
+    const std::string &payload()
     {
-        std::ostringstream output;
-        output << std::setprecision(15);
-
-        for (const auto &sample : samples_)
-        {
-            output << "{\"metric\":{\"__name__\":\"" << json_escape(sample.name) << "\"";
-            for (const auto &[key, value] : sample.labels)
-            {
-                output << ",\"" << json_escape(key) << "\":\"" << json_escape(value)
-                       << "\"";
-            }
+        return encoder_->payload();
+    }
 
-            output << "},\"values\":[" << sample.value << "],\"timestamps\":["
-                   << sample.timestamp_ms << "]}\n";
-        }
+    const MetricPrefixCache *prefix_cache() const
+    {
+        return encoder_->prefix_cache();
+    }
 
-        return output.str();
+    // Moves the encoded batch into output and keeps output's old storage.
+    void take_payload(std::string &output)
+    {
+        encoder_->take_payload(output);
     }
 
     void clear()
     {
-        samples_.clear();
+        encoder_->clear();
+        sample_count_ = 0;
         first_sample_monotonic_ms_ = 0;
     }
 
 private:
+    bool count_added(bool added, int64_t now_monotonic_ms)
+    {
+        if (!added)
+        {
+            return false;
+        }
+
+        if (sample_count_ == 0)
+        {
+            first_sample_monotonic_ms_ = now_monotonic_ms;
+        }
+        ++sample_count_;
+        return true;
+    }
+
     const TelemetryConfig &config_;
-    std::vector<MetricSample> samples_;
+    std::unique_ptr<PayloadEncoder> encoder_;
+    std::size_t sample_count_ {0};
     int64_t first_sample_monotonic_ms_ {0};
 };
 
+// Spool record encoding: compression in the low byte, payload format above it.
+std::uint32_t spool_encoding(PayloadFormat format, PayloadCompression compression)
+{
+    return static_cast<std::uint32_t>(compression) |
+           static_cast<std::uint32_t>(format) << 8;
+}
+
 }  // namespace
 
 class TelemetryWriter::BatchBuffer : public TelemetryWriterBatchBuffer
@@ -117,49 +148,17 @@ int64_t SystemClock::unix_epoch_ms() const
     return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
 }
 
-std::string json_escape(const std::string &value)
+std::vector<HttpTransport::Result> HttpTransport::post_many(
+    const TelemetryConfig &config,
+    const std::vector<const std::string *> &bodies)
 {
-    std::ostringstream output;
-    for (const unsigned char ch : value)
+    std::vector<Result> results;
+    results.reserve(bodies.size());
+    for (const std::string *body : bodies)
     {
-        switch (ch)
-        {
-            case '"':
-                output << "\\\"";
-                break;
-            case '\\':
-                output << "\\\\";
-                break;
-            case '\b':
-                output << "\\b";
-                break;
-            case '\f':
-                output << "\\f";
-                break;
-            case '\n':
-                output << "\\n";
-                break;
-            case '\r':
-                output << "\\r";
-                break;
-            case '\t':
-                output << "\\t";
-                break;
-            default:
-                if (ch < 0x20)
-                {
-                    output << "\\u00" << std::hex << std::nouppercase
-                           << static_cast<int>((ch >> 4) & 0x0F)
-                           << static_cast<int>(ch & 0x0F) << std::dec;
-                }
-                else
-                {
-                    output << static_cast<char>(ch);
-                }
-                break;
-        }
+        results.push_back(post_json_lines(config, *body));
     }
-    return output.str();
+    return results;
 }
 
 TelemetryWriter::TelemetryWriter(TelemetryConfig config,
@@ -179,9 +178,79 @@ TelemetryWriter::TelemetryWriter(TelemetryConfig config,
     {
         throw std::invalid_argument("clock must not be null");
     }
+    max_in_flight_ = std::max<std::size_t>(1, transport_->max_in_flight());
+
+    for (const auto &[name, value] : config_.external_labels)
+    {
+        if (name.empty() || name == "__name__")
+        {
+            throw std::invalid_argument("invalid external label name: \"" + name + "\"");
+        }
+    }
+
+    if (config_.payload_format == PayloadFormat::remote_write)
+    {
+        // The remote_write protocol mandates snappy block compression.
+        if (config_.compression == PayloadCompression::none)
+        {
+            config_.compression = PayloadCompression::snappy;
+        }
+        else if (config_.compression != PayloadCompression::snappy)
+        {
+            throw std::invalid_argument(
+                std::string("remote_write requires snappy compression, got ") +
+                payload_compression_name(config_.compression));
+        }
+    }
+    else if (config_.compression == PayloadCompression::snappy)
+    {
+        // /api/v1/import decodes gzip and zstd bodies, not snappy.
+        throw std::invalid_argument("snappy compression requires the remote_write format");
+    }
+
+    if (config_.compression != PayloadCompression::none)
+    {
+        compressor_ =
+            std::make_unique<PayloadCompressor>(config_.compression, config_.compression_level);
+    }
+
+    if (!config_.spool_directory.empty())
+    {
+        spool_ = std::make_unique<PayloadSpool>(config_.spool_directory,
+                                                config_.max_spool_bytes,
+                                                config_.spool_segment_bytes,
+                                                config_.spool_sync_writes);
+        recover_spool();
+    }
+
+    if (config_.background_sender)
+    {
+        handoff_ = std::make_unique<SpscRing<QueuedPayload>>(config_.sender_queue_capacity);
+        recycled_bodies_ =
+            std::make_unique<SpscRing<std::string>>(config_.sender_queue_capacity);
+        sender_thread_ = std::thread([this] { run_sender(); });
+    }
 }
 
-TelemetryWriter::~TelemetryWriter() = default;
+TelemetryWriter::~TelemetryWriter()
+{
+    if (sender_thread_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(sender_mutex_);
+            stop_sender_ = true;
+        }
+        sender_wake_.notify_one();
+        sender_thread_.join();
+        return;
+    }
+
+    // As on background shutdown: to the queue and spool, without network I/O.
+    for (auto &payload : ready_batches_)
+    {
+        enqueue_payload(std::move(payload));
+    }
+}
 
 bool TelemetryWriter::submit(MetricSample sample)
 {
@@ -190,58 +259,200 @@ bool TelemetryWriter::submit(MetricSample sample)
         sample.timestamp_ms = clock_->unix_epoch_ms();
     }
 
-    if (pending_payload_.has_value())
+    add_to_batch(sample, clock_->monotonic_now_ms());
+    return true;
+}
+
+bool TelemetryWriter::submit(const SeriesRegistry &registry, SeriesSample sample)
+{
+    if (!registry.contains(sample.series))
     {
         ++dropped_samples_;
-        log("WARN",
-            "pending payload exists, dropping sample; dropped_samples=" +
-                std::to_string(dropped_samples_));
+        log("WARN", "submit with unknown series id, dropping; id=" +
+                        std::to_string(sample.series));
         return false;
     }
 
-    if (!batch_->add(sample, clock_->monotonic_now_ms()))
+    if (sample.timestamp_ms == 0)
     {
-        ++dropped_samples_;
-        log("WARN",
-            "batch full, dropping sample; dropped_samples=" +
-                std::to_string(dropped_samples_));
-        return false;
+        sample.timestamp_ms = clock_->unix_epoch_ms();
     }
 
+    add_to_batch(registry, sample, clock_->monotonic_now_ms());
     return true;
 }
 
+TelemetryWriter::SubmitResult TelemetryWriter::submit_batch(std::vector<MetricSample> samples)
+{
+    SubmitResult result;
+    if (samples.empty())
+    {
+        return result;
+    }
+
+    int64_t unix_ms = 0;
+    for (auto &sample : samples)
+    {
+        if (sample.timestamp_ms == 0)
+        {
+            if (unix_ms == 0)
+            {
+                unix_ms = clock_->unix_epoch_ms();
+            }
+            sample.timestamp_ms = unix_ms;
+        }
+    }
+
+    const int64_t now_monotonic_ms = clock_->monotonic_now_ms();
+    for (const auto &sample : samples)
+    {
+        add_to_batch(sample, now_monotonic_ms);
+    }
+    result.accepted = samples.size();
+    return result;
+}
+
+TelemetryWriter::SubmitResult TelemetryWriter::submit_batch(
+    const SeriesRegistry &registry,
+    const std::vector<SeriesSample> &samples)
+{
+    SubmitResult result;
+    if (samples.empty())
+    {
+        return result;
+    }
+
+    int64_t unix_ms = 0;
+    const int64_t now_monotonic_ms = clock_->monotonic_now_ms();
+    for (SeriesSample sample : samples)
+    {
+        if (!registry.contains(sample.series))
+        {
+            ++result.dropped;
+            continue;
+        }
+        if (sample.timestamp_ms == 0)
+        {
+            if (unix_ms == 0)
+            {
+                unix_ms = clock_->unix_epoch_ms();
+            }
+            sample.timestamp_ms = unix_ms;
+        }
+        add_to_batch(registry, sample, now_monotonic_ms);
+        ++result.accepted;
+    }
+
+    if (result.dropped > 0)
+    {
+        dropped_samples_ += result.dropped;
+        log("WARN", "submit_batch with unknown series ids, dropping; count=" +
+                        std::to_string(result.dropped));
+    }
+    return result;
+}
+
+void TelemetryWriter::add_to_batch(const MetricSample &sample, int64_t now_monotonic_ms)
+{
+    if (!batch_->add(sample, now_monotonic_ms))
+    {
+        seal_batch();
+        batch_->add(sample, now_monotonic_ms);
+    }
+
+    if (batch_->full())
+    {
+        seal_batch();
+    }
+}
+
+void TelemetryWriter::add_to_batch(const SeriesRegistry &registry,
+                                   const SeriesSample &sample,
+                                   int64_t now_monotonic_ms)
+{
+    if (!batch_->add(registry, sample, now_monotonic_ms))
+    {
+        seal_batch();
+        batch_->add(registry, sample, now_monotonic_ms);
+    }
+
+    if (batch_->full())
+    {
+        seal_batch();
+    }
+}
+
 void TelemetryWriter::tick()
 {
     const int64_t now_monotonic_ms = clock_->monotonic_now_ms();
 
-    if (pending_payload_.has_value())
+    if (sender_thread_.joinable())
     {
-        if (now_monotonic_ms >= next_retry_at_ms_)
+        if (batch_->should_flush(now_monotonic_ms))
         {
-            retry_pending();
+            hand_off_batch();
         }
+        notify_sender();
         return;
     }
 
+    send_due_payloads(now_monotonic_ms);
+
     if (batch_->should_flush(now_monotonic_ms))
     {
         flush_batch();
     }
 }
 
-void TelemetryWriter::force_flush()
+void TelemetryWriter::flush_open_batch()
 {
-    if (pending_payload_.has_value())
+    if (sender_thread_.joinable())
     {
-        retry_pending();
+        hand_off_batch();
         return;
     }
 
-    if (!batch_->empty())
+    seal_batch();
+    send_due_payloads(clock_->monotonic_now_ms());
+}
+
+void TelemetryWriter::send_due_payloads(int64_t now_monotonic_ms)
+{
+    if (!retry_queue_.empty() && now_monotonic_ms >= next_retry_at_ms_)
+    {
+        drain_queue();
+    }
+    send_ready_batches();
+}
+
+void TelemetryWriter::force_flush()
+{
+    if (!sender_thread_.joinable())
     {
+        drain_queue();
         flush_batch();
+        return;
     }
+
+    hand_off_batch();
+    std::unique_lock<std::mutex> lock(sender_mutex_);
+    const std::uint64_t request = ++flush_requests_;
+    ++wake_requests_;
+    sender_wake_.notify_one();
+    sender_idle_.wait(lock, [this, request] { return flushes_handled_ >= request; });
+}
+
+void TelemetryWriter::wait_idle()
+{
+    if (!sender_thread_.joinable())
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(sender_mutex_);
+    const std::uint64_t request = ++wake_requests_;
+    sender_wake_.notify_one();
+    sender_idle_.wait(lock, [this, request] { return wakes_handled_ >= request; });
 }
 
 std::uint64_t TelemetryWriter::sent_batches() const
@@ -271,7 +482,31 @@ std::size_t TelemetryWriter::buffered_samples() const
 
 bool TelemetryWriter::has_pending_payload() const
 {
-    return pending_payload_.has_value();
+    return queued_payload_count_ != 0;
+}
+
+std::size_t TelemetryWriter::queued_payloads() const
+{
+    return queued_payload_count_;
+}
+
+std::size_t TelemetryWriter::queued_payload_bytes() const
+{
+    return queued_payload_bytes_ + ready_payload_bytes_;
+}
+
+int64_t TelemetryWriter::oldest_queued_payload_age_ms() const
+{
+    if (queued_payload_count_ == 0)
+    {
+        return 0;
+    }
+    return clock_->monotonic_now_ms() - oldest_queued_monotonic_ms_;
+}
+
+std::size_t TelemetryWriter::spool_disk_bytes() const
+{
+    return spool_disk_bytes_;
 }
 
 int64_t TelemetryWriter::next_retry_at_ms() const
@@ -284,6 +519,47 @@ int64_t TelemetryWriter::last_success_unix_ms() const
     return last_success_unix_ms_;
 }
 
+std::uint64_t TelemetryWriter::prefix_cache_hits() const
+{
+    const MetricPrefixCache *cache = batch_->prefix_cache();
+    return cache == nullptr ? 0 : cache->hits();
+}
+
+std::uint64_t TelemetryWriter::prefix_cache_misses() const
+{
+    const MetricPrefixCache *cache = batch_->prefix_cache();
+    return cache == nullptr ? 0 : cache->misses();
+}
+
+std::uint64_t TelemetryWriter::prefix_cache_evictions() const
+{
+    const MetricPrefixCache *cache = batch_->prefix_cache();
+    return cache == nullptr ? 0 : cache->evictions();
+}
+
+std::vector<MetricSample> TelemetryWriter::self_metrics() const
+{
+    const auto metric = [](const char *name, double value) {
+        return MetricSample {name, value, {}, 0};
+    };
+
+    return {
+        metric("edge_sender_sent_batches_total", static_cast<double>(sent_batches())),
+        metric("edge_sender_send_failures_total", static_cast<double>(send_failures())),
+        metric("edge_sender_dropped_samples_total", static_cast<double>(dropped_samples())),
+        metric("edge_sender_dropped_batches_total", static_cast<double>(dropped_batches())),
+        metric("edge_sender_queued_payloads", static_cast<double>(queued_payloads())),
+        metric("edge_sender_queued_payload_bytes",
+                static_cast<double>(queued_payload_bytes())),
+        metric("edge_sender_prefix_cache_hits_total",
+                static_cast<double>(prefix_cache_hits())),
+        metric("edge_sender_prefix_cache_misses_total",
+                static_cast<double>(prefix_cache_misses())),
+        metric("edge_sender_prefix_cache_evictions_total",
+                static_cast<double>(prefix_cache_evictions())),
+    };
+}
+
 void TelemetryWriter::flush_batch()
 {
     if (batch_->empty())
@@ -291,79 +567,572 @@ void TelemetryWriter::flush_batch()
         return;
     }
 
-    const std::string payload = batch_->build_json_lines();
-    if (payload.size() > config_.max_pending_payload_bytes)
+    if (sender_thread_.joinable())
     {
-        ++dropped_batches_;
-        log("ERROR",
-            "payload too large, dropping batch; bytes=" +
-                std::to_string(payload.size()) +
-                " dropped_batches=" + std::to_string(dropped_batches_));
-        batch_->clear();
+        hand_off_batch();
         return;
     }
 
-    const auto result = transport_->post_json_lines(config_, payload);
+    seal_batch();
+    send_ready_batches();
+}
+
+bool TelemetryWriter::send_batch(QueuedPayload &payload)
+{
+    const auto result = transport_->post_json_lines(config_, payload.body);
     if (result.ok)
     {
-        ++sent_batches_;
-        last_success_unix_ms_ = clock_->unix_epoch_ms();
         log("INFO",
             "send ok; http_code=" + std::to_string(result.http_code) +
-                " samples=" + std::to_string(batch_->size()) +
-                " bytes=" + std::to_string(payload.size()));
-        batch_->clear();
-        retry_count_ = 0;
-        next_retry_delay_ms_ = 0;
-        next_retry_at_ms_ = 0;
-        return;
+                " samples=" + std::to_string(payload.sample_count) +
+                " bytes=" + std::to_string(payload.body.size()) +
+                " raw_bytes=" + std::to_string(payload.raw_bytes));
+        release_queued(payload);
+        on_send_success();
+        return true;
     }
 
     ++send_failures_;
-    pending_payload_ = payload;
-    pending_payload_sample_count_ = batch_->size();
-    batch_->clear();
+    enqueue_payload(std::move(payload));
     schedule_retry(result);
 
     log("ERROR",
         "send failed, entering retry; http_code=" + std::to_string(result.http_code) +
             " err=" + result.error_message +
             " resp=" + truncate(result.response_body, 256));
+    return false;
 }
 
-void TelemetryWriter::retry_pending()
+void TelemetryWriter::seal_batch()
 {
-    if (!pending_payload_.has_value())
+    if (batch_->empty())
     {
         return;
     }
 
-    const auto result = transport_->post_json_lines(config_, *pending_payload_);
-    if (result.ok)
+    if (sender_thread_.joinable())
     {
-        ++sent_batches_;
-        last_success_unix_ms_ = clock_->unix_epoch_ms();
-        log("INFO",
-            "retry ok; http_code=" + std::to_string(result.http_code) +
-                " samples=" + std::to_string(pending_payload_sample_count_) +
-                " bytes=" + std::to_string(pending_payload_->size()));
-
-        pending_payload_.reset();
-        pending_payload_sample_count_ = 0;
-        retry_count_ = 0;
-        next_retry_delay_ms_ = 0;
-        next_retry_at_ms_ = 0;
+        hand_off_batch();
         return;
     }
 
-    ++send_failures_;
-    schedule_retry(result);
-    log("ERROR",
-        "retry failed; http_code=" + std::to_string(result.http_code) +
-            " retry_count=" + std::to_string(retry_count_) +
-            " next_retry_in_ms=" + std::to_string(next_retry_delay_ms_) +
-            " err=" + result.error_message +
-            " resp=" + truncate(result.response_body, 256));
+    QueuedPayload payload;
+    payload.sample_count = batch_->size();
+    payload.enqueued_monotonic_ms = clock_->monotonic_now_ms();
+    payload.compression = config_.compression;
+    batch_->take_payload(payload.body);
+    batch_->clear();
+    payload.raw_bytes = payload.body.size();
+    if (compressor_ != nullptr)
+    {
+        payload.body.assign(compressor_->compress(payload.body));
+    }
+
+    // Without a tick() the ready list would grow unbounded. It shares the
+    // retry budget with one batch of headroom, so a batch larger than the
+    // budget still goes out; past that the oldest ready batch is dropped.
+    const std::size_t budget = config_.max_retry_queue_bytes + config_.max_pending_payload_bytes;
+    while (!ready_batches_.empty() &&
+           queued_payload_bytes_ + ready_payload_bytes_ + payload.body.size() > budget)
+    {
+        const QueuedPayload &oldest = ready_batches_.front();
+        ready_payload_bytes_ -= oldest.body.size();
+        ++dropped_batches_;
+        log("WARN",
+            "ready batches over budget, dropping oldest batch; samples=" +
+                std::to_string(oldest.sample_count) +
+                " bytes=" + std::to_string(oldest.body.size()) +
+                " dropped_batches=" + std::to_string(dropped_batches_));
+        ready_batches_.pop_front();
+    }
+
+    ready_payload_bytes_ += payload.body.size();
+    ready_batches_.push_back(std::move(payload));
+    update_queue_stats();
+}
+
+void TelemetryWriter::send_ready_batches()
+{
+    // Posted like background hand-offs; behind a non-empty retry queue they
+    // wait their turn there.
+    while (!ready_batches_.empty())
+    {
+        QueuedPayload payload = std::move(ready_batches_.front());
+        ready_batches_.pop_front();
+        ready_payload_bytes_ -= payload.body.size();
+        if (!retry_queue_.empty())
+        {
+            enqueue_payload(std::move(payload));
+            continue;
+        }
+
+        send_window_.push_back(std::move(payload));
+        if (send_window_.size() == max_in_flight_)
+        {
+            send_window();
+        }
+    }
+    update_queue_stats();
+
+    if (!send_window_.empty())
+    {
+        send_window();
+    }
+}
+
+void TelemetryWriter::hand_off_batch()
+{
+    if (batch_->empty())
+    {
+        return;
+    }
+
+    QueuedPayload payload;
+    recycled_bodies_->try_pop(payload.body);
+    payload.sample_count = batch_->size();
+    payload.enqueued_monotonic_ms = clock_->monotonic_now_ms();
+    batch_->take_payload(payload.body);
+    batch_->clear();
+
+    if (!handoff_->try_push(std::move(payload)))
+    {
+        ++dropped_batches_;
+        log("WARN",
+            "sender queue full, dropping batch; samples=" +
+                std::to_string(payload.sample_count) +
+                " dropped_batches=" + std::to_string(dropped_batches_));
+    }
+
+    notify_sender();
+}
+
+void TelemetryWriter::notify_sender()
+{
+    {
+        std::lock_guard<std::mutex> lock(sender_mutex_);
+        ++wake_requests_;
+    }
+    sender_wake_.notify_one();
+}
+
+void TelemetryWriter::run_sender()
+{
+    std::unique_lock<std::mutex> lock(sender_mutex_);
+    while (true)
+    {
+        const std::uint64_t wake_request = wake_requests_;
+        const std::uint64_t flush_request = flush_requests_;
+        const bool stopping = stop_sender_;
+        lock.unlock();
+
+        // On shutdown, hand-offs go to the queue and spool without network I/O.
+        accept_handoffs(!stopping);
+        if (!stopping && !retry_queue_.empty() &&
+            (flush_request != flushes_handled_ ||
+             clock_->monotonic_now_ms() >= next_retry_at_ms_))
+        {
+            drain_queue();
+        }
+
+        lock.lock();
+        wakes_handled_ = wake_request;
+        flushes_handled_ = flush_request;
+        sender_idle_.notify_all();
+        if (stopping)
+        {
+            return;
+        }
+
+        const auto woken = [this] {
+            return stop_sender_ || wake_requests_ != wakes_handled_;
+        };
+        if (retry_queue_.empty())
+        {
+            sender_wake_.wait(lock, woken);
+        }
+        else
+        {
+            const int64_t delay_ms =
+                std::max<int64_t>(1, next_retry_at_ms_ - clock_->monotonic_now_ms());
+            sender_wake_.wait_for(lock, std::chrono::milliseconds(delay_ms), woken);
+        }
+    }
+}
+
+void TelemetryWriter::accept_handoffs(bool send)
+{
+    QueuedPayload payload;
+    while (handoff_->try_pop(payload))
+    {
+        payload.compression = config_.compression;
+        payload.raw_bytes = payload.body.size();
+        if (compressor_ != nullptr)
+        {
+            payload.body.assign(compressor_->compress(payload.body));
+        }
+
+        if (!send || !retry_queue_.empty())
+        {
+            enqueue_payload(std::move(payload));
+            continue;
+        }
+
+        send_window_.push_back(std::move(payload));
+        if (send_window_.size() == max_in_flight_)
+        {
+            send_window();
+        }
+    }
+
+    if (!send_window_.empty())
+    {
+        send_window();
+    }
+}
+
+void TelemetryWriter::send_window()
+{
+    for (auto &payload : send_window_)
+    {
+        spool_payload(payload);
+    }
+
+    if (send_window_.size() == 1)
+    {
+        QueuedPayload &payload = send_window_.front();
+        if (send_batch(payload))
+        {
+            recycle_body(std::move(payload.body));
+        }
+        send_window_.clear();
+        return;
+    }
+
+    window_bodies_.clear();
+    for (const auto &payload : send_window_)
+    {
+        window_bodies_.push_back(&payload.body);
+    }
+    const auto results = transport_->post_many(config_, window_bodies_);
+
+    // Failed batches are queued in their original order; one backoff step
+    // covers the whole window.
+    const HttpTransport::Result *failure = nullptr;
+    for (std::size_t i = 0; i < send_window_.size(); ++i)
+    {
+        QueuedPayload &payload = send_window_[i];
+        const HttpTransport::Result &result = results[i];
+        if (result.ok)
+        {
+            log("INFO",
+                "send ok; http_code=" + std::to_string(result.http_code) +
+                    " samples=" + std::to_string(payload.sample_count) +
+                    " bytes=" + std::to_string(payload.body.size()) +
+                    " raw_bytes=" + std::to_string(payload.raw_bytes));
+            release_queued(payload);
+            on_send_success();
+            recycle_body(std::move(payload.body));
+            continue;
+        }
+
+        ++send_failures_;
+        log("ERROR",
+            "send failed, entering retry; http_code=" + std::to_string(result.http_code) +
+                " err=" + result.error_message +
+                " resp=" + truncate(result.response_body, 256));
+        enqueue_payload(std::move(payload));
+        if (failure == nullptr)
+        {
+            failure = &result;
+        }
+    }
+    if (failure != nullptr)
+    {
+        schedule_retry(*failure);
+    }
+    send_window_.clear();
+}
+
+void TelemetryWriter::recycle_body(std::string body)
+{
+    if (recycled_bodies_ == nullptr)
+    {
+        return;
+    }
+
+    body.clear();
+    recycled_bodies_->try_push(std::move(body));
+}
+
+void TelemetryWriter::update_queue_stats()
+{
+    queued_payload_count_ = retry_queue_.size() + ready_batches_.size() + spilled_.size();
+    int64_t oldest = 0;
+    for (const auto *queue : {&retry_queue_, &ready_batches_, &spilled_})
+    {
+        if (!queue->empty() && (oldest == 0 || queue->front().enqueued_monotonic_ms < oldest))
+        {
+            oldest = queue->front().enqueued_monotonic_ms;
+        }
+    }
+    oldest_queued_monotonic_ms_ = oldest;
+    if (spool_ != nullptr)
+    {
+        spool_disk_bytes_ = spool_->disk_bytes();
+    }
+}
+
+void TelemetryWriter::spool_payload(QueuedPayload &payload)
+{
+    if (spool_ == nullptr || payload.spool_id != 0 ||
+        payload.body.size() > config_.max_retry_queue_bytes)
+    {
+        return;
+    }
+
+    const auto spool_id = spool_->append(payload.body,
+                                         payload.sample_count,
+                                         clock_->unix_epoch_ms(),
+                                         spool_encoding(config_.payload_format,
+                                                        payload.compression));
+    if (spool_id.has_value())
+    {
+        payload.spool_id = *spool_id;
+    }
+    else
+    {
+        log("WARN",
+            "spool append failed, payload kept in memory only; bytes=" +
+                std::to_string(payload.body.size()));
+    }
+}
+
+void TelemetryWriter::enqueue_payload(QueuedPayload payload)
+{
+    payload.enqueued_monotonic_ms = clock_->monotonic_now_ms();
+    spool_payload(payload);
+    admit_to_queue(std::move(payload));
+}
+
+void TelemetryWriter::admit_to_queue(QueuedPayload payload)
+{
+    if (payload.body.size() > config_.max_retry_queue_bytes)
+    {
+        ++dropped_batches_;
+        log("ERROR",
+            "payload exceeds retry queue budget, dropping batch; bytes=" +
+                std::to_string(payload.body.size()) +
+                " dropped_batches=" + std::to_string(dropped_batches_));
+        release_queued(payload);
+        update_queue_stats();
+        return;
+    }
+
+    // A spooled payload over the memory budget waits on disk behind the ones
+    // already there; reload_spilled() brings it back in order.
+    if (payload.spool_id != 0 &&
+        (!spilled_.empty() ||
+         queued_payload_bytes_ + payload.body.size() > config_.max_retry_queue_bytes))
+    {
+        payload.spilled_bytes = payload.body.size();
+        payload.body = std::string();
+        spilled_.push_back(std::move(payload));
+        update_queue_stats();
+        return;
+    }
+
+    while (!retry_queue_.empty() &&
+           queued_payload_bytes_ + payload.body.size() > config_.max_retry_queue_bytes)
+    {
+        QueuedPayload &oldest = retry_queue_.front();
+        queued_payload_bytes_ -= oldest.body.size();
+        if (oldest.spool_id != 0)
+        {
+            // Still on disk: only its memory is given up.
+            oldest.spilled_bytes = oldest.body.size();
+            oldest.body = std::string();
+            spilled_.push_front(std::move(oldest));
+            retry_queue_.pop_front();
+            continue;
+        }
+
+        ++dropped_batches_;
+        log("WARN",
+            "retry queue full, evicting oldest payload; samples=" +
+                std::to_string(oldest.sample_count) +
+                " bytes=" + std::to_string(oldest.body.size()) +
+                " dropped_batches=" + std::to_string(dropped_batches_));
+        retry_queue_.pop_front();
+    }
+
+    queued_payload_bytes_ += payload.body.size();
+    retry_queue_.push_back(std::move(payload));
+    update_queue_stats();
+}
+
+void TelemetryWriter::release_queued(const QueuedPayload &payload)
+{
+    if (spool_ != nullptr && payload.spool_id != 0)
+    {
+        spool_->ack(payload.spool_id);
+    }
+}
+
+void TelemetryWriter::reload_spilled()
+{
+    PayloadSpool::Record record;
+    while (!spilled_.empty() &&
+           (retry_queue_.empty() ||
+            queued_payload_bytes_ + spilled_.front().spilled_bytes <=
+                config_.max_retry_queue_bytes))
+    {
+        QueuedPayload payload = std::move(spilled_.front());
+        spilled_.pop_front();
+        if (!spool_->read(payload.spool_id, record))
+        {
+            // Evicted to keep the spool within max_spool_bytes.
+            ++dropped_batches_;
+            log("WARN",
+                "spilled payload no longer in spool, dropping batch; samples=" +
+                    std::to_string(payload.sample_count) +
+                    " dropped_batches=" + std::to_string(dropped_batches_));
+            continue;
+        }
+
+        payload.body = std::move(record.body);
+        payload.spilled_bytes = 0;
+        queued_payload_bytes_ += payload.body.size();
+        retry_queue_.push_back(std::move(payload));
+    }
+    update_queue_stats();
+}
+
+void TelemetryWriter::recover_spool()
+{
+    auto records = spool_->take_recovered();
+    if (records.empty())
+    {
+        return;
+    }
+
+    const int64_t now_monotonic_ms = clock_->monotonic_now_ms();
+    const int64_t now_unix_ms = clock_->unix_epoch_ms();
+    for (auto &record : records)
+    {
+        const std::uint32_t compression = record.encoding & 0xFF;
+        if (compression > static_cast<std::uint32_t>(PayloadCompression::snappy) ||
+            (record.encoding >> 8) != static_cast<std::uint32_t>(config_.payload_format))
+        {
+            log("WARN",
+                "spooled payload has unknown encoding or another payload format, "
+                "discarding; encoding=" +
+                    std::to_string(record.encoding));
+            spool_->ack(record.id);
+            continue;
+        }
+
+        QueuedPayload payload;
+        payload.body = std::move(record.body);
+        payload.sample_count = record.sample_count;
+        payload.enqueued_monotonic_ms =
+            now_monotonic_ms - std::max<int64_t>(0, now_unix_ms - record.enqueued_unix_ms);
+        payload.spool_id = record.id;
+        payload.compression = static_cast<PayloadCompression>(compression);
+        admit_to_queue(std::move(payload));
+    }
+
+    log("INFO",
+        "recovered payloads from spool; payloads=" + std::to_string(retry_queue_.size()) +
+            " bytes=" + std::to_string(queued_payload_bytes_) +
+            " on_disk=" + std::to_string(spilled_.size()));
+}
+
+void TelemetryWriter::drain_queue()
+{
+    while (!retry_queue_.empty())
+    {
+        // A window is the queue head plus the payloads behind it that were
+        // encoded the same way.
+        const PayloadCompression compression = retry_queue_.front().compression;
+        window_bodies_.clear();
+        for (const auto &payload : retry_queue_)
+        {
+            if (window_bodies_.size() == max_in_flight_ || payload.compression != compression)
+            {
+                break;
+            }
+            window_bodies_.push_back(&payload.body);
+        }
+        const auto results = post_payloads(window_bodies_, compression);
+
+        // Delivered payloads leave the queue wherever they sit; failed ones
+        // keep their order at the front.
+        const HttpTransport::Result *failure = nullptr;
+        std::size_t position = 0;
+        for (const auto &result : results)
+        {
+            QueuedPayload &payload = retry_queue_[position];
+            if (!result.ok)
+            {
+                ++send_failures_;
+                if (failure == nullptr)
+                {
+                    failure = &result;
+                }
+                ++position;
+                continue;
+            }
+
+            log("INFO",
+                "retry ok; http_code=" + std::to_string(result.http_code) +
+                    " samples=" + std::to_string(payload.sample_count) +
+                    " bytes=" + std::to_string(payload.body.size()));
+            queued_payload_bytes_ -= payload.body.size();
+            release_queued(payload);
+            std::string body = std::move(payload.body);
+            retry_queue_.erase(retry_queue_.begin() + static_cast<std::ptrdiff_t>(position));
+            recycle_body(std::move(body));
+            on_send_success();
+        }
+        reload_spilled();
+
+        if (failure != nullptr)
+        {
+            schedule_retry(*failure);
+            log("ERROR",
+                "retry failed; http_code=" + std::to_string(failure->http_code) +
+                    " retry_count=" + std::to_string(retry_count_) +
+                    " next_retry_in_ms=" + std::to_string(next_retry_delay_ms_) +
+                    " queued_payloads=" + std::to_string(queued_payload_count_) +
+                    " err=" + failure->error_message +
+                    " resp=" + truncate(failure->response_body, 256));
+            return;
+        }
+    }
+}
+
+std::vector<HttpTransport::Result> TelemetryWriter::post_payloads(
+    const std::vector<const std::string *> &bodies,
+    PayloadCompression compression)
+{
+    if (compression == config_.compression)
+    {
+        return transport_->post_many(config_, bodies);
+    }
+
+    // Spooled by a process that ran with a different compression setting.
+    TelemetryConfig config = config_;
+    config.compression = compression;
+    return transport_->post_many(config, bodies);
+}
+
+void TelemetryWriter::on_send_success()
+{
+    ++sent_batches_;
+    last_success_unix_ms_ = clock_->unix_epoch_ms();
+    retry_count_ = 0;
+    next_retry_delay_ms_ = 0;
+    next_retry_at_ms_ = 0;
 }
 
 void TelemetryWriter::schedule_retry(const HttpTransport::Result &result)
@@ -399,7 +1168,8 @@ std::string TelemetryWriter::truncate(const std::string &value, std::size_t max_
 
 void TelemetryWriter::log(const std::string &level, const std::string &message)
 {
-    std::cerr << "[" << level << "] " << message << '\n';
+    // One write per line keeps lines whole when the sender thread logs too.
+    std::cerr << ("[" + level + "] " + message + "\n");
 }
 
 }  // namespace edge_probe
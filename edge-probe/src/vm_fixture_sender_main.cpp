@@ -1,10 +1,15 @@
 #include "edge_probe/collectors.h"
-#include "edge_probe/curl_http_transport.h"
+#include "edge_probe/payload_compressor.h"
+#include "edge_probe/socket_http_transport.h"
 #include "edge_probe/telemetry_sender.h"
 
+#if defined(EDGE_PROBE_HAVE_CURL)
+#include "edge_probe/curl_http_transport.h"
+#endif
+
 #include <fstream>
 #include <iostream>
-#include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -52,100 +57,61 @@ std::string slice_lines(const std::vector<std::string> &lines, int first_line, i
     return output;
 }
 
-void append_metrics(std::vector<MetricSample> &target,
-                    std::vector<MetricSample> source,
-                    const std::map<std::string, std::string> &extra_labels)
+void append_metrics(std::vector<MetricSample> &target, std::vector<MetricSample> source)
 {
     for (auto &sample : source)
     {
-        for (const auto &[key, value] : extra_labels)
-        {
-            sample.labels.emplace(key, value);
-        }
         target.push_back(std::move(sample));
     }
 }
 
-std::vector<MetricSample> collect_cmd_fixture_metrics(const std::string &path,
-                                                      const std::string &device_label)
+std::vector<MetricSample> collect_cmd_fixture_metrics(const std::string &path)
 {
     const auto lines = load_lines(path);
     std::vector<MetricSample> metrics;
 
-    const std::map<std::string, std::string> extra_labels {
-        {"fixture", "cmd_txt"},
-        {"device", device_label},
-    };
-
     append_metrics(metrics,
                    edge_probe::parse_system_identity(slice_lines(lines, 6, 6),
                                                      slice_lines(lines, 7, 15),
                                                      slice_lines(lines, 16, 16),
-                                                     slice_lines(lines, 17, 18)),
-                   extra_labels);
-    append_metrics(metrics, edge_probe::parse_ip_br_link(slice_lines(lines, 27, 31)),
-                   extra_labels);
-    append_metrics(metrics, edge_probe::parse_ip_br_addr(slice_lines(lines, 32, 36)),
-                   extra_labels);
-    append_metrics(metrics, edge_probe::parse_ip_route(slice_lines(lines, 37, 41)),
-                   extra_labels);
-    append_metrics(metrics, edge_probe::parse_iw_dev(slice_lines(lines, 52, 58)),
-                   extra_labels);
-    append_metrics(metrics, edge_probe::parse_iw_phy(slice_lines(lines, 59, 295)),
-                   extra_labels);
-    append_metrics(metrics,
-                   edge_probe::parse_service_list_units(slice_lines(lines, 311, 313)),
-                   extra_labels);
+                                                     slice_lines(lines, 17, 18)));
+    append_metrics(metrics, edge_probe::parse_ip_br_link(slice_lines(lines, 27, 31)));
+    append_metrics(metrics, edge_probe::parse_ip_br_addr(slice_lines(lines, 32, 36)));
+    append_metrics(metrics, edge_probe::parse_ip_route(slice_lines(lines, 37, 41)));
+    append_metrics(metrics, edge_probe::parse_iw_dev(slice_lines(lines, 52, 58)));
+    append_metrics(metrics, edge_probe::parse_iw_phy(slice_lines(lines, 59, 295)));
+    append_metrics(metrics, edge_probe::parse_service_list_units(slice_lines(lines, 311, 313)));
     append_metrics(metrics,
-                   edge_probe::parse_systemd_status("hostapd", slice_lines(lines, 314, 331)),
-                   extra_labels);
+                   edge_probe::parse_systemd_status("hostapd", slice_lines(lines, 314, 331)));
     append_metrics(metrics,
-                   edge_probe::parse_systemd_status("dnsmasq", slice_lines(lines, 332, 346)),
-                   extra_labels);
+                   edge_probe::parse_systemd_status("dnsmasq", slice_lines(lines, 332, 346)));
     append_metrics(
         metrics,
-        edge_probe::parse_systemd_status("NetworkManager", slice_lines(lines, 347, 368)),
-        extra_labels);
-    append_metrics(metrics,
-                   edge_probe::parse_command_path("hostapd_cli", slice_lines(lines, 369, 369)),
-                   extra_labels);
+        edge_probe::parse_systemd_status("NetworkManager", slice_lines(lines, 347, 368)));
     append_metrics(metrics,
-                   edge_probe::parse_command_path("nmcli", slice_lines(lines, 370, 370)),
-                   extra_labels);
+                   edge_probe::parse_command_path("hostapd_cli", slice_lines(lines, 369, 369)));
     append_metrics(metrics,
-                   edge_probe::parse_dnsmasq_leases(slice_lines(lines, 377, 377)),
-                   extra_labels);
-    append_metrics(metrics, edge_probe::parse_mmcli_snapshot("", "", ""), extra_labels);
+                   edge_probe::parse_command_path("nmcli", slice_lines(lines, 370, 370)));
+    append_metrics(metrics, edge_probe::parse_dnsmasq_leases(slice_lines(lines, 377, 377)));
+    append_metrics(metrics, edge_probe::parse_mmcli_snapshot("", "", ""));
     append_metrics(metrics,
-                   edge_probe::parse_nmcli_device_status(slice_lines(lines, 386, 390)),
-                   extra_labels);
+                   edge_probe::parse_nmcli_device_status(slice_lines(lines, 386, 390)));
     append_metrics(
-        metrics, edge_probe::parse_device_node_listing(slice_lines(lines, 398, 398), ""),
-        extra_labels);
-    append_metrics(metrics, edge_probe::parse_loadavg(slice_lines(lines, 405, 405)),
-                   extra_labels);
-    append_metrics(metrics, edge_probe::parse_meminfo(slice_lines(lines, 406, 425)),
-                   extra_labels);
-    append_metrics(metrics, edge_probe::parse_proc_net_dev(slice_lines(lines, 426, 432)),
-                   extra_labels);
+        metrics, edge_probe::parse_device_node_listing(slice_lines(lines, 398, 398), ""));
+    append_metrics(metrics, edge_probe::parse_loadavg(slice_lines(lines, 405, 405)));
+    append_metrics(metrics, edge_probe::parse_meminfo(slice_lines(lines, 406, 425)));
+    append_metrics(metrics, edge_probe::parse_proc_net_dev(slice_lines(lines, 426, 432)));
     append_metrics(metrics,
                    edge_probe::parse_thermal_zone_temp(slice_lines(lines, 433, 433),
-                                                       "thermal_zone0"),
-                   extra_labels);
-    append_metrics(metrics,
-                   edge_probe::parse_command_path("iptables", slice_lines(lines, 484, 484)),
-                   extra_labels);
-    append_metrics(metrics,
-                   edge_probe::parse_iptables(slice_lines(lines, 485, 553)), extra_labels);
+                                                       "thermal_zone0"));
     append_metrics(metrics,
-                   edge_probe::parse_command_path("nft", slice_lines(lines, 554, 554)),
-                   extra_labels);
+                   edge_probe::parse_command_path("iptables", slice_lines(lines, 484, 484)));
+    append_metrics(metrics, edge_probe::parse_iptables(slice_lines(lines, 485, 553)));
     append_metrics(metrics,
-                   edge_probe::parse_nft_ruleset(slice_lines(lines, 555, 691)),
-                   extra_labels);
-    append_metrics(metrics, edge_probe::parse_command_path("conntrack", ""), extra_labels);
-    append_metrics(metrics, edge_probe::parse_ip_neigh(slice_lines(lines, 698, 699)),
-                   extra_labels);
+                   edge_probe::parse_command_path("nft", slice_lines(lines, 554, 554)));
+    append_metrics(metrics, edge_probe::parse_nft_ruleset(slice_lines(lines, 555, 691)));
+    append_metrics(metrics, edge_probe::parse_command_path("conntrack", ""));
+    append_metrics(metrics, edge_probe::parse_ip_neigh(slice_lines(lines, 698, 699)));
 
     return metrics;
 }
@@ -176,15 +142,83 @@ bool has_flag(const std::vector<std::string> &args, const std::string &name)
     return false;
 }
 
+// remote-write bodies are always snappy; /api/v1/import takes gzip or zstd.
+edge_probe::PayloadCompression parse_compression(const std::string &value,
+                                                 edge_probe::PayloadFormat format)
+{
+    const bool remote_write = format == edge_probe::PayloadFormat::remote_write;
+    if (value == "none")
+    {
+        return edge_probe::PayloadCompression::none;
+    }
+    if (value == "snappy")
+    {
+        if (!remote_write)
+        {
+            throw std::invalid_argument(
+                "--compression snappy requires --payload-format remote-write");
+        }
+        return edge_probe::PayloadCompression::snappy;
+    }
+    if (value != "gzip" && value != "zstd")
+    {
+        throw std::invalid_argument("unknown compression: " + value);
+    }
+    if (remote_write)
+    {
+        throw std::invalid_argument(
+            "--payload-format remote-write takes --compression snappy or none, got " + value);
+    }
+    const auto compression = value == "gzip" ? edge_probe::PayloadCompression::gzip
+                                             : edge_probe::PayloadCompression::zstd;
+    if (!edge_probe::PayloadCompressor::supported(compression))
+    {
+        throw std::invalid_argument("--compression " + value + " is not available in this build");
+    }
+    return compression;
+}
+
+edge_probe::PayloadFormat parse_payload_format(const std::string &value)
+{
+    if (value == "json")
+    {
+        return edge_probe::PayloadFormat::json_lines;
+    }
+    if (value == "remote-write")
+    {
+        return edge_probe::PayloadFormat::remote_write;
+    }
+    throw std::invalid_argument("unknown payload format: " + value);
+}
+
+std::shared_ptr<edge_probe::HttpTransport> make_transport(const std::string &value)
+{
+    if (value == "socket")
+    {
+        return std::make_shared<edge_probe::SocketHttpTransport>();
+    }
+#if defined(EDGE_PROBE_HAVE_CURL)
+    if (value == "curl")
+    {
+        return std::make_shared<edge_probe::CurlHttpTransport>();
+    }
+#endif
+    throw std::invalid_argument("unknown or unavailable transport: " + value);
+}
+
 void print_usage()
 {
     std::cerr
         << "Usage: edge_probe_vm_fixture_sender [options]\n"
         << "  --fixture PATH\n"
         << "  --endpoint URL\n"
+        << "  --unix-socket PATH\n"
         << "  --username USER\n"
         << "  --password PASS\n"
         << "  --device-label DEVICE\n"
+        << "  --payload-format json|remote-write\n"
+        << "  --compression none|gzip|zstd (json) or none|snappy (remote-write)\n"
+        << "  --transport curl|socket\n"
         << "  --insecure\n";
 }
 
@@ -211,7 +245,7 @@ int main(int argc, char **argv)
         const std::string device_label =
             read_option(args, "--device-label", "busstop-001");
 
-        const auto metrics = collect_cmd_fixture_metrics(fixture_path, device_label);
+        const auto metrics = collect_cmd_fixture_metrics(fixture_path);
         if (metrics.empty())
         {
             std::cerr << "no metrics were generated from fixture\n";
@@ -219,21 +253,36 @@ int main(int argc, char **argv)
         }
 
         edge_probe::TelemetryConfig config;
-        config.endpoint =
-            read_option(args, "--endpoint", "http://127.0.0.1:8428/api/v1/import");
+        config.payload_format =
+            parse_payload_format(read_option(args, "--payload-format", "json"));
+        const bool remote_write =
+            config.payload_format == edge_probe::PayloadFormat::remote_write;
+        config.endpoint = read_option(args,
+                                      "--endpoint",
+                                      remote_write ? "http://127.0.0.1:8428/api/v1/write"
+                                                   : "http://127.0.0.1:8428/api/v1/import");
+        config.unix_socket_path = read_option(args, "--unix-socket");
         config.username = read_option(args, "--username");
         config.password = read_option(args, "--password");
+        config.external_labels = {{"fixture", "cmd_txt"}, {"device", device_label}};
         config.max_batch_samples = metrics.size() + 1;
         config.flush_interval_ms = 1000;
         config.retry_initial_ms = 1000;
         config.retry_max_ms = 5000;
         config.max_pending_payload_bytes = 1024 * 1024;
+        config.compression =
+            parse_compression(read_option(args, "--compression", "none"), config.payload_format);
         config.connect_timeout_sec = 5;
         config.request_timeout_sec = 10;
         config.verify_peer = !has_flag(args, "--insecure");
         config.verify_host = !has_flag(args, "--insecure");
 
-        auto transport = std::make_shared<edge_probe::CurlHttpTransport>();
+#if defined(EDGE_PROBE_HAVE_CURL)
+        const char *default_transport = "curl";
+#else
+        const char *default_transport = "socket";
+#endif
+        auto transport = make_transport(read_option(args, "--transport", default_transport));
         edge_probe::TelemetryWriter writer(config, transport);
 
         std::size_t accepted = 0;
@@ -253,7 +302,9 @@ int main(int argc, char **argv)
                   << "sent_batches=" << writer.sent_batches() << '\n'
                   << "send_failures=" << writer.send_failures() << '\n'
                   << "dropped_samples=" << writer.dropped_samples() << '\n'
-                  << "dropped_batches=" << writer.dropped_batches() << '\n';
+                  << "dropped_batches=" << writer.dropped_batches() << '\n'
+                  << "prefix_cache_hits=" << writer.prefix_cache_hits() << '\n'
+                  << "prefix_cache_misses=" << writer.prefix_cache_misses() << '\n';
 
         if (writer.sent_batches() == 0 || writer.send_failures() != 0 ||
             writer.has_pending_payload() || writer.dropped_samples() != 0 ||
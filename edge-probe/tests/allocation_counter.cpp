@@ -0,0 +1,146 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+
+thread_local std::uint64_t t_allocation_count = 0;
+
+// Every replaced form counts here and frees with std::free, so memory from
+// any new is released by any delete the standard library pairs with it.
+void *counted_allocate(std::size_t size) noexcept
+{
+    ++t_allocation_count;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *counted_allocate(std::size_t size, std::align_val_t alignment) noexcept
+{
+    ++t_allocation_count;
+    const auto align = static_cast<std::size_t>(alignment);
+    // aligned_alloc wants a size that is a multiple of the alignment.
+    const std::size_t rounded = (size == 0 ? 1 : size) + align - 1;
+    return std::aligned_alloc(align, rounded - rounded % align);
+}
+
+}  // namespace
+
+void *operator new(std::size_t size)
+{
+    if (void *ptr = counted_allocate(size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_allocate(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void *ptr = counted_allocate(size, alignment))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return ::operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return counted_allocate(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return counted_allocate(size, alignment);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+namespace edge_probe_testing
+{
+
+std::uint64_t thread_allocation_count()
+{
+    return t_allocation_count;
+}
+
+}  // namespace edge_probe_testing
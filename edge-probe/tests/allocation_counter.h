@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+namespace edge_probe_testing
+{
+
+// Heap allocations made so far by the calling thread. Counting per thread
+// keeps servers left running by other tests out of a measurement.
+std::uint64_t thread_allocation_count();
+
+}  // namespace edge_probe_testing
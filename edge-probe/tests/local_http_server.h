@@ -0,0 +1,389 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace edge_probe_testing
+{
+
+// Minimal HTTP/1.1 endpoint on 127.0.0.1, or on a unix socket, for transport
+// tests and benchmarks.
+// One poll() thread serves every connection and keeps it open between
+// requests. Each request is answered after the delay with the status the
+// responder returns; 0 resets the connection unanswered.
+class LocalHttpServer
+{
+public:
+    struct Request
+    {
+        std::string method;
+        std::string target;
+        // Header names are lower-cased.
+        std::map<std::string, std::string> headers;
+        std::string body;
+        std::size_t connection {0};
+    };
+
+    // Status and delay for one request; status 0 closes the connection.
+    struct Reply
+    {
+        int status {204};
+        int delay_ms {0};
+    };
+
+    using Responder = std::function<int(const Request &)>;
+    using ReplyResponder = std::function<Reply(const Request &)>;
+
+    explicit LocalHttpServer(Responder responder = [](const Request &) { return 204; },
+                             int response_delay_ms = 0)
+        : LocalHttpServer(ReplyResponder([responder, response_delay_ms](const Request &request) {
+              return Reply {responder(request), response_delay_ms};
+          }))
+    {
+    }
+
+    // port 0 picks a free one.
+    explicit LocalHttpServer(ReplyResponder responder, int port = 0)
+        : responder_(std::move(responder))
+    {
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        listen_on(reinterpret_cast<sockaddr *>(&address), sizeof(address));
+
+        socklen_t length = sizeof(address);
+        ::getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&address), &length);
+        port_ = ntohs(address.sin_port);
+        thread_ = std::thread([this] { run(); });
+    }
+
+    // Listens on an AF_UNIX socket instead, replacing any file at the path.
+    LocalHttpServer(ReplyResponder responder, std::string unix_socket_path)
+        : responder_(std::move(responder)), unix_socket_path_(std::move(unix_socket_path))
+    {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        if (unix_socket_path_.size() >= sizeof(address.sun_path))
+        {
+            throw std::runtime_error("unix socket path too long: " + unix_socket_path_);
+        }
+        std::memcpy(address.sun_path, unix_socket_path_.data(), unix_socket_path_.size());
+        ::unlink(unix_socket_path_.c_str());
+        listen_on(reinterpret_cast<sockaddr *>(&address), sizeof(address));
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~LocalHttpServer()
+    {
+        stop_ = true;
+        thread_.join();
+        for (const auto &connection : connections_)
+        {
+            ::close(connection.fd);
+        }
+        ::close(listen_fd_);
+        if (!unix_socket_path_.empty())
+        {
+            ::unlink(unix_socket_path_.c_str());
+        }
+    }
+
+    LocalHttpServer(const LocalHttpServer &) = delete;
+    LocalHttpServer &operator=(const LocalHttpServer &) = delete;
+
+    int port() const
+    {
+        return port_;
+    }
+
+    // Over a unix socket the host only fills the Host header.
+    std::string url(const std::string &path) const
+    {
+        if (!unix_socket_path_.empty())
+        {
+            return "http://localhost" + path;
+        }
+        return "http://127.0.0.1:" + std::to_string(port_) + path;
+    }
+
+    const std::string &unix_socket_path() const
+    {
+        return unix_socket_path_;
+    }
+
+    std::size_t accepted_connections() const
+    {
+        return accepted_.load();
+    }
+
+    // Most requests that were waiting for their response at the same time.
+    std::size_t max_pending_responses() const
+    {
+        return max_pending_.load();
+    }
+
+    // Body sent with every later response; chunked splits it in two chunks.
+    void set_response_body(std::string body, bool chunked)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        response_body_ = std::move(body);
+        chunked_response_ = chunked;
+    }
+
+    // Keeps requests() from growing without bound under sustained load.
+    void set_record_requests(bool record)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        record_requests_ = record;
+    }
+
+    std::vector<Request> requests() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return requests_;
+    }
+
+private:
+    using SteadyClock = std::chrono::steady_clock;
+
+    struct PendingResponse
+    {
+        SteadyClock::time_point due;
+        int status {0};
+    };
+
+    struct Connection
+    {
+        int fd {-1};
+        std::size_t index {0};
+        std::string input;
+        std::deque<PendingResponse> pending;
+    };
+
+    void listen_on(const sockaddr *address, socklen_t length)
+    {
+        listen_fd_ = ::socket(address->sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const int enable = 1;
+        if (listen_fd_ < 0 ||
+            (address->sa_family == AF_INET &&
+             ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) != 0) ||
+            ::bind(listen_fd_, address, length) != 0 || ::listen(listen_fd_, 64) != 0)
+        {
+            if (listen_fd_ >= 0)
+            {
+                ::close(listen_fd_);
+            }
+            throw std::runtime_error("local http server failed to listen");
+        }
+    }
+
+    void run()
+    {
+        while (!stop_)
+        {
+            std::vector<pollfd> fds {{listen_fd_, POLLIN, 0}};
+            int timeout_ms = 10;
+            const auto now = SteadyClock::now();
+            for (const auto &connection : connections_)
+            {
+                fds.push_back({connection.fd, POLLIN, 0});
+                if (!connection.pending.empty())
+                {
+                    const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        connection.pending.front().due - now);
+                    timeout_ms = std::max(0, std::min<int>(timeout_ms, wait.count()));
+                }
+            }
+            ::poll(fds.data(), fds.size(), timeout_ms);
+
+            if ((fds[0].revents & POLLIN) != 0)
+            {
+                const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd >= 0)
+                {
+                    connections_.push_back({fd, accepted_++, {}, {}});
+                }
+            }
+            for (std::size_t i = 1; i < fds.size(); ++i)
+            {
+                Connection &connection = connections_[i - 1];
+                if ((fds[i].revents != 0 && !receive(connection)) || !respond(connection))
+                {
+                    pending_count_ -= connection.pending.size();
+                    ::close(connection.fd);
+                    connection.fd = -1;
+                }
+            }
+            connections_.erase(std::remove_if(connections_.begin(),
+                                              connections_.end(),
+                                              [](const Connection &c) { return c.fd < 0; }),
+                               connections_.end());
+        }
+    }
+
+    // Reads and queues complete requests; returns false once the peer is gone.
+    bool receive(Connection &connection)
+    {
+        char buffer[16384];
+        const ssize_t received = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+        {
+            return false;
+        }
+        connection.input.append(buffer, static_cast<std::size_t>(received));
+
+        while (true)
+        {
+            const auto header_end = connection.input.find("\r\n\r\n");
+            if (header_end == std::string::npos)
+            {
+                return true;
+            }
+
+            Request request;
+            request.connection = connection.index;
+            std::istringstream head(connection.input.substr(0, header_end));
+            std::string line;
+            std::getline(head, line);
+            std::istringstream request_line(line);
+            request_line >> request.method >> request.target;
+            while (std::getline(head, line))
+            {
+                const auto colon = line.find(':');
+                if (colon == std::string::npos)
+                {
+                    continue;
+                }
+                std::string name = line.substr(0, colon);
+                std::transform(name.begin(), name.end(), name.begin(), [](unsigned char ch) {
+                    return static_cast<char>(std::tolower(ch));
+                });
+                std::string value = line.substr(colon + 1);
+                value.erase(0, value.find_first_not_of(' '));
+                while (!value.empty() && (value.back() == '\r' || value.back() == ' '))
+                {
+                    value.pop_back();
+                }
+                request.headers[name] = value;
+            }
+
+            const auto length = request.headers.find("content-length");
+            const std::size_t body_size =
+                length == request.headers.end() ? 0 : std::stoul(length->second);
+            if (connection.input.size() < header_end + 4 + body_size)
+            {
+                return true;
+            }
+            request.body = connection.input.substr(header_end + 4, body_size);
+            connection.input.erase(0, header_end + 4 + body_size);
+
+            const Reply reply = responder_(request);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (record_requests_)
+                {
+                    requests_.push_back(std::move(request));
+                }
+            }
+            connection.pending.push_back(
+                {SteadyClock::now() + std::chrono::milliseconds(reply.delay_ms), reply.status});
+            const std::size_t pending = ++pending_count_;
+            std::size_t seen = max_pending_.load();
+            while (pending > seen && !max_pending_.compare_exchange_weak(seen, pending))
+            {
+            }
+        }
+    }
+
+    // Sends the responses that are due; returns false once the connection
+    // should be closed.
+    bool respond(Connection &connection)
+    {
+        const auto now = SteadyClock::now();
+        while (!connection.pending.empty() && connection.pending.front().due <= now)
+        {
+            const int status = connection.pending.front().status;
+            connection.pending.pop_front();
+            --pending_count_;
+            if (status == 0)
+            {
+                // Abortive close, so the client sees a reset rather than EOF.
+                const linger abort {1, 0};
+                ::setsockopt(connection.fd, SOL_SOCKET, SO_LINGER, &abort, sizeof(abort));
+                return false;
+            }
+            const std::string response = format_response(status);
+            if (::send(connection.fd, response.data(), response.size(), MSG_NOSIGNAL) !=
+                static_cast<ssize_t>(response.size()))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string format_response(int status) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string response = "HTTP/1.1 " + std::to_string(status) + " Status\r\n";
+        if (!chunked_response_)
+        {
+            return response + "Content-Length: " + std::to_string(response_body_.size()) +
+                   "\r\n\r\n" + response_body_;
+        }
+
+        response += "Transfer-Encoding: chunked\r\n\r\n";
+        const std::size_t half = response_body_.size() / 2;
+        for (const std::string &chunk :
+             {response_body_.substr(0, half), response_body_.substr(half)})
+        {
+            if (!chunk.empty())
+            {
+                std::ostringstream size;
+                size << std::hex << chunk.size();
+                response += size.str() + ";ext=1\r\n" + chunk + "\r\n";
+            }
+        }
+        return response + "0\r\nX-Trailer: done\r\n\r\n";
+    }
+
+    ReplyResponder responder_;
+    std::string unix_socket_path_;
+    int listen_fd_ {-1};
+    int port_ {0};
+    std::atomic<bool> stop_ {false};
+    std::atomic<std::size_t> accepted_ {0};
+    std::atomic<std::size_t> pending_count_ {0};
+    std::atomic<std::size_t> max_pending_ {0};
+    std::vector<Connection> connections_;
+    mutable std::mutex mutex_;
+    std::vector<Request> requests_;
+    bool record_requests_ {true};
+    std::string response_body_;
+    bool chunked_response_ {false};
+    std::thread thread_;
+};
+
+}  // namespace edge_probe_testing
@@ -1,27 +1,79 @@
 #include "edge_probe/collectors.h"
+#include "edge_probe/json_lines_encoder.h"
+#include "edge_probe/metric_prefix_cache.h"
+#include "edge_probe/nl80211_collector.h"
+#include "edge_probe/payload_spool.h"
+#include "edge_probe/remote_write_encoder.h"
+#include "edge_probe/rtnetlink_collector.h"
+#include "edge_probe/series_registry.h"
+#include "edge_probe/snappy.h"
+#include "edge_probe/socket_http_transport.h"
+#include "edge_probe/spsc_ring.h"
+#include "edge_probe/system_health_reader.h"
 #include "edge_probe/telemetry_sender.h"
+#include "allocation_counter.h"
+#include "fake_vm.h"
+#include "local_http_server.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include <linux/if.h>
+#include <linux/neighbour.h>
+#include <linux/rtnetlink.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(EDGE_PROBE_HAVE_CURL)
+#include "edge_probe/curl_http_transport.h"
+#endif
+
 namespace
 {
 
 using edge_probe::Clock;
 using edge_probe::CommandSpec;
 using edge_probe::HttpTransport;
+using edge_probe::LabelSet;
 using edge_probe::MetricSample;
+using edge_probe::PayloadCompression;
+using edge_probe::PayloadCompressor;
+using edge_probe::PayloadFormat;
+using edge_probe::PayloadSpool;
+using edge_probe::SeriesRegistry;
+using edge_probe::SeriesSample;
 using edge_probe::TelemetryConfig;
 using edge_probe::TelemetryWriter;
+using edge_probe_testing::FakeVictoriaMetrics;
+using edge_probe_testing::LocalHttpServer;
 
 class ManualClock final : public Clock
 {
@@ -48,8 +100,26 @@ public:
     }
 
 private:
-    int64_t monotonic_ms_;
-    int64_t unix_ms_;
+    std::atomic<int64_t> monotonic_ms_;
+    std::atomic<int64_t> unix_ms_;
+};
+
+// Each read is counted and returns a time 1 ms later than the previous one.
+class TickingClock final : public Clock
+{
+public:
+    int64_t monotonic_now_ms() const override
+    {
+        return ++monotonic_reads_;
+    }
+
+    int64_t unix_epoch_ms() const override
+    {
+        return 1700000000000LL + ++unix_reads_;
+    }
+
+    mutable int64_t monotonic_reads_ {0};
+    mutable int64_t unix_reads_ {0};
 };
 
 class FakeTransport final : public HttpTransport
@@ -60,9 +130,10 @@ public:
     {
     }
 
-    Result post_json_lines(const TelemetryConfig &, const std::string &body) override
+    Result post_json_lines(const TelemetryConfig &config, const std::string &body) override
     {
         bodies.push_back(body);
+        encodings.push_back(config.compression);
         if (call_count_ < scripted_results_.size())
         {
             return scripted_results_[call_count_++];
@@ -76,12 +147,136 @@ public:
     }
 
     std::vector<std::string> bodies;
+    std::vector<PayloadCompression> encodings;
 
 private:
     std::vector<Result> scripted_results_;
     std::size_t call_count_ {0};
 };
 
+// Posts windows of up to three batches and fails every body that contains
+// fail_marker.
+class WindowTransport final : public HttpTransport
+{
+public:
+    Result post_json_lines(const TelemetryConfig &config, const std::string &body) override
+    {
+        return post_many(config, {&body}).front();
+    }
+
+    std::vector<Result> post_many(const TelemetryConfig &,
+                                  const std::vector<const std::string *> &window) override
+    {
+        window_sizes.push_back(window.size());
+        std::vector<Result> results;
+        for (const std::string *body : window)
+        {
+            Result result;
+            result.ok = fail_marker.empty() || body->find(fail_marker) == std::string::npos;
+            result.http_code = result.ok ? 204 : 503;
+            if (result.ok)
+            {
+                delivered.push_back(*body);
+            }
+            results.push_back(result);
+        }
+        return results;
+    }
+
+    std::size_t max_in_flight() const override
+    {
+        return 3;
+    }
+
+    std::string fail_marker;
+    std::vector<std::size_t> window_sizes;
+    std::vector<std::string> delivered;
+};
+
+// Holds every post until open() so tests can observe a stalled endpoint.
+class GatedTransport final : public HttpTransport
+{
+public:
+    Result post_json_lines(const TelemetryConfig &, const std::string &body) override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++started_;
+        changed_.notify_all();
+        changed_.wait(lock, [this] { return open_; });
+        bodies_.push_back(body);
+
+        Result result;
+        result.ok = true;
+        result.http_code = 204;
+        return result;
+    }
+
+    void wait_started(std::size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [this, count] { return started_ >= count; });
+    }
+
+    void open()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        changed_.notify_all();
+    }
+
+    std::vector<std::string> bodies()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bodies_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::size_t started_ {0};
+    bool open_ {false};
+    std::vector<std::string> bodies_;
+};
+
+class TempDirectory
+{
+public:
+    TempDirectory()
+    {
+        std::string pattern = "/tmp/edge_probe_test_XXXXXX";
+        if (::mkdtemp(pattern.data()) == nullptr)
+        {
+            throw std::runtime_error("mkdtemp failed");
+        }
+        path_ = pattern;
+    }
+
+    ~TempDirectory()
+    {
+        std::error_code ignored;
+        std::filesystem::remove_all(path_, ignored);
+    }
+
+    const std::string &path() const
+    {
+        return path_;
+    }
+
+    std::vector<std::filesystem::path> files() const
+    {
+        std::vector<std::filesystem::path> found;
+        for (const auto &entry : std::filesystem::directory_iterator(path_))
+        {
+            found.push_back(entry.path());
+        }
+        std::sort(found.begin(), found.end());
+        return found;
+    }
+
+private:
+    std::string path_;
+};
+
 struct TestContext
 {
     int failures {0};
@@ -157,13 +352,12 @@ std::string slice_lines(int first_line, int last_line)
     return output.str();
 }
 
-bool labels_match_subset(const std::map<std::string, std::string> &labels,
-                         const std::map<std::string, std::string> &subset)
+bool labels_match_subset(const LabelSet &labels, const LabelSet &subset)
 {
     for (const auto &[key, expected] : subset)
     {
-        const auto it = labels.find(key);
-        if (it == labels.end() || it->second != expected)
+        const std::string *value = labels.find(key);
+        if (value == nullptr || *value != expected)
         {
             return false;
         }
@@ -173,7 +367,7 @@ bool labels_match_subset(const std::map<std::string, std::string> &labels,
 
 const MetricSample *find_metric(const std::vector<MetricSample> &metrics,
                                 const std::string &name,
-                                const std::map<std::string, std::string> &labels = {})
+                                const LabelSet &labels = {})
 {
     for (const auto &metric : metrics)
     {
@@ -188,7 +382,7 @@ const MetricSample *find_metric(const std::vector<MetricSample> &metrics,
 double require_metric_value(TestContext &ctx,
                             const std::vector<MetricSample> &metrics,
                             const std::string &name,
-                            const std::map<std::string, std::string> &labels = {})
+                            const LabelSet &labels = {})
 {
     const MetricSample *metric = find_metric(metrics, name, labels);
     std::ostringstream message;
@@ -214,11 +408,56 @@ double require_metric_value(TestContext &ctx,
 void require_metric_present(TestContext &ctx,
                             const std::vector<MetricSample> &metrics,
                             const std::string &name,
-                            const std::map<std::string, std::string> &labels = {})
+                            const LabelSet &labels = {})
 {
     EXPECT_TRUE(ctx, find_metric(metrics, name, labels) != nullptr);
 }
 
+std::string reference_json_escape(const std::string &value)
+{
+    std::ostringstream output;
+    for (const unsigned char ch : value)
+    {
+        switch (ch)
+        {
+            case '"':
+                output << "\\\"";
+                break;
+            case '\\':
+                output << "\\\\";
+                break;
+            case '\b':
+                output << "\\b";
+                break;
+            case '\f':
+                output << "\\f";
+                break;
+            case '\n':
+                output << "\\n";
+                break;
+            case '\r':
+                output << "\\r";
+                break;
+            case '\t':
+                output << "\\t";
+                break;
+            default:
+                if (ch < 0x20)
+                {
+                    output << "\\u00" << std::hex << std::nouppercase
+                           << static_cast<int>((ch >> 4) & 0x0F)
+                           << static_cast<int>(ch & 0x0F) << std::dec;
+                }
+                else
+                {
+                    output << static_cast<char>(ch);
+                }
+                break;
+        }
+    }
+    return output.str();
+}
+
 void test_default_command_plan(TestContext &ctx)
 {
     const auto plan = edge_probe::default_command_plan();
@@ -264,8 +503,9 @@ void test_sender_retry_flow(TestContext &ctx)
     EXPECT_TRUE(ctx, transport->bodies.front().find("1700000000000") !=
                          std::string::npos);
     EXPECT_TRUE(ctx,
-                !writer.submit({"edge_new_metric", 3.0, {{"device", "busstop-001"}}, 0}));
-    EXPECT_EQ(ctx, writer.dropped_samples(), std::uint64_t {1});
+                writer.submit({"edge_new_metric", 3.0, {{"device", "busstop-001"}}, 0}));
+    EXPECT_EQ(ctx, writer.dropped_samples(), std::uint64_t {0});
+    EXPECT_EQ(ctx, writer.buffered_samples(), std::size_t {1});
 
     clock->advance_ms(999);
     writer.tick();
@@ -277,25 +517,1837 @@ void test_sender_retry_flow(TestContext &ctx)
     EXPECT_EQ(ctx, writer.sent_batches(), std::uint64_t {1});
     EXPECT_TRUE(ctx, !writer.has_pending_payload());
     EXPECT_EQ(ctx, writer.last_success_unix_ms(), 1700000001000LL);
+    EXPECT_EQ(ctx, writer.buffered_samples(), std::size_t {1});
+}
+
+void test_sender_retry_queue_drains_in_order(TestContext &ctx)
+{
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    HttpTransport::Result failure;
+    failure.ok = false;
+    failure.http_code = 503;
+
+    auto transport = std::make_shared<FakeTransport>(
+        std::vector<HttpTransport::Result> {failure, failure});
+
+    TelemetryConfig config;
+    config.max_batch_samples = 1;
+    config.retry_initial_ms = 1000;
+    config.retry_max_ms = 4000;
+
+    TelemetryWriter writer(config, transport, clock);
+    EXPECT_TRUE(ctx, writer.submit({"edge_queue_metric", 1.0, {}, 0}));
+    writer.tick();
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {1});
+
+    clock->advance_ms(500);
+    EXPECT_TRUE(ctx, writer.submit({"edge_queue_metric", 2.0, {}, 0}));
+    writer.tick();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {1});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {2});
+    EXPECT_EQ(ctx, writer.oldest_queued_payload_age_ms(), int64_t {500});
+
+    clock->advance_ms(500);
+    writer.tick();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {2});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {2});
+    EXPECT_EQ(ctx, writer.next_retry_at_ms(), int64_t {4000});
+
+    clock->advance_ms(1000);
+    EXPECT_TRUE(ctx, writer.submit({"edge_queue_metric", 3.0, {}, 0}));
+    writer.tick();
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {3});
+    EXPECT_TRUE(ctx, writer.queued_payload_bytes() > 0);
+
+    clock->advance_ms(1000);
+    writer.tick();
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {0});
+    EXPECT_EQ(ctx, writer.queued_payload_bytes(), std::size_t {0});
+    EXPECT_EQ(ctx, writer.oldest_queued_payload_age_ms(), int64_t {0});
+    EXPECT_EQ(ctx, writer.sent_batches(), std::uint64_t {3});
+    EXPECT_EQ(ctx, writer.dropped_samples(), std::uint64_t {0});
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {5});
+    if (transport->bodies.size() == 5)
+    {
+        EXPECT_TRUE(ctx, transport->bodies[2].find("\"values\":[1]") != std::string::npos);
+        EXPECT_TRUE(ctx, transport->bodies[3].find("\"values\":[2]") != std::string::npos);
+        EXPECT_TRUE(ctx, transport->bodies[4].find("\"values\":[3]") != std::string::npos);
+    }
+}
+
+void test_sender_retry_queue_budget(TestContext &ctx)
+{
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    HttpTransport::Result failure;
+    failure.ok = false;
+    failure.http_code = 500;
+
+    auto transport = std::make_shared<FakeTransport>(
+        std::vector<HttpTransport::Result> {failure});
+
+    TelemetryConfig config;
+    config.max_batch_samples = 1;
+    config.retry_initial_ms = 1000;
+
+    TelemetryWriter writer(config, transport, clock);
+    EXPECT_TRUE(ctx, writer.submit({"edge_budget_metric", 1.0, {}, 0}));
+    writer.tick();
+    const std::size_t payload_bytes = writer.queued_payload_bytes();
+    EXPECT_TRUE(ctx, payload_bytes > 0);
+
+    config.max_retry_queue_bytes = payload_bytes * 2;
+    TelemetryWriter bounded(config,
+                            std::make_shared<FakeTransport>(
+                                std::vector<HttpTransport::Result> {failure}),
+                            clock);
+    for (int i = 1; i <= 4; ++i)
+    {
+        EXPECT_TRUE(ctx, bounded.submit({"edge_budget_metric", static_cast<double>(i), {}, 0}));
+        bounded.tick();
+    }
+
+    EXPECT_EQ(ctx, bounded.queued_payloads(), std::size_t {2});
+    EXPECT_TRUE(ctx, bounded.queued_payload_bytes() <= config.max_retry_queue_bytes);
+    EXPECT_EQ(ctx, bounded.dropped_batches(), std::uint64_t {2});
+    EXPECT_EQ(ctx, bounded.dropped_samples(), std::uint64_t {0});
+}
+
+void test_spsc_ring(TestContext &ctx)
+{
+    edge_probe::SpscRing<std::string> ring(2);
+    std::string value = "a";
+    EXPECT_TRUE(ctx, ring.try_push(std::move(value)));
+    value = "b";
+    EXPECT_TRUE(ctx, ring.try_push(std::move(value)));
+    value = "c";
+    EXPECT_TRUE(ctx, !ring.try_push(std::move(value)));
+    EXPECT_EQ(ctx, value, std::string("c"));
+    EXPECT_EQ(ctx, ring.size(), std::size_t {2});
+
+    std::string popped;
+    EXPECT_TRUE(ctx, ring.try_pop(popped) && popped == "a");
+    EXPECT_TRUE(ctx, ring.try_push(std::move(value)));
+    EXPECT_TRUE(ctx, ring.try_pop(popped) && popped == "b");
+    EXPECT_TRUE(ctx, ring.try_pop(popped) && popped == "c");
+    EXPECT_TRUE(ctx, !ring.try_pop(popped));
+
+    constexpr std::uint64_t count = 100000;
+    edge_probe::SpscRing<std::uint64_t> numbers(16);
+    std::thread producer([&numbers] {
+        for (std::uint64_t i = 1; i <= count;)
+        {
+            std::uint64_t next = i;
+            if (numbers.try_push(std::move(next)))
+            {
+                ++i;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::uint64_t expected = 1;
+    bool ordered = true;
+    while (expected <= count)
+    {
+        std::uint64_t next = 0;
+        if (numbers.try_pop(next))
+        {
+            ordered = ordered && next == expected;
+            ++expected;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(ctx, ordered);
+}
+
+void test_sender_background_never_blocks_caller(TestContext &ctx)
+{
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    auto transport = std::make_shared<GatedTransport>();
+
+    TelemetryConfig config;
+    config.max_batch_samples = 1;
+    config.background_sender = true;
+    config.sender_queue_capacity = 2;
+
+    TelemetryWriter writer(config, transport, clock);
+    EXPECT_TRUE(ctx, writer.submit({"edge_async_metric", 1.0, {}, 0}));
+    transport->wait_started(1);
+
+    // The sender thread is stuck in the first post; the caller keeps going.
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 2; i <= 5; ++i)
+    {
+        EXPECT_TRUE(ctx, writer.submit({"edge_async_metric", static_cast<double>(i), {}, 0}));
+        writer.tick();
+    }
+    EXPECT_TRUE(ctx, std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+    EXPECT_EQ(ctx, writer.sent_batches(), std::uint64_t {0});
+    EXPECT_EQ(ctx, writer.dropped_batches(), std::uint64_t {2});
+
+    transport->open();
+    writer.wait_idle();
+    EXPECT_EQ(ctx, writer.sent_batches(), std::uint64_t {3});
+    EXPECT_EQ(ctx, writer.send_failures(), std::uint64_t {0});
+
+    const auto bodies = transport->bodies();
+    EXPECT_EQ(ctx, bodies.size(), std::size_t {3});
+    if (bodies.size() == 3)
+    {
+        EXPECT_TRUE(ctx, bodies[0].find("\"values\":[1]") != std::string::npos);
+        EXPECT_TRUE(ctx, bodies[1].find("\"values\":[2]") != std::string::npos);
+        EXPECT_TRUE(ctx, bodies[2].find("\"values\":[3]") != std::string::npos);
+    }
+}
+
+void test_sender_background_retry(TestContext &ctx)
+{
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    HttpTransport::Result failure;
+    failure.ok = false;
+    failure.http_code = 503;
+
+    auto transport = std::make_shared<FakeTransport>(
+        std::vector<HttpTransport::Result> {failure, failure});
+
+    TelemetryConfig config;
+    config.max_batch_samples = 2;
+    config.flush_interval_ms = 10000;
+    config.retry_initial_ms = 1000;
+    config.background_sender = true;
+
+    TelemetryWriter writer(config, transport, clock);
+    EXPECT_TRUE(ctx, writer.submit({"edge_async_metric", 1.0, {}, 0}));
+    writer.tick();
+    writer.wait_idle();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {0});
+    EXPECT_EQ(ctx, writer.buffered_samples(), std::size_t {1});
+
+    EXPECT_TRUE(ctx, writer.submit({"edge_async_metric", 2.0, {}, 0}));
+    writer.wait_idle();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {1});
+    EXPECT_EQ(ctx, writer.send_failures(), std::uint64_t {1});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {1});
+    EXPECT_EQ(ctx, writer.next_retry_at_ms(), int64_t {2000});
+
+    clock->advance_ms(999);
+    writer.tick();
+    writer.wait_idle();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {1});
+
+    clock->advance_ms(1);
+    writer.tick();
+    writer.wait_idle();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {2});
+    EXPECT_EQ(ctx, writer.send_failures(), std::uint64_t {2});
+    EXPECT_EQ(ctx, writer.next_retry_at_ms(), int64_t {4000});
+
+    // force_flush() ignores the backoff and waits for the attempt.
+    EXPECT_TRUE(ctx, writer.submit({"edge_async_metric", 3.0, {}, 0}));
+    writer.force_flush();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {4});
+    EXPECT_EQ(ctx, writer.sent_batches(), std::uint64_t {2});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {0});
+    EXPECT_EQ(ctx, writer.buffered_samples(), std::size_t {0});
+    EXPECT_EQ(ctx, writer.last_success_unix_ms(), 1700000001000LL);
+}
+
+void test_curl_transport_reuses_connection(TestContext &ctx)
+{
+#if defined(EDGE_PROBE_HAVE_CURL)
+    std::atomic<int> drops {0};
+    LocalHttpServer server([&drops](const LocalHttpServer::Request &) {
+        if (drops > 0)
+        {
+            --drops;
+            return 0;
+        }
+        return 204;
+    });
+
+    TelemetryConfig config;
+    config.endpoint = server.url("/api/v1/import");
+    config.username = "probe";
+    config.password = "secret";
+    config.compression = PayloadCompression::snappy;
+    edge_probe::CurlHttpTransport transport;
+
+    std::vector<HttpTransport::Result> results;
+    for (int i = 0; i < 3; ++i)
+    {
+        results.push_back(transport.post_json_lines(config, "body-" + std::to_string(i)));
+    }
+    for (const auto &result : results)
+    {
+        EXPECT_TRUE(ctx, result.ok);
+        EXPECT_EQ(ctx, result.http_code, 204L);
+        EXPECT_TRUE(ctx, result.total_time_us > 0);
+    }
+    EXPECT_TRUE(ctx, !results[0].reused_connection);
+    EXPECT_TRUE(ctx, results[0].connect_time_us > 0);
+    EXPECT_TRUE(ctx, results[2].reused_connection);
+    EXPECT_EQ(ctx, server.accepted_connections(), std::size_t {1});
+
+    // curl retries a dead reused connection once on a fresh one, so it takes
+    // two drops to fail a post; the next post reconnects.
+    drops = 2;
+    const auto failed = transport.post_json_lines(config, "lost");
+    EXPECT_TRUE(ctx, !failed.ok);
+    EXPECT_TRUE(ctx, !failed.error_message.empty());
+    const auto recovered = transport.post_json_lines(config, "again");
+    EXPECT_TRUE(ctx, recovered.ok);
+    EXPECT_TRUE(ctx, !recovered.reused_connection);
+    EXPECT_EQ(ctx, server.accepted_connections(), std::size_t {3});
+
+    auto requests = server.requests();
+    EXPECT_EQ(ctx, requests.size(), std::size_t {6});
+    if (requests.size() == 6)
+    {
+        EXPECT_EQ(ctx, requests[1].method, std::string("POST"));
+        EXPECT_EQ(ctx, requests[1].target, std::string("/api/v1/import"));
+        EXPECT_EQ(ctx, requests[1].body, std::string("body-1"));
+        EXPECT_EQ(ctx, requests[1].headers["content-encoding"], std::string("snappy"));
+        EXPECT_EQ(ctx, requests[1].headers["authorization"],
+                  std::string("Basic cHJvYmU6c2VjcmV0"));
+        EXPECT_EQ(ctx, requests[5].body, std::string("again"));
+        EXPECT_EQ(ctx, requests[5].connection, std::size_t {2});
+    }
+#else
+    (void)ctx;
+#endif
+}
+
+void test_socket_transport(TestContext &ctx)
+{
+    std::atomic<int> drops {0};
+    LocalHttpServer server([&drops](const LocalHttpServer::Request &) {
+        if (drops > 0)
+        {
+            --drops;
+            return 0;
+        }
+        return 200;
+    });
+
+    TelemetryConfig config;
+    config.endpoint = server.url("/api/v1/write");
+    config.username = "probe";
+    config.password = "secret";
+    config.payload_format = PayloadFormat::remote_write;
+    config.compression = PayloadCompression::snappy;
+    edge_probe::SocketHttpTransport transport;
+
+    server.set_response_body("plain body", false);
+    const auto plain = transport.post_json_lines(config, "body-0");
+    server.set_response_body("chunked body", true);
+    const auto chunked = transport.post_json_lines(config, "body-1");
+    server.set_response_body("", false);
+    const auto empty = transport.post_json_lines(config, "");
+    for (const auto *result : {&plain, &chunked, &empty})
+    {
+        EXPECT_TRUE(ctx, result->ok);
+        EXPECT_EQ(ctx, result->http_code, 200L);
+        EXPECT_TRUE(ctx, result->error_message.empty());
+    }
+    EXPECT_EQ(ctx, plain.response_body, std::string("plain body"));
+    EXPECT_EQ(ctx, chunked.response_body, std::string("chunked body"));
+    EXPECT_TRUE(ctx, empty.response_body.empty());
+    EXPECT_TRUE(ctx, !plain.reused_connection);
+    EXPECT_TRUE(ctx, chunked.reused_connection);
+    EXPECT_TRUE(ctx, empty.reused_connection);
+    EXPECT_EQ(ctx, server.accepted_connections(), std::size_t {1});
+
+    // A dead kept-alive connection is retried once on a fresh one.
+    drops = 2;
+    const auto failed = transport.post_json_lines(config, "lost");
+    EXPECT_TRUE(ctx, !failed.ok);
+    EXPECT_TRUE(ctx, !failed.error_message.empty());
+    const auto recovered = transport.post_json_lines(config, "again");
+    EXPECT_TRUE(ctx, recovered.ok);
+    EXPECT_TRUE(ctx, !recovered.reused_connection);
+    EXPECT_EQ(ctx, server.accepted_connections(), std::size_t {3});
+
+    auto requests = server.requests();
+    EXPECT_EQ(ctx, requests.size(), std::size_t {6});
+    if (requests.size() == 6)
+    {
+        EXPECT_EQ(ctx, requests[1].method, std::string("POST"));
+        EXPECT_EQ(ctx, requests[1].target, std::string("/api/v1/write"));
+        EXPECT_EQ(ctx, requests[1].body, std::string("body-1"));
+        EXPECT_EQ(ctx, requests[1].headers["host"], "127.0.0.1:" + std::to_string(server.port()));
+        EXPECT_EQ(ctx, requests[1].headers["content-type"], std::string("application/x-protobuf"));
+        EXPECT_EQ(ctx, requests[1].headers["content-encoding"], std::string("snappy"));
+        EXPECT_EQ(ctx, requests[1].headers["x-prometheus-remote-write-version"],
+                  std::string("0.1.0"));
+        EXPECT_EQ(ctx, requests[1].headers["authorization"],
+                  std::string("Basic cHJvYmU6c2VjcmV0"));
+        EXPECT_EQ(ctx, requests[2].headers["content-length"], std::string("0"));
+        EXPECT_EQ(ctx, requests[5].body, std::string("again"));
+        EXPECT_EQ(ctx, requests[5].connection, std::size_t {2});
+    }
+
+    config.endpoint = "https://127.0.0.1/api/v1/write";
+    const auto https = transport.post_json_lines(config, "body");
+    EXPECT_TRUE(ctx, !https.ok);
+    EXPECT_TRUE(ctx, !https.error_message.empty());
+
+    std::string closed_endpoint;
+    {
+        LocalHttpServer gone;
+        closed_endpoint = gone.url("/api/v1/write");
+    }
+    config.endpoint = closed_endpoint;
+    const auto refused = transport.post_json_lines(config, "body");
+    EXPECT_TRUE(ctx, !refused.ok);
+    EXPECT_EQ(ctx, refused.http_code, 0L);
+    EXPECT_TRUE(ctx, !refused.error_message.empty());
+}
+
+void test_unix_socket_transport(TestContext &ctx)
+{
+    TempDirectory dir;
+    LocalHttpServer server(
+        [](const LocalHttpServer::Request &) { return LocalHttpServer::Reply {204, 0}; },
+        dir.path() + "/relay.sock");
+
+    TelemetryConfig config;
+    config.endpoint = server.url("/api/v1/import");
+    config.unix_socket_path = server.unix_socket_path();
+    std::vector<std::shared_ptr<HttpTransport>> transports {
+        std::make_shared<edge_probe::SocketHttpTransport>()};
+#if defined(EDGE_PROBE_HAVE_CURL)
+    transports.push_back(std::make_shared<edge_probe::CurlHttpTransport>());
+#endif
+
+    for (const auto &transport : transports)
+    {
+        const auto first = transport->post_json_lines(config, "first");
+        const auto second = transport->post_json_lines(config, "second");
+        EXPECT_TRUE(ctx, first.ok);
+        EXPECT_TRUE(ctx, second.ok);
+        EXPECT_TRUE(ctx, !first.reused_connection);
+        EXPECT_TRUE(ctx, second.reused_connection);
+    }
+    EXPECT_EQ(ctx, server.accepted_connections(), transports.size());
+
+    auto requests = server.requests();
+    EXPECT_EQ(ctx, requests.size(), 2 * transports.size());
+    for (auto &request : requests)
+    {
+        EXPECT_EQ(ctx, request.target, std::string("/api/v1/import"));
+        EXPECT_EQ(ctx, request.headers["host"], std::string("localhost"));
+    }
+    if (requests.size() >= 2)
+    {
+        EXPECT_EQ(ctx, requests[1].body, std::string("second"));
+    }
+
+    // A missing socket fails the post without touching the endpoint's host.
+    config.unix_socket_path = dir.path() + "/missing.sock";
+    for (const auto &transport : transports)
+    {
+        const auto missing = transport->post_json_lines(config, "lost");
+        EXPECT_TRUE(ctx, !missing.ok);
+        EXPECT_EQ(ctx, missing.http_code, 0L);
+    }
+}
+
+void test_fake_vm_server(TestContext &ctx)
+{
+    const auto schedule = edge_probe_testing::parse_fault_schedule("ok*2,503@5,401,reset");
+    EXPECT_EQ(ctx, schedule.size(), std::size_t {5});
+    if (schedule.size() == 5)
+    {
+        EXPECT_EQ(ctx, schedule[1].status, 204);
+        EXPECT_EQ(ctx, schedule[2].status, 503);
+        EXPECT_EQ(ctx, schedule[2].delay_ms, 5);
+        EXPECT_EQ(ctx, schedule[4].status, 0);
+    }
+    bool threw = false;
+    try
+    {
+        edge_probe_testing::parse_fault_schedule("ok,teapot");
+    }
+    catch (const std::invalid_argument &)
+    {
+        threw = true;
+    }
+    EXPECT_TRUE(ctx, threw);
+
+    FakeVictoriaMetrics server(schedule);
+    TelemetryConfig config;
+    config.endpoint = server.url("/api/v1/import");
+    edge_probe::SocketHttpTransport transport;
+    const std::string body =
+        "{\"metric\":{\"__name__\":\"a\",\"v\":\"x,\\\"values\\\":[\"},"
+        "\"values\":[1,2],\"timestamps\":[10,20]}\n"
+        "{\"metric\":{\"__name__\":\"b\"},\"values\":[3],\"timestamps\":[30]}\n";
+
+    EXPECT_EQ(ctx, transport.post_json_lines(config, body).http_code, 204L);
+    EXPECT_EQ(ctx, transport.post_json_lines(config, "not json").http_code, 400L);
+    EXPECT_EQ(ctx, transport.post_json_lines(config, body).http_code, 503L);
+    EXPECT_EQ(ctx, transport.post_json_lines(config, body).http_code, 401L);
+    // The reset is retried on a fresh connection, which the schedule accepts.
+    EXPECT_EQ(ctx, transport.post_json_lines(config, body).http_code, 204L);
+
+    auto stats = server.stats();
+    EXPECT_EQ(ctx, stats.requests, std::uint64_t {6});
+    EXPECT_EQ(ctx, stats.ok_responses, std::uint64_t {2});
+    EXPECT_EQ(ctx, stats.error_responses, std::uint64_t {3});
+    EXPECT_EQ(ctx, stats.resets, std::uint64_t {1});
+    EXPECT_EQ(ctx, stats.rejected_bodies, std::uint64_t {1});
+    EXPECT_EQ(ctx, stats.series, std::size_t {2});
+    EXPECT_EQ(ctx, stats.points, std::uint64_t {6});
+
+    // Writer output in both formats is decoded and counted.
+    for (const PayloadFormat format : {PayloadFormat::json_lines, PayloadFormat::remote_write})
+    {
+        FakeVictoriaMetrics vm;
+        TelemetryConfig writer_config;
+        writer_config.payload_format = format;
+        writer_config.endpoint = vm.url(format == PayloadFormat::remote_write ? "/api/v1/write"
+                                                                              : "/api/v1/import");
+        if (format == PayloadFormat::json_lines &&
+            PayloadCompressor::supported(PayloadCompression::gzip))
+        {
+            writer_config.compression = PayloadCompression::gzip;
+        }
+        TelemetryWriter writer(writer_config, std::make_shared<edge_probe::SocketHttpTransport>());
+        writer.submit_batch({{"edge_a", 1.0, {{"k", "1"}}, 1000},
+                             {"edge_a", 2.0, {{"k", "1"}}, 2000},
+                             {"edge_b", 3.0, {}, 1000}});
+        writer.force_flush();
+        stats = vm.stats();
+        EXPECT_EQ(ctx, writer.sent_batches(), std::uint64_t {1});
+        EXPECT_EQ(ctx, stats.rejected_bodies, std::uint64_t {0});
+        EXPECT_EQ(ctx, stats.points, std::uint64_t {3});
+        EXPECT_EQ(ctx, stats.series, std::size_t {2});
+    }
 }
 
-void test_sender_oversized_payload(TestContext &ctx)
-{
-    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
-    auto transport =
-        std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+void test_sender_in_flight_window(TestContext &ctx)
+{
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    auto transport = std::make_shared<WindowTransport>();
+    transport->fail_marker = "edge_b";
+    TelemetryConfig config;
+    config.max_batch_samples = 1;
+    TelemetryWriter writer(config, transport, clock);
+
+    for (const char *name : {"edge_a", "edge_b", "edge_c", "edge_d", "edge_e"})
+    {
+        EXPECT_TRUE(ctx, writer.submit({name, 1.0, {}, 0}));
+    }
+    // Sealed batches wait for tick(), counted as queued but not yet posted.
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {5});
+    EXPECT_TRUE(ctx, transport->window_sizes.empty());
+
+    // The first window delivers a and c; b keeps its place ahead of d and e.
+    writer.tick();
+    EXPECT_EQ(ctx, transport->window_sizes.size(), std::size_t {1});
+    EXPECT_EQ(ctx, writer.sent_batches(), std::uint64_t {2});
+    EXPECT_EQ(ctx, writer.send_failures(), std::uint64_t {1});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {3});
+    EXPECT_EQ(ctx, writer.next_retry_at_ms(), int64_t {1000 + config.retry_initial_ms});
+
+    transport->fail_marker.clear();
+    writer.tick();
+    EXPECT_EQ(ctx, transport->window_sizes.size(), std::size_t {1});
+    clock->advance_ms(config.retry_initial_ms);
+    writer.tick();
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {0});
+    EXPECT_EQ(ctx, writer.queued_payload_bytes(), std::size_t {0});
+    EXPECT_EQ(ctx, writer.next_retry_at_ms(), int64_t {0});
+
+    std::string order;
+    for (const auto &body : transport->delivered)
+    {
+        order += body.substr(body.find("edge_") + 5, 1);
+    }
+    EXPECT_EQ(ctx, order, std::string("acbde"));
+    EXPECT_TRUE(ctx, transport->window_sizes == (std::vector<std::size_t> {3, 3}));
+}
+
+void test_curl_multi_transport(TestContext &ctx)
+{
+#if defined(EDGE_PROBE_HAVE_CURL)
+    LocalHttpServer server(
+        [](const LocalHttpServer::Request &request) {
+            return request.body == "body-2" ? 503 : 204;
+        },
+        100);
+
+    TelemetryConfig config;
+    config.endpoint = server.url("/api/v1/import");
+    edge_probe::CurlMultiHttpTransport transport(4);
+    EXPECT_EQ(ctx, transport.max_in_flight(), std::size_t {4});
+
+    std::vector<std::string> bodies;
+    for (int i = 0; i < 4; ++i)
+    {
+        bodies.push_back("body-" + std::to_string(i));
+    }
+    const std::vector<const std::string *> window {&bodies[0], &bodies[1], &bodies[2], &bodies[3]};
+    const auto first = transport.post_many(config, window);
+    EXPECT_EQ(ctx, first.size(), std::size_t {4});
+    for (std::size_t i = 0; i < first.size(); ++i)
+    {
+        EXPECT_EQ(ctx, first[i].ok, i != 2);
+        EXPECT_EQ(ctx, first[i].http_code, i == 2 ? 503L : 204L);
+    }
+    // All four were waiting on the server at once.
+    EXPECT_EQ(ctx, server.max_pending_responses(), std::size_t {4});
+    EXPECT_EQ(ctx, server.accepted_connections(), std::size_t {4});
+
+    const auto second = transport.post_many(config, window);
+    for (const auto &result : second)
+    {
+        EXPECT_TRUE(ctx, result.reused_connection);
+    }
+    EXPECT_EQ(ctx, server.accepted_connections(), std::size_t {4});
+    EXPECT_TRUE(ctx, transport.post_json_lines(config, bodies[0]).ok);
+    EXPECT_EQ(ctx, server.requests().size(), std::size_t {9});
+#else
+    (void)ctx;
+#endif
+}
+
+void test_payload_spool_recovers_unacked_records(TestContext &ctx)
+{
+    TempDirectory dir;
+    {
+        PayloadSpool spool(dir.path(), 64 * 1024, 4096, false);
+        const auto first = spool.append("first\n", 1, 1700000000000LL);
+        const auto second = spool.append("second\n", 2, 1700000000100LL);
+        const auto third = spool.append("third\n", 3, 1700000000200LL);
+        EXPECT_TRUE(ctx, first.has_value() && second.has_value() && third.has_value());
+        if (second.has_value())
+        {
+            spool.ack(*second);
+        }
+        EXPECT_EQ(ctx, spool.live_records(), std::size_t {2});
+
+        PayloadSpool::Record record;
+        EXPECT_TRUE(ctx, third.has_value() && spool.read(*third, record));
+        EXPECT_EQ(ctx, record.body, std::string("third\n"));
+        EXPECT_EQ(ctx, record.sample_count, std::size_t {3});
+        EXPECT_EQ(ctx, record.enqueued_unix_ms, 1700000000200LL);
+        EXPECT_TRUE(ctx, second.has_value() && !spool.read(*second, record));
+    }
+
+    PayloadSpool reopened(dir.path(), 64 * 1024, 4096, false);
+    auto records = reopened.take_recovered();
+    EXPECT_EQ(ctx, records.size(), std::size_t {2});
+    if (records.size() == 2)
+    {
+        EXPECT_EQ(ctx, records[0].body, std::string("first\n"));
+        EXPECT_EQ(ctx, records[0].sample_count, std::size_t {1});
+        EXPECT_EQ(ctx, records[0].enqueued_unix_ms, 1700000000000LL);
+        EXPECT_EQ(ctx, records[1].body, std::string("third\n"));
+        EXPECT_EQ(ctx, records[1].sample_count, std::size_t {3});
+    }
+
+    for (const auto &record : records)
+    {
+        reopened.ack(record.id);
+    }
+    EXPECT_EQ(ctx, reopened.disk_bytes(), std::size_t {0});
+    EXPECT_EQ(ctx, dir.files().size(), std::size_t {0});
+}
+
+void test_payload_spool_discards_torn_and_corrupt_tail(TestContext &ctx)
+{
+    TempDirectory dir;
+    {
+        PayloadSpool spool(dir.path(), 64 * 1024, 4096, true);
+        spool.append("intact\n", 1, 1);
+        spool.append("torn-record-body\n", 1, 2);
+    }
+
+    auto files = dir.files();
+    EXPECT_EQ(ctx, files.size(), std::size_t {1});
+    if (files.size() != 1)
+    {
+        return;
+    }
+
+    const auto full_size = std::filesystem::file_size(files.front());
+    std::filesystem::resize_file(files.front(), full_size - 5);
+    {
+        PayloadSpool spool(dir.path(), 64 * 1024, 4096, true);
+        const auto records = spool.take_recovered();
+        EXPECT_EQ(ctx, records.size(), std::size_t {1});
+        EXPECT_EQ(ctx, spool.discarded_corrupt_records(), std::uint64_t {1});
+        EXPECT_EQ(ctx, std::filesystem::file_size(files.front()), std::uintmax_t {32 + 7});
+
+        spool.append("after-recovery\n", 1, 3);
+    }
+
+    {
+        std::fstream file(files.front(), std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(32 + 2);
+        file.put('X');
+    }
+
+    PayloadSpool spool(dir.path(), 64 * 1024, 4096, true);
+    const auto records = spool.take_recovered();
+    EXPECT_EQ(ctx, spool.discarded_corrupt_records(), std::uint64_t {1});
+    EXPECT_EQ(ctx, records.size(), std::size_t {1});
+    if (!records.empty())
+    {
+        EXPECT_EQ(ctx, records.front().body, std::string("after-recovery\n"));
+    }
+}
+
+void test_payload_spool_evicts_oldest_segments(TestContext &ctx)
+{
+    TempDirectory dir;
+    const std::string body(100, 'p');
+    PayloadSpool spool(dir.path(), 3 * 200, 200, false);
+    for (int i = 0; i < 6; ++i)
+    {
+        EXPECT_TRUE(ctx, spool.append(body + std::to_string(i), 1, i).has_value());
+    }
+
+    EXPECT_TRUE(ctx, spool.disk_bytes() <= std::size_t {600});
+    EXPECT_EQ(ctx, spool.evicted_records(), std::uint64_t {2});
+    EXPECT_EQ(ctx, spool.live_records(), std::size_t {4});
+    EXPECT_TRUE(ctx, !spool.append(std::string(300, 'x'), 1, 7).has_value());
+
+    PayloadSpool reopened(dir.path(), 3 * 200, 200, false);
+    const auto records = reopened.take_recovered();
+    EXPECT_EQ(ctx, records.size(), std::size_t {4});
+    if (records.size() == 4)
+    {
+        EXPECT_EQ(ctx, records.front().body, body + "2");
+        EXPECT_EQ(ctx, records.back().body, body + "5");
+    }
+}
+
+void test_sender_spool_survives_kill_and_restart(TestContext &ctx)
+{
+    TempDirectory dir;
+
+    TelemetryConfig config;
+    config.max_batch_samples = 1;
+    config.retry_initial_ms = 1000;
+    config.spool_directory = dir.path() + "/spool";
+
+    const pid_t child = ::fork();
+    if (child == 0)
+    {
+        HttpTransport::Result failure;
+        failure.ok = false;
+        failure.http_code = 502;
+
+        auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+        auto transport = std::make_shared<FakeTransport>(
+            std::vector<HttpTransport::Result> {failure, failure, failure});
+        TelemetryWriter writer(config, transport, clock);
+        writer.submit({"edge_spool_metric", 1.0, {{"device", "busstop-001"}}, 0});
+        writer.tick();
+        clock->advance_ms(10);
+        writer.submit({"edge_spool_metric", 2.0, {{"device", "busstop-001"}}, 0});
+        writer.tick();
+        ::raise(SIGKILL);
+        ::_exit(1);
+    }
+
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    EXPECT_TRUE(ctx, WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+
+    auto clock = std::make_shared<ManualClock>(500, 1700000030000LL);
+    auto transport =
+        std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+    TelemetryWriter writer(config, transport, clock);
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {2});
+    EXPECT_EQ(ctx, writer.oldest_queued_payload_age_ms(), int64_t {30000});
+    EXPECT_TRUE(ctx, writer.spool_disk_bytes() > 0);
+
+    writer.tick();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {2});
+    if (transport->bodies.size() == 2)
+    {
+        EXPECT_TRUE(ctx, transport->bodies[0].find("\"values\":[1]") != std::string::npos);
+        EXPECT_TRUE(ctx, transport->bodies[0].find("1700000000000") != std::string::npos);
+        EXPECT_TRUE(ctx, transport->bodies[1].find("\"values\":[2]") != std::string::npos);
+    }
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {0});
+    EXPECT_EQ(ctx, writer.spool_disk_bytes(), std::size_t {0});
+
+    TelemetryWriter restarted(config, transport, clock);
+    EXPECT_EQ(ctx, restarted.queued_payloads(), std::size_t {0});
+}
+
+void test_sender_spool_outlasts_retry_queue_budget(TestContext &ctx)
+{
+    TempDirectory dir;
+
+    TelemetryConfig config;
+    config.max_batch_samples = 1;
+    config.retry_initial_ms = 1000;
+    config.max_retry_queue_bytes = 300;
+    config.spool_directory = dir.path() + "/spool";
+    config.spool_sync_writes = false;
+
+    HttpTransport::Result failure;
+    failure.ok = false;
+    failure.http_code = 503;
+
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    {
+        auto transport =
+            std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {failure});
+        TelemetryWriter writer(config, transport, clock);
+        for (int i = 0; i < 10; ++i)
+        {
+            writer.submit({"edge_spool_metric",
+                           static_cast<double>(i),
+                           {{"device", "busstop-001"}},
+                           1700000000000LL + i});
+            writer.tick();
+        }
+
+        // Past the memory budget the payloads wait on disk instead of being dropped.
+        EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {1});
+        EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {10});
+        EXPECT_TRUE(ctx, writer.queued_payload_bytes() <= std::size_t {300});
+        EXPECT_TRUE(ctx, writer.queued_payload_bytes() > 0);
+        EXPECT_EQ(ctx, writer.dropped_batches(), std::uint64_t {0});
+    }
+
+    auto transport = std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+    TelemetryWriter writer(config, transport, clock);
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {10});
+    EXPECT_TRUE(ctx, writer.queued_payload_bytes() <= std::size_t {300});
+
+    writer.tick();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {10});
+    for (std::size_t i = 0; i < transport->bodies.size(); ++i)
+    {
+        ctx.expect(transport->bodies[i].find("\"values\":[" + std::to_string(i) + "]") !=
+                       std::string::npos,
+                   "spilled payload " + std::to_string(i) + " posted in order",
+                   __LINE__);
+    }
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {0});
+    EXPECT_EQ(ctx, writer.spool_disk_bytes(), std::size_t {0});
+
+    // A batch is on disk before its first post, so a crash mid-post loses nothing.
+    class CrashingTransport final : public HttpTransport
+    {
+    public:
+        Result post_json_lines(const TelemetryConfig &, const std::string &) override
+        {
+            ::raise(SIGKILL);
+            return {};
+        }
+    };
+
+    const pid_t child = ::fork();
+    if (child == 0)
+    {
+        TelemetryWriter crashing(config, std::make_shared<CrashingTransport>(), clock);
+        crashing.submit({"edge_spool_metric", 42.0, {{"device", "busstop-001"}}, 0});
+        crashing.tick();
+        ::_exit(1);
+    }
+
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    EXPECT_TRUE(ctx, WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+
+    TelemetryWriter restarted(config, transport, clock);
+    EXPECT_EQ(ctx, restarted.queued_payloads(), std::size_t {1});
+    restarted.tick();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {11});
+    if (transport->bodies.size() == 11)
+    {
+        EXPECT_TRUE(ctx, transport->bodies[10].find("\"values\":[42]") != std::string::npos);
+    }
+}
+
+void test_sender_byte_target(TestContext &ctx)
+{
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    auto transport =
+        std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+
+    TelemetryConfig config;
+    config.max_batch_samples = 10;
+    config.max_pending_payload_bytes = 150;
+
+    TelemetryWriter writer(config, transport, clock);
+    EXPECT_TRUE(ctx, writer.submit({"edge_byte_metric", 1.0, {{"device", "x"}}, 0}));
+    EXPECT_EQ(ctx, writer.buffered_samples(), std::size_t {1});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {0});
+
+    EXPECT_TRUE(ctx, writer.submit({"edge_byte_metric", 2.0, {{"device", "x"}}, 0}));
+    EXPECT_EQ(ctx, writer.buffered_samples(), std::size_t {1});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {1});
+    EXPECT_TRUE(ctx, transport->bodies.empty());
+
+    EXPECT_TRUE(ctx,
+                writer.submit({std::string(200, 'm'), 3.0, {{"device", "x"}}, 0}));
+    EXPECT_EQ(ctx, writer.buffered_samples(), std::size_t {0});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {3});
+    EXPECT_TRUE(ctx, transport->bodies.empty());
+
+    writer.tick();
+    EXPECT_EQ(ctx, writer.sent_batches(), std::uint64_t {3});
+    EXPECT_EQ(ctx, writer.dropped_batches(), std::uint64_t {0});
+    EXPECT_EQ(ctx, writer.dropped_samples(), std::uint64_t {0});
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {3});
+    if (transport->bodies.size() == 3)
+    {
+        EXPECT_TRUE(ctx, transport->bodies[0].find("\"values\":[1]") != std::string::npos);
+        EXPECT_TRUE(ctx, transport->bodies[0].size() <= config.max_pending_payload_bytes);
+        EXPECT_TRUE(ctx, transport->bodies[1].find("\"values\":[2]") != std::string::npos);
+        EXPECT_TRUE(ctx, transport->bodies[2].size() > config.max_pending_payload_bytes);
+    }
+}
+
+void test_sender_ready_batches(TestContext &ctx)
+{
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    auto transport =
+        std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+
+    // Batches larger than the retry budget are still posted: only a failed
+    // post has to fit the queue.
+    TelemetryConfig config;
+    config.max_batch_samples = 1;
+    config.max_pending_payload_bytes = 4096;
+    config.max_retry_queue_bytes = 64;
+
+    TelemetryWriter writer(config, transport, clock);
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(ctx, writer.submit({std::string(100, 'm'), 1.0 * i, {}, 0}));
+    }
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {4});
+    EXPECT_TRUE(ctx, writer.queued_payload_bytes() > 4 * config.max_retry_queue_bytes);
+    EXPECT_EQ(ctx, writer.dropped_batches(), std::uint64_t {0});
+    EXPECT_TRUE(ctx, transport->bodies.empty());
+
+    writer.tick();
+    EXPECT_EQ(ctx, writer.sent_batches(), std::uint64_t {4});
+    EXPECT_EQ(ctx, writer.dropped_batches(), std::uint64_t {0});
+    EXPECT_EQ(ctx, writer.dropped_samples(), std::uint64_t {0});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {0});
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {4});
+    for (const auto &body : transport->bodies)
+    {
+        EXPECT_TRUE(ctx, body.size() > config.max_retry_queue_bytes);
+    }
+    EXPECT_EQ(ctx, writer.queued_payload_bytes(), std::size_t {0});
+
+    // Without a tick() the ready batches stay within the retry budget plus one
+    // batch of headroom; the oldest go first.
+    config.max_pending_payload_bytes = 150;
+    config.max_retry_queue_bytes = 300;
+    transport->bodies.clear();
+    TelemetryWriter stalled(config, transport, clock);
+    for (int i = 0; i < 20; ++i)
+    {
+        EXPECT_TRUE(ctx, stalled.submit({"edge_ready_" + std::to_string(i), 1.0, {}, 0}));
+        EXPECT_TRUE(ctx,
+                    stalled.queued_payload_bytes() <=
+                        config.max_retry_queue_bytes + config.max_pending_payload_bytes);
+    }
+    EXPECT_TRUE(ctx, stalled.dropped_batches() > 0);
+    EXPECT_EQ(ctx, stalled.queued_payloads() + stalled.dropped_batches(), std::uint64_t {20});
+    stalled.tick();
+    EXPECT_EQ(ctx, stalled.queued_payloads(), std::size_t {0});
+    EXPECT_EQ(ctx, transport->bodies.size(), stalled.sent_batches());
+    if (!transport->bodies.empty())
+    {
+        EXPECT_TRUE(ctx, transport->bodies.back().find("edge_ready_19") != std::string::npos);
+    }
+}
+
+void test_sender_flush_open_batch(TestContext &ctx)
+{
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    HttpTransport::Result failure;
+    failure.http_code = 503;
+    auto transport = std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {failure});
+    TelemetryConfig config;
+    config.flush_interval_ms = 60000;
+    TelemetryWriter writer(config, transport, clock);
+
+    // The first event goes out at once and fails into the retry queue.
+    EXPECT_TRUE(ctx, writer.submit({"edge_event", 1.0, {}, 0}));
+    writer.flush_open_batch();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {1});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {1});
+
+    // Events during the backoff queue behind it without posting.
+    for (int i = 0; i < 3; ++i)
+    {
+        clock->advance_ms(config.retry_initial_ms / 4);
+        EXPECT_TRUE(ctx, writer.submit({"edge_event", 2.0 + i, {}, 0}));
+        writer.flush_open_batch();
+    }
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {1});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {4});
+    EXPECT_EQ(ctx, writer.buffered_samples(), std::size_t {0});
+
+    // Once the backoff passes, the next event drains the queue in order.
+    clock->advance_ms(config.retry_initial_ms);
+    EXPECT_TRUE(ctx, writer.submit({"edge_event", 5.0, {}, 0}));
+    writer.flush_open_batch();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {6});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {0});
+    if (transport->bodies.size() == 6)
+    {
+        EXPECT_TRUE(ctx, transport->bodies[1].find("\"values\":[1]") != std::string::npos);
+        EXPECT_TRUE(ctx, transport->bodies[5].find("\"values\":[5]") != std::string::npos);
+    }
+}
+
+void test_sender_series_grouping(TestContext &ctx)
+{
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    const std::vector<MetricSample> samples = {
+        {"edge_a", 1.0, {{"device", "x"}}, 1000},
+        {"edge_b", 2.0, {{"device", "x"}}, 1000},
+        {"edge_a", 3.0, {{"device", "x"}}, 2000},
+        {"edge_a", 4.5, {{"device", "x"}}, 3000},
+    };
+    const std::string expected =
+        "{\"metric\":{\"__name__\":\"edge_a\",\"device\":\"x\"},"
+        "\"values\":[1,3,4.5],\"timestamps\":[1000,2000,3000]}\n"
+        "{\"metric\":{\"__name__\":\"edge_b\",\"device\":\"x\"},"
+        "\"values\":[2],\"timestamps\":[1000]}\n";
+
+    TelemetryConfig config;
+    config.max_batch_samples = 10;
+    config.group_series = true;
+
+    auto transport =
+        std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+    {
+        TelemetryWriter writer(config, transport, clock);
+        for (const auto &sample : samples)
+        {
+            EXPECT_TRUE(ctx, writer.submit(sample));
+        }
+        writer.force_flush();
+    }
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {1});
+    if (transport->bodies.size() == 1)
+    {
+        EXPECT_EQ(ctx, transport->bodies.front(), expected);
+    }
+
+    // Byte accounting is exact: a target equal to the grouped size seals the
+    // batch on the last point, and the next point starts a new batch.
+    config.max_pending_payload_bytes = expected.size();
+    transport->bodies.clear();
+    TelemetryWriter bounded(config, transport, clock);
+    for (const auto &sample : samples)
+    {
+        EXPECT_TRUE(ctx, bounded.submit(sample));
+    }
+    EXPECT_EQ(ctx, bounded.queued_payloads(), std::size_t {1});
+    EXPECT_EQ(ctx, bounded.buffered_samples(), std::size_t {0});
+    EXPECT_TRUE(ctx, transport->bodies.empty());
+
+    EXPECT_TRUE(ctx, bounded.submit({"edge_a", 5.0, {{"device", "x"}}, 4000}));
+    EXPECT_EQ(ctx, bounded.buffered_samples(), std::size_t {1});
+    bounded.force_flush();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {2});
+    if (transport->bodies.size() == 2)
+    {
+        EXPECT_EQ(ctx, transport->bodies[0], expected);
+        EXPECT_EQ(ctx,
+                  transport->bodies[1],
+                  std::string("{\"metric\":{\"__name__\":\"edge_a\",\"device\":\"x\"},"
+                              "\"values\":[5],\"timestamps\":[4000]}\n"));
+    }
+}
+
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+std::string gunzip(const std::string &compressed)
+{
+    z_stream stream {};
+    if (inflateInit2(&stream, 15 + 16) != Z_OK)
+    {
+        throw std::runtime_error("inflateInit2 failed");
+    }
+
+    std::string output;
+    char chunk[4096];
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+    stream.avail_in = static_cast<uInt>(compressed.size());
+    int status = Z_OK;
+    while (status == Z_OK)
+    {
+        stream.next_out = reinterpret_cast<Bytef *>(chunk);
+        stream.avail_out = sizeof(chunk);
+        status = inflate(&stream, Z_NO_FLUSH);
+        output.append(chunk, sizeof(chunk) - stream.avail_out);
+    }
+    inflateEnd(&stream);
+
+    if (status != Z_STREAM_END)
+    {
+        throw std::runtime_error("gzip stream is truncated or corrupt");
+    }
+    return output;
+}
+#endif
+
+void test_payload_compressor(TestContext &ctx)
+{
+    EXPECT_TRUE(ctx, PayloadCompressor::supported(PayloadCompression::none));
+    EXPECT_TRUE(ctx,
+                edge_probe::payload_content_encoding(PayloadCompression::none) == nullptr);
+    EXPECT_EQ(ctx,
+              std::string(edge_probe::payload_content_encoding(PayloadCompression::gzip)),
+              std::string("gzip"));
+
+    if (!PayloadCompressor::supported(PayloadCompression::zstd))
+    {
+        bool threw = false;
+        try
+        {
+            PayloadCompressor unavailable(PayloadCompression::zstd);
+        }
+        catch (const std::invalid_argument &)
+        {
+            threw = true;
+        }
+        EXPECT_TRUE(ctx, threw);
+    }
+
+    if (!PayloadCompressor::supported(PayloadCompression::gzip))
+    {
+        return;
+    }
+
+    std::string raw;
+    for (int i = 0; i < 200; ++i)
+    {
+        raw += "{\"metric\":{\"__name__\":\"edge_wifi_supported_command_info\",\"command\":\"cmd" +
+               std::to_string(i) + "\"},\"values\":[1],\"timestamps\":[1700000000000]}\n";
+    }
+
+    PayloadCompressor compressor(PayloadCompression::gzip);
+    const std::string first = compressor.compress(raw);
+    EXPECT_TRUE(ctx, first.size() * 5 < raw.size());
+    EXPECT_TRUE(ctx, first.size() > 2 && static_cast<unsigned char>(first[0]) == 0x1f &&
+                         static_cast<unsigned char>(first[1]) == 0x8b);
+
+    const std::string second = compressor.compress("short\n");
+    EXPECT_EQ(ctx, compressor.compress(raw), first);
+
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+    EXPECT_EQ(ctx, gunzip(first), raw);
+    EXPECT_EQ(ctx, gunzip(second), std::string("short\n"));
+#endif
+}
+
+void test_sender_compression(TestContext &ctx)
+{
+    if (!PayloadCompressor::supported(PayloadCompression::gzip))
+    {
+        return;
+    }
+
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    HttpTransport::Result failure;
+    failure.ok = false;
+    failure.http_code = 503;
+
+    TempDirectory dir;
+    TelemetryConfig config;
+    config.max_batch_samples = 40;
+    config.compression = PayloadCompression::gzip;
+    config.spool_directory = dir.path();
+    config.spool_sync_writes = false;
+
+    std::size_t raw_bytes = 0;
+    {
+        auto transport = std::make_shared<FakeTransport>(
+            std::vector<HttpTransport::Result> {failure});
+        TelemetryWriter writer(config, transport, clock);
+        edge_probe::JsonLinesEncoder encoder;
+        for (int i = 0; i < 40; ++i)
+        {
+            MetricSample sample {"edge_wifi_supported_command_info",
+                                 1.0,
+                                 {{"command", "cmd" + std::to_string(i)},
+                                  {"device", "busstop-001"}},
+                                 1700000000000LL};
+            encoder.append(sample);
+            EXPECT_TRUE(ctx, writer.submit(std::move(sample)));
+        }
+        raw_bytes = encoder.size();
+
+        writer.tick();
+        EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {1});
+        EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {1});
+        EXPECT_TRUE(ctx, writer.queued_payload_bytes() * 4 < raw_bytes);
+        if (!transport->encodings.empty())
+        {
+            EXPECT_TRUE(ctx, transport->encodings.front() == PayloadCompression::gzip);
+        }
+    }
+
+    // A restart without compression still labels the spooled gzip body correctly.
+    config.compression = PayloadCompression::none;
+    auto transport = std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+    TelemetryWriter writer(config, transport, clock);
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {1});
+    writer.tick();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {1});
+    if (transport->bodies.size() == 1)
+    {
+        EXPECT_TRUE(ctx, transport->encodings.front() == PayloadCompression::gzip);
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+        const std::string inflated = gunzip(transport->bodies.front());
+        EXPECT_EQ(ctx, inflated.size(), raw_bytes);
+        EXPECT_TRUE(ctx, inflated.find("\"command\":\"cmd39\"") != std::string::npos);
+#endif
+    }
+}
+
+void test_snappy(TestContext &ctx)
+{
+    std::string compressed;
+    std::string restored;
+
+    edge_probe::snappy_compress("", compressed);
+    EXPECT_EQ(ctx, compressed, std::string(1, '\0'));
+    EXPECT_TRUE(ctx, edge_probe::snappy_uncompress(compressed, restored));
+    EXPECT_TRUE(ctx, restored.empty());
+
+    // A run compresses to one literal plus overlapping copies.
+    const std::string run(1000, 'a');
+    edge_probe::snappy_compress(run, compressed);
+    EXPECT_TRUE(ctx, compressed.size() < 64);
+    EXPECT_TRUE(ctx, edge_probe::snappy_uncompress(compressed, restored));
+    EXPECT_EQ(ctx, restored, run);
+
+    // Spans several 64 KiB blocks and mixes incompressible and repeated data.
+    std::mt19937 random(7);
+    std::string mixed;
+    while (mixed.size() < 200000)
+    {
+        for (int i = 0; i < 300; ++i)
+        {
+            mixed.push_back(static_cast<char>(random() & 0xFF));
+        }
+        mixed += "{\"metric\":{\"__name__\":\"edge_if_rx_bytes\",\"device\":\"busstop-001\"}}\n";
+    }
+    edge_probe::snappy_compress(mixed, compressed);
+    EXPECT_TRUE(ctx, compressed.size() < mixed.size());
+    EXPECT_TRUE(ctx, edge_probe::snappy_uncompress(compressed, restored));
+    EXPECT_TRUE(ctx, restored == mixed);
+
+    EXPECT_TRUE(ctx, !edge_probe::snappy_uncompress(
+                          std::string_view(compressed).substr(0, compressed.size() - 1),
+                          restored));
+    std::string bad_offset = compressed;
+    bad_offset[0] = static_cast<char>(0x80);
+    EXPECT_TRUE(ctx, !edge_probe::snappy_uncompress(bad_offset, restored));
+    EXPECT_TRUE(ctx, !edge_probe::snappy_uncompress(std::string("\x05\x09\x00", 3), restored));
+
+    PayloadCompressor compressor(PayloadCompression::snappy);
+    EXPECT_TRUE(ctx, edge_probe::snappy_uncompress(compressor.compress(mixed), restored));
+    EXPECT_TRUE(ctx, restored == mixed);
+}
+
+void test_remote_write_encoder(TestContext &ctx)
+{
+    edge_probe::RemoteWriteEncoder encoder;
+    EXPECT_TRUE(ctx, encoder.add({"up", 1.0, {{"job", "a"}}, 1}, 1024));
+
+    // WriteRequest{timeseries: {labels: [__name__=up, job=a], samples: [{1.0, 1}]}}
+    const std::string expected = std::string("\x0a\x27", 2) +
+                                 std::string("\x0a\x0e\x0a\x08__name__\x12\x02up", 16) +
+                                 std::string("\x0a\x08\x0a\x03job\x12\x01" "a", 10) +
+                                 std::string("\x12\x0b\x09\0\0\0\0\0\0\xf0\x3f\x10\x01", 13);
+    EXPECT_EQ(ctx, encoder.payload(), expected);
+    EXPECT_EQ(ctx, encoder.size_bytes(), expected.size());
+
+    // Same label set joins the series; labels sorting before __name__ stay ahead of it.
+    EXPECT_TRUE(ctx, encoder.add({"up", 0.0, {{"job", "a"}}, 2}, 1024));
+    EXPECT_TRUE(ctx, encoder.add({"up", 0.0, {{"Zone", "b"}}, 2}, 1024));
+    EXPECT_EQ(ctx, encoder.series_count(), std::size_t {2});
+    EXPECT_EQ(ctx, encoder.size_bytes(), encoder.payload().size());
+    const std::string zone_first("\x0a\x04Zone\x12\x01" "b\x0a\x0e\x0a\x08__name__", 21);
+    EXPECT_TRUE(ctx, encoder.payload().find(zone_first) != std::string::npos);
+
+    // Growing one series until its length prefix needs a second byte keeps the
+    // tracked size exact.
+    for (int i = 0; i < 20; ++i)
+    {
+        EXPECT_TRUE(ctx, encoder.add({"up", 1.0, {{"job", "a"}}, 1700000000000LL + i}, 4096));
+    }
+    EXPECT_EQ(ctx, encoder.size_bytes(), encoder.payload().size());
+
+    const std::size_t before = encoder.size_bytes();
+    EXPECT_TRUE(ctx, !encoder.add({"down", 1.0, {}, 1}, before + 4));
+    EXPECT_EQ(ctx, encoder.size_bytes(), before);
+
+    std::string taken;
+    encoder.take_payload(taken);
+    EXPECT_EQ(ctx, taken.size(), before);
+    encoder.clear();
+    EXPECT_EQ(ctx, encoder.size_bytes(), std::size_t {0});
+    EXPECT_TRUE(ctx, encoder.payload().empty());
+}
+
+void test_sender_remote_write(TestContext &ctx)
+{
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    auto transport = std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+
+    TelemetryConfig config;
+    config.max_batch_samples = 3;
+    config.payload_format = PayloadFormat::remote_write;
+    TelemetryWriter writer(config, transport, clock);
+
+    EXPECT_TRUE(ctx, writer.submit({"edge_a", 1.0, {{"device", "x"}}, 1000}));
+    EXPECT_TRUE(ctx, writer.submit({"edge_b", 2.0, {{"device", "x"}}, 1000}));
+    EXPECT_TRUE(ctx, writer.submit({"edge_a", 3.0, {{"device", "x"}}, 2000}));
+    writer.tick();
+
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {1});
+    if (transport->bodies.size() == 1)
+    {
+        EXPECT_TRUE(ctx, transport->encodings.front() == PayloadCompression::snappy);
+
+        edge_probe::RemoteWriteEncoder expected;
+        expected.add({"edge_a", 1.0, {{"device", "x"}}, 1000}, 1024);
+        expected.add({"edge_b", 2.0, {{"device", "x"}}, 1000}, 1024);
+        expected.add({"edge_a", 3.0, {{"device", "x"}}, 2000}, 1024);
+
+        std::string restored;
+        EXPECT_TRUE(ctx, edge_probe::snappy_uncompress(transport->bodies.front(), restored));
+        EXPECT_EQ(ctx, restored, expected.payload());
+    }
+
+    config.compression = PayloadCompression::gzip;
+    bool threw = false;
+    try
+    {
+        TelemetryWriter rejected(config, transport, clock);
+    }
+    catch (const std::invalid_argument &)
+    {
+        threw = true;
+    }
+    EXPECT_TRUE(ctx, threw);
+
+    config.payload_format = PayloadFormat::json_lines;
+    config.compression = PayloadCompression::snappy;
+    threw = false;
+    try
+    {
+        TelemetryWriter rejected(config, transport, clock);
+    }
+    catch (const std::invalid_argument &)
+    {
+        threw = true;
+    }
+    EXPECT_TRUE(ctx, threw);
+}
+
+void test_label_set(TestContext &ctx)
+{
+    LabelSet labels {{"zone", "b"}, {"device", "bus"}, {"zone", "a"}};
+    EXPECT_EQ(ctx, labels.size(), std::size_t {2});
+    EXPECT_EQ(ctx, labels.begin()->name, std::string("device"));
+    EXPECT_EQ(ctx, *labels.find("zone"), std::string("b"));
+    EXPECT_TRUE(ctx, labels.find("host") == nullptr);
+    EXPECT_TRUE(ctx, !labels.emplace("zone", "c"));
+
+    labels["host"] = "gw";
+    labels["addr"];
+    EXPECT_EQ(ctx, labels.size(), std::size_t {4});
+    EXPECT_TRUE(ctx, labels.contains("addr"));
+    EXPECT_EQ(ctx, *labels.find("host"), std::string("gw"));
+
+    // Outgrowing the inline slots keeps order, lookups and copies intact.
+    for (const char *name : {"c", "e", "y", "b"})
+    {
+        EXPECT_TRUE(ctx, labels.emplace(name, std::string(name) + "-value-past-sso-size"));
+    }
+    EXPECT_EQ(ctx, labels.size(), std::size_t {8});
+    std::string names;
+    for (const auto &[name, value] : labels)
+    {
+        names += name + ",";
+    }
+    EXPECT_EQ(ctx, names, std::string("addr,b,c,device,e,host,y,zone,"));
+    EXPECT_EQ(ctx, *labels.find("e"), std::string("e-value-past-sso-size"));
+
+    const LabelSet copied = labels;
+    EXPECT_TRUE(ctx, copied == labels);
+    EXPECT_TRUE(ctx, labels.erase("c"));
+    EXPECT_TRUE(ctx, !labels.erase("c"));
+    EXPECT_TRUE(ctx, copied != labels);
+
+    // A moved-from set is empty and reusable, whichever storage it used.
+    LabelSet moved = std::move(labels);
+    EXPECT_EQ(ctx, moved.size(), std::size_t {7});
+    EXPECT_EQ(ctx, labels.size(), std::size_t {0});
+    EXPECT_TRUE(ctx, labels.begin() == labels.end());
+    EXPECT_TRUE(ctx, labels.find("zone") == nullptr);
+    labels.clear();
+    for (const char *name : {"q", "p", "o", "n", "m"})
+    {
+        EXPECT_TRUE(ctx, labels.emplace(name, name));
+    }
+    EXPECT_TRUE(ctx, labels.erase("o"));
+    names.clear();
+    for (const auto &[name, value] : labels)
+    {
+        names += name + ",";
+    }
+    EXPECT_EQ(ctx, names, std::string("m,n,p,q,"));
+    labels = std::move(moved);
+    EXPECT_EQ(ctx, labels.size(), std::size_t {7});
+    EXPECT_EQ(ctx, moved.size(), std::size_t {0});
+    moved.clear();
+    EXPECT_TRUE(ctx, moved.emplace("a", "1"));
+
+    LabelSet small {{"b", "2"}, {"a", "1"}, {"c", "3"}};
+    EXPECT_TRUE(ctx, small.erase("a"));
+    EXPECT_EQ(ctx, small.begin()->name, std::string("b"));
+    EXPECT_TRUE(ctx, small == (LabelSet {{"c", "3"}, {"b", "2"}}));
+    small.clear();
+    EXPECT_TRUE(ctx, small.empty());
+    EXPECT_TRUE(ctx, small.emplace("a", "1"));
+}
+
+void test_series_registry(TestContext &ctx)
+{
+    SeriesRegistry registry;
+    const LabelSet if_labels {{"interface", "wlan0"}, {"device", "bus"}};
+    const auto first = registry.intern("edge_if_up", if_labels);
+    EXPECT_EQ(ctx, registry.intern("edge_if_up", {{"interface", "wlan0"}, {"device", "bus"}}),
+              first);
+    EXPECT_EQ(ctx, registry.intern(MetricSample {"edge_if_up", 0.0, if_labels, 0}), first);
+    EXPECT_EQ(ctx, registry.size(), std::size_t {1});
+
+    EXPECT_TRUE(ctx, registry.intern("edge_if_up", {{"interface", "end0"}, {"device", "bus"}}) !=
+                         first);
+    EXPECT_TRUE(ctx, registry.intern("edge_if_up", {{"device", "bus"}}) != first);
+    // A repeated name keeps its first value, like std::map::emplace.
+    const auto duplicate = registry.intern("edge_x", {{"a", "1"}, {"a", "2"}, {"b", ""}});
+    EXPECT_EQ(ctx, registry.labels(duplicate).size(), std::size_t {2});
+    EXPECT_EQ(ctx, std::string(registry.labels(duplicate).begin()->value), std::string("1"));
+
+    EXPECT_EQ(ctx, std::string(registry.name(first)), std::string("edge_if_up"));
+    const auto labels = registry.labels(first);
+    EXPECT_EQ(ctx, labels.size(), std::size_t {2});
+    EXPECT_EQ(ctx, std::string(labels.begin()->name), std::string("device"));
+    EXPECT_EQ(ctx, std::string((labels.begin() + 1)->value), std::string("wlan0"));
+
+    // Views stay valid while the arena and index grow.
+    const char *name_data = registry.name(first).data();
+    std::vector<edge_probe::SeriesId> ids;
+    for (int i = 0; i < 2000; ++i)
+    {
+        ids.push_back(registry.intern("edge_rule_packets", {{"rule", std::to_string(i)}}));
+    }
+    EXPECT_TRUE(ctx, registry.name(first).data() == name_data);
+    bool stable = true;
+    for (int i = 0; i < 2000; ++i)
+    {
+        stable = stable &&
+                 registry.intern("edge_rule_packets", {{"rule", std::to_string(i)}}) == ids[i] &&
+                 registry.labels(ids[i]).begin()->value == std::to_string(i);
+    }
+    EXPECT_TRUE(ctx, stable);
+    EXPECT_TRUE(ctx, registry.contains(ids.back()));
+    EXPECT_TRUE(ctx, !registry.contains(static_cast<edge_probe::SeriesId>(registry.size())));
+    EXPECT_TRUE(ctx, registry.memory_bytes() > 0);
+}
+
+void test_sender_series_registry(TestContext &ctx)
+{
+    const std::vector<MetricSample> samples {
+        {"edge_a", 1.0, {{"device", "x"}}, 1000},
+        {"edge_b", 2.0, {{"device", "x"}, {"path", "\"q\""}}, 1000},
+        {"edge_a", 3.0, {{"device", "x"}}, 2000},
+    };
+
+    for (const auto format : {PayloadFormat::json_lines, PayloadFormat::remote_write})
+    {
+        for (const bool grouped : {false, true})
+        {
+            auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+            TelemetryConfig config;
+            config.max_batch_samples = samples.size();
+            config.payload_format = format;
+            config.group_series = grouped;
+
+            auto by_sample =
+                std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+            TelemetryWriter sample_writer(config, by_sample, clock);
+            auto by_series =
+                std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+            TelemetryWriter series_writer(config, by_series, clock);
+
+            SeriesRegistry registry;
+            for (const auto &sample : samples)
+            {
+                EXPECT_TRUE(ctx, sample_writer.submit(sample));
+                const SeriesSample interned {
+                    registry.intern(sample), sample.value, sample.timestamp_ms};
+                EXPECT_TRUE(ctx, series_writer.submit(registry, interned));
+            }
+            sample_writer.tick();
+            series_writer.tick();
+
+            EXPECT_EQ(ctx, by_series->bodies.size(), std::size_t {1});
+            EXPECT_TRUE(ctx, by_series->bodies == by_sample->bodies);
+        }
+    }
+
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    auto transport = std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+    TelemetryWriter writer(TelemetryConfig {}, transport, clock);
+    SeriesRegistry registry;
+    EXPECT_TRUE(ctx, !writer.submit(registry, SeriesSample {7, 1.0, 0}));
+    EXPECT_EQ(ctx, writer.dropped_samples(), std::uint64_t {1});
+    EXPECT_EQ(ctx, writer.buffered_samples(), std::size_t {0});
+}
+
+void test_sender_submit_batch(TestContext &ctx)
+{
+    auto clock = std::make_shared<TickingClock>();
+    auto transport = std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+    TelemetryConfig config;
+    config.max_batch_samples = 2;
+    TelemetryWriter writer(config, transport, clock);
+
+    std::vector<MetricSample> samples {
+        {"edge_a", 1.0, {{"device", "x"}}, 0},
+        {"edge_b", 2.0, {{"device", "x"}}, 5000},
+        {"edge_c", 3.0, {{"device", "x"}}, 0},
+        {"edge_d", 4.0, {{"device", "x"}}, 0},
+        {"edge_e", 5.0, {{"device", "x"}}, 0},
+    };
+    const auto result = writer.submit_batch(std::move(samples));
+    EXPECT_EQ(ctx, result.accepted, std::size_t {5});
+    EXPECT_EQ(ctx, result.dropped, std::size_t {0});
+    EXPECT_EQ(ctx, clock->unix_reads_, int64_t {1});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {2});
+    EXPECT_TRUE(ctx, transport->bodies.empty());
+    EXPECT_EQ(ctx, writer.buffered_samples(), std::size_t {1});
+
+    writer.force_flush();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {3});
+    if (transport->bodies.size() == 3)
+    {
+        EXPECT_TRUE(ctx, transport->bodies[0].find("\"timestamps\":[1700000000001]") !=
+                             std::string::npos);
+        EXPECT_TRUE(ctx, transport->bodies[0].find("\"timestamps\":[5000]") !=
+                             std::string::npos);
+        EXPECT_TRUE(ctx, transport->bodies[2].find("\"timestamps\":[1700000000001]") !=
+                             std::string::npos);
+    }
+    EXPECT_EQ(ctx, writer.submit_batch({}).accepted, std::size_t {0});
+
+    SeriesRegistry registry;
+    const auto known = registry.intern("edge_known", {{"device", "x"}});
+    const auto partial = writer.submit_batch(
+        registry, {{known, 1.0, 0}, {known + 7, 2.0, 0}, {known, 3.0, 9000}});
+    EXPECT_EQ(ctx, partial.accepted, std::size_t {2});
+    EXPECT_EQ(ctx, partial.dropped, std::size_t {1});
+    EXPECT_EQ(ctx, writer.dropped_samples(), std::uint64_t {1});
+    EXPECT_EQ(ctx, writer.queued_payloads(), std::size_t {1});
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {3});
+}
+
+void test_metric_prefix_cache(TestContext &ctx)
+{
+    const MetricSample a {"edge_a", 1.0, {{"path", "C:\\tmp"}}, 0};
+    const MetricSample b {"edge_b", 1.0, {}, 0};
+    const MetricSample c {"edge_a", 1.0, {{"path", "D:\\tmp"}}, 0};
+
+    edge_probe::MetricPrefixCache cache(2);
+    std::string cached;
+    std::string expected;
+    for (const auto *sample : {&a, &b, &a, &c, &a, &b})
+    {
+        cache.append_metric(*sample, cached);
+        edge_probe::JsonLinesEncoder::append_metric(*sample, expected);
+    }
+    EXPECT_EQ(ctx, cached, expected);
+    // a, b miss; a hits; c evicts b; a hits; b evicts c.
+    EXPECT_EQ(ctx, cache.hits(), std::uint64_t {2});
+    EXPECT_EQ(ctx, cache.misses(), std::uint64_t {4});
+    EXPECT_EQ(ctx, cache.evictions(), std::uint64_t {2});
+    EXPECT_EQ(ctx, cache.size(), std::size_t {2});
+
+    SeriesRegistry registry;
+    const auto id = registry.intern(a);
+    cached.clear();
+    expected.clear();
+    cache.append_metric(registry, id, cached);
+    edge_probe::JsonLinesEncoder::append_metric(registry, id, expected);
+    EXPECT_EQ(ctx, cached, expected);
+    EXPECT_EQ(ctx, cache.hits(), std::uint64_t {3});
+
+    // The writer reuses prefixes across cycles and produces the same bytes.
+    for (const bool grouped : {false, true})
+    {
+        auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+        TelemetryConfig config;
+        config.max_batch_samples = 6;
+        config.group_series = grouped;
+        auto with_cache = std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+        TelemetryWriter cached_writer(config, with_cache, clock);
+        config.metric_prefix_cache_entries = 0;
+        auto without = std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+        TelemetryWriter plain_writer(config, without, clock);
+
+        for (int cycle = 0; cycle < 2; ++cycle)
+        {
+            for (const auto *sample : {&a, &b, &c})
+            {
+                MetricSample stamped = *sample;
+                stamped.timestamp_ms = 1700000000000LL + cycle * 10000;
+                EXPECT_TRUE(ctx, cached_writer.submit(stamped));
+                EXPECT_TRUE(ctx, plain_writer.submit(stamped));
+            }
+        }
+        cached_writer.tick();
+        plain_writer.tick();
+
+        EXPECT_EQ(ctx, with_cache->bodies.size(), std::size_t {1});
+        EXPECT_TRUE(ctx, with_cache->bodies == without->bodies);
+        EXPECT_EQ(ctx, cached_writer.prefix_cache_hits(), std::uint64_t {3});
+        EXPECT_EQ(ctx, cached_writer.prefix_cache_misses(), std::uint64_t {3});
+        EXPECT_EQ(ctx, plain_writer.prefix_cache_hits(), std::uint64_t {0});
+
+        bool reported = false;
+        for (const auto &metric : cached_writer.self_metrics())
+        {
+            if (metric.name == "edge_sender_prefix_cache_hits_total")
+            {
+                reported = metric.value == 3.0;
+            }
+        }
+        EXPECT_TRUE(ctx, reported);
+    }
+}
+
+void test_sender_external_labels(TestContext &ctx)
+{
+    const edge_probe::ExternalLabels external {
+        {"device", "fleet-default"}, {"fixture", "cmd_txt"}, {"site", "s1"}};
+    const std::vector<MetricSample> samples {
+        {"edge_a", 1.0, {{"device", "x"}, {"zone", "1"}}, 1700000000000LL},
+        {"edge_b", 2.0, {}, 1700000000000LL},
+    };
+
+    // The same samples with the external labels merged by hand, as
+    // append_metrics() used to do.
+    std::vector<MetricSample> merged = samples;
+    for (auto &sample : merged)
+    {
+        for (const auto &[key, value] : external)
+        {
+            sample.labels.emplace(key, value);
+        }
+    }
+
+    for (const auto format : {PayloadFormat::json_lines, PayloadFormat::remote_write})
+    {
+        for (const bool grouped : {false, true})
+        {
+            for (const std::size_t cache_entries : {std::size_t {0}, std::size_t {16}})
+            {
+                auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+                TelemetryConfig config;
+                config.max_batch_samples = samples.size();
+                config.payload_format = format;
+                config.group_series = grouped;
+                config.metric_prefix_cache_entries = cache_entries;
+
+                auto expected =
+                    std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+                TelemetryWriter merged_writer(config, expected, clock);
+                config.external_labels = external;
+                auto actual =
+                    std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+                TelemetryWriter writer(config, actual, clock);
+
+                SeriesRegistry registry;
+                for (std::size_t i = 0; i < samples.size(); ++i)
+                {
+                    EXPECT_TRUE(ctx, merged_writer.submit(merged[i]));
+                    const SeriesSample interned {
+                        registry.intern(samples[i]), samples[i].value, samples[i].timestamp_ms};
+                    EXPECT_TRUE(ctx, writer.submit(registry, interned));
+                }
+                merged_writer.tick();
+                writer.tick();
+
+                EXPECT_EQ(ctx, actual->bodies.size(), std::size_t {1});
+                EXPECT_TRUE(ctx, actual->bodies == expected->bodies);
+            }
+        }
+    }
+
+    auto clock = std::make_shared<ManualClock>(1000, 1700000000000LL);
+    auto transport = std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+    TelemetryConfig config;
+    config.max_batch_samples = 1;
+    config.external_labels = external;
+    TelemetryWriter writer(config, transport, clock);
+    EXPECT_TRUE(ctx, writer.submit(samples.front()));
+    writer.tick();
+    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {1});
+    if (!transport->bodies.empty())
+    {
+        EXPECT_EQ(ctx,
+                  transport->bodies.front(),
+                  std::string("{\"metric\":{\"__name__\":\"edge_a\",\"device\":\"x\","
+                              "\"fixture\":\"cmd_txt\",\"site\":\"s1\",\"zone\":\"1\"},"
+                              "\"values\":[1],\"timestamps\":[1700000000000]}\n"));
+    }
+
+    config.external_labels = {{"__name__", "x"}};
+    bool threw = false;
+    try
+    {
+        TelemetryWriter rejected(config, transport, clock);
+    }
+    catch (const std::invalid_argument &)
+    {
+        threw = true;
+    }
+    EXPECT_TRUE(ctx, threw);
+}
+
+void test_json_lines_encoder(TestContext &ctx)
+{
+    edge_probe::JsonLinesEncoder encoder(1024);
+    const std::size_t reserved = encoder.capacity();
+
+    encoder.append({"edge_test_metric",
+                    0.1,
+                    {{"device", "bus\"stop"}, {"path", "C:\\tmp\n"}},
+                    1700000000000LL});
+    encoder.append({"edge_raw_bytes", 1005356.0 * 1024.0, {}, -5});
+    encoder.append({"edge_ctrl", -2.5e-7, {{"raw", std::string("a\x01" "b")}}, 7});
+
+    EXPECT_EQ(ctx,
+              encoder.buffer(),
+              std::string("{\"metric\":{\"__name__\":\"edge_test_metric\","
+                          "\"device\":\"bus\\\"stop\",\"path\":\"C:\\\\tmp\\n\"},"
+                          "\"values\":[0.1],\"timestamps\":[1700000000000]}\n"
+                          "{\"metric\":{\"__name__\":\"edge_raw_bytes\"},"
+                          "\"values\":[1029484544],\"timestamps\":[-5]}\n"
+                          "{\"metric\":{\"__name__\":\"edge_ctrl\",\"raw\":\"a\\u0001b\"},"
+                          "\"values\":[-2.5e-07],\"timestamps\":[7]}\n"));
+    EXPECT_EQ(ctx, encoder.capacity(), reserved);
+
+    const std::size_t first_line = encoder.buffer().find('\n') + 1;
+    encoder.truncate(first_line);
+    EXPECT_EQ(ctx, encoder.size(), first_line);
+    encoder.truncate(first_line + 10);
+    EXPECT_EQ(ctx, encoder.size(), first_line);
+
+    encoder.clear();
+    EXPECT_TRUE(ctx, encoder.empty());
+    EXPECT_EQ(ctx, encoder.capacity(), reserved);
+}
+
+void test_json_escape_kernels(TestContext &ctx)
+{
+    using edge_probe::JsonEscapeKernel;
+
+    std::vector<std::string> corpus;
+    for (int ch = 0; ch < 256; ++ch)
+    {
+        corpus.emplace_back(1, static_cast<char>(ch));
+        corpus.push_back(std::string(40, 'a') + static_cast<char>(ch) + std::string(7, 'z'));
+    }
+    for (const std::size_t position : {0, 31, 32, 1023, 1500, 2047})
+    {
+        std::string value(2048, 'x');
+        value[position] = position % 2 == 0 ? '\x02' : '"';
+        corpus.push_back(std::move(value));
+    }
+    corpus.emplace_back("");
+    corpus.emplace_back("NJTransit - Free WiFi");
+    corpus.emplace_back("iifname \"wlan0\" oifname \"wwx00217edb231f\" accept");
+
+    std::mt19937 rng(20240607);
+    const std::string alphabet = std::string("abcXYZ09 -_/:.\"\\\n\t\x01\x1f\x7f") +
+                                 static_cast<char>(0x80) + static_cast<char>(0xff);
+    for (std::size_t length = 1; length <= 130; ++length)
+    {
+        for (int round = 0; round < 4; ++round)
+        {
+            std::string value;
+            for (std::size_t i = 0; i < length; ++i)
+            {
+                value.push_back(alphabet[rng() % alphabet.size()]);
+            }
+            corpus.push_back(std::move(value));
+        }
+    }
+
+    EXPECT_TRUE(ctx,
+                edge_probe::json_escape_kernel_supported(
+                    edge_probe::json_escape_active_kernel()));
 
-    TelemetryConfig config;
-    config.max_batch_samples = 5;
-    config.max_pending_payload_bytes = 32;
+    for (const auto kernel : {JsonEscapeKernel::scalar,
+                              JsonEscapeKernel::sse2,
+                              JsonEscapeKernel::avx2,
+                              JsonEscapeKernel::neon})
+    {
+        if (!edge_probe::json_escape_kernel_supported(kernel))
+        {
+            continue;
+        }
 
-    TelemetryWriter writer(config, transport, clock);
-    EXPECT_TRUE(ctx, writer.submit({"edge_large_metric_name", 1.0, {{"device", "x"}}, 0}));
-    writer.force_flush();
+        std::size_t mismatches = 0;
+        for (const auto &value : corpus)
+        {
+            std::string appended = "prefix:";
+            edge_probe::json_escape(value, appended, kernel);
+            if (appended != "prefix:" + reference_json_escape(value))
+            {
+                ++mismatches;
+            }
+        }
+        ctx.expect(mismatches == 0,
+                   std::string("json_escape kernel ") +
+                       edge_probe::json_escape_kernel_name(kernel) +
+                       " differs from reference",
+                   __LINE__);
+    }
 
-    EXPECT_EQ(ctx, writer.dropped_batches(), std::uint64_t {1});
-    EXPECT_EQ(ctx, transport->bodies.size(), std::size_t {0});
-    EXPECT_EQ(ctx, writer.sent_batches(), std::uint64_t {0});
+    std::size_t mismatches = 0;
+    for (const auto &value : corpus)
+    {
+        if (edge_probe::json_escape(value) != reference_json_escape(value))
+        {
+            ++mismatches;
+        }
+    }
+    EXPECT_EQ(ctx, mismatches, std::size_t {0});
 }
 
 void test_system_identity_parser(TestContext &ctx)
@@ -759,6 +2811,871 @@ void test_neighbor_parser(TestContext &ctx)
                 0.001);
 }
 
+// Shapes the fixture does not contain, pinned to what the original regex
+// parsers produced.
+void test_parser_edge_cases(TestContext &ctx)
+{
+    auto status = edge_probe::parse_systemd_status("svc",
+                                                   "CPU: 1min 2.5s 250ms\n"
+                                                   "Memory: 1.5M\n"
+                                                   "Tasks: 3 (limit: 4915)\n"
+                                                   "Main PID: 42 (svc)\n");
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx, status, "edge_service_cpu_seconds"),
+                62.75,
+                0.0001);
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx, status, "edge_service_memory_bytes"),
+                1.5 * 1024.0 * 1024.0,
+                0.001);
+    EXPECT_NEAR(ctx, require_metric_value(ctx, status, "edge_service_task_limit"), 4915.0, 0.001);
+    EXPECT_NEAR(ctx, require_metric_value(ctx, status, "edge_service_main_pid"), 42.0, 0.001);
+
+    auto iw_dev = edge_probe::parse_iw_dev(
+        "Interface wlan1\n\tAddr AA:BB:CC:00:11:22\n\tssid edge net\n\ttype AP\n");
+    require_metric_present(ctx,
+                           iw_dev,
+                           "edge_wifi_ap_info",
+                           {{"interface", "wlan1"},
+                            {"mac", "AA:BB:CC:00:11:22"},
+                            {"ssid", "edge net"},
+                            {"type", "AP"}});
+
+    auto iptables = edge_probe::parse_iptables(
+        "Chain OUTPUT (policy ACCEPT 12 packets, 1.5MiB bytes)\n"
+        "    7   2K ACCEPT     0    --  *      lo      0.0.0.0/0            0.0.0.0/0\n");
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx,
+                                     iptables,
+                                     "edge_firewall_iptables_chain_policy_bytes",
+                                     {{"chain", "OUTPUT"}}),
+                1.5 * 1024.0 * 1024.0,
+                0.001);
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx,
+                                     iptables,
+                                     "edge_firewall_iptables_rule_bytes",
+                                     {{"chain", "OUTPUT"}, {"output", "lo"}}),
+                2048.0,
+                0.001);
+
+    // The last counter on a line is the one reported.
+    auto nft = edge_probe::parse_nft_ruleset(
+        "table inet t {\nchain c{\ncounter packets 1 bytes 2 counter packets 3 bytes 4 drop\n"
+        "}\n}\n");
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx,
+                                     nft,
+                                     "edge_firewall_nft_rule_bytes",
+                                     {{"table", "t"},
+                                      {"chain", "c"},
+                                      {"expression", "counter packets 1 bytes 2 drop"}}),
+                4.0,
+                0.001);
+
+    EXPECT_TRUE(ctx, edge_probe::parse_loadavg("0.10 0.20 0.30 1/99").empty());
+    auto meminfo = edge_probe::parse_meminfo("HugePages_Total:       0\nBad: 12 kB extra\n");
+    EXPECT_EQ(ctx, meminfo.size(), static_cast<std::size_t>(1));
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx,
+                                     meminfo,
+                                     "edge_system_meminfo_bytes",
+                                     {{"field", "HugePages_Total"}}),
+                0.0,
+                0.001);
+}
+
+void write_text_file(const std::filesystem::path &path, const std::string &contents)
+{
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    output << contents;
+}
+
+void test_system_health_reader(TestContext &ctx)
+{
+    TempDirectory dir;
+    const std::filesystem::path proc = dir.path() + "/proc";
+    const std::filesystem::path sys = dir.path() + "/sys";
+    write_text_file(proc / "loadavg", slice_lines(405, 405));
+    std::string meminfo = slice_lines(406, 425) + "\n";
+    for (int i = 0; i < 5; ++i)
+    {
+        meminfo += "Extra" + std::to_string(i) + ":  1 kB\n";
+    }
+    write_text_file(proc / "meminfo", meminfo);
+    write_text_file(proc / "net" / "dev", slice_lines(426, 432));
+    write_text_file(sys / "class" / "thermal" / "thermal_zone0" / "temp", "48000\n");
+    write_text_file(sys / "class" / "thermal" / "thermal_zone10" / "temp", "51500\n");
+    write_text_file(sys / "class" / "thermal" / "cooling_device0" / "cur_state", "0\n");
+    write_text_file(sys / "class" / "hwmon" / "hwmon1" / "name", "coretemp\n");
+    write_text_file(sys / "class" / "hwmon" / "hwmon1" / "temp1_input", "62000\n");
+    write_text_file(sys / "class" / "hwmon" / "hwmon1" / "temp1_label", "Package id 0\n");
+    write_text_file(sys / "class" / "hwmon" / "hwmon1" / "temp2_input", "59000\n");
+    write_text_file(sys / "class" / "hwmon" / "hwmon1" / "fan1_input", "1200\n");
+
+    edge_probe::SystemHealthReader reader(proc.string(), sys.string());
+    EXPECT_EQ(ctx, reader.thermal_zones(), std::size_t {2});
+    EXPECT_EQ(ctx, reader.hwmon_sensors(), std::size_t {2});
+    EXPECT_EQ(ctx, reader.open_files(), std::size_t {7});
+
+    // Same samples as the shell path for the files it reads.
+    std::vector<MetricSample> expected = edge_probe::parse_loadavg(slice_lines(405, 405));
+    for (auto &sample : edge_probe::parse_meminfo(slice_lines(406, 425)))
+    {
+        expected.push_back(std::move(sample));
+    }
+    for (auto &sample : edge_probe::parse_proc_net_dev(slice_lines(426, 432)))
+    {
+        expected.push_back(std::move(sample));
+    }
+    std::vector<MetricSample> metrics;
+    reader.collect(metrics);
+    EXPECT_EQ(ctx, metrics.size(), expected.size() + 4);
+    bool same_prefix = metrics.size() >= expected.size();
+    for (std::size_t i = 0; same_prefix && i < expected.size(); ++i)
+    {
+        same_prefix = metrics[i].name == expected[i].name &&
+                      metrics[i].value == expected[i].value &&
+                      metrics[i].labels == expected[i].labels;
+    }
+    EXPECT_TRUE(ctx, same_prefix);
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx,
+                                     metrics,
+                                     "edge_system_temperature_celsius",
+                                     {{"zone", "thermal_zone10"}}),
+                51.5,
+                0.001);
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx,
+                                     metrics,
+                                     "edge_system_hwmon_temperature_celsius",
+                                     {{"hwmon", "hwmon1"},
+                                      {"chip", "coretemp"},
+                                      {"sensor", "Package id 0"}}),
+                62.0,
+                0.001);
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx,
+                                     metrics,
+                                     "edge_system_hwmon_temperature_celsius",
+                                     {{"sensor", "temp2"}}),
+                59.0,
+                0.001);
+
+    // The kept-open descriptors see rewritten contents on the next cycle.
+    write_text_file(proc / "loadavg", "1.50 0.75 0.25 2/140 9999\n");
+    write_text_file(sys / "class" / "thermal" / "thermal_zone0" / "temp", "\n");
+    metrics.clear();
+    reader.collect(metrics);
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx,
+                                     metrics,
+                                     "edge_system_load_average",
+                                     {{"window", "1m"}}),
+                1.5,
+                0.001);
+    EXPECT_NEAR(ctx, require_metric_value(ctx, metrics, "edge_system_last_pid", {}), 9999.0, 0.001);
+    EXPECT_TRUE(ctx,
+                find_metric(metrics,
+                            "edge_system_temperature_celsius",
+                            {{"zone", "thermal_zone0"}}) == nullptr);
+    EXPECT_EQ(ctx, reader.read_failures(), std::uint64_t {0});
+
+    edge_probe::SystemHealthReader missing(dir.path() + "/absent", dir.path() + "/absent");
+    EXPECT_EQ(ctx, missing.open_files(), std::size_t {0});
+    metrics.clear();
+    missing.collect(metrics);
+    EXPECT_TRUE(ctx, metrics.empty());
+}
+
+void test_parsers_skip_lines_without_allocating(TestContext &ctx)
+{
+    // The counter sees every form of new the standard library may pick, such
+    // as the nothrow one behind std::stable_sort's buffer.
+    struct alignas(64) Aligned
+    {
+        char bytes[64];
+    };
+    // Volatile pointers keep the compiler from pairing away new and delete.
+    const std::uint64_t start = edge_probe_testing::thread_allocation_count();
+    int *volatile number = new int(1);
+    delete number;
+    int *volatile numbers = new int[4];
+    delete[] numbers;
+    void *volatile raw = ::operator new(16, std::nothrow);
+    ::operator delete(raw);
+    Aligned *volatile aligned = new Aligned;
+    delete aligned;
+    Aligned *volatile aligned_array = new (std::nothrow) Aligned[2];
+    delete[] aligned_array;
+    const std::uint64_t counted = edge_probe_testing::thread_allocation_count() - start;
+    EXPECT_EQ(ctx, counted, std::uint64_t {5});
+
+    // Lines a parser passes over must not allocate, so doubling the number of
+    // such lines in a capture leaves its allocation count unchanged.
+    using Parse = std::function<std::vector<MetricSample>(const std::string &)>;
+    struct Case
+    {
+        std::string parser;
+        std::string capture;
+        std::string skipped_line;
+        Parse parse;
+    };
+    const auto systemd_status = [](const std::string &output) {
+        return edge_probe::parse_systemd_status("hostapd", output);
+    };
+    const auto mmcli = [](const std::string &output) {
+        return edge_probe::parse_mmcli_snapshot("/usr/bin/mmcli", "", output);
+    };
+    const auto system_identity = [](const std::string &output) {
+        return edge_probe::parse_system_identity(
+            slice_lines(6, 6), output, slice_lines(16, 16), slice_lines(17, 18));
+    };
+    const std::vector<Case> cases = {
+        {"system_identity", slice_lines(7, 15), "# managed by image builder\n", system_identity},
+        {"ip_br_link", slice_lines(27, 31), "   \n", edge_probe::parse_ip_br_link},
+        {"ip_br_addr", slice_lines(32, 36), "\t\n", edge_probe::parse_ip_br_addr},
+        {"ip_route", slice_lines(37, 41), "\n", edge_probe::parse_ip_route},
+        {"iw_dev", slice_lines(52, 58), "\tmulticast TXQ:\n", edge_probe::parse_iw_dev},
+        {"iw_phy", slice_lines(59, 295), "\tHT Capability overrides:\n", edge_probe::parse_iw_phy},
+        {"list_units", slice_lines(311, 313), "UNIT LOAD ACTIVE\n",
+         edge_probe::parse_service_list_units},
+        {"systemd_status",
+         slice_lines(314, 331),
+         "Oct 18 10:00:00 ap hostapd[612]: wlan0: STA 02:00:00:00:00:01 WPA: group key handshake\n",
+         systemd_status},
+        {"dnsmasq_leases", slice_lines(377, 377), "duid 00:01:00:01\n",
+         edge_probe::parse_dnsmasq_leases},
+        {"mmcli", "  state: connected\n", "  -----------------------\n", mmcli},
+        {"nmcli", slice_lines(386, 390), "DEVICE  TYPE  STATE  CONNECTION\n",
+         edge_probe::parse_nmcli_device_status},
+        {"meminfo", slice_lines(406, 425), "no colon here\n", edge_probe::parse_meminfo},
+        {"proc_net_dev",
+         slice_lines(426, 432),
+         " face |bytes    packets errs drop fifo frame compressed multicast\n",
+         edge_probe::parse_proc_net_dev},
+        {"iptables",
+         slice_lines(485, 553),
+         " pkts bytes target     prot opt in     out     source               destination\n",
+         edge_probe::parse_iptables},
+        {"nft", slice_lines(555, 691), "type filter hook input priority filter; policy accept;\n",
+         edge_probe::parse_nft_ruleset},
+        {"ip_neigh", slice_lines(698, 699), "10.0.0.9 dev\n", edge_probe::parse_ip_neigh},
+    };
+
+    const auto allocations = [](const Parse &parse, const std::string &output) {
+        const std::uint64_t before = edge_probe_testing::thread_allocation_count();
+        parse(output);
+        return edge_probe_testing::thread_allocation_count() - before;
+    };
+    for (const auto &test_case : cases)
+    {
+        std::string padded = test_case.capture;
+        for (int i = 0; i < 100; ++i)
+        {
+            padded += test_case.skipped_line;
+        }
+        const std::uint64_t once = allocations(test_case.parse, padded);
+        for (int i = 0; i < 100; ++i)
+        {
+            padded += test_case.skipped_line;
+        }
+        const std::uint64_t twice = allocations(test_case.parse, padded);
+        ctx.expect(once == twice,
+                   test_case.parser + " allocates per skipped line: " + std::to_string(once) +
+                       " then " + std::to_string(twice),
+                   __LINE__);
+    }
+}
+
+// One "name value labels" line per sample in the named families, sorted.
+std::vector<std::string> family_lines(const std::vector<MetricSample> &metrics,
+                                      const std::vector<std::string> &names)
+{
+    std::vector<std::string> lines;
+    for (const auto &sample : metrics)
+    {
+        if (std::find(names.begin(), names.end(), sample.name) == names.end())
+        {
+            continue;
+        }
+        std::ostringstream line;
+        line << sample.name << ' ' << sample.value;
+        for (const auto &label : sample.labels)
+        {
+            line << ' ' << label.name << '=' << label.value;
+        }
+        lines.push_back(line.str());
+    }
+    std::sort(lines.begin(), lines.end());
+    return lines;
+}
+
+// Output of a shell command, or nullopt when it cannot run or fails.
+std::optional<std::string> command_output(const std::string &command)
+{
+    FILE *pipe = ::popen((command + " 2>/dev/null").c_str(), "r");
+    if (pipe == nullptr)
+    {
+        return std::nullopt;
+    }
+    std::string output;
+    char chunk[4096];
+    for (std::size_t read = 0; (read = std::fread(chunk, 1, sizeof(chunk), pipe)) > 0;)
+    {
+        output.append(chunk, read);
+    }
+    if (::pclose(pipe) != 0)
+    {
+        return std::nullopt;
+    }
+    return output;
+}
+
+void test_rtnetlink_collector(TestContext &ctx)
+{
+    std::ifstream proc_net_dev("/proc/net/dev");
+    std::ostringstream proc_contents;
+    proc_contents << proc_net_dev.rdbuf();
+    const auto proc_metrics = edge_probe::parse_proc_net_dev(proc_contents.str());
+
+    edge_probe::RtnetlinkCollector collector;
+    std::vector<MetricSample> metrics;
+    collector.collect(metrics);
+    EXPECT_EQ(ctx, collector.dump_failures(), std::uint64_t {0});
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx, metrics, "edge_network_link_up", {{"interface", "lo"}}),
+                1.0,
+                0.001);
+    require_metric_present(ctx,
+                           metrics,
+                           "edge_network_address_info",
+                           {{"interface", "lo"}, {"cidr", "127.0.0.1/8"}});
+
+    // IFLA_STATS64 covers the same interfaces as /proc/net/dev, and counters
+    // read later are never smaller.
+    std::size_t proc_counters = 0;
+    for (const auto &sample : proc_metrics)
+    {
+        ++proc_counters;
+        const MetricSample *native = find_metric(metrics, sample.name, sample.labels);
+        ctx.expect(native != nullptr && native->value >= sample.value,
+                   sample.name + " for " + *sample.labels.find("interface") + " went missing or "
+                       "backwards",
+                   __LINE__);
+    }
+    EXPECT_TRUE(ctx, proc_counters > 0);
+    EXPECT_EQ(ctx,
+              family_lines(metrics, {"edge_network_receive_bytes"}).size(),
+              family_lines(proc_metrics, {"edge_network_receive_bytes"}).size());
+
+    // Where iproute2 is installed, the text parsers over its output agree.
+    const auto links = command_output("ip -br link");
+    const auto addresses = command_output("ip -br addr");
+    const auto routes = command_output("ip route");
+    if (!links || !addresses || !routes)
+    {
+        return;
+    }
+    std::string plain_links;
+    std::istringstream link_lines(*links);
+    for (std::string line; std::getline(link_lines, line);)
+    {
+        // veth and vlan names print as "name@peer".
+        const auto at = line.find('@');
+        const auto space = line.find_first_of(" \t");
+        plain_links += at < space ? line.substr(0, at) + line.substr(space) : line;
+        plain_links += '\n';
+    }
+    const std::vector<std::string> link_families = {"edge_network_link_info",
+                                                    "edge_network_link_up",
+                                                    "edge_network_lower_up",
+                                                    "edge_network_no_carrier"};
+    EXPECT_TRUE(ctx,
+                family_lines(metrics, link_families) ==
+                    family_lines(edge_probe::parse_ip_br_link(plain_links), link_families));
+    const std::vector<std::string> address_families = {"edge_network_address_count",
+                                                       "edge_network_address_info"};
+    EXPECT_TRUE(ctx,
+                family_lines(metrics, address_families) ==
+                    family_lines(edge_probe::parse_ip_br_addr(*addresses), address_families));
+    const std::vector<std::string> route_families = {"edge_network_route_info",
+                                                     "edge_network_default_route_info",
+                                                     "edge_network_route_metric"};
+    EXPECT_TRUE(ctx,
+                family_lines(metrics, route_families) ==
+                    family_lines(edge_probe::parse_ip_route(*routes), route_families));
+
+    // A veth pair needs CAP_NET_ADMIN; without it this part is skipped.
+    if (!command_output("ip link add edgeprobe0 type veth peer name edgeprobe1"))
+    {
+        return;
+    }
+    struct VethPair
+    {
+        ~VethPair()
+        {
+            command_output("ip link del edgeprobe0");
+        }
+    } veth_pair;
+    command_output("ip addr add 198.51.100.7/24 dev edgeprobe0");
+    command_output("ip link set edgeprobe1 up");
+    command_output("ip link set edgeprobe0 up");
+    metrics.clear();
+    collector.collect(metrics);
+    EXPECT_NEAR(ctx,
+                require_metric_value(
+                    ctx, metrics, "edge_network_link_up", {{"interface", "edgeprobe0"}}),
+                1.0,
+                0.001);
+    require_metric_present(ctx,
+                           metrics,
+                           "edge_network_address_info",
+                           {{"interface", "edgeprobe0"}, {"cidr", "198.51.100.7/24"}});
+    require_metric_present(ctx,
+                           metrics,
+                           "edge_network_route_info",
+                           {{"prefix", "198.51.100.0/24"}, {"device", "edgeprobe0"}});
+    require_metric_present(
+        ctx, metrics, "edge_network_transmit_packets", {{"interface", "edgeprobe1"}});
+    EXPECT_EQ(ctx, collector.dump_failures(), std::uint64_t {0});
+}
+
+// Appends one rtnetlink message laid out as the kernel sends it: the family
+// header, then each attribute padded to four bytes. Notifications carry no
+// sequence and port; replies carry the request's.
+template <typename Header>
+void append_netlink_message(std::string &datagram,
+                            std::uint16_t type,
+                            const Header &header,
+                            const std::vector<std::pair<std::uint16_t, std::string>> &attributes,
+                            std::uint16_t flags = 0,
+                            std::uint32_t sequence = 0,
+                            std::uint32_t port_id = 0)
+{
+    std::string body(reinterpret_cast<const char *>(&header), sizeof(header));
+    body.resize(NLMSG_ALIGN(body.size()), '\0');
+    for (const auto &[attribute_type, value] : attributes)
+    {
+        rtattr attribute {};
+        attribute.rta_len = static_cast<unsigned short>(RTA_LENGTH(value.size()));
+        attribute.rta_type = attribute_type;
+        body.append(reinterpret_cast<const char *>(&attribute), sizeof(attribute));
+        body += value;
+        body.resize(RTA_ALIGN(body.size()), '\0');
+    }
+
+    nlmsghdr message {};
+    message.nlmsg_len = static_cast<std::uint32_t>(NLMSG_LENGTH(body.size()));
+    message.nlmsg_type = type;
+    message.nlmsg_flags = flags;
+    message.nlmsg_seq = sequence;
+    message.nlmsg_pid = port_id;
+    datagram.append(reinterpret_cast<const char *>(&message), sizeof(message));
+    datagram += body;
+}
+
+template <typename Value>
+std::string attribute_bytes(const Value &value)
+{
+    return std::string(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void test_rtnetlink_event_monitor_replay(TestContext &ctx)
+{
+    // Notifications for an interface index no real link uses, so the live
+    // table the monitor starts from does not interfere.
+    constexpr int kIndex = 9001;
+    const auto link_message = [](std::uint16_t type, unsigned int flags) {
+        ifinfomsg header {};
+        header.ifi_index = kIndex;
+        header.ifi_flags = flags;
+        std::string datagram;
+        append_netlink_message(
+            datagram, type, header, {{IFLA_IFNAME, std::string("replay0") + '\0'}});
+        return datagram;
+    };
+    const auto neighbour_message = [](std::uint16_t type, std::uint16_t state) {
+        ndmsg header {};
+        header.ndm_family = AF_INET;
+        header.ndm_ifindex = kIndex;
+        header.ndm_state = state;
+        std::string datagram;
+        append_netlink_message(datagram,
+                               type,
+                               header,
+                               {{NDA_DST, std::string("\xc0\x00\x02\x32", 4)},
+                                {NDA_LLADDR, std::string("\x02\x00\x00\x00\x00\x32", 6)}});
+        return datagram;
+    };
+    const auto last_value = [](const std::vector<MetricSample> &changes, const std::string &name) {
+        double value = -1.0;
+        for (const auto &sample : changes)
+        {
+            if (sample.name == name)
+            {
+                value = sample.value;
+            }
+        }
+        return value;
+    };
+
+    edge_probe::RtnetlinkEventMonitor monitor;
+    std::vector<MetricSample> changes;
+    const unsigned int running = IFF_UP | IFF_LOWER_UP | IFF_RUNNING;
+    EXPECT_EQ(ctx, monitor.apply(link_message(RTM_NEWLINK, running), changes), std::size_t {1});
+    require_metric_present(ctx, changes, "edge_network_link_up", {{"interface", "replay0"}});
+    EXPECT_NEAR(ctx, last_value(changes, "edge_network_link_flaps_total"), 0.0, 0.001);
+
+    // Carrier lost and regained in one datagram is one flap.
+    changes.clear();
+    EXPECT_EQ(ctx,
+              monitor.apply(link_message(RTM_NEWLINK, IFF_UP) +
+                                link_message(RTM_NEWLINK, running),
+                            changes),
+              std::size_t {2});
+    EXPECT_EQ(ctx, changes.size(), std::size_t {6});
+    EXPECT_NEAR(ctx, last_value(changes, "edge_network_link_flaps_total"), 1.0, 0.001);
+    EXPECT_NEAR(ctx, last_value(changes, "edge_network_lower_up"), 1.0, 0.001);
+
+    // A notification that changes no flag reports nothing.
+    changes.clear();
+    monitor.apply(link_message(RTM_NEWLINK, running), changes);
+    EXPECT_TRUE(ctx, changes.empty());
+
+    ifaddrmsg address {};
+    address.ifa_family = AF_INET;
+    address.ifa_prefixlen = 24;
+    address.ifa_index = kIndex;
+    rtmsg main_route {};
+    main_route.rtm_family = AF_INET;
+    main_route.rtm_table = RT_TABLE_MAIN;
+    main_route.rtm_type = RTN_UNICAST;
+    rtmsg local_route = main_route;
+    local_route.rtm_table = RT_TABLE_LOCAL;
+    local_route.rtm_type = RTN_LOCAL;
+    std::string datagram;
+    append_netlink_message(
+        datagram, RTM_NEWADDR, address, {{IFA_LOCAL, std::string("\xc6\x33\x64\x07", 4)}});
+    append_netlink_message(
+        datagram, RTM_NEWROUTE, main_route, {{RTA_OIF, attribute_bytes(std::uint32_t {kIndex})}});
+    append_netlink_message(
+        datagram, RTM_NEWROUTE, local_route, {{RTA_OIF, attribute_bytes(std::uint32_t {kIndex})}});
+    changes.clear();
+    EXPECT_EQ(ctx, monitor.apply(datagram, changes), std::size_t {3});
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx,
+                                     changes,
+                                     "edge_network_address_changes_total",
+                                     {{"interface", "replay0"}}),
+                1.0,
+                0.001);
+    EXPECT_EQ(ctx,
+              family_lines(changes, {"edge_network_route_changes_total"}).size(),
+              std::size_t {1});
+
+    // Neighbour entries count on appearing, changing state, and going away.
+    changes.clear();
+    monitor.apply(neighbour_message(RTM_NEWNEIGH, NUD_REACHABLE), changes);
+    monitor.apply(neighbour_message(RTM_NEWNEIGH, NUD_REACHABLE), changes);
+    monitor.apply(neighbour_message(RTM_NEWNEIGH, NUD_STALE), changes);
+    monitor.apply(neighbour_message(RTM_DELNEIGH, NUD_STALE), changes);
+    EXPECT_NEAR(ctx, last_value(changes, "edge_neighbor_state_changes_total"), 3.0, 0.001);
+    require_metric_present(ctx,
+                           changes,
+                           "edge_neighbor_entry_info",
+                           {{"device", "replay0"},
+                            {"ip", "192.0.2.50"},
+                            {"mac", "02:00:00:00:00:32"},
+                            {"state", "STALE"}});
+
+    // Removing a running link is a flap too; a truncated datagram is ignored.
+    changes.clear();
+    monitor.apply(link_message(RTM_DELLINK, running), changes);
+    EXPECT_NEAR(ctx, last_value(changes, "edge_network_link_flaps_total"), 2.0, 0.001);
+    const std::string truncated = link_message(RTM_NEWLINK, IFF_UP);
+    EXPECT_EQ(ctx,
+              monitor.apply(truncated.substr(0, truncated.size() - 4), changes),
+              std::size_t {0});
+
+    std::vector<MetricSample> metrics;
+    monitor.collect(metrics);
+    const LabelSet interface {{"interface", "replay0"}};
+    const LabelSet device {{"device", "replay0"}};
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx, metrics, "edge_network_link_flaps_total", interface),
+                2.0,
+                0.001);
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx, metrics, "edge_network_route_changes_total", device),
+                1.0,
+                0.001);
+    EXPECT_NEAR(ctx,
+                require_metric_value(ctx, metrics, "edge_neighbor_state_changes_total", device),
+                3.0,
+                0.001);
+    require_metric_present(ctx, metrics, "edge_network_link_flaps_total", {{"interface", "lo"}});
+    EXPECT_EQ(ctx, monitor.overruns(), std::uint64_t {0});
+}
+
+void test_netlink_exchange_replay(TestContext &ctx)
+{
+    constexpr std::uint32_t kSequence = 7;
+    constexpr std::uint32_t kPort = 4242;
+    const auto notify = [](std::string &datagram, std::uint16_t type, int index) {
+        ifinfomsg header {};
+        header.ifi_index = index;
+        append_netlink_message(datagram, type, header, {});
+    };
+    const auto reply = [](std::string &datagram, int index, std::uint32_t sequence) {
+        ifinfomsg header {};
+        header.ifi_index = index;
+        append_netlink_message(datagram, RTM_NEWLINK, header, {}, NLM_F_MULTI, sequence, kPort);
+    };
+    const auto done = [](std::string &datagram, std::uint16_t flags = NLM_F_MULTI) {
+        append_netlink_message(datagram, NLMSG_DONE, std::int32_t {0}, {}, flags, kSequence, kPort);
+    };
+    const auto index_into = [](std::vector<int> &indexes) {
+        return [&indexes](const nlmsghdr &, std::string_view payload) {
+            indexes.push_back(edge_probe::read_netlink_struct<ifinfomsg>(payload).ifi_index);
+        };
+    };
+
+    // A dump reply, a notification the kernel queued between two replies, a
+    // leftover of an abandoned dump, then the last reply and NLMSG_DONE.
+    std::string datagram;
+    reply(datagram, 1, kSequence);
+    notify(datagram, RTM_NEWLINK, 2);
+    reply(datagram, 3, kSequence - 1);
+    reply(datagram, 4, kSequence);
+    done(datagram);
+    notify(datagram, RTM_DELLINK, 5);
+
+    std::vector<int> replies;
+    std::vector<int> notifications;
+    edge_probe::NetlinkExchange exchange(kSequence, kPort, true);
+    exchange.read(datagram, index_into(replies), index_into(notifications));
+    EXPECT_TRUE(ctx, exchange.finished());
+    EXPECT_TRUE(ctx, exchange.succeeded());
+    EXPECT_TRUE(ctx, replies == (std::vector<int> {1, 4}));
+    EXPECT_TRUE(ctx, notifications == (std::vector<int> {2, 5}));
+
+    // Without a notification handler they are dropped, and an interrupted
+    // dump finishes without success.
+    std::string interrupted;
+    notify(interrupted, RTM_NEWLINK, 2);
+    done(interrupted, NLM_F_MULTI | NLM_F_DUMP_INTR);
+    replies.clear();
+    edge_probe::NetlinkExchange second(kSequence, kPort, true);
+    second.read(interrupted, index_into(replies), {});
+    EXPECT_TRUE(ctx, second.finished());
+    EXPECT_TRUE(ctx, !second.succeeded());
+    EXPECT_TRUE(ctx, replies.empty());
+}
+
+void test_rtnetlink_event_monitor_namespace(TestContext &ctx)
+{
+    // The child moves into a fresh network namespace, which needs
+    // CAP_SYS_ADMIN, and reports through its exit status; 77 means skipped.
+    constexpr int kSkipped = 77;
+    const pid_t child = ::fork();
+    if (child == 0)
+    {
+        if (::unshare(CLONE_NEWNET) != 0)
+        {
+            ::_exit(kSkipped);
+        }
+        edge_probe::RtnetlinkEventMonitor monitor;
+        if (std::system("ip link add ep0 type dummy 2>/dev/null || "
+                        "(ip link add ep0 type veth peer name ep1 && ip link set ep1 up)") != 0 ||
+            std::system("ip link set ep0 up") != 0)
+        {
+            ::_exit(kSkipped);
+        }
+
+        // The writer's own flush interval is far longer than the deadline.
+        auto transport = std::make_shared<FakeTransport>(std::vector<HttpTransport::Result> {});
+        TelemetryConfig config;
+        config.flush_interval_ms = 60000;
+        TelemetryWriter writer(config, transport);
+        for (int i = 0; i < 5; ++i)
+        {
+            monitor.poll(20, writer);
+        }
+
+        const auto reported = [&transport] {
+            for (const auto &body : transport->bodies)
+            {
+                std::istringstream lines(body);
+                for (std::string line; std::getline(lines, line);)
+                {
+                    if (line.find("\"edge_network_link_flaps_total\"") != std::string::npos &&
+                        line.find("\"ep0\"") != std::string::npos &&
+                        line.find("\"values\":[1]") != std::string::npos)
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+        const auto start = std::chrono::steady_clock::now();
+        if (std::system("ip link set ep0 down") != 0)
+        {
+            ::_exit(kSkipped);
+        }
+        while (!reported() && std::chrono::steady_clock::now() - start < std::chrono::seconds(1))
+        {
+            monitor.poll(100, writer);
+        }
+        ::_exit(reported() ? 0 : 1);
+    }
+
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    EXPECT_TRUE(ctx,
+                WIFEXITED(status) && (WEXITSTATUS(status) == 0 || WEXITSTATUS(status) == kSkipped));
+}
+
+// Back-to-back nl80211 reply messages from tests/fixtures, NLMSG_DONE
+// included. They encode the phy0 and wlan0 of cmd.txt, with the wiphy in the
+// kernel's split-dump layout of one message per channel, and two stations.
+std::string nl80211_fixture(const std::string &name)
+{
+    std::ifstream input(std::string(EDGE_PROBE_SOURCE_DIR) + "/tests/fixtures/" + name,
+                        std::ios::binary);
+    if (!input)
+    {
+        throw std::runtime_error("failed to open fixture " + name);
+    }
+    std::ostringstream bytes;
+    bytes << input.rdbuf();
+    return bytes.str();
+}
+
+void test_nl80211_decoders(TestContext &ctx)
+{
+    const std::vector<std::string> phy_families = {
+        "edge_wifi_phy_limit",
+        "edge_wifi_max_associated_stations",
+        "edge_wifi_supported_interface_mode_info",
+        "edge_wifi_supported_command_info",
+        "edge_wifi_wowlan_support_info",
+        "edge_wifi_frame_type_support_info",
+        "edge_wifi_extended_feature_info",
+        "edge_wifi_band_frequency_info",
+        "edge_wifi_band_frequencies_total",
+        "edge_wifi_band_radar_frequencies_total",
+    };
+    const std::string wiphy = nl80211_fixture("nl80211_wiphy.bin");
+    const auto phy_metrics = edge_probe::decode_nl80211_wiphy(wiphy);
+    const auto phy_lines = family_lines(phy_metrics, phy_families);
+    EXPECT_EQ(ctx, phy_lines.size(), phy_metrics.size());
+    EXPECT_TRUE(ctx,
+                phy_lines ==
+                    family_lines(edge_probe::parse_iw_phy(slice_lines(59, 295)), phy_families));
+    require_metric_value(
+        ctx, phy_metrics, "edge_wifi_phy_limit", {{"limit", "max_scan_plan_interval"}});
+    require_metric_present(ctx,
+                           phy_metrics,
+                           "edge_wifi_band_frequency_info",
+                           {{"band", "2"},
+                            {"mhz", "5960"},
+                            {"channel", "2"},
+                            {"disabled", "true"},
+                            {"radar_detection", "false"}});
+
+    const std::vector<std::string> dev_families = {"edge_wifi_interface_ifindex",
+                                                   "edge_wifi_ap_info"};
+    const auto dev_metrics =
+        edge_probe::decode_nl80211_interfaces(nl80211_fixture("nl80211_interface.bin"));
+    EXPECT_EQ(ctx, dev_metrics.size(), std::size_t {2});
+    EXPECT_TRUE(ctx,
+                family_lines(dev_metrics, dev_families) ==
+                    family_lines(edge_probe::parse_iw_dev(slice_lines(52, 58)), dev_families));
+
+    const std::string stations = nl80211_fixture("nl80211_station.bin");
+    const auto station_metrics = edge_probe::decode_nl80211_stations(stations, "wlan0");
+    const LabelSet near {{"interface", "wlan0"}, {"station", "3c:2e:ff:4a:91:d0"}};
+    const LabelSet far {{"interface", "wlan0"}, {"station", "f2:d4:1b:0c:77:e5"}};
+    EXPECT_EQ(ctx,
+              require_metric_value(
+                  ctx, station_metrics, "edge_wifi_stations_total", {{"interface", "wlan0"}}),
+              2.0);
+    EXPECT_EQ(ctx,
+              require_metric_value(ctx, station_metrics, "edge_wifi_station_signal_dbm", near),
+              -52.0);
+    EXPECT_EQ(ctx,
+              require_metric_value(ctx, station_metrics, "edge_wifi_station_signal_dbm", far),
+              -71.0);
+    EXPECT_NEAR(ctx,
+                require_metric_value(
+                    ctx, station_metrics, "edge_wifi_station_transmit_bitrate_mbps", far),
+                58.5,
+                1e-9);
+    EXPECT_EQ(ctx,
+              require_metric_value(
+                  ctx, station_metrics, "edge_wifi_station_receive_bitrate_mbps", near),
+              65.0);
+    // Past 4 GiB only the 64-bit counter is right.
+    EXPECT_EQ(ctx,
+              require_metric_value(ctx, station_metrics, "edge_wifi_station_receive_bytes", near),
+              5242880000.0);
+    EXPECT_EQ(ctx,
+              require_metric_value(ctx, station_metrics, "edge_wifi_station_transmit_bytes", far),
+              4410028.0);
+    EXPECT_NEAR(ctx,
+                require_metric_value(
+                    ctx, station_metrics, "edge_wifi_station_inactive_seconds", far),
+                12.8,
+                1e-9);
+    EXPECT_EQ(ctx,
+              require_metric_value(
+                  ctx, station_metrics, "edge_wifi_station_connected_seconds", near),
+              1843.0);
+
+    // A capture cut mid-message keeps the whole messages before the cut.
+    const auto cut_stations =
+        edge_probe::decode_nl80211_stations(std::string_view(stations).substr(0, 200), "wlan0");
+    EXPECT_EQ(ctx,
+              require_metric_value(
+                  ctx, cut_stations, "edge_wifi_stations_total", {{"interface", "wlan0"}}),
+              1.0);
+    const auto cut_wiphy =
+        edge_probe::decode_nl80211_wiphy(std::string_view(wiphy).substr(0, wiphy.size() / 2));
+    EXPECT_TRUE(ctx, !cut_wiphy.empty() && cut_wiphy.size() < phy_metrics.size());
+    EXPECT_TRUE(ctx, edge_probe::decode_nl80211_interfaces(stations).empty());
+}
+
+void test_nl80211_collector(TestContext &ctx)
+{
+    // Without a wireless driver the kernel has no nl80211 family to resolve.
+    std::optional<edge_probe::Nl80211Collector> collector;
+    try
+    {
+        collector.emplace();
+    }
+    catch (const std::runtime_error &)
+    {
+        return;
+    }
+
+    std::vector<MetricSample> metrics;
+    collector->collect(metrics);
+    EXPECT_EQ(ctx, collector->dump_failures(), std::uint64_t {0});
+    for (const auto &sample : metrics)
+    {
+        const std::string *name = sample.labels.find("interface");
+        if (sample.name == "edge_wifi_interface_ifindex" && name != nullptr)
+        {
+            require_metric_present(
+                ctx, metrics, "edge_wifi_stations_total", {{"interface", *name}});
+        }
+    }
+}
+
 }  // namespace
 
 int main()
@@ -768,7 +3685,42 @@ int main()
     const std::vector<std::pair<std::string, std::function<void(TestContext &)>>> tests = {
         {"default_command_plan", test_default_command_plan},
         {"sender_retry_flow", test_sender_retry_flow},
-        {"sender_oversized_payload", test_sender_oversized_payload},
+        {"sender_retry_queue_drains_in_order", test_sender_retry_queue_drains_in_order},
+        {"sender_retry_queue_budget", test_sender_retry_queue_budget},
+        {"spsc_ring", test_spsc_ring},
+        {"sender_background_never_blocks_caller", test_sender_background_never_blocks_caller},
+        {"sender_background_retry", test_sender_background_retry},
+        {"curl_transport_reuses_connection", test_curl_transport_reuses_connection},
+        {"socket_transport", test_socket_transport},
+        {"unix_socket_transport", test_unix_socket_transport},
+        {"fake_vm_server", test_fake_vm_server},
+        {"sender_in_flight_window", test_sender_in_flight_window},
+        {"curl_multi_transport", test_curl_multi_transport},
+        {"payload_spool_recovers_unacked_records",
+         test_payload_spool_recovers_unacked_records},
+        {"payload_spool_discards_torn_and_corrupt_tail",
+         test_payload_spool_discards_torn_and_corrupt_tail},
+        {"payload_spool_evicts_oldest_segments", test_payload_spool_evicts_oldest_segments},
+        {"sender_spool_survives_kill_and_restart", test_sender_spool_survives_kill_and_restart},
+        {"sender_spool_outlasts_retry_queue_budget",
+         test_sender_spool_outlasts_retry_queue_budget},
+        {"sender_byte_target", test_sender_byte_target},
+        {"sender_ready_batches", test_sender_ready_batches},
+        {"sender_flush_open_batch", test_sender_flush_open_batch},
+        {"sender_series_grouping", test_sender_series_grouping},
+        {"payload_compressor", test_payload_compressor},
+        {"sender_compression", test_sender_compression},
+        {"snappy", test_snappy},
+        {"remote_write_encoder", test_remote_write_encoder},
+        {"sender_remote_write", test_sender_remote_write},
+        {"label_set", test_label_set},
+        {"series_registry", test_series_registry},
+        {"sender_series_registry", test_sender_series_registry},
+        {"sender_submit_batch", test_sender_submit_batch},
+        {"metric_prefix_cache", test_metric_prefix_cache},
+        {"sender_external_labels", test_sender_external_labels},
+        {"json_lines_encoder", test_json_lines_encoder},
+        {"json_escape_kernels", test_json_escape_kernels},
         {"system_identity_parser", test_system_identity_parser},
         {"network_parsers", test_network_parsers},
         {"wifi_parsers", test_wifi_parsers},
@@ -778,6 +3730,15 @@ int main()
         {"system_health_parsers", test_system_health_parsers},
         {"firewall_parsers", test_firewall_parsers},
         {"neighbor_parser", test_neighbor_parser},
+        {"parser_edge_cases", test_parser_edge_cases},
+        {"parsers_skip_lines_without_allocating", test_parsers_skip_lines_without_allocating},
+        {"system_health_reader", test_system_health_reader},
+        {"rtnetlink_collector", test_rtnetlink_collector},
+        {"rtnetlink_event_monitor_replay", test_rtnetlink_event_monitor_replay},
+        {"netlink_exchange_replay", test_netlink_exchange_replay},
+        {"rtnetlink_event_monitor_namespace", test_rtnetlink_event_monitor_namespace},
+        {"nl80211_decoders", test_nl80211_decoders},
+        {"nl80211_collector", test_nl80211_collector},
     };
 
     for (const auto &[name, test] : tests)
@@ -0,0 +1,384 @@
+#include "fake_vm.h"
+
+#include "edge_probe/snappy.h"
+
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace edge_probe_testing
+{
+
+namespace
+{
+
+constexpr std::string_view kMetricPrefix = "{\"metric\":";
+constexpr std::string_view kValuesPrefix = ",\"values\":[";
+constexpr std::string_view kTimestampsPrefix = "\"timestamps\":[";
+
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+constexpr bool kHaveGzip = true;
+#else
+constexpr bool kHaveGzip = false;
+#endif
+
+int parse_int(std::string_view text, const std::string &step)
+{
+    int value = 0;
+    const auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (parsed.ec != std::errc() || parsed.ptr != text.data() + text.size() || value < 0)
+    {
+        throw std::invalid_argument("malformed fault schedule step: " + step);
+    }
+    return value;
+}
+
+int64_t thread_cpu_time_us()
+{
+    timespec now {};
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+bool gunzip(const std::string &input, std::string &output)
+{
+#if defined(EDGE_PROBE_HAVE_ZLIB)
+    z_stream stream {};
+    if (inflateInit2(&stream, 15 + 16) != Z_OK)
+    {
+        return false;
+    }
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    output.clear();
+    int status = Z_OK;
+    while (status == Z_OK)
+    {
+        const std::size_t used = output.size();
+        output.resize(used + std::max<std::size_t>(input.size() * 4, 16 * 1024));
+        stream.next_out = reinterpret_cast<Bytef *>(&output[used]);
+        stream.avail_out = static_cast<uInt>(output.size() - used);
+        status = inflate(&stream, Z_NO_FLUSH);
+        output.resize(output.size() - stream.avail_out);
+    }
+    inflateEnd(&stream);
+    return status == Z_STREAM_END;
+#else
+    (void)input;
+    (void)output;
+    return false;
+#endif
+}
+
+bool read_varint(std::string_view &input, std::uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && !input.empty(); shift += 7)
+    {
+        const auto byte = static_cast<unsigned char>(input.front());
+        input.remove_prefix(1);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Reads the next protobuf field; bytes is set for length-delimited fields.
+bool read_field(std::string_view &input, std::uint64_t &field, std::string_view &bytes)
+{
+    std::uint64_t key = 0;
+    if (!read_varint(input, key))
+    {
+        return false;
+    }
+    field = key >> 3;
+    bytes = {};
+    std::uint64_t length = 0;
+    switch (key & 0x7)
+    {
+        case 0:
+            return read_varint(input, length);
+        case 1:
+            length = 8;
+            break;
+        case 2:
+            if (!read_varint(input, length))
+            {
+                return false;
+            }
+            break;
+        case 5:
+            length = 4;
+            break;
+        default:
+            return false;
+    }
+    if (length > input.size())
+    {
+        return false;
+    }
+    bytes = input.substr(0, length);
+    input.remove_prefix(length);
+    return true;
+}
+
+}  // namespace
+
+std::vector<FaultStep> parse_fault_schedule(const std::string &text)
+{
+    std::vector<FaultStep> schedule;
+    std::size_t start = 0;
+    while (start <= text.size() && !text.empty())
+    {
+        const std::size_t comma = std::min(text.find(',', start), text.size());
+        const std::string step = text.substr(start, comma - start);
+        start = comma + 1;
+
+        std::string_view token = step;
+        int repeat = 1;
+        if (const auto star = token.find('*'); star != std::string_view::npos)
+        {
+            repeat = parse_int(token.substr(star + 1), step);
+            token = token.substr(0, star);
+        }
+        FaultStep fault;
+        if (const auto at = token.find('@'); at != std::string_view::npos)
+        {
+            fault.delay_ms = parse_int(token.substr(at + 1), step);
+            token = token.substr(0, at);
+        }
+        if (token == "ok")
+        {
+            fault.status = 204;
+        }
+        else if (token == "reset")
+        {
+            fault.status = 0;
+        }
+        else
+        {
+            fault.status = parse_int(token, step);
+            if (fault.status < 100 || fault.status > 599)
+            {
+                throw std::invalid_argument("malformed fault schedule step: " + step);
+            }
+        }
+        schedule.insert(schedule.end(), static_cast<std::size_t>(repeat), fault);
+    }
+    return schedule;
+}
+
+FakeVictoriaMetrics::FakeVictoriaMetrics(std::vector<FaultStep> schedule,
+                                         int latency_ms,
+                                         int port)
+    : schedule_(schedule.empty() ? std::vector<FaultStep> {FaultStep {}} : std::move(schedule)),
+      latency_ms_(latency_ms),
+      server_([this](const LocalHttpServer::Request &request) { return handle(request); }, port)
+{
+    server_.set_record_requests(false);
+}
+
+FakeVictoriaMetrics::FakeVictoriaMetrics(std::vector<FaultStep> schedule,
+                                         int latency_ms,
+                                         std::string unix_socket_path)
+    : schedule_(schedule.empty() ? std::vector<FaultStep> {FaultStep {}} : std::move(schedule)),
+      latency_ms_(latency_ms),
+      server_([this](const LocalHttpServer::Request &request) { return handle(request); },
+              std::move(unix_socket_path))
+{
+    server_.set_record_requests(false);
+}
+
+int FakeVictoriaMetrics::port() const
+{
+    return server_.port();
+}
+
+std::string FakeVictoriaMetrics::url(const std::string &path) const
+{
+    return server_.url(path);
+}
+
+const std::string &FakeVictoriaMetrics::unix_socket_path() const
+{
+    return server_.unix_socket_path();
+}
+
+FakeVmStats FakeVictoriaMetrics::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    FakeVmStats stats = stats_;
+    stats.series = series_.size();
+    return stats;
+}
+
+LocalHttpServer::Reply FakeVictoriaMetrics::handle(const LocalHttpServer::Request &request)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const FaultStep step = schedule_[next_step_];
+    next_step_ = (next_step_ + 1) % schedule_.size();
+
+    ++stats_.requests;
+    stats_.body_bytes += request.body.size();
+    LocalHttpServer::Reply reply {step.status, step.delay_ms + latency_ms_};
+    if (step.status >= 200 && step.status < 300)
+    {
+        reply.status = ingest(request);
+    }
+
+    if (reply.status == 0)
+    {
+        ++stats_.resets;
+    }
+    else if (reply.status >= 200 && reply.status < 300)
+    {
+        ++stats_.ok_responses;
+    }
+    else
+    {
+        ++stats_.error_responses;
+    }
+    stats_.cpu_time_us = thread_cpu_time_us();
+    return reply;
+}
+
+// Returns the status VictoriaMetrics would answer the request with.
+int FakeVictoriaMetrics::ingest(const LocalHttpServer::Request &request)
+{
+    const auto header = request.headers.find("content-encoding");
+    const std::string encoding = header == request.headers.end() ? "" : header->second;
+    const std::string *body = &request.body;
+    if (encoding == "gzip" && !kHaveGzip)
+    {
+        ++stats_.rejected_bodies;
+        return 415;
+    }
+    if (encoding == "gzip" || encoding == "snappy")
+    {
+        const bool decoded = encoding == "gzip"
+                                 ? gunzip(request.body, decoded_)
+                                 : edge_probe::snappy_uncompress(request.body, decoded_);
+        if (!decoded)
+        {
+            ++stats_.rejected_bodies;
+            return 400;
+        }
+        body = &decoded_;
+    }
+    else if (!encoding.empty())
+    {
+        ++stats_.rejected_bodies;
+        return 415;
+    }
+
+    const std::string path = request.target.substr(0, request.target.find('?'));
+    bool counted = false;
+    if (path == "/api/v1/import")
+    {
+        counted = count_json_lines(*body);
+    }
+    else if (path == "/api/v1/write")
+    {
+        counted = encoding == "snappy" && count_remote_write(*body);
+    }
+    else
+    {
+        return 404;
+    }
+    if (!counted)
+    {
+        ++stats_.rejected_bodies;
+        return 400;
+    }
+    return 204;
+}
+
+bool FakeVictoriaMetrics::count_json_lines(const std::string &body)
+{
+    std::string_view rest = body;
+    while (!rest.empty())
+    {
+        const std::size_t newline = std::min(rest.find('\n'), rest.size());
+        const std::string_view line = rest.substr(0, newline);
+        rest.remove_prefix(std::min(newline + 1, rest.size()));
+        if (line.empty())
+        {
+            continue;
+        }
+
+        // Quotes inside label values are escaped, so the first unescaped
+        // ,"values":[ ends the metric object.
+        const std::size_t values = line.find(kValuesPrefix);
+        const std::size_t timestamps = line.find(kTimestampsPrefix, values);
+        if (line.compare(0, kMetricPrefix.size(), kMetricPrefix) != 0 ||
+            values == std::string_view::npos || timestamps == std::string_view::npos)
+        {
+            return false;
+        }
+        const std::size_t first = timestamps + kTimestampsPrefix.size();
+        const std::size_t last = line.find(']', first);
+        if (last == std::string_view::npos)
+        {
+            return false;
+        }
+
+        series_.emplace(line.substr(0, values));
+        if (last > first)
+        {
+            stats_.points += 1 + std::count(line.begin() + first, line.begin() + last, ',');
+        }
+    }
+    return true;
+}
+
+bool FakeVictoriaMetrics::count_remote_write(const std::string &body)
+{
+    // WriteRequest.timeseries = 1; TimeSeries.labels = 1, samples = 2.
+    std::string_view request = body;
+    std::string labels;
+    while (!request.empty())
+    {
+        std::uint64_t field = 0;
+        std::string_view series;
+        if (!read_field(request, field, series))
+        {
+            return false;
+        }
+        if (field != 1)
+        {
+            continue;
+        }
+
+        labels.clear();
+        while (!series.empty())
+        {
+            std::string_view bytes;
+            if (!read_field(series, field, bytes))
+            {
+                return false;
+            }
+            if (field == 1)
+            {
+                labels.append(bytes);
+            }
+            else if (field == 2)
+            {
+                ++stats_.points;
+            }
+        }
+        series_.insert(labels);
+    }
+    return true;
+}
+
+}  // namespace edge_probe_testing
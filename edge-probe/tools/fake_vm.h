@@ -0,0 +1,83 @@
+#pragma once
+
+#include "local_http_server.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace edge_probe_testing
+{
+
+// One response of a fault schedule; status 0 resets the connection.
+struct FaultStep
+{
+    int status {204};
+    int delay_ms {0};
+};
+
+// Parses comma-separated steps such as "ok*8,503,401,reset,ok@250": ok, an
+// HTTP status, or reset, each with an optional @delay_ms and *repeat count.
+// Throws std::invalid_argument on malformed input.
+std::vector<FaultStep> parse_fault_schedule(const std::string &text);
+
+struct FakeVmStats
+{
+    std::uint64_t requests {0};
+    std::uint64_t ok_responses {0};
+    std::uint64_t error_responses {0};
+    std::uint64_t resets {0};
+    // Bodies answered with 400 or 415 because they could not be decoded.
+    std::uint64_t rejected_bodies {0};
+    std::uint64_t body_bytes {0};
+    std::uint64_t points {0};
+    std::size_t series {0};
+    // CPU time of the server thread so far.
+    std::int64_t cpu_time_us {0};
+};
+
+// Stand-in for VictoriaMetrics on 127.0.0.1. Accepts /api/v1/import JSON
+// lines and /api/v1/write remote_write, gzip or snappy encoded, and counts
+// the distinct series and points of every body it accepts. Requests are
+// answered by the schedule in a cycle, with latency_ms added to each step;
+// bodies answered with an injected error are not counted.
+class FakeVictoriaMetrics
+{
+public:
+    explicit FakeVictoriaMetrics(std::vector<FaultStep> schedule = {},
+                                 int latency_ms = 0,
+                                 int port = 0);
+    // Listens on an AF_UNIX socket instead of TCP.
+    FakeVictoriaMetrics(std::vector<FaultStep> schedule,
+                        int latency_ms,
+                        std::string unix_socket_path);
+
+    FakeVictoriaMetrics(const FakeVictoriaMetrics &) = delete;
+    FakeVictoriaMetrics &operator=(const FakeVictoriaMetrics &) = delete;
+
+    int port() const;
+    std::string url(const std::string &path) const;
+    const std::string &unix_socket_path() const;
+    FakeVmStats stats() const;
+
+private:
+    LocalHttpServer::Reply handle(const LocalHttpServer::Request &request);
+    int ingest(const LocalHttpServer::Request &request);
+    bool count_json_lines(const std::string &body);
+    bool count_remote_write(const std::string &body);
+
+    mutable std::mutex mutex_;
+    std::vector<FaultStep> schedule_;
+    int latency_ms_ {0};
+    std::size_t next_step_ {0};
+    FakeVmStats stats_;
+    std::unordered_set<std::string> series_;
+    std::string decoded_;
+    // Declared last: its thread calls handle() until it is destroyed.
+    LocalHttpServer server_;
+};
+
+}  // namespace edge_probe_testing
@@ -0,0 +1,130 @@
+#include "fake_vm.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+std::atomic<bool> g_stop {false};
+
+void handle_signal(int)
+{
+    g_stop = true;
+}
+
+std::string read_option(const std::vector<std::string> &args,
+                        const std::string &name,
+                        const std::string &default_value = "")
+{
+    for (std::size_t i = 0; i + 1 < args.size(); ++i)
+    {
+        if (args[i] == name)
+        {
+            return args[i + 1];
+        }
+    }
+    return default_value;
+}
+
+bool has_flag(const std::vector<std::string> &args, const std::string &name)
+{
+    for (const auto &arg : args)
+    {
+        if (arg == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void print_stats(const edge_probe_testing::FakeVmStats &stats)
+{
+    std::cout << "requests=" << stats.requests << " ok=" << stats.ok_responses
+              << " errors=" << stats.error_responses << " resets=" << stats.resets
+              << " rejected=" << stats.rejected_bodies << " body_bytes=" << stats.body_bytes
+              << " series=" << stats.series << " points=" << stats.points << std::endl;
+}
+
+void print_usage()
+{
+    std::cerr << "Usage: edge_probe_fake_vm [options]\n"
+              << "  --port PORT            (default 8428, listens on 127.0.0.1)\n"
+              << "  --unix-socket PATH     listen on a unix socket instead\n"
+              << "  --latency-ms MS        added to every response\n"
+              << "  --schedule STEPS       e.g. ok*8,503,401,reset,ok@250\n"
+              << "  --duration-sec SEC     0 runs until SIGINT or SIGTERM\n"
+              << "  --report-interval-sec SEC\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        std::vector<std::string> args;
+        for (int i = 1; i < argc; ++i)
+        {
+            args.emplace_back(argv[i]);
+        }
+
+        if (has_flag(args, "--help"))
+        {
+            print_usage();
+            return 0;
+        }
+
+        const int port = std::stoi(read_option(args, "--port", "8428"));
+        const int latency_ms = std::stoi(read_option(args, "--latency-ms", "0"));
+        const int duration_sec = std::stoi(read_option(args, "--duration-sec", "0"));
+        const int report_sec = std::stoi(read_option(args, "--report-interval-sec", "5"));
+        auto schedule = edge_probe_testing::parse_fault_schedule(read_option(args, "--schedule"));
+        const std::string unix_socket_path = read_option(args, "--unix-socket");
+        auto server =
+            unix_socket_path.empty()
+                ? std::make_unique<edge_probe_testing::FakeVictoriaMetrics>(
+                      std::move(schedule), latency_ms, port)
+                : std::make_unique<edge_probe_testing::FakeVictoriaMetrics>(
+                      std::move(schedule), latency_ms, unix_socket_path);
+
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+        std::cout << "listening on "
+                  << (unix_socket_path.empty() ? server->url("/") : unix_socket_path)
+                  << std::endl;
+
+        const auto start = std::chrono::steady_clock::now();
+        auto next_report = start + std::chrono::seconds(report_sec);
+        while (!g_stop)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            const auto now = std::chrono::steady_clock::now();
+            if (duration_sec > 0 && now - start >= std::chrono::seconds(duration_sec))
+            {
+                break;
+            }
+            if (report_sec > 0 && now >= next_report)
+            {
+                print_stats(server->stats());
+                next_report = now + std::chrono::seconds(report_sec);
+            }
+        }
+
+        print_stats(server->stats());
+        return 0;
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << "fatal: " << ex.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,352 @@
+#include "fake_vm.h"
+
+#include "edge_probe/socket_http_transport.h"
+#include "edge_probe/telemetry_sender.h"
+
+#if defined(EDGE_PROBE_HAVE_CURL)
+#include "edge_probe/curl_http_transport.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace
+{
+
+using SteadyClock = std::chrono::steady_clock;
+
+// Records the latency of every post the writer makes.
+class TimedTransport final : public edge_probe::HttpTransport
+{
+public:
+    explicit TimedTransport(std::shared_ptr<edge_probe::HttpTransport> inner)
+        : inner_(std::move(inner))
+    {
+    }
+
+    Result post_json_lines(const edge_probe::TelemetryConfig &config,
+                           const std::string &body) override
+    {
+        const auto start = SteadyClock::now();
+        Result result = inner_->post_json_lines(config, body);
+        record(result, SteadyClock::now() - start);
+        return result;
+    }
+
+    std::vector<Result> post_many(const edge_probe::TelemetryConfig &config,
+                                  const std::vector<const std::string *> &bodies) override
+    {
+        const auto start = SteadyClock::now();
+        std::vector<Result> results = inner_->post_many(config, bodies);
+        const auto elapsed = SteadyClock::now() - start;
+        for (const auto &result : results)
+        {
+            record(result, elapsed);
+        }
+        return results;
+    }
+
+    std::size_t max_in_flight() const override
+    {
+        return inner_->max_in_flight();
+    }
+
+    std::vector<int64_t> latencies_us() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return latencies_us_;
+    }
+
+private:
+    void record(const Result &result, SteadyClock::duration elapsed)
+    {
+        const int64_t elapsed_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        std::lock_guard<std::mutex> lock(mutex_);
+        latencies_us_.push_back(result.total_time_us > 0 ? result.total_time_us : elapsed_us);
+    }
+
+    std::shared_ptr<edge_probe::HttpTransport> inner_;
+    mutable std::mutex mutex_;
+    std::vector<int64_t> latencies_us_;
+};
+
+std::string read_option(const std::vector<std::string> &args,
+                        const std::string &name,
+                        const std::string &default_value = "")
+{
+    for (std::size_t i = 0; i + 1 < args.size(); ++i)
+    {
+        if (args[i] == name)
+        {
+            return args[i + 1];
+        }
+    }
+    return default_value;
+}
+
+bool has_flag(const std::vector<std::string> &args, const std::string &name)
+{
+    for (const auto &arg : args)
+    {
+        if (arg == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+edge_probe::PayloadCompression parse_compression(const std::string &value)
+{
+    if (value == "none")
+    {
+        return edge_probe::PayloadCompression::none;
+    }
+    if (value == "gzip")
+    {
+        return edge_probe::PayloadCompression::gzip;
+    }
+    if (value == "zstd")
+    {
+        return edge_probe::PayloadCompression::zstd;
+    }
+    if (value == "snappy")
+    {
+        return edge_probe::PayloadCompression::snappy;
+    }
+    throw std::invalid_argument("unknown compression: " + value);
+}
+
+edge_probe::PayloadFormat parse_payload_format(const std::string &value)
+{
+    if (value == "json")
+    {
+        return edge_probe::PayloadFormat::json_lines;
+    }
+    if (value == "remote-write")
+    {
+        return edge_probe::PayloadFormat::remote_write;
+    }
+    throw std::invalid_argument("unknown payload format: " + value);
+}
+
+std::shared_ptr<edge_probe::HttpTransport> make_transport(const std::string &value,
+                                                          std::size_t in_flight)
+{
+    if (value == "socket")
+    {
+        return std::make_shared<edge_probe::SocketHttpTransport>();
+    }
+#if defined(EDGE_PROBE_HAVE_CURL)
+    if (value == "curl")
+    {
+        return std::make_shared<edge_probe::CurlHttpTransport>();
+    }
+    if (value == "curl-multi")
+    {
+        return std::make_shared<edge_probe::CurlMultiHttpTransport>(in_flight);
+    }
+#else
+    (void)in_flight;
+#endif
+    throw std::invalid_argument("unknown or unavailable transport: " + value);
+}
+
+int64_t process_cpu_time_us()
+{
+    rusage usage {};
+    ::getrusage(RUSAGE_SELF, &usage);
+    return (static_cast<int64_t>(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000000 +
+           usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+double percentile_ms(std::vector<int64_t> values, double fraction)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+    const std::size_t index = std::min(
+        values.size() - 1, static_cast<std::size_t>(fraction * static_cast<double>(values.size())));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return static_cast<double>(values[index]) / 1000.0;
+}
+
+void print_usage()
+{
+    std::cerr << "Usage: edge_probe_load_driver [options]\n"
+              << "  --rate SAMPLES_PER_SEC   (default 1000)\n"
+              << "  --duration-sec SEC       (default 10)\n"
+              << "  --drain-sec SEC          time allowed to empty the queue (default 10)\n"
+              << "  --series COUNT           distinct series (default 100)\n"
+              << "  --transport socket|curl|curl-multi\n"
+              << "  --in-flight N            curl-multi posts in flight (default 4)\n"
+              << "  --endpoint URL           default: an in-process fake VictoriaMetrics\n"
+              << "  --unix-socket PATH       connect over a unix socket\n"
+              << "  --latency-ms MS          in-process endpoint latency\n"
+              << "  --schedule STEPS         in-process fault schedule, e.g. ok*8,503,reset\n"
+              << "  --payload-format json|remote-write\n"
+              << "  --compression none|gzip|zstd|snappy\n"
+              << "  --batch-samples N        (default 500)\n"
+              << "  --background-sender\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        std::vector<std::string> args;
+        for (int i = 1; i < argc; ++i)
+        {
+            args.emplace_back(argv[i]);
+        }
+
+        if (has_flag(args, "--help"))
+        {
+            print_usage();
+            return 0;
+        }
+
+        const double rate = std::stod(read_option(args, "--rate", "1000"));
+        const int duration_sec = std::stoi(read_option(args, "--duration-sec", "10"));
+        const int drain_sec = std::stoi(read_option(args, "--drain-sec", "10"));
+        const std::size_t series = std::stoul(read_option(args, "--series", "100"));
+        if (rate <= 0.0 || duration_sec <= 0 || series == 0)
+        {
+            throw std::invalid_argument("rate, duration, and series must be positive");
+        }
+
+        std::unique_ptr<edge_probe_testing::FakeVictoriaMetrics> server;
+        edge_probe::TelemetryConfig config;
+        config.payload_format =
+            parse_payload_format(read_option(args, "--payload-format", "json"));
+        const bool remote_write =
+            config.payload_format == edge_probe::PayloadFormat::remote_write;
+        config.endpoint = read_option(args, "--endpoint");
+        config.unix_socket_path = read_option(args, "--unix-socket");
+        if (config.endpoint.empty())
+        {
+            auto schedule =
+                edge_probe_testing::parse_fault_schedule(read_option(args, "--schedule"));
+            const int latency_ms = std::stoi(read_option(args, "--latency-ms", "0"));
+            server = config.unix_socket_path.empty()
+                         ? std::make_unique<edge_probe_testing::FakeVictoriaMetrics>(
+                               std::move(schedule), latency_ms)
+                         : std::make_unique<edge_probe_testing::FakeVictoriaMetrics>(
+                               std::move(schedule), latency_ms, config.unix_socket_path);
+            config.endpoint = server->url(remote_write ? "/api/v1/write" : "/api/v1/import");
+        }
+        config.compression = parse_compression(read_option(args, "--compression", "none"));
+        config.max_batch_samples = std::stoul(read_option(args, "--batch-samples", "500"));
+        config.flush_interval_ms = 1000;
+        config.retry_initial_ms = 250;
+        config.retry_max_ms = 2000;
+        config.max_pending_payload_bytes = 1024 * 1024;
+        config.max_retry_queue_bytes = 16 * 1024 * 1024;
+        config.background_sender = has_flag(args, "--background-sender");
+
+        auto transport = std::make_shared<TimedTransport>(
+            make_transport(read_option(args, "--transport", "socket"),
+                           std::stoul(read_option(args, "--in-flight", "4"))));
+        edge_probe::TelemetryWriter writer(config, transport);
+
+        std::vector<edge_probe::LabelSet> labels;
+        for (std::size_t i = 0; i < series; ++i)
+        {
+            labels.push_back({{"device", "load-driver"}, {"series", std::to_string(i)}});
+        }
+
+        std::uint64_t offered = 0;
+        std::uint64_t accepted = 0;
+        std::uint64_t rejected = 0;
+        const int64_t cpu_start_us = process_cpu_time_us();
+        const auto start = SteadyClock::now();
+        const auto stop = start + std::chrono::seconds(duration_sec);
+        for (auto now = start; now < stop; now = SteadyClock::now())
+        {
+            const double elapsed_sec = std::chrono::duration<double>(now - start).count();
+            const auto due = static_cast<std::uint64_t>(rate * elapsed_sec);
+            std::vector<edge_probe::MetricSample> batch;
+            batch.reserve(due - offered);
+            for (; offered < due; ++offered)
+            {
+                batch.push_back({"edge_load_test_value",
+                                 static_cast<double>(offered),
+                                 labels[offered % series],
+                                 0});
+            }
+            const auto result = writer.submit_batch(std::move(batch));
+            accepted += result.accepted;
+            rejected += result.dropped;
+            writer.tick();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        writer.force_flush();
+        const auto drain_stop = SteadyClock::now() + std::chrono::seconds(drain_sec);
+        while ((writer.queued_payloads() > 0 || writer.has_pending_payload()) &&
+               SteadyClock::now() < drain_stop)
+        {
+            writer.wait_idle();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            writer.tick();
+        }
+        writer.wait_idle();
+        const double elapsed_sec =
+            std::chrono::duration<double>(SteadyClock::now() - start).count();
+        int64_t cpu_us = process_cpu_time_us() - cpu_start_us;
+
+        const auto latencies = transport->latencies_us();
+        std::cout << "transport=" << read_option(args, "--transport", "socket") << '\n'
+                  << "elapsed_sec=" << elapsed_sec << '\n'
+                  << "offered_samples=" << offered << '\n'
+                  << "accepted_samples=" << accepted << '\n'
+                  << "rejected_samples=" << rejected << '\n'
+                  << "dropped_samples=" << writer.dropped_samples() << '\n'
+                  << "dropped_batches=" << writer.dropped_batches() << '\n'
+                  << "sent_batches=" << writer.sent_batches() << '\n'
+                  << "send_failures=" << writer.send_failures() << '\n'
+                  << "queued_payloads_left=" << writer.queued_payloads() << '\n'
+                  << "posts=" << latencies.size() << '\n'
+                  << "post_p50_ms=" << percentile_ms(latencies, 0.50) << '\n'
+                  << "post_p99_ms=" << percentile_ms(latencies, 0.99) << '\n';
+        if (server)
+        {
+            // The in-process endpoint's own CPU is not charged to the sender.
+            const auto stats = server->stats();
+            cpu_us -= stats.cpu_time_us;
+            std::cout << "server_requests=" << stats.requests << '\n'
+                      << "server_errors=" << stats.error_responses << '\n'
+                      << "server_resets=" << stats.resets << '\n'
+                      << "server_rejected_bodies=" << stats.rejected_bodies << '\n'
+                      << "server_series=" << stats.series << '\n'
+                      << "delivered_points=" << stats.points << '\n'
+                      << "delivered_points_per_sec="
+                      << static_cast<double>(stats.points) / elapsed_sec << '\n';
+        }
+        std::cout << "cpu_us_per_sample="
+                  << (accepted == 0 ? 0.0
+                                    : static_cast<double>(cpu_us) / static_cast<double>(accepted))
+                  << '\n';
+        return 0;
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << "fatal: " << ex.what() << '\n';
+        return 1;
+    }
+}